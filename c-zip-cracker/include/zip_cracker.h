@@ -22,10 +22,38 @@ typedef enum {
     ATTACK_DICTIONARY,
     ATTACK_BRUTEFORCE,
     ATTACK_CRC32,
-    ATTACK_HYBRID
+    ATTACK_HYBRID,
+    ATTACK_PLAINTEXT
 } attack_mode_t;
 
-// 压缩包信息结构
+// 内存中的压缩包映像：启动时读入一次，所有线程只读共享
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    bool mapped;                   // mmap映射，否则为malloc的副本
+} archive_image_t;
+
+// 文件条目信息
+typedef struct {
+    char *filename;
+    uint32_t crc32;
+    uint64_t compressed_size;
+    uint64_t uncompressed_size;
+    bool is_encrypted;
+    uint16_t compression_method;   // 仅ZIP，AES条目为实际压缩方法
+    uint16_t encryption_method;    // 仅ZIP，取值同libzip的ZIP_EM_*
+    uint16_t flags;                // 仅ZIP：中央目录中的通用标志
+    uint16_t local_flags;          // 仅ZIP：本地文件头中的通用标志
+    uint16_t mod_time;             // 仅ZIP：DOS修改时间，带数据描述符时提供校验字节
+    bool fake_encrypted;           // 仅ZIP：带加密标志但数据并未加密
+    uint64_t central_offset;       // 仅ZIP：中央目录记录在文件中的位置（已修正自解压前缀）
+    uint64_t local_header_offset;  // 仅ZIP：本地文件头在文件中的位置（已修正自解压前缀）
+    uint64_t data_offset;          // 仅ZIP：数据在文件中的位置
+    uint8_t salt[16];              // RAR/7z：条目或所在文件夹的加密盐
+    uint8_t salt_len;
+} file_entry_t;
+
+// 压缩包模型：每个目标只解析一次，创建后只读，各阶段通过引用计数共享
 typedef struct {
     char *filename;
     archive_type_t type;
@@ -33,27 +61,467 @@ typedef struct {
     bool has_fake_encryption;
     uint32_t file_count;
     uint64_t total_size;
+    bool headers_encrypted;        // RAR/7z：文件列表本身被加密，条目信息不可见
+    uint8_t header_salt[16];       // 加密头使用的盐
+    uint8_t header_salt_len;
+    file_entry_t *entries;
+    uint32_t entry_capacity;
+    archive_image_t *image;        // 内存映像，确认阶段的读取句柄也建立在它上面
+    int refcount;
 } archive_info_t;
 
-// 文件条目信息
+// ZipCrypto密钥状态
+typedef struct {
+    uint32_t key0;
+    uint32_t key1;
+    uint32_t key2;
+} zip_crypto_keys_t;
+
+// ZipCrypto加密条目（缓存12字节加密头）
 typedef struct {
     char *filename;
+    uint64_t local_header_offset;
+    uint64_t data_offset;
+    uint64_t compressed_size;
+    uint64_t uncompressed_size;
     uint32_t crc32;
+    uint16_t flags;
+    uint16_t compression_method;
+    uint16_t mod_time;
+    uint8_t check_byte;
+    uint8_t header[12];
+} zip_crypto_entry_t;
+
+// ZipCrypto批量校验内核
+typedef enum {
+    ZC_KERNEL_SCALAR,
+    ZC_KERNEL_AVX2,
+    ZC_KERNEL_AVX512
+} zip_crypto_kernel_t;
+
+// 每批校验的密码数量
+#define ZIP_CRYPTO_BATCH_SIZE 64
+
+// 由内部密钥反推密码的最大长度
+#define MAX_KEY_PASSWORD_LENGTH 32
+#define DEFAULT_KEY_PASSWORD_LENGTH 10
+
+// 多路SHA哈希的最大路数（AVX-512）
+#define SHA_MAX_LANES 16
+
+// 多路流式哈希的算法
+typedef enum {
+    SHA_ALGO_SHA1,
+    SHA_ALGO_SHA256
+} sha_algo_t;
+
+// 多路流式SHA-1/SHA-256：各路输入等长，状态和消息字按[字][路]转置存放
+typedef struct {
+    sha_algo_t algo;
+    zip_crypto_kernel_t kernel;
+    int lanes;
+    size_t fill;
+    uint64_t total;
+    uint8_t block[SHA_MAX_LANES][64];
+    uint32_t words[16][SHA_MAX_LANES];
+    uint32_t state[8][SHA_MAX_LANES];
+} sha_lanes_t;
+
+// ZipCrypto校验上下文（每个目标只解析一次）
+typedef struct {
+    zip_crypto_entry_t *entries;   // 按代价模型排序，前cascade_count个参与级联校验
+    uint32_t entry_count;
+    uint32_t cascade_count;
+    zip_crypto_kernel_t kernel;
+    const archive_image_t *image;  // 二阶段验证直接读取共享映像中的密文
+} zip_crypto_ctx_t;
+
+// WinZip AES加密条目（缓存盐和2字节密码校验值）
+typedef struct {
+    char *filename;
+    uint64_t local_header_offset;
+    uint64_t data_offset;
     uint64_t compressed_size;
     uint64_t uncompressed_size;
-    bool is_encrypted;
-} file_entry_t;
+    uint32_t crc32;
+    uint16_t vendor_version;
+    uint16_t actual_method;
+    uint8_t strength;
+    uint8_t key_len;
+    uint8_t salt_len;
+    uint8_t salt[16];
+    uint16_t verifier;
+    int pbkdf2_block;
+    int verifier_offset;
+} zip_aes_entry_t;
+
+// WinZip AES校验上下文
+typedef struct {
+    zip_aes_entry_t *entries;
+    uint32_t entry_count;
+    zip_crypto_kernel_t kernel;
+    const archive_image_t *image;
+} zip_aes_ctx_t;
+
+// 7zAES之后的下一个编码器（决定首块结构检查方式）
+typedef enum {
+    SZ_CODER_COPY,
+    SZ_CODER_LZMA,
+    SZ_CODER_LZMA2,
+    SZ_CODER_OTHER
+} sevenzip_coder_t;
+
+// 7zAES密码转为UTF-16LE后的最大字节数
+#define MAX_PASSWORD_UTF16_BYTES 256
+
+// 7z中选定的AES加密流（加密的头或代价最低的文件夹）
+typedef struct {
+    uint8_t num_cycles_power;      // 密钥派生做2^N次SHA-256输入
+    uint8_t salt_len;
+    uint8_t salt[16];
+    uint8_t iv[16];
+    uint64_t pack_offset;
+    uint64_t pack_size;
+    uint64_t aes_size;             // AES解密输出的有效长度
+    sevenzip_coder_t next_coder;
+    uint8_t coder_props[5];
+    uint8_t coder_props_len;
+    bool direct;                   // AES之后只有一个可流式解码的编码器
+    uint64_t unpack_size;
+    uint64_t check_size;           // 计算CRC的输出长度（第一个子流或整个头）
+    uint32_t check_crc;
+    bool has_crc;
+    uint8_t first_block[16];
+    uint8_t last_blocks[32];
+    bool is_header;
+} sevenzip_stream_t;
+
+// 7z AES校验上下文
+typedef struct {
+    sevenzip_stream_t stream;
+    zip_crypto_kernel_t kernel;
+    const archive_image_t *image;
+} sevenzip_ctx_t;
+
+// RAR5加密参数（加密头或第一个加密文件）
+typedef struct {
+    uint8_t kdf_log2;              // PBKDF2迭代次数为2^N
+    uint8_t salt[16];
+    uint8_t iv[16];
+    bool has_check;                // 有8字节密码校验值时无需解密
+    uint8_t check[8];
+    bool is_header;                // 整个头部被加密（-hp）
+    uint8_t method;                // 文件压缩方法，0为存储
+    uint64_t comp_info;            // 压缩信息：算法版本、固实标志、方法和字典大小
+    bool has_crc;
+    uint32_t data_crc;
+    bool has_blake2;               // 没有CRC时文件记录BLAKE2sp摘要
+    uint8_t blake2[32];
+    bool use_mac;                  // 校验和经过HashKey的HMAC变换
+    bool split;                    // 文件数据延续到下一卷
+    uint64_t unpacked_size;
+    uint8_t cipher[256];           // 加密头开头或文件数据第一个块的密文
+    size_t cipher_len;
+    const archive_image_t *image;
+    size_t data_offset;            // 完整密文在映像中的位置，供第二阶段解密
+    uint64_t data_size;
+    zip_crypto_kernel_t kernel;
+} rar5_ctx_t;
+
+// RAR3/RAR4加密参数（加密头或第一个AES加密文件）
+typedef struct {
+    bool has_salt;
+    uint8_t salt[8];
+    bool is_header;                // 整个头部被加密（-hp）
+    uint8_t method;                // 0x30为存储
+    uint8_t unp_ver;
+    uint32_t file_crc;
+    uint64_t unpacked_size;
+    uint64_t pack_size;
+    uint8_t cipher[256];           // 加密头开头或文件数据开头的密文
+    size_t cipher_len;
+    const archive_image_t *image;
+    size_t data_offset;            // 完整密文（或第一个加密头）在映像中的位置，供第二阶段解密
+    zip_crypto_kernel_t kernel;
+} rar3_ctx_t;
+
+// 第一阶段通过的口令派生出的AES密钥和IV，第二阶段直接使用
+typedef struct {
+    uint8_t key[16];
+    uint8_t iv[16];
+} rar3_key_t;
+
+// 第二阶段验证结果
+typedef enum {
+    ZIP_VERIFY_OK,
+    ZIP_VERIFY_FAIL,
+    ZIP_VERIFY_UNSUPPORTED
+} zip_verify_result_t;
+
+// 已知明文（连续部分 + 可选的分散字节）
+typedef struct {
+    char *entry_name;
+    uint8_t *data;
+    size_t size;
+    int64_t offset;          // 相对加密头之后的数据起点，-1为加密头的校验字节
+    size_t extra_count;
+    int64_t *extra_offsets;
+    uint8_t *extra_bytes;
+    const char *source;
+} known_plaintext_t;
 
 // 攻击状态
 typedef struct {
     bool stop;
     uint64_t tried_passwords;
     uint64_t total_passwords;
+    bool total_estimated;          // 总数还是估计值，后台计数完成后变为精确值
     time_t start_time;
     char *current_password;
     pthread_mutex_t lock;
 } attack_status_t;
 
+// 每个线程复用的读取句柄，校验一个密码只需换密码并读第一个加密条目
+typedef struct {
+    const archive_image_t *image;
+    archive_type_t type;
+    struct zip *zip;               // ZIP：打开一次的libzip句柄
+    int64_t zip_index;             // 验证代价最低的加密条目
+} archive_reader_t;
+
+// 解压到内存时的一个条目（目录的data为NULL）
+typedef struct {
+    char *name;
+    uint8_t *data;
+    size_t size;
+} extracted_file_t;
+
+// 掩码的位置数上限和自定义字符集数量（?1-?4）
+#define MASK_MAX_LENGTH      64
+#define MASK_CUSTOM_CHARSETS 4
+
+// 一个位置可取的字符
+typedef struct {
+    uint8_t chars[256];
+    uint16_t size;
+} mask_charset_t;
+
+// 一个固定长度的掩码，增量模式下每个长度是一条
+typedef struct {
+    uint16_t sets[MASK_MAX_LENGTH];  // 每个位置在字符集池中的下标
+    int length;
+    uint64_t keyspace;
+    uint64_t offset;                 // 在整个队列中的起始下标
+} mask_t;
+
+// 按顺序排队的掩码，字符集去重后共用
+typedef struct {
+    mask_charset_t *charsets;
+    uint32_t charset_count;
+    mask_t *masks;
+    uint32_t count;
+    uint64_t keyspace;
+} mask_list_t;
+
+// 掩码游标：按下标定位一次，之后逐个做里程表式递增，不分配内存
+typedef struct {
+    const mask_list_t *list;
+    uint32_t mask;
+    uint64_t remaining;
+    bool started;
+    uint16_t digits[MASK_MAX_LENGTH];
+    char password[MASK_MAX_LENGTH + 1];
+} mask_cursor_t;
+
+// Markov生成器：按位置训练字符转移表，每个转移的概率量化成0到MARKOV_LEVELS-1级（0级最可能），
+// 候选按各位置级别之和从小到大枚举
+#define MARKOV_MAX_LENGTH 16
+#define MARKOV_LEVELS     11
+
+// 一组候选：长度和级别之和都相同，组内按前缀的级别排序
+typedef struct {
+    uint16_t level;
+    uint16_t length;
+    uint64_t keyspace;
+    uint64_t offset;               // 在整个候选空间中的起始下标
+} markov_group_t;
+
+// 训练好的Markov模型，字符按训练中出现过的字节重新编号
+typedef struct {
+    uint8_t chars[256];
+    uint32_t char_count;
+    uint8_t *levels;               // [位置][前一个字符（char_count表示开头）][字符] 的级别
+    uint8_t *successors;           // 同样的形状，每个上下文的字符按级别从小到大排序
+    uint64_t *completions[MARKOV_MAX_LENGTH + 1];  // 每个长度：[位置][前一个字符][剩余级别] 的补全数
+    int max_level;                 // 补全表覆盖的最大级别
+    int min_length;
+    int max_length;
+    int threshold;                 // 候选的级别之和上限
+    markov_group_t *groups;
+    uint32_t group_count;
+    uint64_t keyspace;
+} markov_model_t;
+
+// Markov游标：按下标定位一次，之后在组内逐个递增，不分配内存
+typedef struct {
+    const markov_model_t *model;
+    uint32_t group;
+    uint64_t remaining;
+    bool started;
+    uint16_t ranks[MARKOV_MAX_LENGTH];       // 每个位置选的是第几个后继
+    uint8_t symbols[MARKOV_MAX_LENGTH];      // 每个位置的字符编号
+    uint16_t budget[MARKOV_MAX_LENGTH + 1];  // 每个位置之前剩余的级别
+    char password[MARKOV_MAX_LENGTH + 1];
+} markov_cursor_t;
+
+// 候选密码的最大字节数，批次为每个密码预留固定存储
+#define MAX_CANDIDATE_LENGTH 255
+
+// 一批候选密码，在取下一批之前有效。passwords指向storage或直接指向字典的映射，
+// 不保证以\0结尾，长度以lens为准
+typedef struct {
+    const char *passwords[ZIP_CRYPTO_BATCH_SIZE];
+    size_t lens[ZIP_CRYPTO_BATCH_SIZE];
+    char storage[ZIP_CRYPTO_BATCH_SIZE][MAX_CANDIDATE_LENGTH + 1];
+    int count;
+} password_batch_t;
+
+// 载入内存的词表：按长度分桶紧密存放，长度为L的第k个词位于 data + bucket_offset[L] + k * L
+typedef struct {
+    char *data;
+    uint64_t count;
+    uint64_t bucket_count[MAX_CANDIDATE_LENGTH + 1];
+    uint64_t bucket_offset[MAX_CANDIDATE_LENGTH + 1];
+    int min_length;                // 非空桶的长度范围
+    int max_length;
+} word_list_t;
+
+// 组合攻击：左字典的每个词依次接上每个分隔符，再接上右字典的每个词
+typedef struct {
+    word_list_t *right;
+    char **separators;
+    size_t *separator_lens;
+    uint32_t separator_count;
+    uint64_t per_word;             // 左字典每个词组合出的候选数
+} combinator_t;
+
+// PRINCE生成器：把同一个词表中的词首尾相接成链，按候选长度、同长度按链的候选数从少到多枚举
+#define PRINCE_MAX_LENGTH   32
+#define PRINCE_MAX_ELEMENTS 8
+
+// 一条链：依次拼接的元素长度，候选数是各长度词数之积
+typedef struct {
+    uint8_t lengths[PRINCE_MAX_ELEMENTS];
+    uint8_t count;                 // 元素个数
+    uint8_t length;                // 候选长度
+    uint64_t keyspace;
+    uint64_t offset;               // 在整个候选空间中的起始下标
+} prince_chain_t;
+
+// 元素词表和排好序的链
+typedef struct {
+    word_list_t *elements;
+    prince_chain_t *chains;
+    uint64_t chain_count;
+    uint64_t keyspace;
+    int min_length;
+    int max_length;
+    int max_elements;
+} prince_model_t;
+
+// PRINCE游标：按下标定位一次，之后链内最后一个元素变化最快地逐个递增，只重写变化的元素
+typedef struct {
+    const prince_model_t *model;
+    uint64_t chain;
+    uint64_t remaining;
+    bool started;
+    uint64_t digits[PRINCE_MAX_ELEMENTS];      // 每个元素在所在长度桶中的下标
+    uint8_t positions[PRINCE_MAX_ELEMENTS];    // 每个元素在候选中的起点
+    char password[PRINCE_MAX_LENGTH + 1];
+} prince_cursor_t;
+
+// 预编译字典（compile-dict）：去重后按长度分桶紧密存放，按本机字节序写出
+#define DICT_COMPILED_MAGIC "ZCDICT1"
+#define DICT_COMPILED_VERSION 1
+#define DICT_COMPILED_BUCKETS (MAX_CANDIDATE_LENGTH + 1)
+
+// 预编译字典的枚举顺序
+typedef enum {
+    DICT_ORDER_INPUT,              // 第一次出现的顺序
+    DICT_ORDER_FREQUENCY,          // 在所有输入中出现的次数从多到少
+    DICT_ORDER_LENGTH              // 按长度桶依次枚举，不需要顺序表
+} dict_order_t;
+
+// 预编译字典的文件头，长度为L的第k个条目位于 bucket_offset[L] + k * L
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t order;                // dict_order_t
+    uint64_t entry_count;
+    uint64_t order_offset;         // 顺序表（条目下标数组）的偏移，按长度枚举时为0
+    uint64_t bucket_first[DICT_COMPILED_BUCKETS + 1];  // 每个长度桶第一个条目的下标
+    uint64_t bucket_offset[DICT_COMPILED_BUCKETS];     // 每个长度桶的数据偏移
+} dict_compiled_header_t;
+
+// 规则的一条指令：操作符是规则语法中的字符，位置参数已解码成数值
+typedef struct {
+    uint8_t op;
+    uint8_t a;
+    uint8_t b;
+} rule_insn_t;
+
+// 解析好的规则集（hashcat/John规则语法），所有规则的指令首尾相接存放
+typedef struct {
+    rule_insn_t *code;
+    uint32_t *offsets;             // 第i条规则是code[offsets[i], offsets[i + 1])
+    uint32_t count;
+} rule_set_t;
+
+// 字典文件的压缩格式，按文件开头的魔数识别
+typedef enum {
+    DICT_PLAIN,
+    DICT_GZIP,
+    DICT_BZIP2,
+    DICT_XZ,
+    DICT_ZSTD
+} dict_compression_t;
+
+// 压缩字典的后台解压流
+typedef struct dict_stream dict_stream_t;
+
+// 多个线程共享的字典：整个文件只读映射，切块后空闲的线程用原子游标领取下一块。
+// 文本字典按字节区间切块，预编译字典按条目下标切块，压缩字典由后台线程解压成块排队领取
+typedef struct {
+    const char *data;              // 空文件和压缩字典为NULL
+    uint64_t size;
+    uint64_t chunk_size;
+    uint64_t next_offset;          // 下一块的起始偏移（预编译字典为条目下标），原子递增
+    bool use_avx2;                 // 换行符扫描使用AVX2
+    const dict_compiled_header_t *compiled;  // 文本字典为NULL
+    const uint64_t *order;         // 预编译字典的顺序表，按长度枚举时为NULL
+    dict_compression_t compression;
+    dict_stream_t *stream;         // 压缩字典的解压流
+    uint64_t counted_bytes;        // 后台计数已经数过的字节数
+    uint64_t counted_lines;
+} dict_source_t;
+
+// 一个线程领到的字典块：映射中从块内开始的完整行，换行符按64字节一组做成位图；
+// 预编译字典则是一段条目下标
+typedef struct {
+    const char *data;
+    size_t len;
+    size_t pos;                    // 下一行的开头
+    size_t scan;                   // 下一组尚未扫描的位置
+    size_t base;                   // 当前位图对应的组的起点
+    uint64_t newlines;             // 当前组里还没有取走的换行符
+    bool use_avx2;
+    const dict_source_t *compiled; // 预编译字典的来源，文本字典为NULL
+    uint64_t index;                // 预编译字典：下一个条目的下标
+    uint64_t end;
+    dict_stream_t *stream;         // 压缩字典：持有一个解压块，领取下一块时归还
+    int block;
+} dict_chunk_t;
+
 // 线程池配置
 typedef struct {
     int thread_count;
@@ -62,6 +530,25 @@ typedef struct {
     char *target_file;
     char *dict_file;
     attack_mode_t mode;
+    zip_crypto_ctx_t *zip_crypto;
+    zip_aes_ctx_t *zip_aes;
+    sevenzip_ctx_t *sevenzip;
+    rar5_ctx_t *rar5;
+    rar3_ctx_t *rar3;
+    archive_info_t *info;           // 共享的压缩包模型（持有一个引用）
+    known_plaintext_t *plaintext;   // 用户提供的已知明文
+    bool has_keys;
+    zip_crypto_keys_t keys;         // 已知明文攻击恢复或用户指定的内部密钥
+    char *charset;                  // 由密钥反推密码时的字符集
+    int max_length;                 // 由密钥反推密码的最大长度
+    const char *output_dir;         // 解压目录，"-"表示写到标准输出
+    bool extract_test;              // 只解压到内存检查，不写文件
+    char *found_password;           // 破解出的密码，攻击线程都结束后用它解压
+    mask_list_t *masks;             // 暴力破解使用的掩码队列，为空时用1-8位数字
+    rule_set_t *rules;              // 字典攻击的规则，为空时只尝试原词
+    markov_model_t *markov;         // 暴力破解改用Markov模型时不为空，优先于掩码
+    prince_model_t *prince;         // 暴力破解改用PRINCE链时不为空，优先于掩码
+    combinator_t *combinator;       // 字典攻击改为组合攻击时不为空，字典作为左字典
 } thread_pool_t;
 
 // 函数声明
@@ -69,30 +556,186 @@ typedef struct {
 // 压缩包分析
 archive_type_t detect_archive_type(const char *filename);
 archive_info_t* analyze_archive(const char *filename);
+archive_info_t* archive_info_retain(archive_info_t *info);
+file_entry_t* archive_info_add_entry(archive_info_t *info);
 bool is_archive_encrypted(const char *filename, archive_type_t type);
 bool has_fake_encryption(const char *filename);
-bool fix_fake_encryption(const char *filename, const char *output_filename);
+bool fix_fake_encryption(const archive_info_t *info, const char *output_filename);
 void free_archive_info(archive_info_t *info);
 
 // 密码生成和字典
 typedef struct password_generator password_generator_t;
 password_generator_t* create_dict_generator(const char *dict_file);
+password_generator_t* create_shared_dict_generator(dict_source_t *source, const rule_set_t *rules);
 password_generator_t* create_numeric_generator(int min_len, int max_len);
+password_generator_t* create_alpha_generator(int min_len, int max_len, bool include_uppercase);
+password_generator_t* create_alphanum_generator(int min_len, int max_len);
+password_generator_t* create_mask_generator(const mask_list_t *list, uint64_t start, uint64_t count);
+password_generator_t* create_markov_generator(const markov_model_t *model, uint64_t start, uint64_t count);
+password_generator_t* create_prince_generator(const prince_model_t *model, uint64_t start, uint64_t count);
+password_generator_t* create_combinator_generator(dict_source_t *source, const combinator_t *comb);
 char* get_next_password(password_generator_t *gen);
+int fill_password_batch(password_generator_t *gen, password_batch_t *batch);
 void free_password_generator(password_generator_t *gen);
 uint64_t count_passwords_in_dict(const char *dict_file);
 
+// 共享字典
+dict_source_t* dict_source_open(const char *dict_file, int readers);
+bool dict_source_next_chunk(dict_source_t *source, dict_chunk_t *chunk);
+bool dict_chunk_next_line(dict_chunk_t *chunk, const char **line, size_t *len);
+uint64_t dict_source_count_lines(const dict_source_t *source, int threads);
+uint64_t dict_source_estimate_lines(const dict_source_t *source, bool *exact);
+bool dict_source_refine(dict_source_t *source, uint64_t *estimate);
+bool dict_compile(const char *const *inputs, int input_count, const char *output, dict_order_t order);
+
+// 压缩字典
+dict_compression_t dict_detect_compression(int fd);
+const char* dict_compression_name(dict_compression_t type);
+dict_stream_t* dict_stream_open(int fd, dict_compression_t type, int readers);
+bool dict_stream_next_chunk(dict_stream_t *stream, dict_chunk_t *chunk);
+uint64_t dict_stream_estimate_lines(dict_stream_t *stream, bool *exact);
+uint64_t dict_stream_count_lines(dict_stream_t *stream);
+bool dict_stream_refine(dict_stream_t *stream, uint64_t *estimate);
+void dict_stream_close(dict_stream_t *stream);
+void dict_source_close(dict_source_t *source);
+
+// Markov生成器
+markov_model_t* markov_train(const char *train_file, int min_len, int max_len, int threshold);
+bool markov_cursor_init(markov_cursor_t *cursor, const markov_model_t *model, uint64_t start, uint64_t count);
+bool markov_cursor_next(markov_cursor_t *cursor, const char **password, size_t *len);
+void markov_model_free(markov_model_t *model);
+
+// 词表、组合攻击和PRINCE生成器
+word_list_t* word_list_load(const char *file, int max_len);
+void word_list_free(word_list_t *list);
+combinator_t* combinator_create(const char *right_file, const char *const *separators, int separator_count);
+void combinator_free(combinator_t *comb);
+prince_model_t* prince_build(const char *word_file, int min_len, int max_len, int max_elements);
+bool prince_cursor_init(prince_cursor_t *cursor, const prince_model_t *model, uint64_t start, uint64_t count);
+bool prince_cursor_next(prince_cursor_t *cursor, const char **password, size_t *len);
+void prince_model_free(prince_model_t *model);
+
+// 规则引擎
+rule_set_t* rule_set_load(const char *rule_file);
+int rule_apply(const rule_set_t *set, uint32_t index, const char *word, size_t len, char *out);
+void rule_set_free(rule_set_t *set);
+
+// 掩码攻击
+mask_list_t* mask_list_parse(const char *spec, const char *const custom[MASK_CUSTOM_CHARSETS],
+                             int min_len, int max_len);
+bool mask_list_candidate(const mask_list_t *list, uint64_t index, char *out, size_t *len);
+bool mask_cursor_init(mask_cursor_t *cursor, const mask_list_t *list, uint64_t start, uint64_t count);
+bool mask_cursor_next(mask_cursor_t *cursor, const char **password, size_t *len);
+void mask_list_free(mask_list_t *list);
+
 // CRC32攻击
 bool crc32_attack(const char *filename, uint32_t target_crc, int file_size, char *result);
 uint32_t calculate_crc32(const char *data, size_t len);
 
 // 暴力破解
-bool try_password(const char *archive_path, const char *password, archive_type_t type);
-bool extract_with_password(const char *archive_path, const char *password, 
-                          const char *output_dir, archive_type_t type);
+archive_image_t* archive_image_load(const char *filename);
+void archive_image_free(archive_image_t *image);
+bool archive_reader_init(archive_reader_t *reader, const archive_image_t *image, archive_type_t type);
+bool archive_reader_try(archive_reader_t *reader, const char *password);
+void archive_reader_close(archive_reader_t *reader);
+bool extract_with_password(const archive_info_t *info, const char *password, const char *output_dir);
+extracted_file_t* extract_to_memory(const archive_info_t *info, const char *password, uint32_t *count);
+void free_extracted_files(extracted_file_t *files, uint32_t count);
+
+// ZipCrypto原生校验
+zip_crypto_ctx_t* zip_crypto_load(const archive_info_t *info);
+bool zip_crypto_check_password(const zip_crypto_ctx_t *ctx, const char *password, size_t len);
+bool zip_crypto_check_cascade(const zip_crypto_ctx_t *ctx, const char *password, size_t len,
+                              uint32_t first);
+void zip_crypto_rank_entries(zip_crypto_ctx_t *ctx);
+void zip_crypto_print_plan(const zip_crypto_ctx_t *ctx);
+void zip_crypto_init_keys(zip_crypto_keys_t *keys, const char *password, size_t len);
+void zip_crypto_decrypt(zip_crypto_keys_t *keys, uint8_t *data, size_t len);
+void zip_crypto_free(zip_crypto_ctx_t *ctx);
+bool zip_crypto_decrypt_archive(const archive_info_t *info, const zip_crypto_keys_t *keys,
+                                const char *output_filename);
+const uint32_t* zip_crypto_get_crc_table(void);
+int zip_crypto_check_batch(const zip_crypto_ctx_t *ctx, const char *const *passwords,
+                           const size_t *lens, int count, bool *results);
+zip_crypto_kernel_t zip_crypto_select_kernel(void);
+const char* zip_crypto_kernel_name(zip_crypto_kernel_t kernel);
+void zip_crypto_benchmark(void);
+
+// WinZip AES原生校验
+zip_aes_ctx_t* zip_aes_load(const archive_info_t *info);
+bool zip_aes_check_password(const zip_aes_ctx_t *ctx, const char *password, size_t len);
+int zip_aes_check_batch(const zip_aes_ctx_t *ctx, const char *const *passwords,
+                        const size_t *lens, int count, bool *results);
+void zip_aes_benchmark(void);
+void zip_aes_free(zip_aes_ctx_t *ctx);
+
+// 多路SHA哈希
+int sha_kernel_lanes(zip_crypto_kernel_t kernel);
+void sha1_compress_words(uint32_t state[5], const uint32_t block[16], uint32_t tail[16]);
+void sha1_compress_lanes(zip_crypto_kernel_t kernel, int lanes, uint32_t state[][SHA_MAX_LANES],
+                         const uint32_t words[16][SHA_MAX_LANES]);
+void sha256_compress_lanes(zip_crypto_kernel_t kernel, int lanes, uint32_t state[8][SHA_MAX_LANES],
+                           const uint32_t words[16][SHA_MAX_LANES]);
+void sha_lanes_init(sha_lanes_t *l, sha_algo_t algo, zip_crypto_kernel_t kernel, int lanes);
+void sha_lanes_update(sha_lanes_t *l, const uint8_t *const *data, size_t len);
+void sha_lanes_final(sha_lanes_t *l, uint8_t digests[][32]);
+
+// 7z AES原生校验
+sevenzip_ctx_t* sevenzip_load(const archive_info_t *info);
+bool sevenzip_check_password(const sevenzip_ctx_t *ctx, const char *password, size_t len);
+int sevenzip_check_batch(const sevenzip_ctx_t *ctx, const char *const *passwords,
+                         const size_t *lens, int count, bool *results);
+zip_verify_result_t sevenzip_verify_password(const sevenzip_ctx_t *ctx,
+                                             const char *password, size_t len);
+void sevenzip_benchmark(void);
+void sevenzip_free(sevenzip_ctx_t *ctx);
+bool sevenzip_analyze(archive_info_t *info);
+
+// RAR5原生校验
+rar5_ctx_t* rar5_load(const archive_info_t *info);
+bool rar5_check_password(const rar5_ctx_t *ctx, const char *password, size_t len);
+int rar5_check_batch(const rar5_ctx_t *ctx, const char *const *passwords,
+                     const size_t *lens, int count, bool *results);
+zip_verify_result_t rar5_verify_password(const rar5_ctx_t *ctx, const char *password, size_t len);
+void rar5_benchmark(void);
+void rar5_free(rar5_ctx_t *ctx);
+bool rar5_analyze(archive_info_t *info);
+
+// RAR5/RAR3压缩数据解码，解出的数据按顺序交给回调
+typedef void (*rar_output_fn)(void *opaque, const uint8_t *data, size_t len);
+bool rar5_probe_block(const uint8_t *data, size_t size, uint64_t comp_info);
+zip_verify_result_t rar5_unpack(const uint8_t *data, size_t size, uint64_t comp_info, uint64_t unpacked_size,
+                                bool split, rar_output_fn output, void *opaque);
+
+// RAR3/RAR4原生校验
+rar3_ctx_t* rar3_load(const archive_info_t *info);
+bool rar3_check_password(const rar3_ctx_t *ctx, const char *password, size_t len);
+int rar3_check_batch(const rar3_ctx_t *ctx, const char *const *passwords,
+                     const size_t *lens, int count, bool *results, rar3_key_t *keys);
+zip_verify_result_t rar3_verify_key(const rar3_ctx_t *ctx, const rar3_key_t *key);
+zip_verify_result_t rar3_verify_password(const rar3_ctx_t *ctx, const char *password, size_t len);
+void rar3_benchmark(void);
+void rar3_free(rar3_ctx_t *ctx);
+bool rar3_analyze(archive_info_t *info);
+zip_verify_result_t rar3_unpack(const uint8_t *data, size_t size, uint64_t unpacked_size, bool partial,
+                                rar_output_fn output, void *opaque);
+
+// 第二阶段验证（流式解密/解压 + CRC32，AES比较HMAC）
+zip_verify_result_t zip_crypto_verify_password(const zip_crypto_ctx_t *ctx,
+                                               const char *password, size_t len);
+zip_verify_result_t zip_aes_verify_password(const zip_aes_ctx_t *ctx,
+                                            const char *password, size_t len);
+
+// 已知明文攻击
+bool plaintext_attack(thread_pool_t *pool, const known_plaintext_t *pt);
+known_plaintext_t** collect_known_plaintext(const zip_crypto_ctx_t *ctx, int *count);
+known_plaintext_t* load_known_plaintext(const char *plain_file, const char *entry_name, long offset);
+void free_known_plaintext(known_plaintext_t *pt);
+bool zip_crypto_recover_password(const zip_crypto_keys_t *keys, const char *charset, int max_length,
+                                 int thread_count, attack_status_t *status, char *password);
 
 // 多线程攻击
-thread_pool_t* create_thread_pool(int thread_count, const char *target_file, 
+thread_pool_t* create_thread_pool(int thread_count, archive_info_t *info, 
                                   const char *dict_file, attack_mode_t mode);
 void start_attack(thread_pool_t *pool);
 void stop_attack(thread_pool_t *pool);
@@ -108,8 +751,11 @@ int get_cpu_count(void);
 char* get_file_extension(const char *filename);
 bool file_exists(const char *filename);
 size_t get_file_size(const char *filename);
+void set_message_stream(FILE *stream);
+FILE* message_stream(void);
 void print_error(const char *format, ...);
 void print_info(const char *format, ...);
 void print_success(const char *format, ...);
+size_t utf8_to_utf16le(const char *password, size_t len, uint8_t *out, size_t max_bytes);
 
 #endif // ZIP_CRACKER_H
\ No newline at end of file
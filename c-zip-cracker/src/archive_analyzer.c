@@ -3,6 +3,47 @@
 #include <archive.h>
 #include <archive_entry.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <zlib.h>
+
+// ZIP结构签名和字段
+#define ZIP_LOCAL_HEADER_SIG    0x04034b50
+#define ZIP_CENTRAL_HEADER_SIG  0x02014b50
+#define ZIP_EOCD_SIG            0x06054b50
+#define ZIP64_EOCD_SIG          0x06064b50
+#define ZIP64_LOCATOR_SIG       0x07064b50
+#define ZIP_LOCAL_HEADER_SIZE   30
+#define ZIP_CENTRAL_HEADER_SIZE 46
+#define ZIP_EOCD_SIZE           22
+#define ZIP64_EOCD_SIZE         56
+#define ZIP64_LOCATOR_SIZE      20
+#define ZIP_MAX_COMMENT_SIZE    65535
+#define ZIP_FLAG_ENCRYPTED      0x0001
+#define ZIP_METHOD_STORE        0
+#define ZIP_METHOD_DEFLATE      8
+#define ZIP_METHOD_AES          99
+#define ZIP64_EXTRA_ID          0x0001
+#define ZIP_AES_EXTRA_ID        0x9901
+
+// 判断deflate条目是否伪加密时试解压的字节数
+#define FAKE_PROBE_SIZE 4096
+
+static uint16_t read_le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t read_le64(const uint8_t *p) {
+    return (uint64_t)read_le32(p) | ((uint64_t)read_le32(p + 4) << 32);
+}
 
 // 检测压缩包类型
 archive_type_t detect_archive_type(const char *filename) {
@@ -22,133 +63,266 @@ archive_type_t detect_archive_type(const char *filename) {
     return ARCHIVE_UNKNOWN;
 }
 
-// 分析ZIP文件
-static archive_info_t* analyze_zip(const char *filename) {
-    int err;
-    zip_t *archive = zip_open(filename, ZIP_RDONLY, &err);
-    if (!archive) {
-        print_error("无法打开ZIP文件: %s", filename);
-        return NULL;
+// 从尾部向前查找EOCD，注释长度必须与文件末尾吻合
+static bool find_eocd(const uint8_t *data, size_t size, size_t *eocd_pos) {
+    if (size < ZIP_EOCD_SIZE) {
+        return false;
     }
     
-    archive_info_t *info = calloc(1, sizeof(archive_info_t));
-    if (!info) {
-        zip_close(archive);
-        return NULL;
+    size_t lowest = size > ZIP_EOCD_SIZE + ZIP_MAX_COMMENT_SIZE ? size - ZIP_EOCD_SIZE - ZIP_MAX_COMMENT_SIZE : 0;
+    for (size_t i = size - ZIP_EOCD_SIZE + 1; i-- > lowest; ) {
+        if (read_le32(data + i) == ZIP_EOCD_SIG &&
+            i + ZIP_EOCD_SIZE + read_le16(data + i + 20) <= size) {
+            *eocd_pos = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 查找ZIP64 EOCD记录：先按定位器中的偏移找，自解压文件中再按紧挨定位器的位置找
+static bool find_zip64_eocd(const uint8_t *data, size_t eocd_pos, size_t *record_pos) {
+    if (eocd_pos < ZIP64_LOCATOR_SIZE + ZIP64_EOCD_SIZE) {
+        return false;
     }
     
-    info->filename = strdup(filename);
-    info->type = ARCHIVE_ZIP;
-    info->file_count = zip_get_num_entries(archive, 0);
-    info->total_size = 0;
-    info->is_encrypted = false;
-    info->has_fake_encryption = false;
-    
-    // 检查每个文件条目
-    for (zip_uint64_t i = 0; i < info->file_count; i++) {
-        zip_stat_t stat;
-        if (zip_stat_index(archive, i, 0, &stat) == 0) {
-            info->total_size += stat.size;
-            
-            // 检查加密标志
-            if (stat.encryption_method != ZIP_EM_NONE) {
-                info->is_encrypted = true;
-            }
-            
-            // 检查伪加密（通过标志位检测）
-            zip_file_t *file = zip_fopen_index(archive, i, 0);
-            if (!file && zip_get_error(archive)->zip_err == ZIP_ER_WRONGPASSWD) {
-                // 尝试读取文件头来检测伪加密
-                struct zip_stat st;
-                if (zip_stat_index(archive, i, ZIP_FL_UNCHANGED, &st) == 0) {
-                    if (st.size > 0 && st.size <= 8 && st.comp_size == st.size) {
-                        info->has_fake_encryption = true;
-                    }
+    const uint8_t *locator = data + eocd_pos - ZIP64_LOCATOR_SIZE;
+    if (read_le32(locator) != ZIP64_LOCATOR_SIG) {
+        return false;
+    }
+    
+    uint64_t recorded = read_le64(locator + 8);
+    if (recorded + ZIP64_EOCD_SIZE <= eocd_pos - ZIP64_LOCATOR_SIZE &&
+        read_le32(data + recorded) == ZIP64_EOCD_SIG) {
+        *record_pos = (size_t)recorded;
+        return true;
+    }
+    
+    size_t adjacent = eocd_pos - ZIP64_LOCATOR_SIZE - ZIP64_EOCD_SIZE;
+    if (read_le32(data + adjacent) == ZIP64_EOCD_SIG) {
+        *record_pos = adjacent;
+        return true;
+    }
+    return false;
+}
+
+// 从ZIP64扩展字段中取出被标记为0xFFFFFFFF的大小和偏移
+static void read_zip64_extra(const uint8_t *extra, size_t extra_len, uint64_t *uncompressed,
+                             uint64_t *compressed, uint64_t *local_offset) {
+    size_t pos = 0;
+    while (pos + 4 <= extra_len) {
+        uint16_t id = read_le16(extra + pos);
+        uint16_t len = read_le16(extra + pos + 2);
+        if (pos + 4 + len > extra_len) break;
+        
+        if (id == ZIP64_EXTRA_ID) {
+            const uint8_t *field = extra + pos + 4;
+            size_t off = 0;
+            uint64_t *values[3] = { uncompressed, compressed, local_offset };
+            for (int i = 0; i < 3; i++) {
+                if (*values[i] == 0xFFFFFFFF && off + 8 <= len) {
+                    *values[i] = read_le64(field + off);
+                    off += 8;
                 }
-            } else if (file) {
-                zip_fclose(file);
             }
+            return;
         }
+        pos += 4 + len;
+    }
+}
+
+// 查找AES扩展字段，返回加密强度并给出实际压缩方法
+static uint16_t read_aes_extra(const uint8_t *extra, size_t extra_len, uint16_t *method) {
+    size_t pos = 0;
+    while (pos + 4 <= extra_len) {
+        uint16_t id = read_le16(extra + pos);
+        uint16_t len = read_le16(extra + pos + 2);
+        if (pos + 4 + len > extra_len) break;
+        
+        if (id == ZIP_AES_EXTRA_ID && len >= 7) {
+            *method = read_le16(extra + pos + 9);
+            return extra[pos + 8];
+        }
+        pos += 4 + len;
+    }
+    return 0;
+}
+
+// 带加密标志的条目是否伪加密：AES一定是真加密；存储条目真加密时多出12字节加密头；
+// deflate条目试解压开头一段，能正常解压的数据不可能是ZipCrypto密文
+static bool entry_is_fake(const archive_image_t *image, const file_entry_t *entry) {
+    if (entry->encryption_method > ZIP_EM_TRAD_PKWARE) {
+        return false;
+    }
+    if ((entry->flags ^ entry->local_flags) & ZIP_FLAG_ENCRYPTED) {
+        return true;    // 本地头和中央目录不一致是最常见的伪加密
+    }
+    if (entry->data_offset + entry->compressed_size > image->size) {
+        return false;
+    }
+    if (entry->compression_method == ZIP_METHOD_STORE) {
+        return entry->compressed_size == entry->uncompressed_size;
+    }
+    if (entry->compression_method != ZIP_METHOD_DEFLATE) {
+        return false;
     }
     
-    zip_close(archive);
-    return info;
+    uint8_t out[FAKE_PROBE_SIZE];
+    size_t want = entry->compressed_size < FAKE_PROBE_SIZE ? (size_t)entry->compressed_size : FAKE_PROBE_SIZE;
+    
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+        return false;
+    }
+    strm.next_in = (Bytef *)(image->data + entry->data_offset);
+    strm.avail_in = (uInt)want;
+    
+    int ret;
+    do {
+        strm.next_out = out;
+        strm.avail_out = sizeof(out);
+        ret = inflate(&strm, Z_NO_FLUSH);
+    } while (ret == Z_OK && strm.avail_in > 0);
+    uLong total_out = strm.total_out;
+    inflateEnd(&strm);
+    
+    // 完整读入的流必须正常结束且长度一致，较长的流只要开头一段合法即可
+    if (ret == Z_STREAM_END) {
+        return total_out == entry->uncompressed_size;
+    }
+    return (ret == Z_OK || ret == Z_BUF_ERROR) && want < entry->compressed_size;
 }
 
-// 分析RAR文件（使用libarchive）
-static archive_info_t* analyze_rar(const char *filename) {
-    struct archive *a = archive_read_new();
-    archive_read_support_filter_all(a);
-    archive_read_support_format_rar(a);
+// 分析ZIP文件：直接遍历内存映像中的中央目录和本地文件头，支持ZIP64和自解压前缀
+static bool analyze_zip(archive_info_t *info) {
+    const uint8_t *data = info->image->data;
+    size_t size = info->image->size;
     
-    if (archive_read_open_filename(a, filename, 10240) != ARCHIVE_OK) {
-        print_error("无法打开RAR文件: %s", filename);
-        archive_read_free(a);
-        return NULL;
+    size_t eocd_pos;
+    if (!find_eocd(data, size, &eocd_pos)) {
+        print_error("无法打开ZIP文件: %s", info->filename);
+        return false;
     }
     
-    archive_info_t *info = calloc(1, sizeof(archive_info_t));
-    if (!info) {
-        archive_read_free(a);
-        return NULL;
+    uint64_t total_entries = read_le16(data + eocd_pos + 10);
+    uint64_t cd_size = read_le32(data + eocd_pos + 12);
+    uint64_t cd_offset = read_le32(data + eocd_pos + 16);
+    size_t cd_end = eocd_pos;
+    
+    size_t zip64_pos;
+    if (find_zip64_eocd(data, eocd_pos, &zip64_pos)) {
+        total_entries = read_le64(data + zip64_pos + 32);
+        cd_size = read_le64(data + zip64_pos + 40);
+        cd_offset = read_le64(data + zip64_pos + 48);
+        cd_end = zip64_pos;
     }
     
-    info->filename = strdup(filename);
-    info->type = ARCHIVE_RAR;
-    info->file_count = 0;
-    info->total_size = 0;
-    info->is_encrypted = false;
-    info->has_fake_encryption = false;
+    // 中央目录紧挨在结束记录之前，和记录的偏移之差就是自解压程序等前缀的长度
+    if (cd_size > cd_end) {
+        print_error("ZIP中央目录损坏: %s", info->filename);
+        return false;
+    }
+    uint64_t cd_start = cd_end - cd_size;
+    uint64_t prefix = cd_start >= cd_offset ? cd_start - cd_offset : 0;
     
-    struct archive_entry *entry;
-    while (archive_read_next_header(a, &entry) == ARCHIVE_OK) {
-        info->file_count++;
-        info->total_size += archive_entry_size(entry);
+    uint64_t capacity = cd_size / ZIP_CENTRAL_HEADER_SIZE;
+    if (total_entries < capacity) {
+        capacity = total_entries;
+    }
+    info->entries = calloc(capacity ? capacity : 1, sizeof(file_entry_t));
+    if (!info->entries) {
+        return false;
+    }
+    
+    uint64_t pos = cd_start;
+    while (info->file_count < capacity && pos + ZIP_CENTRAL_HEADER_SIZE <= cd_end &&
+           read_le32(data + pos) == ZIP_CENTRAL_HEADER_SIG) {
+        const uint8_t *rec = data + pos;
+        uint16_t name_len = read_le16(rec + 28);
+        uint16_t extra_len = read_le16(rec + 30);
+        size_t record_size = ZIP_CENTRAL_HEADER_SIZE + name_len + extra_len + read_le16(rec + 32);
+        if (pos + record_size > cd_end) break;
         
-        // 检查是否加密
-        if (archive_entry_is_encrypted(entry)) {
+        file_entry_t *entry = &info->entries[info->file_count++];
+        const uint8_t *extra = rec + ZIP_CENTRAL_HEADER_SIZE + name_len;
+        entry->filename = strndup((const char *)rec + ZIP_CENTRAL_HEADER_SIZE, name_len);
+        entry->flags = read_le16(rec + 8);
+        entry->compression_method = read_le16(rec + 10);
+        entry->mod_time = read_le16(rec + 12);
+        entry->crc32 = read_le32(rec + 16);
+        entry->compressed_size = read_le32(rec + 20);
+        entry->uncompressed_size = read_le32(rec + 24);
+        entry->central_offset = pos;
+        
+        uint64_t local_offset = read_le32(rec + 42);
+        read_zip64_extra(extra, extra_len, &entry->uncompressed_size, &entry->compressed_size, &local_offset);
+        entry->local_header_offset = local_offset + prefix;
+        
+        if (entry->flags & ZIP_FLAG_ENCRYPTED) {
+            entry->encryption_method = ZIP_EM_TRAD_PKWARE;
+            if (entry->compression_method == ZIP_METHOD_AES) {
+                uint16_t strength = read_aes_extra(extra, extra_len, &entry->compression_method);
+                entry->encryption_method = (uint16_t)(ZIP_EM_AES_128 - 1 + (strength ? strength : 3));
+            }
+        }
+        entry->is_encrypted = entry->encryption_method != ZIP_EM_NONE;
+        info->total_size += entry->uncompressed_size;
+        pos += record_size;
+        
+        // 检查加密标志
+        if (entry->is_encrypted) {
             info->is_encrypted = true;
         }
         
-        archive_read_data_skip(a);
+        // 本地文件头给出真正的数据位置和本地标志，用于伪加密检测
+        const uint8_t *local = data + entry->local_header_offset;
+        if (entry->local_header_offset + ZIP_LOCAL_HEADER_SIZE > size ||
+            read_le32(local) != ZIP_LOCAL_HEADER_SIG) {
+            continue;
+        }
+        entry->local_flags = read_le16(local + 6);
+        entry->data_offset = entry->local_header_offset + ZIP_LOCAL_HEADER_SIZE +
+                             read_le16(local + 26) + read_le16(local + 28);
+        
+        if (((entry->flags | entry->local_flags) & ZIP_FLAG_ENCRYPTED) && entry_is_fake(info->image, entry)) {
+            entry->fake_encrypted = true;
+            info->has_fake_encryption = true;
+        }
     }
     
-    archive_read_free(a);
-    return info;
+    return true;
 }
 
-// 分析7Z文件（使用libarchive）
-static archive_info_t* analyze_7z(const char *filename) {
+// 分析RAR/7Z文件（使用libarchive读取内存映像）
+static bool analyze_libarchive(archive_info_t *info) {
     struct archive *a = archive_read_new();
     archive_read_support_filter_all(a);
-    archive_read_support_format_7zip(a);
-    
-    if (archive_read_open_filename(a, filename, 10240) != ARCHIVE_OK) {
-        print_error("无法打开7Z文件: %s", filename);
-        archive_read_free(a);
-        return NULL;
+    if (info->type == ARCHIVE_RAR) {
+        archive_read_support_format_rar(a);
+    } else {
+        archive_read_support_format_7zip(a);
     }
     
-    archive_info_t *info = calloc(1, sizeof(archive_info_t));
-    if (!info) {
+    if (archive_read_open_memory(a, info->image->data, info->image->size) != ARCHIVE_OK) {
+        print_error("无法打开%s文件: %s", info->type == ARCHIVE_RAR ? "RAR" : "7Z", info->filename);
         archive_read_free(a);
-        return NULL;
+        return false;
     }
     
-    info->filename = strdup(filename);
-    info->type = ARCHIVE_7Z;
-    info->file_count = 0;
-    info->total_size = 0;
-    info->is_encrypted = false;
-    info->has_fake_encryption = false;
-    
     struct archive_entry *entry;
     while (archive_read_next_header(a, &entry) == ARCHIVE_OK) {
-        info->file_count++;
-        info->total_size += archive_entry_size(entry);
+        file_entry_t *item = archive_info_add_entry(info);
+        if (!item) break;
+        
+        const char *name = archive_entry_pathname(entry);
+        item->filename = strdup(name ? name : "");
+        item->uncompressed_size = (uint64_t)archive_entry_size(entry);
+        item->is_encrypted = archive_entry_is_encrypted(entry);
+        info->total_size += item->uncompressed_size;
         
         // 检查是否加密
-        if (archive_entry_is_encrypted(entry)) {
+        if (item->is_encrypted) {
             info->is_encrypted = true;
         }
         
@@ -156,28 +330,86 @@ static archive_info_t* analyze_7z(const char *filename) {
     }
     
     archive_read_free(a);
-    return info;
+    return true;
+}
+
+// 在模型末尾追加一个清零的条目，容量不足时倍增
+file_entry_t* archive_info_add_entry(archive_info_t *info) {
+    if (info->file_count == info->entry_capacity) {
+        uint32_t new_capacity = info->entry_capacity ? info->entry_capacity * 2 : 64;
+        file_entry_t *entries = realloc(info->entries, new_capacity * sizeof(file_entry_t));
+        if (!entries) return NULL;
+        info->entries = entries;
+        info->entry_capacity = new_capacity;
+    }
+    
+    file_entry_t *entry = &info->entries[info->file_count++];
+    memset(entry, 0, sizeof(file_entry_t));
+    return entry;
+}
+
+// 丢弃原生解析器留下的部分结果，换用libarchive重新分析
+static void reset_entries(archive_info_t *info) {
+    for (uint32_t i = 0; i < info->file_count; i++) {
+        free(info->entries[i].filename);
+    }
+    free(info->entries);
+    info->entries = NULL;
+    info->file_count = info->entry_capacity = 0;
+    info->total_size = 0;
+    info->is_encrypted = info->headers_encrypted = false;
+    info->header_salt_len = 0;
 }
 
-// 分析压缩包
+// 分析压缩包：读入内存映像并建立只读模型，引用计数为1
 archive_info_t* analyze_archive(const char *filename) {
     if (!filename || !file_exists(filename)) {
         return NULL;
     }
     
     archive_type_t type = detect_archive_type(filename);
+    if (type == ARCHIVE_UNKNOWN) {
+        print_error("不支持的压缩包格式");
+        return NULL;
+    }
     
-    switch (type) {
-        case ARCHIVE_ZIP:
-            return analyze_zip(filename);
-        case ARCHIVE_RAR:
-            return analyze_rar(filename);
-        case ARCHIVE_7Z:
-            return analyze_7z(filename);
-        default:
-            print_error("不支持的压缩包格式");
-            return NULL;
+    archive_info_t *info = calloc(1, sizeof(archive_info_t));
+    if (!info) return NULL;
+    
+    info->filename = strdup(filename);
+    info->type = type;
+    info->refcount = 1;
+    info->image = archive_image_load(filename);
+    if (!info->image) {
+        print_error("无法读取压缩包: %s", filename);
+        free_archive_info(info);
+        return NULL;
     }
+    
+    // RAR和7z只读头部块，不触碰数据区；原生解析不认识的变体再交给libarchive
+    bool ok;
+    if (type == ARCHIVE_ZIP) {
+        ok = analyze_zip(info);
+    } else {
+        ok = type == ARCHIVE_RAR ? rar5_analyze(info) || rar3_analyze(info) : sevenzip_analyze(info);
+        if (!ok) {
+            reset_entries(info);
+            ok = analyze_libarchive(info);
+        }
+    }
+    if (!ok) {
+        free_archive_info(info);
+        return NULL;
+    }
+    return info;
+}
+
+// 增加模型的引用
+archive_info_t* archive_info_retain(archive_info_t *info) {
+    if (info) {
+        __atomic_add_fetch(&info->refcount, 1, __ATOMIC_RELAXED);
+    }
+    return info;
 }
 
 // 检查压缩包是否加密
@@ -197,7 +429,7 @@ bool has_fake_encryption(const char *filename) {
         return false; // 只有ZIP支持伪加密检测
     }
     
-    archive_info_t *info = analyze_zip(filename);
+    archive_info_t *info = analyze_archive(filename);
     if (!info) return false;
     
     bool fake = info->has_fake_encryption;
@@ -205,66 +437,100 @@ bool has_fake_encryption(const char *filename) {
     return fake;
 }
 
-// 修复伪加密
-bool fix_fake_encryption(const char *filename, const char *output_filename) {
-    if (detect_archive_type(filename) != ARCHIVE_ZIP) {
-        return false;
+// 从文件复制len字节：优先copy_file_range在内核中完成，不支持时退回固定大小的缓冲区
+static bool copy_file_data(int in_fd, int out_fd, uint64_t len) {
+    loff_t in_off = 0, out_off = 0;
+    while ((uint64_t)in_off < len) {
+        ssize_t n = copy_file_range(in_fd, &in_off, out_fd, &out_off, (size_t)(len - (uint64_t)in_off), 0);
+        if (n > 0) continue;
+        if (n == 0) return false;
+        if (errno != EXDEV && errno != ENOSYS && errno != EINVAL && errno != EOPNOTSUPP) {
+            return false;
+        }
+        
+        // 跨文件系统或内核不支持，从当前位置起普通复制
+        size_t buffer_size = 1 << 20;
+        uint8_t *buffer = malloc(buffer_size);
+        if (!buffer) return false;
+        while ((uint64_t)in_off < len) {
+            size_t want = len - (uint64_t)in_off < buffer_size ? (size_t)(len - (uint64_t)in_off) : buffer_size;
+            ssize_t got = pread(in_fd, buffer, want, in_off);
+            if (got <= 0 || pwrite(out_fd, buffer, (size_t)got, out_off) != got) {
+                free(buffer);
+                return false;
+            }
+            in_off += got;
+            out_off += got;
+        }
+        free(buffer);
     }
-    
-    int err;
-    zip_t *source = zip_open(filename, ZIP_RDONLY, &err);
-    if (!source) {
+    return true;
+}
+
+// 修复伪加密：克隆原文件（reflink或copy_file_range），只清除伪加密条目在本地头和中央目录中的加密位；
+// 输出文件名与输入相同时直接原地修改
+bool fix_fake_encryption(const archive_info_t *info, const char *output_filename) {
+    if (!info || info->type != ARCHIVE_ZIP || !output_filename) {
         return false;
     }
     
-    zip_t *dest = zip_open(output_filename, ZIP_CREATE | ZIP_TRUNCATE, &err);
-    if (!dest) {
-        zip_close(source);
+    int in_fd = open(info->filename, O_RDONLY);
+    if (in_fd < 0) {
         return false;
     }
     
-    zip_uint64_t num_entries = zip_get_num_entries(source, 0);
+    bool in_place = strcmp(info->filename, output_filename) == 0;
+    int out_fd = in_place ? open(output_filename, O_RDWR) : open(output_filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    bool ok = out_fd >= 0;
     
-    for (zip_uint64_t i = 0; i < num_entries; i++) {
-        zip_stat_t stat;
-        if (zip_stat_index(source, i, 0, &stat) != 0) {
-            continue;
-        }
-        
-        // 读取文件数据
-        zip_file_t *file = zip_fopen_index(source, i, 0);
-        if (!file) continue;
-        
-        char *buffer = malloc(stat.size);
-        if (!buffer) {
-            zip_fclose(file);
+    if (ok && !in_place) {
+#ifdef FICLONE
+        ok = ioctl(out_fd, FICLONE, in_fd) == 0 || copy_file_data(in_fd, out_fd, info->image->size);
+#else
+        ok = copy_file_data(in_fd, out_fd, info->image->size);
+#endif
+    }
+    
+    // 只改写标志位所在的2字节，其余数据保持不变
+    int patched = 0;
+    for (uint32_t i = 0; i < info->file_count && ok; i++) {
+        const file_entry_t *entry = &info->entries[i];
+        if (!entry->fake_encrypted) {
             continue;
         }
         
-        zip_int64_t bytes_read = zip_fread(file, buffer, stat.size);
-        zip_fclose(file);
-        
-        if (bytes_read > 0) {
-            // 创建新的文件条目（移除加密标志）
-            zip_source_t *source_data = zip_source_buffer(dest, buffer, bytes_read, 1);
-            if (source_data) {
-                zip_file_add(dest, stat.name, source_data, ZIP_FL_OVERWRITE);
-            }
-        } else {
-            free(buffer);
-        }
+        uint8_t value[2];
+        value[0] = (uint8_t)(entry->flags & ~ZIP_FLAG_ENCRYPTED);
+        value[1] = (uint8_t)(entry->flags >> 8);
+        ok = pwrite(out_fd, value, 2, (off_t)entry->central_offset + 8) == 2;
+        value[0] = (uint8_t)(entry->local_flags & ~ZIP_FLAG_ENCRYPTED);
+        value[1] = (uint8_t)(entry->local_flags >> 8);
+        ok = ok && pwrite(out_fd, value, 2, (off_t)entry->local_header_offset + 6) == 2;
+        patched++;
     }
     
-    zip_close(dest);
-    zip_close(source);
+    if (out_fd >= 0 && close(out_fd) != 0) {
+        ok = false;
+    }
+    close(in_fd);
     
-    return true;
+    if (ok) {
+        print_info("已清除 %d 个条目的伪加密标志", patched);
+    }
+    return ok;
 }
 
-// 释放压缩包信息
+// 释放一个引用，最后一个引用释放整个模型
 void free_archive_info(archive_info_t *info) {
-    if (info) {
-        free(info->filename);
-        free(info);
+    if (!info || __atomic_sub_fetch(&info->refcount, 1, __ATOMIC_ACQ_REL) > 0) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < info->file_count; i++) {
+        free(info->entries[i].filename);
     }
+    free(info->entries);
+    archive_image_free(info->image);
+    free(info->filename);
+    free(info);
 }
\ No newline at end of file
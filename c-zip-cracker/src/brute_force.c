@@ -4,89 +4,174 @@
 #include <archive_entry.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-// 尝试使用密码解压ZIP文件
-static bool try_zip_password(const char *archive_path, const char *password) {
-    int err;
-    zip_t *archive = zip_open(archive_path, ZIP_RDONLY, &err);
-    if (!archive) {
-        return false;
+// 解压时每个线程的读写缓冲区
+#define EXTRACT_BUFFER_SIZE (1 << 20)
+#define EXTRACT_STDOUT      "-"
+
+// 解压目标
+typedef enum {
+    EXTRACT_TO_DISK,
+    EXTRACT_TO_MEMORY,
+    EXTRACT_TO_STDOUT
+} extract_target_t;
+
+// 把压缩包读入内存：优先mmap，失败时整体读入
+archive_image_t* archive_image_load(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
     }
     
-    // 设置密码
-    if (zip_set_default_password(archive, password) != 0) {
-        zip_close(archive);
-        return false;
+    archive_image_t *image = calloc(1, sizeof(archive_image_t));
+    if (!image) {
+        close(fd);
+        return NULL;
+    }
+    image->size = (size_t)st.st_size;
+    
+    void *map = mmap(NULL, image->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+        madvise(map, image->size, MADV_WILLNEED);
+        image->data = map;
+        image->mapped = true;
+    } else {
+        image->data = malloc(image->size);
+        size_t done = 0;
+        while (image->data && done < image->size) {
+            ssize_t n = pread(fd, image->data + done, image->size - done, (off_t)done);
+            if (n <= 0) break;
+            done += (size_t)n;
+        }
+        if (done != image->size) {
+            free(image->data);
+            free(image);
+            image = NULL;
+        }
     }
     
-    // 尝试读取第一个加密文件
+    close(fd);
+    return image;
+}
+
+// 释放内存映像
+void archive_image_free(archive_image_t *image) {
+    if (!image) return;
+    
+    if (image->mapped) {
+        munmap(image->data, image->size);
+    } else {
+        free(image->data);
+    }
+    free(image);
+}
+
+// 在libzip句柄上选择验证代价最低的加密条目：传统加密优先于AES，存储优先于压缩，其次按大小
+static zip_int64_t select_zip_entry(zip_t *archive) {
     zip_uint64_t num_entries = zip_get_num_entries(archive, 0);
-    bool success = false;
+    zip_int64_t best_index = -1;
+    zip_uint64_t best_cost = 0;
     
-    for (zip_uint64_t i = 0; i < num_entries && !success; i++) {
+    for (zip_uint64_t i = 0; i < num_entries; i++) {
         zip_stat_t stat;
-        if (zip_stat_index(archive, i, 0, &stat) == 0) {
-            if (stat.encryption_method != ZIP_EM_NONE) {
-                zip_file_t *file = zip_fopen_index(archive, i, 0);
-                if (file) {
-                    // 尝试读取一些数据来验证密码
-                    char buffer[1024];
-                    zip_int64_t bytes_read = zip_fread(file, buffer, sizeof(buffer));
-                    if (bytes_read >= 0) {
-                        success = true;
-                    }
-                    zip_fclose(file);
-                }
-            }
+        if (zip_stat_index(archive, i, 0, &stat) != 0 || stat.encryption_method == ZIP_EM_NONE) {
+            continue;
+        }
+        
+        zip_uint64_t cost = stat.comp_size;
+        if (stat.comp_method != ZIP_CM_STORE) {
+            cost *= 4;
+        }
+        if (stat.encryption_method != ZIP_EM_TRAD_PKWARE) {
+            cost += (zip_uint64_t)1 << 40;
+        }
+        
+        if (best_index < 0 || cost < best_cost) {
+            best_index = (zip_int64_t)i;
+            best_cost = cost;
         }
     }
-    
-    zip_close(archive);
-    return success;
+    return best_index;
 }
 
-// 尝试使用密码解压RAR文件
-static bool try_rar_password(const char *archive_path, const char *password) {
-    struct archive *a = archive_read_new();
-    archive_read_support_filter_all(a);
-    archive_read_support_format_rar(a);
-    archive_read_add_passphrase(a, password);
+// 在内存映像上打开一个libzip句柄，句柄之间互不共享状态
+static zip_t* open_zip_image(const archive_image_t *image) {
+    zip_error_t error;
+    zip_error_init(&error);
+    zip_source_t *source = zip_source_buffer_create(image->data, image->size, 0, &error);
+    if (!source) {
+        zip_error_fini(&error);
+        return NULL;
+    }
     
-    if (archive_read_open_filename(a, archive_path, 10240) != ARCHIVE_OK) {
-        archive_read_free(a);
+    zip_t *archive = zip_open_from_source(source, ZIP_RDONLY, &error);
+    zip_error_fini(&error);
+    if (!archive) {
+        zip_source_free(source);
+    }
+    return archive;
+}
+
+// 初始化线程自己的读取句柄：ZIP在内存映像上打开一次libzip并选好条目
+bool archive_reader_init(archive_reader_t *reader, const archive_image_t *image, archive_type_t type) {
+    if (!reader || !image) {
         return false;
     }
     
-    struct archive_entry *entry;
-    bool success = false;
+    memset(reader, 0, sizeof(archive_reader_t));
+    reader->image = image;
+    reader->type = type;
+    reader->zip_index = -1;
     
-    // 尝试读取第一个加密条目
-    while (archive_read_next_header(a, &entry) == ARCHIVE_OK) {
-        if (archive_entry_is_encrypted(entry)) {
-            // 尝试读取一些数据
-            char buffer[1024];
-            la_ssize_t bytes_read = archive_read_data(a, buffer, sizeof(buffer));
-            if (bytes_read >= 0) {
-                success = true;
-                break;
-            }
-        } else {
-            archive_read_data_skip(a);
+    if (type == ARCHIVE_ZIP) {
+        reader->zip = open_zip_image(image);
+        if (!reader->zip) {
+            return false;
         }
+        reader->zip_index = select_zip_entry(reader->zip);
+    }
+    return true;
+}
+
+// 完整读取选中的ZIP条目，libzip在读到结尾时会校验CRC
+static bool try_zip_password(archive_reader_t *reader, const char *password) {
+    if (!reader->zip || reader->zip_index < 0) {
+        return false;
     }
     
-    archive_read_free(a);
-    return success;
+    zip_file_t *file = zip_fopen_index_encrypted(reader->zip, (zip_uint64_t)reader->zip_index, 0, password);
+    if (!file) {
+        return false;
+    }
+    
+    char buffer[8192];
+    zip_int64_t bytes_read;
+    while ((bytes_read = zip_fread(file, buffer, sizeof(buffer))) > 0) {
+    }
+    zip_fclose(file);
+    return bytes_read == 0;
 }
 
-// 尝试使用密码解压7Z文件
-static bool try_7z_password(const char *archive_path, const char *password) {
+// 用libarchive从内存映像完整解出第一个加密条目（RAR/7Z），读到ARCHIVE_EOF才算通过
+static bool try_libarchive_password(archive_reader_t *reader, const char *password) {
     struct archive *a = archive_read_new();
     archive_read_support_filter_all(a);
-    archive_read_support_format_7zip(a);
+    if (reader->type == ARCHIVE_RAR) {
+        archive_read_support_format_rar(a);
+        archive_read_support_format_rar5(a);
+    } else {
+        archive_read_support_format_7zip(a);
+    }
     archive_read_add_passphrase(a, password);
     
-    if (archive_read_open_filename(a, archive_path, 10240) != ARCHIVE_OK) {
+    if (archive_read_open_memory(a, reader->image->data, reader->image->size) != ARCHIVE_OK) {
         archive_read_free(a);
         return false;
     }
@@ -94,267 +179,440 @@ static bool try_7z_password(const char *archive_path, const char *password) {
     struct archive_entry *entry;
     bool success = false;
     
-    // 尝试读取第一个加密条目
     while (archive_read_next_header(a, &entry) == ARCHIVE_OK) {
-        if (archive_entry_is_encrypted(entry)) {
-            // 尝试读取一些数据
-            char buffer[1024];
-            la_ssize_t bytes_read = archive_read_data(a, buffer, sizeof(buffer));
-            if (bytes_read >= 0) {
-                success = true;
-                break;
-            }
-        } else {
+        if (!archive_entry_is_encrypted(entry)) {
             archive_read_data_skip(a);
+            continue;
         }
+        
+        // 和ZIP一样解到条目结尾，libarchive在结尾校验CRC。不支持的加密方式
+        // （如RAR）会原样返回密文直到结尾，只留下错误信息，所以还要求没有任何错误
+        const void *buff;
+        size_t size;
+        la_int64_t offset;
+        int ret;
+        while ((ret = archive_read_data_block(a, &buff, &size, &offset)) == ARCHIVE_OK) {
+        }
+        success = ret == ARCHIVE_EOF && archive_errno(a) == 0;
+        break;
     }
     
     archive_read_free(a);
     return success;
 }
 
-// 尝试密码
-bool try_password(const char *archive_path, const char *password, archive_type_t type) {
-    if (!archive_path || !password) {
+// 用线程自己的读取句柄尝试密码，不再有任何文件系统调用
+bool archive_reader_try(archive_reader_t *reader, const char *password) {
+    if (!reader || !reader->image || !password) {
         return false;
     }
     
-    switch (type) {
+    switch (reader->type) {
         case ARCHIVE_ZIP:
-            return try_zip_password(archive_path, password);
+            return try_zip_password(reader, password);
         case ARCHIVE_RAR:
-            return try_rar_password(archive_path, password);
         case ARCHIVE_7Z:
-            return try_7z_password(archive_path, password);
+            return try_libarchive_password(reader, password);
         default:
             return false;
     }
 }
 
-// 使用密码解压ZIP文件
-static bool extract_zip_with_password(const char *archive_path, const char *password, 
-                                     const char *output_dir) {
-    int err;
-    zip_t *archive = zip_open(archive_path, ZIP_RDONLY, &err);
-    if (!archive) {
+// 关闭读取句柄（内存映像由调用者释放）
+void archive_reader_close(archive_reader_t *reader) {
+    if (!reader) return;
+    
+    if (reader->zip) {
+        zip_close(reader->zip);
+        reader->zip = NULL;
+    }
+    reader->image = NULL;
+}
+
+// 拒绝绝对路径和含".."的条目名，防止写到输出目录之外
+static bool safe_entry_name(const char *name) {
+    if (!name || name[0] == '\0' || name[0] == '/') {
         return false;
     }
-    
-    if (zip_set_default_password(archive, password) != 0) {
-        zip_close(archive);
+    for (const char *p = name; *p; ) {
+        const char *end = strchr(p, '/');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len == 2 && p[0] == '.' && p[1] == '.') {
+            return false;
+        }
+        p += len;
+        if (*p == '/') p++;
+    }
+    return true;
+}
+
+// 逐级创建路径中的父目录，多个线程同时创建同一目录时EEXIST不算错误
+static bool make_parent_dirs(const char *path) {
+    char buffer[1024];
+    snprintf(buffer, sizeof(buffer), "%s", path);
+    for (char *p = buffer + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(buffer, 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+        *p = '/';
+    }
+    return true;
+}
+
+// ZIP并行解压任务：各线程通过原子游标领取条目
+typedef struct {
+    const archive_image_t *image;
+    const char *password;
+    const char *output_dir;
+    extract_target_t target;
+    extracted_file_t *files;        // 内存模式下按条目下标存放结果
+    zip_uint64_t num_entries;
+    zip_uint64_t next;
+    bool failed;
+} zip_extract_job_t;
+
+// 解压一个ZIP条目：写磁盘时用大缓冲区读出后pwrite，写内存时直接读进结果缓冲区
+static bool extract_zip_entry(zip_t *archive, zip_uint64_t index, zip_extract_job_t *job, uint8_t *buffer) {
+    zip_stat_t stat;
+    if (zip_stat_index(archive, index, 0, &stat) != 0) {
         return false;
     }
+    if (!safe_entry_name(stat.name)) {
+        print_error("跳过不安全的条目名: %s", stat.name ? stat.name : "");
+        return true;
+    }
     
-    // 创建输出目录
-    if (access(output_dir, F_OK) != 0) {
-        if (mkdir(output_dir, 0755) != 0) {
-            zip_close(archive);
+    bool is_dir = stat.name[strlen(stat.name) - 1] == '/';
+    extracted_file_t *item = job->target == EXTRACT_TO_MEMORY ? &job->files[index] : NULL;
+    if (item) {
+        item->name = strdup(stat.name);
+        if (!item->name) return false;
+    }
+    
+    char output_path[1024];
+    if (job->target == EXTRACT_TO_DISK) {
+        snprintf(output_path, sizeof(output_path), "%s/%s", job->output_dir, stat.name);
+        if (!make_parent_dirs(output_path)) {
             return false;
         }
+        if (is_dir) {
+            return mkdir(output_path, 0755) == 0 || errno == EEXIST;
+        }
+    } else if (is_dir) {
+        return true;
     }
     
-    zip_uint64_t num_entries = zip_get_num_entries(archive, 0);
-    bool success = true;
+    zip_file_t *file = zip_fopen_index(archive, index, 0);
+    if (!file) {
+        return false;
+    }
     
-    for (zip_uint64_t i = 0; i < num_entries && success; i++) {
-        zip_stat_t stat;
-        if (zip_stat_index(archive, i, 0, &stat) == 0) {
-            // 构建输出文件路径
-            char output_path[1024];
-            snprintf(output_path, sizeof(output_path), "%s/%s", output_dir, stat.name);
-            
-            // 如果是目录，创建目录
-            if (stat.name[strlen(stat.name) - 1] == '/') {
-                if (mkdir(output_path, 0755) != 0 && errno != EEXIST) {
-                    success = false;
-                    break;
-                }
-                continue;
-            }
-            
-            // 打开ZIP文件中的条目
-            zip_file_t *file = zip_fopen_index(archive, i, 0);
-            if (!file) {
-                success = false;
-                break;
-            }
-            
-            // 创建输出文件
-            FILE *output_file = fopen(output_path, "wb");
-            if (!output_file) {
-                zip_fclose(file);
-                success = false;
-                break;
-            }
-            
-            // 复制数据
-            char buffer[8192];
-            zip_int64_t bytes_read;
-            while ((bytes_read = zip_fread(file, buffer, sizeof(buffer))) > 0) {
-                if (fwrite(buffer, 1, (size_t)bytes_read, output_file) != (size_t)bytes_read) {
-                    success = false;
-                    break;
-                }
-            }
-            
-            fclose(output_file);
-            zip_fclose(file);
-            
-            if (bytes_read < 0) {
-                success = false;
-            }
+    bool ok = true;
+    zip_int64_t bytes_read = 0;
+    if (item) {
+        // 大小已知，一次分配后直接解压进去
+        item->data = malloc(stat.size ? stat.size : 1);
+        ok = item->data != NULL;
+        while (ok && item->size < stat.size &&
+               (bytes_read = zip_fread(file, item->data + item->size, stat.size - item->size)) > 0) {
+            item->size += (size_t)bytes_read;
+        }
+        ok = ok && item->size == stat.size;
+    } else if (job->target == EXTRACT_TO_STDOUT) {
+        while ((bytes_read = zip_fread(file, buffer, EXTRACT_BUFFER_SIZE)) > 0 && ok) {
+            ok = fwrite(buffer, 1, (size_t)bytes_read, stdout) == (size_t)bytes_read;
+        }
+    } else {
+        int fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ok = fd >= 0;
+        off_t offset = 0;
+        while (ok && (bytes_read = zip_fread(file, buffer, EXTRACT_BUFFER_SIZE)) > 0) {
+            ok = pwrite(fd, buffer, (size_t)bytes_read, offset) == bytes_read;
+            offset += bytes_read;
+        }
+        if (fd >= 0 && close(fd) != 0) {
+            ok = false;
         }
     }
     
-    zip_close(archive);
-    return success;
+    // 读到结尾时libzip会校验CRC
+    zip_fclose(file);
+    return ok && bytes_read >= 0;
 }
 
-// 使用密码解压RAR文件
-static bool extract_rar_with_password(const char *archive_path, const char *password, 
-                                     const char *output_dir) {
-    struct archive *a = archive_read_new();
-    struct archive *ext = archive_write_disk_new();
-    
-    archive_read_support_filter_all(a);
-    archive_read_support_format_rar(a);
-    archive_read_add_passphrase(a, password);
+// 解压线程：每个线程在内存映像上有自己的libzip句柄
+static void* zip_extract_worker(void *arg) {
+    zip_extract_job_t *job = (zip_extract_job_t*)arg;
+    zip_t *archive = open_zip_image(job->image);
+    uint8_t *buffer = malloc(EXTRACT_BUFFER_SIZE);
+    if (!archive || !buffer || zip_set_default_password(archive, job->password) != 0) {
+        __atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+    }
     
-    archive_write_disk_set_options(ext, ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM);
+    while (!__atomic_load_n(&job->failed, __ATOMIC_RELAXED)) {
+        zip_uint64_t index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (index >= job->num_entries) break;
+        if (!extract_zip_entry(archive, index, job, buffer)) {
+            __atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+        }
+    }
     
-    if (archive_read_open_filename(a, archive_path, 10240) != ARCHIVE_OK) {
-        archive_read_free(a);
-        archive_write_free(ext);
+    free(buffer);
+    if (archive) zip_close(archive);
+    return NULL;
+}
+
+// 解压ZIP：互不依赖的条目分给多个线程，写到标准输出时保持条目顺序只用一个线程
+static bool extract_zip(const archive_image_t *image, const char *password, extract_target_t target,
+                        const char *output_dir, extracted_file_t **files, uint32_t *count) {
+    zip_t *archive = open_zip_image(image);
+    if (!archive) {
         return false;
     }
+    zip_extract_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.image = image;
+    job.password = password;
+    job.output_dir = output_dir;
+    job.target = target;
+    job.num_entries = (zip_uint64_t)zip_get_num_entries(archive, 0);
+    zip_close(archive);
     
-    // 创建输出目录
-    if (access(output_dir, F_OK) != 0) {
-        if (mkdir(output_dir, 0755) != 0) {
-            archive_read_free(a);
-            archive_write_free(ext);
-            return false;
-        }
+    if (target == EXTRACT_TO_MEMORY) {
+        job.files = calloc(job.num_entries ? job.num_entries : 1, sizeof(extracted_file_t));
+        if (!job.files) return false;
     }
     
-    struct archive_entry *entry;
-    bool success = true;
+    int thread_count = target == EXTRACT_TO_STDOUT ? 1 : get_cpu_count();
+    if ((zip_uint64_t)thread_count > job.num_entries) {
+        thread_count = job.num_entries ? (int)job.num_entries : 1;
+    }
     
-    while (archive_read_next_header(a, &entry) == ARCHIVE_OK && success) {
-        // 修改路径前缀
-        const char *current_file = archive_entry_pathname(entry);
-        char new_path[1024];
-        snprintf(new_path, sizeof(new_path), "%s/%s", output_dir, current_file);
-        archive_entry_set_pathname(entry, new_path);
-        
-        if (archive_write_header(ext, entry) != ARCHIVE_OK) {
-            success = false;
-            break;
+    pthread_t *threads = calloc((size_t)thread_count, sizeof(pthread_t));
+    int started = 0;
+    while (threads && started < thread_count &&
+           pthread_create(&threads[started], NULL, zip_extract_worker, &job) == 0) {
+        started++;
+    }
+    if (started == 0) {
+        zip_extract_worker(&job);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    
+    if (target == EXTRACT_TO_MEMORY) {
+        if (job.failed) {
+            free_extracted_files(job.files, (uint32_t)job.num_entries);
+            return false;
         }
-        
-        if (archive_entry_size(entry) > 0) {
-            const void *buff;
-            size_t size;
-            la_int64_t offset;
-            
-            while (archive_read_data_block(a, &buff, &size, &offset) == ARCHIVE_OK) {
-                if (archive_write_data_block(ext, buff, size, offset) != ARCHIVE_OK) {
-                    success = false;
-                    break;
-                }
-            }
+        *files = job.files;
+        *count = (uint32_t)job.num_entries;
+    }
+    return !job.failed;
+}
+
+// 读出当前条目的全部数据到结果项
+static bool read_libarchive_entry(struct archive *a, extracted_file_t *item, int64_t size_hint) {
+    size_t capacity = size_hint > 0 ? (size_t)size_hint : 0;
+    item->data = malloc(capacity ? capacity : 1);
+    if (!item->data) return false;
+    
+    const void *buff;
+    size_t size;
+    la_int64_t offset;
+    int ret;
+    while ((ret = archive_read_data_block(a, &buff, &size, &offset)) == ARCHIVE_OK) {
+        size_t end = (size_t)offset + size;
+        if (end > capacity) {
+            size_t new_capacity = capacity ? capacity : 4096;
+            while (new_capacity < end) new_capacity *= 2;
+            uint8_t *data = realloc(item->data, new_capacity);
+            if (!data) return false;
+            item->data = data;
+            capacity = new_capacity;
         }
-        
-        if (archive_write_finish_entry(ext) != ARCHIVE_OK) {
-            success = false;
+        if ((size_t)offset > item->size) {
+            memset(item->data + item->size, 0, (size_t)offset - item->size);   // 稀疏文件的空洞
         }
+        memcpy(item->data + offset, buff, size);
+        if (end > item->size) item->size = end;
     }
-    
-    archive_read_free(a);
-    archive_write_free(ext);
-    return success;
+    return ret == ARCHIVE_EOF;
 }
 
-// 使用密码解压7Z文件
-static bool extract_7z_with_password(const char *archive_path, const char *password, 
-                                    const char *output_dir) {
+// 解压RAR/7Z：libarchive直接读内存映像；固实压缩包的条目只能按顺序解出
+static bool extract_libarchive(const archive_image_t *image, archive_type_t type, const char *password,
+                               extract_target_t target, const char *output_dir,
+                               extracted_file_t **files, uint32_t *count) {
     struct archive *a = archive_read_new();
-    struct archive *ext = archive_write_disk_new();
-    
     archive_read_support_filter_all(a);
-    archive_read_support_format_7zip(a);
+    if (type == ARCHIVE_RAR) {
+        archive_read_support_format_rar(a);
+        archive_read_support_format_rar5(a);
+    } else {
+        archive_read_support_format_7zip(a);
+    }
     archive_read_add_passphrase(a, password);
     
-    archive_write_disk_set_options(ext, ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM);
-    
-    if (archive_read_open_filename(a, archive_path, 10240) != ARCHIVE_OK) {
+    if (archive_read_open_memory(a, image->data, image->size) != ARCHIVE_OK) {
         archive_read_free(a);
-        archive_write_free(ext);
         return false;
     }
     
-    // 创建输出目录
-    if (access(output_dir, F_OK) != 0) {
-        if (mkdir(output_dir, 0755) != 0) {
-            archive_read_free(a);
-            archive_write_free(ext);
-            return false;
-        }
+    struct archive *ext = NULL;
+    if (target == EXTRACT_TO_DISK) {
+        ext = archive_write_disk_new();
+        archive_write_disk_set_options(ext, ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM |
+                                            ARCHIVE_EXTRACT_SECURE_NODOTDOT | ARCHIVE_EXTRACT_SECURE_SYMLINKS);
     }
     
+    extracted_file_t *items = NULL;
+    uint32_t item_count = 0, capacity = 0;
     struct archive_entry *entry;
     bool success = true;
+    int ret;
     
-    while (archive_read_next_header(a, &entry) == ARCHIVE_OK && success) {
-        // 修改路径前缀
+    while (success && (ret = archive_read_next_header(a, &entry)) == ARCHIVE_OK) {
         const char *current_file = archive_entry_pathname(entry);
-        char new_path[1024];
-        snprintf(new_path, sizeof(new_path), "%s/%s", output_dir, current_file);
-        archive_entry_set_pathname(entry, new_path);
-        
-        if (archive_write_header(ext, entry) != ARCHIVE_OK) {
-            success = false;
-            break;
-        }
+        const void *buff;
+        size_t size;
+        la_int64_t offset;
         
-        if (archive_entry_size(entry) > 0) {
-            const void *buff;
-            size_t size;
-            la_int64_t offset;
-            
-            while (archive_read_data_block(a, &buff, &size, &offset) == ARCHIVE_OK) {
-                if (archive_write_data_block(ext, buff, size, offset) != ARCHIVE_OK) {
+        if (target == EXTRACT_TO_MEMORY) {
+            if (item_count == capacity) {
+                uint32_t new_capacity = capacity ? capacity * 2 : 64;
+                extracted_file_t *grown = realloc(items, new_capacity * sizeof(extracted_file_t));
+                if (!grown) {
                     success = false;
                     break;
                 }
+                items = grown;
+                capacity = new_capacity;
+            }
+            extracted_file_t *item = &items[item_count++];
+            memset(item, 0, sizeof(extracted_file_t));
+            item->name = strdup(current_file ? current_file : "");
+            if (archive_entry_filetype(entry) != AE_IFDIR) {
+                success = item->name && read_libarchive_entry(a, item, archive_entry_size(entry));
+            }
+        } else if (target == EXTRACT_TO_STDOUT) {
+            int data_ret;
+            while (success && (data_ret = archive_read_data_block(a, &buff, &size, &offset)) == ARCHIVE_OK) {
+                success = fwrite(buff, 1, size, stdout) == size;
+            }
+            // 读数据出错（如libarchive不支持的加密方式）时不能当作解压成功
+            if (success && data_ret != ARCHIVE_EOF) {
+                success = false;
+            }
+        } else {
+            // 修改路径前缀
+            char new_path[1024];
+            snprintf(new_path, sizeof(new_path), "%s/%s", output_dir, current_file);
+            archive_entry_set_pathname(entry, new_path);
+            
+            if (archive_write_header(ext, entry) != ARCHIVE_OK) {
+                success = false;
+                break;
+            }
+            if (archive_entry_size(entry) > 0) {
+                int data_ret;
+                while ((data_ret = archive_read_data_block(a, &buff, &size, &offset)) == ARCHIVE_OK) {
+                    if (archive_write_data_block(ext, buff, size, offset) != ARCHIVE_OK) {
+                        success = false;
+                        break;
+                    }
+                }
+                if (success && data_ret != ARCHIVE_EOF) {
+                    success = false;
+                }
+            }
+            if (archive_write_finish_entry(ext) != ARCHIVE_OK) {
+                success = false;
             }
-        }
-        
-        if (archive_write_finish_entry(ext) != ARCHIVE_OK) {
-            success = false;
         }
     }
+    if (success && ret != ARCHIVE_EOF) {
+        success = false;
+    }
     
     archive_read_free(a);
-    archive_write_free(ext);
+    if (ext) archive_write_free(ext);
+    
+    if (target == EXTRACT_TO_MEMORY) {
+        if (!success) {
+            free_extracted_files(items, item_count);
+            return false;
+        }
+        *files = items;
+        *count = item_count;
+    }
     return success;
 }
 
-// 使用密码解压文件
-bool extract_with_password(const char *archive_path, const char *password, 
-                          const char *output_dir, archive_type_t type) {
-    if (!archive_path || !password || !output_dir) {
+// 按类型解压压缩包模型中的内存映像
+static bool extract_image(const archive_info_t *info, const char *password, extract_target_t target,
+                          const char *output_dir, extracted_file_t **files, uint32_t *count) {
+    if (!info->image) {
+        return false;
+    }
+    if (target == EXTRACT_TO_DISK && access(output_dir, F_OK) != 0 && mkdir(output_dir, 0755) != 0) {
         return false;
     }
     
-    switch (type) {
+    bool success;
+    switch (info->type) {
         case ARCHIVE_ZIP:
-            return extract_zip_with_password(archive_path, password, output_dir);
+            success = extract_zip(info->image, password, target, output_dir, files, count);
+            break;
         case ARCHIVE_RAR:
-            return extract_rar_with_password(archive_path, password, output_dir);
         case ARCHIVE_7Z:
-            return extract_7z_with_password(archive_path, password, output_dir);
+            success = extract_libarchive(info->image, info->type, password, target, output_dir, files, count);
+            break;
         default:
-            return false;
+            success = false;
+            break;
+    }
+    if (target == EXTRACT_TO_STDOUT) {
+        fflush(stdout);
+    }
+    return success;
+}
+
+// 使用密码解压文件，output_dir为"-"时依次写到标准输出
+bool extract_with_password(const archive_info_t *info, const char *password, const char *output_dir) {
+    if (!info || !password || !output_dir) {
+        return false;
     }
-}
\ No newline at end of file
+    
+    extract_target_t target = strcmp(output_dir, EXTRACT_STDOUT) == 0 ? EXTRACT_TO_STDOUT : EXTRACT_TO_DISK;
+    return extract_image(info, password, target, output_dir, NULL, NULL);
+}
+
+// 使用密码解压到内存，不写任何文件；返回的数组用free_extracted_files释放
+extracted_file_t* extract_to_memory(const archive_info_t *info, const char *password, uint32_t *count) {
+    if (!info || !password || !count) {
+        return NULL;
+    }
+    
+    extracted_file_t *files = NULL;
+    *count = 0;
+    if (!extract_image(info, password, EXTRACT_TO_MEMORY, NULL, &files, count)) {
+        return NULL;
+    }
+    return files;
+}
+
+// 释放解压到内存的结果
+void free_extracted_files(extracted_file_t *files, uint32_t count) {
+    if (!files) return;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        free(files[i].name);
+        free(files[i].data);
+    }
+    free(files);
+}
@@ -0,0 +1,135 @@
+#include "../include/zip_cracker.h"
+
+// 读一遍词表：next为空时只统计各长度的词数，否则把每个词写进所在的长度桶
+static bool word_list_read(const char *file, int max_len, word_list_t *list, uint64_t *next) {
+    dict_source_t *source = dict_source_open(file, 1);
+    if (!source) {
+        print_error("无法打开词表: %s", file);
+        return false;
+    }
+
+    dict_chunk_t chunk;
+    memset(&chunk, 0, sizeof(chunk));
+    const char *line;
+    size_t len;
+
+    while (dict_source_next_chunk(source, &chunk)) {
+        while (dict_chunk_next_line(&chunk, &line, &len)) {
+            if (len > (size_t)max_len) continue;
+            if (!next) {
+                list->bucket_count[len]++;
+                continue;
+            }
+            // 第二遍的内容和第一遍不同（文件被改写）时不越出桶
+            if (next[len] == list->bucket_count[len]) continue;
+            memcpy(list->data + list->bucket_offset[len] + next[len]++ * len, line, len);
+        }
+    }
+
+    dict_source_close(source);
+    return true;
+}
+
+// 把词表读进内存，按长度分桶紧密存放；超过max_len的词跳过。读两遍，内存只占词表本身的大小
+word_list_t* word_list_load(const char *file, int max_len) {
+    if (!file || max_len < 0 || max_len > MAX_CANDIDATE_LENGTH) {
+        return NULL;
+    }
+
+    word_list_t *list = calloc(1, sizeof(word_list_t));
+    uint64_t *next = calloc(MAX_CANDIDATE_LENGTH + 1, sizeof(uint64_t));
+    if (!list || !next || !word_list_read(file, max_len, list, NULL)) {
+        free(list);
+        free(next);
+        return NULL;
+    }
+
+    // 各长度桶的词数取前缀和得到数据偏移，同时记下非空桶的范围
+    uint64_t size = 0;
+    list->min_length = -1;
+    for (int len = 0; len <= max_len; len++) {
+        list->bucket_offset[len] = size;
+        size += list->bucket_count[len] * (uint64_t)len;
+        list->count += list->bucket_count[len];
+        if (list->bucket_count[len] == 0) continue;
+        if (list->min_length < 0) list->min_length = len;
+        list->max_length = len;
+    }
+
+    if (list->count == 0) {
+        print_error("词表中没有长度不超过%d的词: %s", max_len, file);
+        free(next);
+        free(list);
+        return NULL;
+    }
+
+    list->data = calloc(size ? size : 1, 1);
+    if (!list->data || !word_list_read(file, max_len, list, next)) {
+        free(next);
+        word_list_free(list);
+        return NULL;
+    }
+
+    free(next);
+    return list;
+}
+
+// 释放词表
+void word_list_free(word_list_t *list) {
+    if (!list) return;
+
+    free(list->data);
+    free(list);
+}
+
+// 建立组合攻击：右字典读进内存，左字典由字典线程流式领取；没有指定分隔符时直接拼接
+combinator_t* combinator_create(const char *right_file, const char *const *separators, int separator_count) {
+    combinator_t *comb = calloc(1, sizeof(combinator_t));
+    if (!comb) return NULL;
+
+    if (separator_count == 0) {
+        static const char *const none[] = { "" };
+        separators = none;
+        separator_count = 1;
+    }
+
+    comb->separators = calloc((size_t)separator_count, sizeof(char *));
+    comb->separator_lens = calloc((size_t)separator_count, sizeof(size_t));
+    if (!comb->separators || !comb->separator_lens) {
+        combinator_free(comb);
+        return NULL;
+    }
+    for (int i = 0; i < separator_count; i++) {
+        comb->separators[i] = strdup(separators[i]);
+        if (!comb->separators[i]) {
+            combinator_free(comb);
+            return NULL;
+        }
+        comb->separator_lens[i] = strlen(separators[i]);
+        comb->separator_count++;
+    }
+
+    comb->right = word_list_load(right_file, MAX_CANDIDATE_LENGTH);
+    if (!comb->right) {
+        combinator_free(comb);
+        return NULL;
+    }
+
+    comb->per_word = comb->right->count * comb->separator_count;
+    print_info("组合攻击: 右字典 %lu 个词，%u 个分隔符，左字典每个词组合出 %lu 个候选",
+               comb->right->count, comb->separator_count, comb->per_word);
+    return comb;
+}
+
+// 释放组合攻击
+void combinator_free(combinator_t *comb) {
+    if (!comb) return;
+
+    for (uint32_t i = 0; comb->separators && i < comb->separator_count; i++) {
+        free(comb->separators[i]);
+    }
+    free(comb->separators);
+    free(comb->separator_lens);
+    word_list_free(comb->right);
+    free(comb);
+}
@@ -118,11 +118,11 @@ bool crc32_attack(const char *filename, uint32_t target_crc, int file_size, char
             
             // 每100万次显示进度
             if (combo % 1000000 == 0 && combo > 0) {
-                printf("\r[*] 进度: %.2f%%", (double)combo / total_combinations * 100);
-                fflush(stdout);
+                fprintf(message_stream(), "\r[*] 进度: %.2f%%", (double)combo / total_combinations * 100);
+                fflush(message_stream());
             }
         }
-        printf("\n");
+        fprintf(message_stream(), "\n");
     } else {
         // 对于较大的文件，使用可打印字符集
         print_info("使用可打印字符集进行攻击...");
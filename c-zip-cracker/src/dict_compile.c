@@ -0,0 +1,265 @@
+#include "../include/zip_cracker.h"
+
+// 去重哈希表的初始槽数，装载超过一半时翻倍
+#define COMPILE_INITIAL_SLOTS (1 << 16)
+// 写出文件时使用的缓冲区大小
+#define COMPILE_WRITE_BUFFER (1 << 20)
+
+// 一个去重后的条目
+typedef struct {
+    uint64_t offset;               // 在字符串区中的偏移
+    uint64_t count;                // 在所有输入中出现的次数
+    uint8_t len;
+} compile_entry_t;
+
+// 去重集合：字符串紧密存放在一块内存里，开放寻址的槽里存条目下标+1
+typedef struct {
+    char *arena;
+    uint64_t arena_size;
+    uint64_t arena_capacity;
+    compile_entry_t *entries;
+    uint64_t count;
+    uint64_t capacity;
+    uint64_t *slots;
+    uint64_t slot_mask;
+} compile_set_t;
+
+// FNV-1a哈希
+static uint64_t hash_bytes(const char *data, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// 槽数翻倍并重新放入所有条目
+static bool set_grow_slots(compile_set_t *set) {
+    uint64_t slot_count = set->slots ? (set->slot_mask + 1) * 2 : COMPILE_INITIAL_SLOTS;
+    uint64_t *slots = calloc(slot_count, sizeof(uint64_t));
+    if (!slots) return false;
+
+    for (uint64_t id = 0; id < set->count; id++) {
+        const compile_entry_t *entry = &set->entries[id];
+        uint64_t i = hash_bytes(set->arena + entry->offset, entry->len) & (slot_count - 1);
+        while (slots[i]) {
+            i = (i + 1) & (slot_count - 1);
+        }
+        slots[i] = id + 1;
+    }
+
+    free(set->slots);
+    set->slots = slots;
+    set->slot_mask = slot_count - 1;
+    return true;
+}
+
+// 加入一个候选，已经存在时只增加出现次数
+static bool set_add(compile_set_t *set, const char *word, size_t len) {
+    if (!set->slots || (set->count + 1) * 2 > set->slot_mask + 1) {
+        if (!set_grow_slots(set)) return false;
+    }
+
+    uint64_t i = hash_bytes(word, len) & set->slot_mask;
+    while (set->slots[i]) {
+        compile_entry_t *entry = &set->entries[set->slots[i] - 1];
+        if (entry->len == len && memcmp(set->arena + entry->offset, word, len) == 0) {
+            entry->count++;
+            return true;
+        }
+        i = (i + 1) & set->slot_mask;
+    }
+
+    if (set->count == set->capacity) {
+        uint64_t capacity = set->capacity ? set->capacity * 2 : COMPILE_INITIAL_SLOTS;
+        compile_entry_t *entries = realloc(set->entries, capacity * sizeof(compile_entry_t));
+        if (!entries) return false;
+        set->entries = entries;
+        set->capacity = capacity;
+    }
+    if (set->arena_size + len > set->arena_capacity) {
+        uint64_t capacity = set->arena_capacity ? set->arena_capacity : COMPILE_WRITE_BUFFER;
+        while (capacity < set->arena_size + len) capacity *= 2;
+        char *arena = realloc(set->arena, capacity);
+        if (!arena) return false;
+        set->arena = arena;
+        set->arena_capacity = capacity;
+    }
+
+    memcpy(set->arena + set->arena_size, word, len);
+    set->entries[set->count].offset = set->arena_size;
+    set->entries[set->count].count = 1;
+    set->entries[set->count].len = (uint8_t)len;
+    set->arena_size += len;
+    set->slots[i] = ++set->count;
+    return true;
+}
+
+// 释放去重集合
+static void set_free(compile_set_t *set) {
+    free(set->arena);
+    free(set->entries);
+    free(set->slots);
+}
+
+// 读入一个字典（文本或已编译的）加进去重集合，累计读到的行数和跳过的超长行
+static bool compile_read_input(compile_set_t *set, const char *input, uint64_t *lines, uint64_t *skipped) {
+    dict_source_t *source = dict_source_open(input, 1);
+    if (!source) {
+        print_error("无法打开字典文件: %s", input);
+        return false;
+    }
+
+    dict_chunk_t chunk;
+    memset(&chunk, 0, sizeof(chunk));
+    const char *line;
+    size_t len;
+    bool ok = true;
+
+    while (ok && dict_source_next_chunk(source, &chunk)) {
+        while (dict_chunk_next_line(&chunk, &line, &len)) {
+            (*lines)++;
+            if (len > MAX_CANDIDATE_LENGTH) {
+                (*skipped)++;
+                continue;
+            }
+            if (!set_add(set, line, len)) {
+                print_error("内存不足，无法继续去重");
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    dict_source_close(source);
+    return ok;
+}
+
+// 频率排序的比较对象
+static const compile_entry_t *g_sort_entries;
+
+// 出现次数多的在前，次数相同时保持第一次出现的顺序
+static int compare_frequency(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    uint64_t cx = g_sort_entries[x].count;
+    uint64_t cy = g_sort_entries[y].count;
+    if (cx != cy) return cx > cy ? -1 : 1;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// 写出预编译字典：文件头、各长度桶的数据、按8字节对齐的顺序表
+static bool compile_write(const compile_set_t *set, const char *output, dict_order_t order) {
+    dict_compiled_header_t *header = calloc(1, sizeof(dict_compiled_header_t));
+    uint64_t *ids = malloc((set->count ? set->count : 1) * sizeof(uint64_t));
+    uint64_t *by_bucket = malloc((set->count ? set->count : 1) * sizeof(uint64_t));
+    FILE *file = fopen(output, "wb");
+    bool ok = header && ids && by_bucket && file;
+
+    if (ok) {
+        memcpy(header->magic, DICT_COMPILED_MAGIC, sizeof(DICT_COMPILED_MAGIC));
+        header->version = DICT_COMPILED_VERSION;
+        header->order = (uint32_t)order;
+        header->entry_count = set->count;
+
+        // 各长度桶的条目数取前缀和，得到每个桶的第一个下标和数据偏移
+        uint64_t next[DICT_COMPILED_BUCKETS] = {0};
+        for (uint64_t id = 0; id < set->count; id++) {
+            header->bucket_first[set->entries[id].len + 1]++;
+        }
+        uint64_t offset = sizeof(dict_compiled_header_t);
+        for (int len = 0; len < DICT_COMPILED_BUCKETS; len++) {
+            uint64_t bucket_count = header->bucket_first[len + 1];
+            header->bucket_first[len + 1] = header->bucket_first[len] + bucket_count;
+            header->bucket_offset[len] = offset;
+            next[len] = header->bucket_first[len];
+            offset += bucket_count * (uint64_t)len;
+        }
+
+        // 桶内保持第一次出现的顺序，ids记录每个条目在文件中的下标
+        for (uint64_t id = 0; id < set->count; id++) {
+            uint64_t index = next[set->entries[id].len]++;
+            ids[id] = index;
+            by_bucket[index] = id;
+        }
+
+        if (order != DICT_ORDER_LENGTH) {
+            header->order_offset = (offset + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+        }
+
+        setvbuf(file, NULL, _IOFBF, COMPILE_WRITE_BUFFER);
+        ok = fwrite(header, sizeof(dict_compiled_header_t), 1, file) == 1;
+        for (uint64_t index = 0; ok && index < set->count; index++) {
+            const compile_entry_t *entry = &set->entries[by_bucket[index]];
+            ok = fwrite(set->arena + entry->offset, 1, entry->len, file) == entry->len;
+        }
+    }
+
+    // 顺序表：输入顺序直接用ids；频率顺序先排序条目，再换成文件中的下标
+    if (ok && order != DICT_ORDER_LENGTH) {
+        static const char zeros[sizeof(uint64_t)] = {0};
+        size_t padding = (size_t)(header->order_offset - (uint64_t)ftello(file));
+        ok = fwrite(zeros, 1, padding, file) == padding;
+
+        if (ok && order == DICT_ORDER_FREQUENCY) {
+            for (uint64_t id = 0; id < set->count; id++) {
+                by_bucket[id] = id;
+            }
+            g_sort_entries = set->entries;
+            qsort(by_bucket, set->count, sizeof(uint64_t), compare_frequency);
+            for (uint64_t rank = 0; rank < set->count; rank++) {
+                by_bucket[rank] = ids[by_bucket[rank]];
+            }
+            ok = fwrite(by_bucket, sizeof(uint64_t), set->count, file) == set->count;
+        } else if (ok) {
+            ok = fwrite(ids, sizeof(uint64_t), set->count, file) == set->count;
+        }
+    }
+
+    if (file && fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok && file) {
+        remove(output);
+    }
+    free(header);
+    free(ids);
+    free(by_bucket);
+    return ok;
+}
+
+// 把一个或多个字典编译成二进制格式：去重、按长度分桶、记录精确条目数和可选的频率顺序
+bool dict_compile(const char *const *inputs, int input_count, const char *output, dict_order_t order) {
+    if (!inputs || input_count <= 0 || !output) {
+        return false;
+    }
+
+    compile_set_t set;
+    memset(&set, 0, sizeof(set));
+    uint64_t lines = 0;
+    uint64_t skipped = 0;
+
+    for (int i = 0; i < input_count; i++) {
+        print_info("正在读取字典: %s", inputs[i]);
+        if (!compile_read_input(&set, inputs[i], &lines, &skipped)) {
+            set_free(&set);
+            return false;
+        }
+    }
+
+    print_info("共读取 %lu 行，去重后 %lu 个条目", lines, set.count);
+    if (skipped > 0) {
+        print_info("跳过 %lu 个超过 %d 字节的行", skipped, MAX_CANDIDATE_LENGTH);
+    }
+
+    bool ok = compile_write(&set, output, order);
+    if (ok) {
+        print_success("预编译字典已写出: %s", output);
+    } else {
+        print_error("无法写出预编译字典: %s", output);
+    }
+
+    set_free(&set);
+    return ok;
+}
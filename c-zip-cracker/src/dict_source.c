@@ -0,0 +1,424 @@
+#include "../include/zip_cracker.h"
+#include <immintrin.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// 块大小的范围：小字典切得细一些，慢速格式下各线程才分得均匀
+#define DICT_CHUNK_MIN 4096
+#define DICT_CHUNK_MAX (1 << 20)
+// 每个读取线程平均分到的块数
+#define DICT_CHUNKS_PER_READER 64
+// 换行符位图一组的字节数
+#define DICT_GROUP_SIZE 64
+// 小于这个大小的字典只用一个线程计数
+#define DICT_COUNT_MIN_PER_THREAD (16 << 20)
+// 预编译字典每块的条目数范围
+#define DICT_ENTRIES_MIN 256
+#define DICT_ENTRIES_MAX (64 << 10)
+// 估计行数时均匀抽取的样本数和每个样本的字节数
+#define DICT_SAMPLE_COUNT 16
+#define DICT_SAMPLE_SIZE (64 << 10)
+// 后台计数每次统计的字节数，数完一段就修正一次总数
+#define DICT_COUNT_STEP (64 << 20)
+
+// 检查预编译字典的头：桶和顺序表都必须落在文件内
+static bool compiled_header_valid(const dict_compiled_header_t *header, uint64_t size) {
+    if (header->version != DICT_COMPILED_VERSION ||
+        header->bucket_first[0] != 0 ||
+        header->bucket_first[DICT_COMPILED_BUCKETS] != header->entry_count) {
+        return false;
+    }
+
+    for (int len = 0; len < DICT_COMPILED_BUCKETS; len++) {
+        uint64_t first = header->bucket_first[len];
+        uint64_t next = header->bucket_first[len + 1];
+        if (next < first || header->bucket_offset[len] > size ||
+            (next - first) > (size - header->bucket_offset[len]) / (len > 0 ? (uint64_t)len : 1)) {
+            return false;
+        }
+    }
+
+    if (header->order_offset != 0) {
+        if (header->order_offset % sizeof(uint64_t) != 0 || header->order_offset > size ||
+            header->entry_count > (size - header->order_offset) / sizeof(uint64_t)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 打开共享字典：只读映射整个文件，按读取线程数决定块大小；压缩字典改为打开解压流
+dict_source_t* dict_source_open(const char *dict_file, int readers) {
+    if (!dict_file) return NULL;
+
+    int fd = open(dict_file, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return NULL;
+    }
+
+    dict_source_t *source = calloc(1, sizeof(dict_source_t));
+    if (!source) {
+        close(fd);
+        return NULL;
+    }
+
+    source->size = (uint64_t)st.st_size;
+    source->use_avx2 = zip_crypto_select_kernel() != ZC_KERNEL_SCALAR;
+    source->compression = dict_detect_compression(fd);
+    if (source->compression != DICT_PLAIN) {
+        source->stream = dict_stream_open(fd, source->compression, readers);
+        if (!source->stream) {
+            free(source);
+            return NULL;
+        }
+        return source;
+    }
+
+    if (source->size > 0) {
+        void *data = mmap(NULL, source->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            free(source);
+            return NULL;
+        }
+        // 各线程领取的块整体上按顺序推进，让内核积极预读并回收读过的页
+        madvise(data, source->size, MADV_SEQUENTIAL);
+        source->data = data;
+    }
+    close(fd);
+
+    uint64_t shares = (uint64_t)(readers > 0 ? readers : 1) * DICT_CHUNKS_PER_READER;
+    source->next_offset = 0;
+
+    // 预编译字典：头里已有精确的条目数，按条目下标切块
+    if (source->size >= sizeof(DICT_COMPILED_MAGIC) &&
+        memcmp(source->data, DICT_COMPILED_MAGIC, sizeof(DICT_COMPILED_MAGIC)) == 0) {
+        const dict_compiled_header_t *header = (const dict_compiled_header_t *)source->data;
+        if (source->size < sizeof(dict_compiled_header_t) || !compiled_header_valid(header, source->size)) {
+            dict_source_close(source);
+            return NULL;
+        }
+        source->compiled = header;
+        source->order = header->order_offset ?
+                        (const uint64_t *)(source->data + header->order_offset) : NULL;
+        source->chunk_size = header->entry_count / shares;
+        if (source->chunk_size < DICT_ENTRIES_MIN) source->chunk_size = DICT_ENTRIES_MIN;
+        if (source->chunk_size > DICT_ENTRIES_MAX) source->chunk_size = DICT_ENTRIES_MAX;
+        return source;
+    }
+
+    source->chunk_size = source->size / shares;
+    if (source->chunk_size < DICT_CHUNK_MIN) source->chunk_size = DICT_CHUNK_MIN;
+    if (source->chunk_size > DICT_CHUNK_MAX) source->chunk_size = DICT_CHUNK_MAX;
+
+    return source;
+}
+
+// 标量：n字节内换行符的位图
+static uint64_t newline_mask_scalar(const char *p, size_t n) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < n; i++) {
+        mask |= (uint64_t)(p[i] == '\n') << i;
+    }
+    return mask;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// AVX2：一次比较64字节，得到换行符的位图
+__attribute__((target("avx2")))
+static uint64_t newline_mask_avx2(const char *p) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    __m256i lo = _mm256_loadu_si256((const __m256i *)p);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+    uint32_t lo_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline));
+    uint32_t hi_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline));
+    return (uint64_t)lo_mask | ((uint64_t)hi_mask << 32);
+}
+
+#endif
+
+// 扫描一组（最后一组可能不足64字节），不越过块的末尾读取
+static uint64_t newline_mask(bool use_avx2, const char *p, size_t n) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (use_avx2 && n == DICT_GROUP_SIZE) {
+        return newline_mask_avx2(p);
+    }
+#else
+    (void)use_avx2;
+#endif
+    return newline_mask_scalar(p, n);
+}
+
+// 领取下一块：行归属于它开头所在的块，块首不完整的行留给前一块，块尾的行延伸到换行符为止
+bool dict_source_next_chunk(dict_source_t *source, dict_chunk_t *chunk) {
+    if (!source || !chunk) return false;
+
+    // 压缩字典领取下一个解压好的块，同时归还手里的块
+    if (source->stream) {
+        if (!dict_stream_next_chunk(source->stream, chunk)) return false;
+        chunk->use_avx2 = source->use_avx2;
+        return true;
+    }
+
+    // 预编译字典直接领取一段条目下标
+    if (source->compiled) {
+        uint64_t count = source->compiled->entry_count;
+        uint64_t start = __atomic_fetch_add(&source->next_offset, source->chunk_size, __ATOMIC_RELAXED);
+        if (start >= count) return false;
+
+        memset(chunk, 0, sizeof(*chunk));
+        chunk->compiled = source;
+        chunk->index = start;
+        chunk->end = count - start < source->chunk_size ? count : start + source->chunk_size;
+        return true;
+    }
+
+    for (;;) {
+        uint64_t start = __atomic_fetch_add(&source->next_offset, source->chunk_size, __ATOMIC_RELAXED);
+        if (start >= source->size) return false;
+
+        uint64_t end = start + source->chunk_size;
+        if (end > source->size) end = source->size;
+
+        // 从前一个字节开始找换行符，判断块首是否正好是一行的开头
+        uint64_t head = start;
+        if (start > 0) {
+            const char *newline = memchr(source->data + start - 1, '\n', (size_t)(end - start + 1));
+            if (!newline) continue;   // 整块都在前一块开头的长行里
+            head = (uint64_t)(newline - source->data) + 1;
+        }
+        if (head >= end) continue;
+
+        // 最后一行延伸到块外时一直取到它的换行符
+        if (source->data[end - 1] != '\n' && end < source->size) {
+            const char *newline = memchr(source->data + end, '\n', (size_t)(source->size - end));
+            end = newline ? (uint64_t)(newline - source->data) + 1 : source->size;
+        }
+
+        memset(chunk, 0, sizeof(*chunk));
+        chunk->data = source->data + head;
+        chunk->len = (size_t)(end - head);
+        chunk->use_avx2 = source->use_avx2;
+        return true;
+    }
+}
+
+// 按枚举下标取预编译字典的条目：经顺序表换成条目下标，再二分查找所在的长度桶；
+// 顺序表损坏时返回NULL
+static const char* compiled_entry(const dict_source_t *source, uint64_t index, size_t *len) {
+    const dict_compiled_header_t *header = source->compiled;
+    uint64_t id = source->order ? source->order[index] : index;
+    if (id >= header->entry_count) return NULL;
+
+    // 找bucket_first[L] <= id的最大L，它一定是非空的桶
+    int lo = 0;
+    int hi = DICT_COMPILED_BUCKETS - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (header->bucket_first[mid] <= id) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    *len = (size_t)lo;
+    return source->data + header->bucket_offset[lo] + (id - header->bucket_first[lo]) * (uint64_t)lo;
+}
+
+// 取块中的下一行，去掉行尾的\n和\r\n；返回的指针指向映射，不以\0结尾
+bool dict_chunk_next_line(dict_chunk_t *chunk, const char **line, size_t *len) {
+    if (chunk->compiled) {
+        while (chunk->index < chunk->end) {
+            *line = compiled_entry(chunk->compiled, chunk->index++, len);
+            if (*line) return true;
+        }
+        return false;
+    }
+    if (chunk->pos >= chunk->len) return false;
+
+    size_t start = chunk->pos;
+    size_t n;
+    for (;;) {
+        if (chunk->newlines) {
+            size_t newline = chunk->base + (size_t)__builtin_ctzll(chunk->newlines);
+            chunk->newlines &= chunk->newlines - 1;
+            n = newline - start;
+            chunk->pos = newline + 1;
+            break;
+        }
+        if (chunk->scan >= chunk->len) {
+            // 文件最后一行没有换行符
+            n = chunk->len - start;
+            chunk->pos = chunk->len;
+            break;
+        }
+
+        size_t group = chunk->len - chunk->scan;
+        if (group > DICT_GROUP_SIZE) group = DICT_GROUP_SIZE;
+        chunk->base = chunk->scan;
+        chunk->newlines = newline_mask(chunk->use_avx2, chunk->data + chunk->scan, group);
+        chunk->scan += group;
+    }
+
+    if (n > 0 && chunk->data[start + n - 1] == '\r') n--;
+    *line = chunk->data + start;
+    *len = n;
+    return true;
+}
+
+// 计数线程的参数
+typedef struct {
+    const char *data;
+    size_t size;
+    bool use_avx2;
+    uint64_t count;
+} dict_count_job_t;
+
+// 统计一段内存中的换行符个数
+static uint64_t count_range(const char *data, size_t size, bool use_avx2) {
+    uint64_t count = 0;
+    size_t i = 0;
+
+    for (; i + DICT_GROUP_SIZE <= size; i += DICT_GROUP_SIZE) {
+        count += (uint64_t)__builtin_popcountll(newline_mask(use_avx2, data + i, DICT_GROUP_SIZE));
+    }
+    count += (uint64_t)__builtin_popcountll(newline_mask_scalar(data + i, size - i));
+    return count;
+}
+
+// 计数线程：统计分到的一段
+static void* count_newlines(void *arg) {
+    dict_count_job_t *job = (dict_count_job_t *)arg;
+    job->count = count_range(job->data, job->size, job->use_avx2);
+    return NULL;
+}
+
+// 统计字典中[offset, offset + size)范围内的换行符个数
+static uint64_t count_newlines_at(const dict_source_t *source, uint64_t offset, uint64_t size) {
+    if (offset >= source->size) return 0;
+    if (size > source->size - offset) size = source->size - offset;
+    return count_range(source->data + offset, (size_t)size, source->use_avx2);
+}
+
+// 从均匀分布的样本估计行数，不必读完整个文件；字典小到样本覆盖全文时直接精确计数
+uint64_t dict_source_estimate_lines(const dict_source_t *source, bool *exact) {
+    if (exact) *exact = true;
+    if (!source) return 0;
+    if (source->stream) return dict_stream_estimate_lines(source->stream, exact);
+    if (source->size == 0) return 0;
+    if (source->compiled) return source->compiled->entry_count;
+
+    if (source->size <= (uint64_t)DICT_SAMPLE_COUNT * DICT_SAMPLE_SIZE) {
+        return dict_source_count_lines(source, 1);
+    }
+
+    uint64_t lines = 0;
+    for (int i = 0; i < DICT_SAMPLE_COUNT; i++) {
+        uint64_t offset = (source->size - DICT_SAMPLE_SIZE) * (uint64_t)i / (DICT_SAMPLE_COUNT - 1);
+        lines += count_newlines_at(source, offset, DICT_SAMPLE_SIZE);
+    }
+    if (exact) *exact = false;
+
+    // 样本里没有换行符时整个文件至少也有一行
+    double per_byte = (double)lines / ((double)DICT_SAMPLE_COUNT * DICT_SAMPLE_SIZE);
+    uint64_t estimate = (uint64_t)(per_byte * (double)source->size);
+    return estimate > 0 ? estimate : 1;
+}
+
+// 多线程统计字典的行数，最后一行没有换行符时也算一行
+uint64_t dict_source_count_lines(const dict_source_t *source, int threads) {
+    if (!source) return 0;
+    if (source->stream) return dict_stream_count_lines(source->stream);
+    if (source->size == 0) return 0;
+    if (source->compiled) return source->compiled->entry_count;
+
+    uint64_t max_threads = source->size / DICT_COUNT_MIN_PER_THREAD;
+    if (threads < 1) threads = 1;
+    if ((uint64_t)threads > max_threads) threads = max_threads > 0 ? (int)max_threads : 1;
+
+    dict_count_job_t *jobs = calloc((size_t)threads, sizeof(dict_count_job_t));
+    pthread_t *ids = calloc((size_t)threads, sizeof(pthread_t));
+    bool *started = calloc((size_t)threads, sizeof(bool));
+    if (!jobs || !ids || !started) {
+        free(jobs);
+        free(ids);
+        free(started);
+        return 0;
+    }
+
+    for (int i = 0; i < threads; i++) {
+        uint64_t from = source->size * (uint64_t)i / (uint64_t)threads;
+        uint64_t to = source->size * (uint64_t)(i + 1) / (uint64_t)threads;
+        jobs[i].data = source->data + from;
+        jobs[i].size = (size_t)(to - from);
+        jobs[i].use_avx2 = source->use_avx2;
+        // 第一段在当前线程里数，创建失败的段也退回当前线程
+        if (i > 0) {
+            started[i] = pthread_create(&ids[i], NULL, count_newlines, &jobs[i]) == 0;
+        }
+    }
+
+    uint64_t total = 0;
+    for (int i = 0; i < threads; i++) {
+        if (started[i]) {
+            pthread_join(ids[i], NULL);
+        } else {
+            count_newlines(&jobs[i]);
+        }
+        total += jobs[i].count;
+    }
+
+    if (source->data[source->size - 1] != '\n') {
+        total++;
+    }
+
+    free(jobs);
+    free(ids);
+    free(started);
+    return total;
+}
+
+// 修正行数的估计，供后台计数线程反复调用：文本字典每次多数一段，已数部分精确，
+// 其余按已数部分的平均行长推算；压缩字典按后台解压的进度推算。总数已精确时返回true
+bool dict_source_refine(dict_source_t *source, uint64_t *estimate) {
+    if (!source) return true;
+    if (source->stream) return dict_stream_refine(source->stream, estimate);
+    if (source->compiled || source->size == 0) {
+        *estimate = source->compiled ? source->compiled->entry_count : 0;
+        return true;
+    }
+
+    uint64_t step = source->size - source->counted_bytes;
+    if (step > DICT_COUNT_STEP) step = DICT_COUNT_STEP;
+    source->counted_lines += count_newlines_at(source, source->counted_bytes, step);
+    source->counted_bytes += step;
+
+    *estimate = source->counted_lines;
+    if (source->counted_bytes < source->size) {
+        *estimate += (uint64_t)((double)source->counted_lines / (double)source->counted_bytes *
+                                (double)(source->size - source->counted_bytes));
+        return false;
+    }
+    if (source->data[source->size - 1] != '\n') {
+        (*estimate)++;
+    }
+    return true;
+}
+
+// 关闭共享字典
+void dict_source_close(dict_source_t *source) {
+    if (!source) return;
+    dict_stream_close(source->stream);
+    if (source->data) {
+        munmap((void *)source->data, source->size);
+    }
+    free(source);
+}
@@ -0,0 +1,821 @@
+#include "../include/zip_cracker.h"
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <bzlib.h>
+#include <lzma.h>
+#include <zstd.h>
+
+// 解压块的大小，块内只放完整的行，超过块大小的行直接丢弃
+#define STREAM_BLOCK_SIZE (1 << 20)
+// 每次从文件读取的压缩数据
+#define STREAM_INPUT_SIZE (256 << 10)
+// 多块xz/多帧zstd的解压线程数上限
+#define STREAM_DECODE_THREADS 4
+// 估计行数时解压的字节数
+#define STREAM_SAMPLE_SIZE (4 << 20)
+// 后台修正总数的间隔（微秒）
+#define STREAM_REFINE_INTERVAL 200000
+
+// 多帧zstd的并行解压：各线程领取整帧解压，结果按帧号放进环形槽里按顺序交给消费者
+typedef struct {
+    char *data;
+    size_t len;
+    bool ready;
+} zstd_slot_t;
+
+typedef struct {
+    const uint8_t *map;
+    uint64_t size;
+    uint64_t *offsets;
+    uint64_t *sizes;
+    uint64_t count;
+    zstd_slot_t *slots;
+    uint64_t window;               // 解压最多领先消费者的帧数
+    uint64_t next_frame;           // 下一个要领取的帧
+    uint64_t current;              // 消费者正在读的帧
+    size_t current_pos;
+    uint64_t consumed;             // 已读完的帧的压缩字节数
+    bool stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    pthread_t threads[STREAM_DECODE_THREADS];
+    int thread_count;
+} zstd_frames_t;
+
+// 一个顺序解压器，用pread从自己的偏移读取，同一个文件可以同时有多个
+typedef struct {
+    dict_compression_t type;
+    int fd;
+    uint64_t offset;               // 下一次从文件读取的位置
+    uint8_t *in;
+    size_t in_len;
+    size_t in_pos;
+    bool input_done;
+    bool done;
+    z_stream z;
+    bz_stream bz;
+    lzma_stream lz;
+    ZSTD_DStream *zs;
+    zstd_frames_t *frames;
+} stream_decoder_t;
+
+// 一个解压块
+typedef struct {
+    char *data;
+    size_t len;
+} stream_block_t;
+
+// 压缩字典的解压流：后台线程解压成只含完整行的块，工作线程排队领取，用完的块归还复用
+struct dict_stream {
+    int fd;
+    uint64_t size;
+    dict_compression_t type;
+    int decode_threads;
+    stream_decoder_t decoder;
+    stream_block_t *blocks;
+    int block_count;
+    int *ready;                    // 已解压的块，先进先出
+    int ready_head;
+    int ready_count;
+    int *free_blocks;
+    int free_count;
+    uint64_t lines;                // 已经解压出的行数
+    uint64_t consumed;             // 对应的压缩字节数
+    bool started;                  // 已经尝试过启动解压线程
+    bool running;
+    bool finished;
+    bool stopping;
+    pthread_t producer;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+};
+
+// 按文件开头的魔数识别压缩格式
+dict_compression_t dict_detect_compression(int fd) {
+    uint8_t magic[6];
+    ssize_t n = pread(fd, magic, sizeof(magic), 0);
+    if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return DICT_GZIP;
+    }
+    if (n >= 3 && memcmp(magic, "BZh", 3) == 0) {
+        return DICT_BZIP2;
+    }
+    if (n >= 6 && memcmp(magic, "\xfd" "7zXZ\0", 6) == 0) {
+        return DICT_XZ;
+    }
+    if (n >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        return DICT_ZSTD;
+    }
+    return DICT_PLAIN;
+}
+
+// 压缩格式的名称
+const char* dict_compression_name(dict_compression_t type) {
+    switch (type) {
+        case DICT_GZIP:
+            return "gzip";
+        case DICT_BZIP2:
+            return "bzip2";
+        case DICT_XZ:
+            return "xz";
+        case DICT_ZSTD:
+            return "zstd";
+        default:
+            return "未压缩";
+    }
+}
+
+// 解压一整帧zstd，内容大小未知时边解压边扩大缓冲区
+static char* zstd_decode_frame(ZSTD_DCtx *dctx, const uint8_t *src, size_t size, size_t *out_len) {
+    *out_len = 0;
+    unsigned long long content = ZSTD_getFrameContentSize(src, size);
+    if (content != ZSTD_CONTENTSIZE_UNKNOWN && content != ZSTD_CONTENTSIZE_ERROR &&
+        content <= (unsigned long long)SIZE_MAX / 2) {
+        char *data = malloc(content > 0 ? (size_t)content : 1);
+        if (!data) return NULL;
+        size_t ret = ZSTD_decompressDCtx(dctx, data, (size_t)content, src, size);
+        if (ZSTD_isError(ret)) {
+            free(data);
+            return NULL;
+        }
+        *out_len = ret;
+        return data;
+    }
+
+    size_t capacity = STREAM_BLOCK_SIZE;
+    char *data = malloc(capacity);
+    if (!data) return NULL;
+    ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only);
+    ZSTD_inBuffer in = { src, size, 0 };
+    while (in.pos < in.size) {
+        if (*out_len == capacity) {
+            char *grown = realloc(data, capacity * 2);
+            if (!grown) break;
+            data = grown;
+            capacity *= 2;
+        }
+        ZSTD_outBuffer out = { data + *out_len, capacity - *out_len, 0 };
+        size_t ret = ZSTD_decompressStream(dctx, &out, &in);
+        *out_len += out.pos;
+        if (ZSTD_isError(ret) || (ret == 0 && out.pos == 0 && in.pos < in.size)) break;
+    }
+    return data;
+}
+
+// 多帧zstd的解压线程：依次领取下一帧，最多领先消费者window帧
+static void* zstd_frame_worker(void *arg) {
+    zstd_frames_t *frames = (zstd_frames_t *)arg;
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+
+    pthread_mutex_lock(&frames->lock);
+    while (dctx) {
+        while (!frames->stopping && frames->next_frame < frames->count &&
+               frames->next_frame >= frames->current + frames->window) {
+            pthread_cond_wait(&frames->changed, &frames->lock);
+        }
+        if (frames->stopping || frames->next_frame >= frames->count) break;
+        uint64_t index = frames->next_frame++;
+        pthread_mutex_unlock(&frames->lock);
+
+        size_t len;
+        char *data = zstd_decode_frame(dctx, frames->map + frames->offsets[index],
+                                       (size_t)frames->sizes[index], &len);
+
+        pthread_mutex_lock(&frames->lock);
+        zstd_slot_t *slot = &frames->slots[index % frames->window];
+        slot->data = data;
+        slot->len = data ? len : 0;
+        slot->ready = true;
+        pthread_cond_broadcast(&frames->changed);
+    }
+    pthread_mutex_unlock(&frames->lock);
+
+    ZSTD_freeDCtx(dctx);
+    return NULL;
+}
+
+// 停止并释放多帧zstd的解压线程
+static void zstd_frames_free(zstd_frames_t *frames) {
+    if (!frames) return;
+
+    pthread_mutex_lock(&frames->lock);
+    frames->stopping = true;
+    pthread_cond_broadcast(&frames->changed);
+    pthread_mutex_unlock(&frames->lock);
+    for (int i = 0; i < frames->thread_count; i++) {
+        pthread_join(frames->threads[i], NULL);
+    }
+
+    if (frames->slots) {
+        for (uint64_t i = 0; i < frames->window; i++) {
+            free(frames->slots[i].data);
+        }
+    }
+    pthread_mutex_destroy(&frames->lock);
+    pthread_cond_destroy(&frames->changed);
+    free(frames->slots);
+    free(frames->offsets);
+    free(frames->sizes);
+    munmap((void *)frames->map, frames->size);
+    free(frames);
+}
+
+// 映射zstd文件并找出所有帧的边界，只有一帧或者帧结构有问题时返回NULL，由单线程流式解压
+static zstd_frames_t* zstd_frames_open(int fd, int threads) {
+    struct stat st;
+    if (threads < 2 || fstat(fd, &st) != 0 || st.st_size == 0) return NULL;
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) return NULL;
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    zstd_frames_t *frames = calloc(1, sizeof(zstd_frames_t));
+    if (!frames) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    frames->map = map;
+    frames->size = (uint64_t)st.st_size;
+    pthread_mutex_init(&frames->lock, NULL);
+    pthread_cond_init(&frames->changed, NULL);
+
+    uint64_t capacity = 0;
+    for (uint64_t offset = 0; offset < frames->size; ) {
+        size_t size = ZSTD_findFrameCompressedSize(frames->map + offset, (size_t)(frames->size - offset));
+        if (ZSTD_isError(size) || size == 0) {
+            zstd_frames_free(frames);
+            return NULL;
+        }
+        if (frames->count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            uint64_t *offsets = realloc(frames->offsets, capacity * sizeof(uint64_t));
+            if (offsets) frames->offsets = offsets;
+            uint64_t *sizes = realloc(frames->sizes, capacity * sizeof(uint64_t));
+            if (sizes) frames->sizes = sizes;
+            if (!offsets || !sizes) {
+                zstd_frames_free(frames);
+                return NULL;
+            }
+        }
+        frames->offsets[frames->count] = offset;
+        frames->sizes[frames->count++] = size;
+        offset += size;
+    }
+
+    if (frames->count < 2) {
+        zstd_frames_free(frames);
+        return NULL;
+    }
+
+    frames->thread_count = threads < (int)frames->count ? threads : (int)frames->count;
+    frames->window = (uint64_t)frames->thread_count * 2;
+    frames->slots = calloc(frames->window, sizeof(zstd_slot_t));
+    if (!frames->slots) {
+        zstd_frames_free(frames);
+        return NULL;
+    }
+
+    int started = 0;
+    for (int i = 0; i < frames->thread_count; i++) {
+        if (pthread_create(&frames->threads[started], NULL, zstd_frame_worker, frames) == 0) {
+            started++;
+        }
+    }
+    frames->thread_count = started;
+    if (started == 0) {
+        zstd_frames_free(frames);
+        return NULL;
+    }
+    return frames;
+}
+
+// 按帧号顺序读出并行解压的结果
+static size_t zstd_frames_read(stream_decoder_t *dec, char *out, size_t capacity) {
+    zstd_frames_t *frames = dec->frames;
+    size_t produced = 0;
+
+    pthread_mutex_lock(&frames->lock);
+    while (produced < capacity) {
+        if (frames->current >= frames->count || frames->stopping) {
+            dec->done = true;
+            break;
+        }
+
+        zstd_slot_t *slot = &frames->slots[frames->current % frames->window];
+        while (!slot->ready && !frames->stopping) {
+            pthread_cond_wait(&frames->changed, &frames->lock);
+        }
+        if (!slot->ready) continue;
+
+        size_t n = slot->len - frames->current_pos;
+        if (n > capacity - produced) n = capacity - produced;
+        memcpy(out + produced, slot->data + frames->current_pos, n);
+        produced += n;
+        frames->current_pos += n;
+
+        if (frames->current_pos == slot->len) {
+            free(slot->data);
+            slot->data = NULL;
+            slot->ready = false;
+            frames->consumed += frames->sizes[frames->current];
+            frames->current++;
+            frames->current_pos = 0;
+            pthread_cond_broadcast(&frames->changed);
+        }
+    }
+    pthread_mutex_unlock(&frames->lock);
+    return produced;
+}
+
+// 初始化解压器；xz用liblzma的多线程解码，多帧zstd用并行帧解压
+static bool decoder_init(stream_decoder_t *dec, int fd, dict_compression_t type, int threads) {
+    memset(dec, 0, sizeof(*dec));
+    dec->type = type;
+    dec->fd = fd;
+
+    if (type == DICT_ZSTD) {
+        dec->frames = zstd_frames_open(fd, threads);
+        if (dec->frames) return true;
+    }
+
+    dec->in = malloc(STREAM_INPUT_SIZE);
+    if (!dec->in) return false;
+
+    bool ok = false;
+    switch (type) {
+        case DICT_GZIP:
+            // 15+32：自动识别gzip和zlib头
+            ok = inflateInit2(&dec->z, 15 + 32) == Z_OK;
+            break;
+        case DICT_BZIP2:
+            ok = BZ2_bzDecompressInit(&dec->bz, 0, 0) == BZ_OK;
+            break;
+        case DICT_XZ: {
+            lzma_stream init = LZMA_STREAM_INIT;
+            dec->lz = init;
+#if LZMA_VERSION >= 50040002
+            if (threads > 1) {
+                lzma_mt mt;
+                memset(&mt, 0, sizeof(mt));
+                mt.flags = LZMA_CONCATENATED;
+                mt.threads = (uint32_t)threads;
+                mt.memlimit_threading = lzma_physmem() / 4;
+                mt.memlimit_stop = UINT64_MAX;
+                ok = lzma_stream_decoder_mt(&dec->lz, &mt) == LZMA_OK;
+                break;
+            }
+#endif
+            ok = lzma_stream_decoder(&dec->lz, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+            break;
+        }
+        case DICT_ZSTD:
+            dec->zs = ZSTD_createDStream();
+            ok = dec->zs && !ZSTD_isError(ZSTD_initDStream(dec->zs));
+            break;
+        default:
+            break;
+    }
+
+    if (!ok) {
+        free(dec->in);
+        dec->in = NULL;
+    }
+    return ok;
+}
+
+// 释放解压器
+static void decoder_end(stream_decoder_t *dec) {
+    switch (dec->type) {
+        case DICT_GZIP:
+            inflateEnd(&dec->z);
+            break;
+        case DICT_BZIP2:
+            BZ2_bzDecompressEnd(&dec->bz);
+            break;
+        case DICT_XZ:
+            lzma_end(&dec->lz);
+            break;
+        case DICT_ZSTD:
+            ZSTD_freeDStream(dec->zs);
+            break;
+        default:
+            break;
+    }
+    zstd_frames_free(dec->frames);
+    free(dec->in);
+    memset(dec, 0, sizeof(*dec));
+}
+
+// 输入缓冲区用完时从文件读下一段
+static void decoder_fill(stream_decoder_t *dec) {
+    if (dec->in_pos < dec->in_len || dec->input_done) return;
+
+    ssize_t n = pread(dec->fd, dec->in, STREAM_INPUT_SIZE, (off_t)dec->offset);
+    if (n <= 0) {
+        dec->input_done = true;
+        dec->in_len = dec->in_pos = 0;
+        return;
+    }
+    dec->offset += (uint64_t)n;
+    dec->in_len = (size_t)n;
+    dec->in_pos = 0;
+}
+
+// 已经消耗的压缩字节数
+static uint64_t decoder_consumed(const stream_decoder_t *dec) {
+    if (dec->frames) return dec->frames->consumed;
+    return dec->offset - (dec->in_len - dec->in_pos);
+}
+
+// 解压出最多capacity字节，到结尾或出错时置done；首尾相接的多个gzip成员/bzip2流/zstd帧都会读完
+static size_t decoder_read(stream_decoder_t *dec, char *out, size_t capacity) {
+    if (dec->frames) return zstd_frames_read(dec, out, capacity);
+
+    size_t produced = 0;
+    while (produced < capacity && !dec->done) {
+        decoder_fill(dec);
+        size_t before_in = dec->in_pos;
+        size_t before_out = produced;
+
+        switch (dec->type) {
+            case DICT_GZIP: {
+                dec->z.next_in = dec->in + dec->in_pos;
+                dec->z.avail_in = (uInt)(dec->in_len - dec->in_pos);
+                dec->z.next_out = (Bytef *)out + produced;
+                dec->z.avail_out = (uInt)(capacity - produced);
+                int ret = inflate(&dec->z, Z_NO_FLUSH);
+                dec->in_pos = dec->in_len - dec->z.avail_in;
+                produced = capacity - dec->z.avail_out;
+                if (ret == Z_STREAM_END) {
+                    decoder_fill(dec);
+                    if (dec->in_pos < dec->in_len) {
+                        inflateReset(&dec->z);
+                    } else {
+                        dec->done = true;
+                    }
+                } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                    dec->done = true;
+                }
+                break;
+            }
+            case DICT_BZIP2: {
+                dec->bz.next_in = (char *)dec->in + dec->in_pos;
+                dec->bz.avail_in = (unsigned int)(dec->in_len - dec->in_pos);
+                dec->bz.next_out = out + produced;
+                dec->bz.avail_out = (unsigned int)(capacity - produced);
+                int ret = BZ2_bzDecompress(&dec->bz);
+                dec->in_pos = dec->in_len - dec->bz.avail_in;
+                produced = capacity - dec->bz.avail_out;
+                if (ret == BZ_STREAM_END) {
+                    decoder_fill(dec);
+                    if (dec->in_pos < dec->in_len) {
+                        BZ2_bzDecompressEnd(&dec->bz);
+                        dec->done = BZ2_bzDecompressInit(&dec->bz, 0, 0) != BZ_OK;
+                    } else {
+                        dec->done = true;
+                    }
+                } else if (ret != BZ_OK) {
+                    dec->done = true;
+                }
+                break;
+            }
+            case DICT_XZ: {
+                dec->lz.next_in = dec->in + dec->in_pos;
+                dec->lz.avail_in = dec->in_len - dec->in_pos;
+                dec->lz.next_out = (uint8_t *)out + produced;
+                dec->lz.avail_out = capacity - produced;
+                lzma_ret ret = lzma_code(&dec->lz, dec->input_done ? LZMA_FINISH : LZMA_RUN);
+                dec->in_pos = dec->in_len - dec->lz.avail_in;
+                produced = capacity - dec->lz.avail_out;
+                if (ret != LZMA_OK) {
+                    dec->done = true;
+                }
+                break;
+            }
+            case DICT_ZSTD: {
+                ZSTD_inBuffer in = { dec->in + dec->in_pos, dec->in_len - dec->in_pos, 0 };
+                ZSTD_outBuffer o = { out + produced, capacity - produced, 0 };
+                size_t ret = ZSTD_decompressStream(dec->zs, &o, &in);
+                dec->in_pos += in.pos;
+                produced += o.pos;
+                if (ZSTD_isError(ret)) {
+                    dec->done = true;
+                }
+                break;
+            }
+            default:
+                dec->done = true;
+                break;
+        }
+
+        // 输入已经读完且这一轮没有任何进展：正常结尾或者文件被截断
+        if (!dec->done && dec->input_done &&
+            dec->in_pos == before_in && produced == before_out) {
+            dec->done = true;
+        }
+    }
+    return produced;
+}
+
+// 统计换行符
+static uint64_t count_lines_in(const char *data, size_t len) {
+    uint64_t count = 0;
+    const char *end = data + len;
+    while (data < end && (data = memchr(data, '\n', (size_t)(end - data))) != NULL) {
+        count++;
+        data++;
+    }
+    return count;
+}
+
+// 从空闲块里取一个，解压流关闭时返回-1
+static int take_free_block(dict_stream_t *stream) {
+    pthread_mutex_lock(&stream->lock);
+    while (stream->free_count == 0 && !stream->stopping) {
+        pthread_cond_wait(&stream->changed, &stream->lock);
+    }
+    int block = stream->stopping ? -1 : stream->free_blocks[--stream->free_count];
+    pthread_mutex_unlock(&stream->lock);
+    return block;
+}
+
+// 归还一个块，调用时持有锁
+static void release_block_locked(dict_stream_t *stream, int block) {
+    stream->free_blocks[stream->free_count++] = block;
+    pthread_cond_broadcast(&stream->changed);
+}
+
+// 后台解压线程：把解压结果切成只含完整行的块，块末尾的半行带到下一块
+static void* stream_producer(void *arg) {
+    dict_stream_t *stream = (dict_stream_t *)arg;
+    stream_decoder_t *dec = &stream->decoder;
+    char *carry = malloc(STREAM_BLOCK_SIZE);
+    size_t carry_len = 0;
+    bool skipping = false;   // 正在丢弃一条比整块还长的行
+
+    while (carry) {
+        int index = take_free_block(stream);
+        if (index < 0) break;
+        stream_block_t *block = &stream->blocks[index];
+
+        memcpy(block->data, carry, carry_len);
+        size_t len = carry_len;
+        carry_len = 0;
+        while (len < STREAM_BLOCK_SIZE && !dec->done) {
+            len += decoder_read(dec, block->data + len, STREAM_BLOCK_SIZE - len);
+        }
+
+        // 丢弃超长行剩下的部分
+        size_t start = 0;
+        if (skipping) {
+            char *newline = memchr(block->data, '\n', len);
+            if (newline) {
+                start = (size_t)(newline - block->data) + 1;
+                skipping = false;
+            } else {
+                start = len;
+            }
+        }
+
+        // 最后一个换行符之后的半行留给下一块；整块没有换行符时这一行太长，丢弃到下一个换行符
+        size_t end = len;
+        if (!dec->done && !skipping) {
+            char *newline = memrchr(block->data + start, '\n', len - start);
+            if (newline) {
+                end = (size_t)(newline - block->data) + 1;
+            } else if (start > 0) {
+                end = start;
+            } else {
+                end = start;
+                skipping = true;
+            }
+            if (!skipping) {
+                carry_len = len - end;
+                memcpy(carry, block->data + end, carry_len);
+            }
+        }
+
+        if (start > 0 && end > start) {
+            memmove(block->data, block->data + start, end - start);
+        }
+        block->len = end > start ? end - start : 0;
+
+        uint64_t lines = count_lines_in(block->data, block->len);
+        if (dec->done && block->len > 0 && block->data[block->len - 1] != '\n') {
+            lines++;
+        }
+
+        pthread_mutex_lock(&stream->lock);
+        stream->lines += lines;
+        stream->consumed = decoder_consumed(dec);
+        if (block->len > 0) {
+            stream->ready[(stream->ready_head + stream->ready_count++) % stream->block_count] = index;
+            pthread_cond_broadcast(&stream->changed);
+        } else {
+            release_block_locked(stream, index);
+        }
+        pthread_mutex_unlock(&stream->lock);
+
+        if (dec->done) break;
+    }
+
+    free(carry);
+    pthread_mutex_lock(&stream->lock);
+    stream->finished = true;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+    return NULL;
+}
+
+// 打开压缩字典的解压流，接管fd；解压线程在第一次领取块时才启动
+dict_stream_t* dict_stream_open(int fd, dict_compression_t type, int readers) {
+    struct stat st;
+    dict_stream_t *stream = calloc(1, sizeof(dict_stream_t));
+    if (!stream || fstat(fd, &st) != 0) {
+        free(stream);
+        close(fd);
+        return NULL;
+    }
+
+    int cpus = get_cpu_count();
+    stream->fd = fd;
+    stream->size = (uint64_t)st.st_size;
+    stream->type = type;
+    stream->decode_threads = cpus < STREAM_DECODE_THREADS ? cpus : STREAM_DECODE_THREADS;
+    stream->block_count = (readers > 0 ? readers : 1) * 2 + 2;
+    stream->blocks = calloc((size_t)stream->block_count, sizeof(stream_block_t));
+    stream->ready = calloc((size_t)stream->block_count, sizeof(int));
+    stream->free_blocks = calloc((size_t)stream->block_count, sizeof(int));
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->changed, NULL);
+
+    if (!stream->blocks || !stream->ready || !stream->free_blocks) {
+        dict_stream_close(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+// 启动后台解压线程，块缓冲区这时才分配
+static bool stream_start_locked(dict_stream_t *stream) {
+    stream->started = true;
+
+    for (int i = 0; i < stream->block_count; i++) {
+        stream->blocks[i].data = malloc(STREAM_BLOCK_SIZE);
+        if (!stream->blocks[i].data) return false;
+        stream->free_blocks[stream->free_count++] = i;
+    }
+
+    if (!decoder_init(&stream->decoder, stream->fd, stream->type, stream->decode_threads)) {
+        return false;
+    }
+    if (pthread_create(&stream->producer, NULL, stream_producer, stream) != 0) {
+        decoder_end(&stream->decoder);
+        return false;
+    }
+    stream->running = true;
+    return true;
+}
+
+// 归还上一块并领取下一个解压好的块，全部解压完后返回false
+bool dict_stream_next_chunk(dict_stream_t *stream, dict_chunk_t *chunk) {
+    pthread_mutex_lock(&stream->lock);
+
+    if (chunk->stream) {
+        release_block_locked(stream, chunk->block);
+        chunk->stream = NULL;
+    }
+
+    if (!stream->started && !stream_start_locked(stream)) {
+        print_error("无法启动%s字典的解压线程", dict_compression_name(stream->type));
+        stream->finished = true;
+    }
+
+    while (stream->ready_count == 0 && !stream->finished) {
+        pthread_cond_wait(&stream->changed, &stream->lock);
+    }
+    if (stream->ready_count == 0) {
+        pthread_mutex_unlock(&stream->lock);
+        return false;
+    }
+
+    int index = stream->ready[stream->ready_head];
+    stream->ready_head = (stream->ready_head + 1) % stream->block_count;
+    stream->ready_count--;
+    pthread_mutex_unlock(&stream->lock);
+
+    memset(chunk, 0, sizeof(*chunk));
+    chunk->data = stream->blocks[index].data;
+    chunk->len = stream->blocks[index].len;
+    chunk->stream = stream;
+    chunk->block = index;
+    return true;
+}
+
+// 单独解压一段统计行数；limit为0时解压整个文件
+static uint64_t stream_sample(dict_stream_t *stream, uint64_t limit, bool *complete, uint64_t *consumed) {
+    stream_decoder_t dec;
+    *complete = false;
+    *consumed = 0;
+    if (!decoder_init(&dec, stream->fd, stream->type, 1)) return 0;
+
+    char *buffer = malloc(STREAM_BLOCK_SIZE);
+    uint64_t lines = 0;
+    uint64_t total = 0;
+    char last = '\n';
+    while (buffer && !dec.done && (limit == 0 || total < limit)) {
+        size_t n = decoder_read(&dec, buffer, STREAM_BLOCK_SIZE);
+        if (n == 0) continue;
+        lines += count_lines_in(buffer, n);
+        total += n;
+        last = buffer[n - 1];
+    }
+    if (dec.done && last != '\n') {
+        lines++;
+    }
+
+    *complete = buffer && dec.done;
+    *consumed = decoder_consumed(&dec);
+    free(buffer);
+    decoder_end(&dec);
+    return lines;
+}
+
+// 解压开头一段估计行数：按每个压缩字节对应的行数推算整个文件
+uint64_t dict_stream_estimate_lines(dict_stream_t *stream, bool *exact) {
+    bool complete;
+    uint64_t consumed;
+    uint64_t lines = stream_sample(stream, STREAM_SAMPLE_SIZE, &complete, &consumed);
+
+    if (exact) *exact = complete;
+    if (complete || consumed == 0) return lines;
+
+    uint64_t estimate = (uint64_t)((double)lines / (double)consumed * (double)stream->size);
+    return estimate > lines ? estimate : lines;
+}
+
+// 解压整个文件精确计数
+uint64_t dict_stream_count_lines(dict_stream_t *stream) {
+    bool complete;
+    uint64_t consumed;
+    return stream_sample(stream, 0, &complete, &consumed);
+}
+
+// 用后台解压的进度修正估计：已解压部分精确，其余按压缩比推算；解压完后返回true
+bool dict_stream_refine(dict_stream_t *stream, uint64_t *estimate) {
+    usleep(STREAM_REFINE_INTERVAL);
+
+    pthread_mutex_lock(&stream->lock);
+    uint64_t lines = stream->lines;
+    uint64_t consumed = stream->consumed;
+    bool finished = stream->finished;
+    pthread_mutex_unlock(&stream->lock);
+
+    if (finished) {
+        *estimate = lines;
+        return true;
+    }
+    if (consumed > 0 && consumed < stream->size) {
+        *estimate = lines + (uint64_t)((double)lines / (double)consumed * (double)(stream->size - consumed));
+    }
+    return false;
+}
+
+// 关闭解压流：停止后台线程，释放块和解压器
+void dict_stream_close(dict_stream_t *stream) {
+    if (!stream) return;
+
+    pthread_mutex_lock(&stream->lock);
+    stream->stopping = true;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+
+    // 解压线程可能正等着并行解压的帧
+    if (stream->decoder.frames) {
+        zstd_frames_t *frames = stream->decoder.frames;
+        pthread_mutex_lock(&frames->lock);
+        frames->stopping = true;
+        pthread_cond_broadcast(&frames->changed);
+        pthread_mutex_unlock(&frames->lock);
+    }
+
+    if (stream->running) {
+        pthread_join(stream->producer, NULL);
+        decoder_end(&stream->decoder);
+    }
+
+    if (stream->blocks) {
+        for (int i = 0; i < stream->block_count; i++) {
+            free(stream->blocks[i].data);
+        }
+    }
+    free(stream->blocks);
+    free(stream->ready);
+    free(stream->free_blocks);
+    pthread_mutex_destroy(&stream->lock);
+    pthread_cond_destroy(&stream->changed);
+    close(stream->fd);
+    free(stream);
+}
@@ -0,0 +1,407 @@
+#include "../include/zip_cracker.h"
+
+// 由ZipCrypto内部密钥反推密码
+// 长度不超过6直接枚举前缀并由key0反解最后4个字符；
+// 更长的密码从目标密钥反向预计算最后6个字符的约束，与正向枚举的前缀在中间相遇
+
+#define MULT    0x08088405u
+#define MULTINV 0xD94FA8CDu
+
+#define MASK_24_32 0xFF000000u
+#define MAXDIFF_24 (0x00FFFFFFu + 0xFF)
+
+// 直接反解能覆盖的最大长度
+#define KEY_DIRECT_MAX_LENGTH 6
+
+// 默认字符集：可打印ASCII
+#define KEY_DEFAULT_CHARSET \
+    " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~"
+
+static const uint32_t *crc_tab;
+static uint32_t crcinv_tab[256];
+static uint8_t fiber2[256][8];
+static uint8_t fiber2_count[256];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+// 反向预计算的结果（只读，所有线程共享）
+typedef struct {
+    zip_crypto_keys_t target;
+    const uint8_t *charset;
+    size_t charset_len;
+    bool allowed[256];
+    int length;
+    uint32_t y5;
+    uint32_t z[7];                 // z[4..6]精确，z[1..3]只有最高字节有意义
+    uint8_t z0_16_32[1 << 13];     // 可能的Z0[16,32)位图
+    uint8_t zm1_24_32[1 << 5];     // 可能的Z{-1}[24,32)位图
+    size_t next;                   // 第一个前缀字符的分配游标
+    bool found;
+    char password[MAX_KEY_PASSWORD_LENGTH + 1];
+    attack_status_t *status;
+    pthread_mutex_t lock;
+} key_search_t;
+
+// 单个线程的工作状态
+typedef struct {
+    key_search_t *search;
+    uint8_t prefix[MAX_KEY_PASSWORD_LENGTH];
+    uint32_t x[7];
+    uint32_t y[7];
+    uint32_t z[7];
+    uint8_t p[6];
+} key_worker_t;
+
+static inline uint8_t lsb(uint32_t x) { return (uint8_t)x; }
+static inline uint8_t msb(uint32_t x) { return (uint8_t)(x >> 24); }
+
+static inline uint32_t crc32_step(uint32_t pval, uint8_t b) {
+    return (pval >> 8) ^ crc_tab[lsb(pval) ^ b];
+}
+
+static inline uint32_t crc32_inv(uint32_t crc, uint8_t b) {
+    return (crc << 8) ^ crcinv_tab[msb(crc)] ^ b;
+}
+
+static inline bool bit_test(const uint8_t *bits, uint32_t i) {
+    return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+static inline void bit_set(uint8_t *bits, uint32_t i) {
+    bits[i >> 3] |= (uint8_t)(1 << (i & 7));
+}
+
+// 初始化查找表
+static void init_tables(void) {
+    crc_tab = zip_crypto_get_crc_table();
+    for (int b = 0; b < 256; b++) {
+        crcinv_tab[crc_tab[b] >> 24] = (crc_tab[b] << 8) ^ (uint32_t)b;
+    }
+
+    uint32_t prodinv = 0;
+    for (int x = 0; x < 256; x++, prodinv += MULTINV) {
+        uint8_t m = msb(prodinv);
+        fiber2[m][fiber2_count[m]++] = (uint8_t)x;
+        fiber2[(uint8_t)(m + 1)][fiber2_count[(uint8_t)(m + 1)]++] = (uint8_t)x;
+    }
+}
+
+// 用一个密码字节更新密钥
+static inline void keys_update(zip_crypto_keys_t *k, uint8_t c) {
+    k->key0 = crc32_step(k->key0, c);
+    k->key1 = (k->key1 + lsb(k->key0)) * MULT + 1;
+    k->key2 = crc32_step(k->key2, msb(k->key1));
+}
+
+static inline bool keys_equal(const zip_crypto_keys_t *a, const zip_crypto_keys_t *b) {
+    return a->key0 == b->key0 && a->key1 == b->key1 && a->key2 == b->key2;
+}
+
+// 记录找到的密码
+static void report_password(key_search_t *s, const uint8_t *bytes, int len) {
+    pthread_mutex_lock(&s->lock);
+    if (!s->found) {
+        memcpy(s->password, bytes, (size_t)len);
+        s->password[len] = '\0';
+        s->found = true;
+    }
+    pthread_mutex_unlock(&s->lock);
+}
+
+// 已知前缀后的状态，由key0直接反解最后4个字符并验证key1/key2
+static bool solve_last_four(key_search_t *s, const zip_crypto_keys_t *state, uint8_t *tail) {
+    uint32_t x = s->target.key0;
+    for (int i = 0; i < 4; i++) {
+        x = crc32_inv(x, 0);
+    }
+    x ^= state->key0;
+
+    zip_crypto_keys_t k = *state;
+    for (int i = 0; i < 4; i++) {
+        tail[i] = (uint8_t)(x >> (8 * i));
+        if (!s->allowed[tail[i]]) {
+            return false;
+        }
+        keys_update(&k, tail[i]);
+    }
+    return keys_equal(&k, &s->target);
+}
+
+// 直接搜索：枚举 length-4 个前缀字符（不足4个时全部枚举）
+static bool direct_search(key_search_t *s, zip_crypto_keys_t state, uint8_t *buf, int depth) {
+    int length = s->length;
+
+    if (length >= 4 && depth == length - 4) {
+        if (solve_last_four(s, &state, buf + depth)) {
+            report_password(s, buf, length);
+            return true;
+        }
+        return false;
+    }
+    if (depth == length) {
+        if (keys_equal(&state, &s->target)) {
+            report_password(s, buf, length);
+            return true;
+        }
+        return false;
+    }
+
+    for (size_t i = 0; i < s->charset_len; i++) {
+        zip_crypto_keys_t next = state;
+        buf[depth] = s->charset[i];
+        keys_update(&next, buf[depth]);
+        if (direct_search(s, next, buf, depth + 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 从目标密钥反向预计算最后6个字符对Z0/Z{-1}的约束
+static void precompute_tail(key_search_t *s) {
+    uint32_t x6 = s->target.key0;
+    uint32_t y6 = s->target.key1;
+    s->z[6] = s->target.key2;
+    s->y5 = (y6 - 1) * MULTINV - lsb(x6);
+    s->z[5] = crc32_inv(s->z[6], msb(y6));
+    s->z[4] = crc32_inv(s->z[5], msb(s->y5));
+
+    memset(s->z0_16_32, 0, sizeof(s->z0_16_32));
+    memset(s->zm1_24_32, 0, sizeof(s->zm1_24_32));
+
+    for (size_t i = 0; i < s->charset_len; i++) {
+        uint32_t x5 = crc32_inv(x6, s->charset[i]);
+        uint32_t y4 = (s->y5 - 1) * MULTINV - lsb(x5);
+        uint32_t z3 = crc32_inv(s->z[4], msb(y4));
+
+        for (size_t j = 0; j < s->charset_len; j++) {
+            uint32_t x4 = crc32_inv(x5, s->charset[j]);
+            uint32_t y3 = (y4 - 1) * MULTINV - lsb(x4);
+            uint32_t z2 = crc32_inv(z3, msb(y3));
+            uint32_t z1 = crc32_inv(z2, 0);
+            uint32_t z0 = crc32_inv(z1, 0);
+
+            // Z3[8,32)、Z2[16,32)、Z1[24,32)与猜测的字符无关
+            s->z[3] = z3;
+            s->z[2] = z2;
+            s->z[1] = z1;
+
+            bit_set(s->z0_16_32, z0 >> 16);
+            bit_set(s->zm1_24_32, crc32_inv(z0, 0) >> 24);
+        }
+    }
+}
+
+// Y列表完整后推出X列表和最后6个字符
+static void finish_tail(key_worker_t *w, const zip_crypto_keys_t *initial, int prefix_len) {
+    key_search_t *s = w->search;
+
+    // 只有X1的最低字节还未确定，X2..X5的最低字节来自Y列表
+    uint32_t x[7];
+    memcpy(x, w->x, sizeof(x));
+    x[0] = initial->key0;
+    x[1] = (w->y[1] - 1) * MULTINV - w->y[0];
+    if (x[1] > 0xFF) return;
+
+    for (int j = 5; j >= 0; j--) {
+        uint32_t xi_xor_pi = crc32_inv(x[j + 1], 0);
+        w->p[j] = lsb(xi_xor_pi ^ x[j]);
+        x[j] = xi_xor_pi ^ w->p[j];
+    }
+    if (x[0] != initial->key0) return;
+
+    zip_crypto_keys_t k = *initial;
+    for (int j = 0; j < 6; j++) {
+        if (!s->allowed[w->p[j]]) return;
+        keys_update(&k, w->p[j]);
+    }
+    if (!keys_equal(&k, &s->target)) return;
+
+    uint8_t password[MAX_KEY_PASSWORD_LENGTH];
+    memcpy(password, w->prefix, (size_t)prefix_len);
+    memcpy(password + prefix_len, w->p, 6);
+    report_password(s, password, prefix_len + 6);
+}
+
+// 由Y5反推Y4..Y1，同时得到X5..X2的最低字节
+static void explore_ylists(key_worker_t *w, int i, const zip_crypto_keys_t *initial, int prefix_len) {
+    if (i == 1) {
+        finish_tail(w, initial, prefix_len);
+        return;
+    }
+
+    uint32_t fy = (w->y[i] - 1) * MULTINV;
+    uint32_t ffy = (fy - 1) * MULTINV;
+    uint8_t m = msb(ffy - (w->y[i - 2] & MASK_24_32));
+
+    for (int f = 0; f < fiber2_count[m]; f++) {
+        uint8_t xi_0_8 = fiber2[m][f];
+        uint32_t yim1 = fy - xi_0_8;
+
+        if (ffy - xi_0_8 * MULTINV - (w->y[i - 2] & MASK_24_32) <= MAXDIFF_24 &&
+            msb(yim1) == msb(w->y[i - 1])) {
+            w->y[i - 1] = yim1;
+            w->x[i] = xi_0_8;
+            explore_ylists(w, i - 1, initial, prefix_len);
+        }
+    }
+}
+
+// 已知前缀后的完整状态，恢复最后6个字符
+static void solve_last_six(key_worker_t *w, const zip_crypto_keys_t *initial, int prefix_len) {
+    key_search_t *s = w->search;
+
+    if (!bit_test(s->z0_16_32, initial->key2 >> 16)) return;
+
+    w->x[6] = s->target.key0;
+    w->y[0] = initial->key1;
+    w->y[5] = s->y5;
+    w->y[6] = s->target.key1;
+    w->z[0] = initial->key2;
+
+    // 补全Z1..Z4并得到Y1..Y4的最高字节
+    for (int i = 1; i <= 4; i++) {
+        uint8_t yi_24_32 = lsb(crcinv_tab[msb(s->z[i])]) ^ lsb(w->z[i - 1]);
+        w->y[i] = (uint32_t)yi_24_32 << 24;
+        w->z[i] = crc32_step(w->z[i - 1], yi_24_32);
+    }
+    if (w->z[4] != s->z[4]) return;
+
+    explore_ylists(w, 5, initial, prefix_len);
+}
+
+// 正向枚举前缀，剩6个字符时与反向约束相遇
+static void mitm_search(key_worker_t *w, zip_crypto_keys_t state, int depth) {
+    key_search_t *s = w->search;
+    if (s->found || s->status->stop) return;
+
+    int remaining = s->length - depth;
+    if (remaining == 6) {
+        solve_last_six(w, &state, depth);
+        return;
+    }
+    if (remaining == 7 && !bit_test(s->zm1_24_32, state.key2 >> 24)) {
+        return;
+    }
+
+    for (size_t i = 0; i < s->charset_len; i++) {
+        zip_crypto_keys_t next = state;
+        w->prefix[depth] = s->charset[i];
+        keys_update(&next, w->prefix[depth]);
+        mitm_search(w, next, depth + 1);
+    }
+}
+
+// 工作线程：按第一个前缀字符分配任务
+static void* key_worker(void *arg) {
+    key_search_t *s = (key_search_t*)arg;
+    key_worker_t w;
+    memset(&w, 0, sizeof(w));
+    w.search = s;
+
+    while (!s->found && !s->status->stop) {
+        pthread_mutex_lock(&s->lock);
+        size_t i = s->next++;
+        pthread_mutex_unlock(&s->lock);
+
+        if (i >= s->charset_len) {
+            break;
+        }
+
+        zip_crypto_keys_t state;
+        zip_crypto_init_keys(&state, (const char*)&s->charset[i], 1);
+        w.prefix[0] = s->charset[i];
+        mitm_search(&w, state, 1);
+
+        pthread_mutex_lock(&s->status->lock);
+        s->status->tried_passwords++;
+        pthread_mutex_unlock(&s->status->lock);
+    }
+
+    return NULL;
+}
+
+// 由内部密钥恢复不超过max_length的密码
+bool zip_crypto_recover_password(const zip_crypto_keys_t *keys, const char *charset, int max_length,
+                                 int thread_count, attack_status_t *status, char *password) {
+    if (!keys || !status || !password) return false;
+
+    pthread_once(&tables_once, init_tables);
+
+    if (!charset || !*charset) {
+        charset = KEY_DEFAULT_CHARSET;
+    }
+    if (max_length > MAX_KEY_PASSWORD_LENGTH) {
+        max_length = MAX_KEY_PASSWORD_LENGTH;
+    }
+    if (thread_count <= 0) {
+        thread_count = get_cpu_count();
+    }
+
+    key_search_t *s = calloc(1, sizeof(key_search_t));
+    if (!s) return false;
+
+    s->target = *keys;
+    s->status = status;
+    pthread_mutex_init(&s->lock, NULL);
+
+    // 去重后的字符集
+    uint8_t *unique = malloc(256);
+    if (!unique) {
+        pthread_mutex_destroy(&s->lock);
+        free(s);
+        return false;
+    }
+    for (const uint8_t *c = (const uint8_t*)charset; *c; c++) {
+        if (!s->allowed[*c]) {
+            s->allowed[*c] = true;
+            unique[s->charset_len++] = *c;
+        }
+    }
+    s->charset = unique;
+
+    bool found = false;
+    for (int length = 0; length <= max_length && !found && !status->stop; length++) {
+        s->length = length;
+
+        if (length <= KEY_DIRECT_MAX_LENGTH) {
+            uint8_t buf[MAX_KEY_PASSWORD_LENGTH];
+            zip_crypto_keys_t initial;
+            zip_crypto_init_keys(&initial, "", 0);
+            found = direct_search(s, initial, buf, 0);
+            continue;
+        }
+
+        print_info("正在由内部密钥搜索 %d 位密码...", length);
+        precompute_tail(s);
+        s->next = 0;
+
+        pthread_mutex_lock(&status->lock);
+        status->tried_passwords = 0;
+        status->total_passwords = s->charset_len;
+        pthread_mutex_unlock(&status->lock);
+
+        pthread_t *threads = calloc(thread_count, sizeof(pthread_t));
+        int started = 0;
+        for (int i = 0; threads && i < thread_count; i++) {
+            if (pthread_create(&threads[i], NULL, key_worker, s) != 0) {
+                break;
+            }
+            started++;
+        }
+        for (int i = 0; i < started; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        free(threads);
+        found = s->found;
+    }
+
+    if (s->found) {
+        strcpy(password, s->password);
+    }
+
+    found = s->found;
+    pthread_mutex_destroy(&s->lock);
+    free(unique);
+    free(s);
+    return found;
+}
@@ -8,7 +8,7 @@ static thread_pool_t *g_thread_pool = NULL;
 // 信号处理函数
 void signal_handler(int sig) {
     if (g_thread_pool) {
-        printf("\n[!] 收到中断信号，正在停止攻击...\n");
+        fprintf(message_stream(), "\n[!] 收到中断信号，正在停止攻击...\n");
         stop_attack(g_thread_pool);
     }
     exit(0);
@@ -19,8 +19,30 @@ void print_usage(const char *program_name) {
     printf("\n选项:\n");
     printf("  -d, --dict <文件>     指定字典文件 (默认: password_list.txt)\n");
     printf("  -t, --threads <数量>  指定线程数 (默认: CPU核心数 * 4)\n");
-    printf("  -m, --mode <模式>     攻击模式: dict|brute|crc|hybrid (默认: hybrid)\n");
-    printf("  -o, --output <目录>   解压输出目录 (默认: ./extracted)\n");
+    printf("  -m, --mode <模式>     攻击模式: dict|brute|crc|hybrid|plain (默认: hybrid)\n");
+    printf("  -o, --output <目录>   解压输出目录，- 表示写到标准输出 (默认: ./extracted)\n");
+    printf("  -p, --plaintext <文件> 已知明文文件 (plain模式)\n");
+    printf("  -e, --plain-entry <名称> 已知明文对应的加密条目\n");
+    printf("  -O, --plain-offset <偏移> 已知明文在条目数据中的偏移 (默认: 0)\n");
+    printf("  -k, --keys <k0> <k1> <k2> 已知的ZipCrypto内部密钥（十六进制）\n");
+    printf("  -c, --charset <字符>  由密钥反推密码时使用的字符集 (默认: 可打印ASCII)\n");
+    printf("  -L, --max-length <长度> 由密钥反推密码的最大长度 (默认: %d)\n", DEFAULT_KEY_PASSWORD_LENGTH);
+    printf("  -M, --mask <掩码|文件> 暴力破解使用的掩码或.hcmask文件，如 ?u?l?l?l?d?d (默认: 1-8位数字)\n");
+    printf("  -1/-2/-3/-4 <字符集>  自定义字符集，在掩码中用 ?1-?4 引用，如 -1 ?l?d_\n");
+    printf("      --markov <文件>  用字典或potfile(.pot)训练按位置的Markov模型，暴力破解按概率从高到低枚举\n");
+    printf("      --markov-length <最小>-<最大> Markov候选的长度范围 (默认: 1-8)\n");
+    printf("      --markov-threshold <级别> 候选各位置级别之和的上限，每级概率减半 (默认: 自动)\n");
+    printf("  -r, --rules <文件>    对字典的每个词应用规则文件中的所有规则（hashcat/John规则语法）\n");
+    printf("      --combinator <文件> 组合攻击：字典的每个词接上此文件中的每个词\n");
+    printf("      --separator <字符串> 组合攻击中两个词之间的分隔符，可重复指定 (默认: 直接拼接)\n");
+    printf("      --prince <文件>  PRINCE攻击：把文件中的词拼接成链，按长度和链的候选数从少到多枚举\n");
+    printf("      --prince-length <最小>-<最大> PRINCE候选的长度范围 (默认: 1-16)\n");
+    printf("      --prince-elements <数量> 每个PRINCE候选最多由几个词组成 (默认: 4)\n");
+    printf("      --test           找到密码后只在内存中解压检查各条目，不写任何文件\n");
+    printf("  -i, --increment      增量模式：从短到长依次尝试掩码的前缀\n");
+    printf("      --increment-min <长度> 增量模式的最小长度 (默认: 1)\n");
+    printf("      --increment-max <长度> 增量模式的最大长度 (默认: 掩码长度)\n");
+    printf("  -b, --benchmark      测试各指令集的ZipCrypto/AES/7z/RAR校验速度\n");
     printf("  -h, --help           显示此帮助信息\n");
     printf("\n支持的压缩包格式:\n");
     printf("  - ZIP (.zip)\n");
@@ -30,6 +52,64 @@ void print_usage(const char *program_name) {
     printf("  %s target.zip\n", program_name);
     printf("  %s -d mydict.txt -t 8 target.zip\n", program_name);
     printf("  %s -m crc target.zip\n", program_name);
+    printf("  %s -m plain -p plain.txt -e secret.txt target.zip\n", program_name);
+    printf("  %s -k 8879dfed 14335b6b 8dc58b53 -c abcdef0123456789 target.zip\n", program_name);
+    printf("  %s -M ?u?l?l?l?l?d?d -i --increment-min 5 target.zip\n", program_name);
+    printf("  %s -m brute -1 ?l?d -M ?1?1?1?1?1?1 target.7z\n", program_name);
+    printf("  %s -m dict -d words.txt -r best64.rule target.zip\n", program_name);
+    printf("  %s --markov rockyou.txt --markov-length 6-9 target.zip\n", program_name);
+    printf("  %s -d first.txt --combinator last.txt --separator \"\" --separator _ target.zip\n", program_name);
+    printf("  %s --prince words.txt --prince-length 8-14 --prince-elements 3 target.7z\n", program_name);
+    printf("\n预编译字典:\n");
+    printf("  %s compile-dict [--order input|freq|length] -o <输出文件> <字典>...\n", program_name);
+    printf("  编译后的文件可直接用 -d 指定，启动时不再逐行解析和计数\n");
+}
+
+// compile-dict子命令：把一个或多个字典编译成二进制格式
+static int run_compile_dict(int argc, char *argv[]) {
+    const char *output = NULL;
+    dict_order_t order = DICT_ORDER_INPUT;
+    
+    static struct option compile_options[] = {
+        {"output", required_argument, 0, 'o'},
+        {"order", required_argument, 0, 'r'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    
+    int opt;
+    while ((opt = getopt_long(argc, argv, "o:r:h", compile_options, NULL)) != -1) {
+        switch (opt) {
+            case 'o':
+                output = optarg;
+                break;
+            case 'r':
+                if (strcmp(optarg, "input") == 0) {
+                    order = DICT_ORDER_INPUT;
+                } else if (strcmp(optarg, "freq") == 0) {
+                    order = DICT_ORDER_FREQUENCY;
+                } else if (strcmp(optarg, "length") == 0) {
+                    order = DICT_ORDER_LENGTH;
+                } else {
+                    print_error("未知的顺序: %s (可选 input|freq|length)", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                printf("用法: compile-dict [--order input|freq|length] -o <输出文件> <字典>...\n");
+                printf("  input  - 保持第一次出现的顺序 (默认)\n");
+                printf("  freq   - 按在所有字典中出现的次数从多到少\n");
+                printf("  length - 按长度从短到长，不写顺序表\n");
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    
+    if (!output || optind >= argc) {
+        print_error("compile-dict 需要 -o <输出文件> 和至少一个字典");
+        return 1;
+    }
+    
+    return dict_compile((const char *const *)&argv[optind], argc - optind, output, order) ? 0 : 1;
 }
 
 attack_mode_t parse_attack_mode(const char *mode_str) {
@@ -41,18 +121,50 @@ attack_mode_t parse_attack_mode(const char *mode_str) {
         return ATTACK_CRC32;
     } else if (strcmp(mode_str, "hybrid") == 0) {
         return ATTACK_HYBRID;
+    } else if (strcmp(mode_str, "plain") == 0) {
+        return ATTACK_PLAINTEXT;
     } else {
         return ATTACK_HYBRID; // 默认模式
     }
 }
 
 int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "compile-dict") == 0) {
+        return run_compile_dict(argc - 1, argv + 1);
+    }
+    
     // 默认参数
     char *dict_file = "password_list.txt";
     char *output_dir = "./extracted";
     char *target_file = NULL;
+    char *plain_file = NULL;
+    char *plain_entry = NULL;
+    long plain_offset = 0;
+    bool has_keys = false;
+    zip_crypto_keys_t keys = {0, 0, 0};
+    char *charset = NULL;
+    int max_length = DEFAULT_KEY_PASSWORD_LENGTH;
     int thread_count = get_cpu_count() * 4;
     attack_mode_t mode = ATTACK_HYBRID;
+    bool mode_set = false;
+    char *mask = NULL;
+    char *rule_file = NULL;
+    char *markov_file = NULL;
+    int markov_min = 1;
+    int markov_max = 8;
+    int markov_threshold = -1;
+    char *combinator_file = NULL;
+    const char *separators[argc];
+    int separator_count = 0;
+    char *prince_file = NULL;
+    int prince_min = 1;
+    int prince_max = 16;
+    int prince_elements = 4;
+    bool extract_test = false;
+    const char *custom_charsets[MASK_CUSTOM_CHARSETS] = { NULL, NULL, NULL, NULL };
+    bool increment = false;
+    int increment_min = 0;
+    int increment_max = 0;
     
     // 命令行参数解析
     static struct option long_options[] = {
@@ -60,12 +172,37 @@ int main(int argc, char *argv[]) {
         {"threads", required_argument, 0, 't'},
         {"mode", required_argument, 0, 'm'},
         {"output", required_argument, 0, 'o'},
+        {"plaintext", required_argument, 0, 'p'},
+        {"plain-entry", required_argument, 0, 'e'},
+        {"plain-offset", required_argument, 0, 'O'},
+        {"keys", required_argument, 0, 'k'},
+        {"charset", required_argument, 0, 'c'},
+        {"max-length", required_argument, 0, 'L'},
+        {"mask", required_argument, 0, 'M'},
+        {"custom-charset1", required_argument, 0, '1'},
+        {"custom-charset2", required_argument, 0, '2'},
+        {"custom-charset3", required_argument, 0, '3'},
+        {"custom-charset4", required_argument, 0, '4'},
+        {"rules", required_argument, 0, 'r'},
+        {"increment", no_argument, 0, 'i'},
+        {"increment-min", required_argument, 0, 256},
+        {"increment-max", required_argument, 0, 257},
+        {"markov", required_argument, 0, 258},
+        {"markov-threshold", required_argument, 0, 259},
+        {"markov-length", required_argument, 0, 260},
+        {"combinator", required_argument, 0, 261},
+        {"separator", required_argument, 0, 262},
+        {"prince", required_argument, 0, 263},
+        {"prince-length", required_argument, 0, 264},
+        {"prince-elements", required_argument, 0, 265},
+        {"test", no_argument, 0, 266},
+        {"benchmark", no_argument, 0, 'b'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
     
     int opt;
-    while ((opt = getopt_long(argc, argv, "d:t:m:o:h", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "d:t:m:o:p:e:O:k:c:L:M:1:2:3:4:r:ibh", long_options, NULL)) != -1) {
         switch (opt) {
             case 'd':
                 dict_file = optarg;
@@ -79,10 +216,126 @@ int main(int argc, char *argv[]) {
                 break;
             case 'm':
                 mode = parse_attack_mode(optarg);
+                mode_set = true;
                 break;
             case 'o':
                 output_dir = optarg;
+                // 解压到标准输出时，提示和进度都改写到stderr
+                set_message_stream(strcmp(optarg, "-") == 0 ? stderr : NULL);
+                break;
+            case 'p':
+                plain_file = optarg;
+                break;
+            case 'e':
+                plain_entry = optarg;
+                break;
+            case 'O':
+                plain_offset = atol(optarg);
+                break;
+            case 'k':
+                // 三个密钥依次占用 optarg 和后面两个参数
+                if (optind + 1 >= argc) {
+                    print_error("--keys 需要三个十六进制密钥");
+                    return 1;
+                }
+                keys.key0 = (uint32_t)strtoul(optarg, NULL, 16);
+                keys.key1 = (uint32_t)strtoul(argv[optind++], NULL, 16);
+                keys.key2 = (uint32_t)strtoul(argv[optind++], NULL, 16);
+                has_keys = true;
+                break;
+            case 'c':
+                charset = optarg;
+                break;
+            case 'L':
+                max_length = atoi(optarg);
+                if (max_length < 0 || max_length > MAX_KEY_PASSWORD_LENGTH) {
+                    print_error("最大长度必须在0到%d之间", MAX_KEY_PASSWORD_LENGTH);
+                    return 1;
+                }
+                break;
+            case 'M':
+                mask = optarg;
+                break;
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+                custom_charsets[opt - '1'] = optarg;
+                break;
+            case 'r':
+                rule_file = optarg;
+                break;
+            case 'i':
+                increment = true;
+                break;
+            case 256:
+            case 257:
+                increment = true;
+                if (atoi(optarg) <= 0 || atoi(optarg) > MASK_MAX_LENGTH) {
+                    print_error("增量长度必须在1到%d之间", MASK_MAX_LENGTH);
+                    return 1;
+                }
+                if (opt == 256) {
+                    increment_min = atoi(optarg);
+                } else {
+                    increment_max = atoi(optarg);
+                }
+                break;
+            case 258:
+                markov_file = optarg;
+                break;
+            case 259:
+                markov_threshold = atoi(optarg);
+                if (markov_threshold < 0) {
+                    print_error("Markov阈值不能为负数");
+                    return 1;
+                }
                 break;
+            case 260:
+                // "6-9"表示长度范围，单个数字表示固定长度
+                if (sscanf(optarg, "%d-%d", &markov_min, &markov_max) == 1) {
+                    markov_max = markov_min;
+                }
+                if (markov_min <= 0 || markov_max < markov_min || markov_max > MARKOV_MAX_LENGTH) {
+                    print_error("Markov长度必须在1到%d之间", MARKOV_MAX_LENGTH);
+                    return 1;
+                }
+                break;
+            case 261:
+                combinator_file = optarg;
+                break;
+            case 262:
+                separators[separator_count++] = optarg;
+                break;
+            case 263:
+                prince_file = optarg;
+                break;
+            case 264:
+                if (sscanf(optarg, "%d-%d", &prince_min, &prince_max) == 1) {
+                    prince_max = prince_min;
+                }
+                if (prince_min <= 0 || prince_max < prince_min || prince_max > PRINCE_MAX_LENGTH) {
+                    print_error("PRINCE长度必须在1到%d之间", PRINCE_MAX_LENGTH);
+                    return 1;
+                }
+                break;
+            case 265:
+                prince_elements = atoi(optarg);
+                if (prince_elements <= 0 || prince_elements > PRINCE_MAX_ELEMENTS) {
+                    print_error("PRINCE元素个数必须在1到%d之间", PRINCE_MAX_ELEMENTS);
+                    return 1;
+                }
+                break;
+            case 266:
+                extract_test = true;
+                break;
+            case 'b':
+                zip_crypto_benchmark();
+                zip_aes_benchmark();
+                sevenzip_benchmark();
+                rar5_benchmark();
+                rar3_benchmark();
+                return 0;
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -101,6 +354,30 @@ int main(int argc, char *argv[]) {
     
     target_file = argv[optind];
     
+    // 指定了掩码、Markov模型或PRINCE词表但没有指定模式时只做暴力破解，组合攻击只做字典攻击
+    if ((mask || markov_file || prince_file) && !mode_set) {
+        mode = ATTACK_BRUTEFORCE;
+    }
+    if (combinator_file && !mode_set) {
+        mode = ATTACK_DICTIONARY;
+    }
+    if (markov_file && (mask || increment)) {
+        print_error("--markov 不能和 --mask/--increment 同时使用");
+        return 1;
+    }
+    if (prince_file && (markov_file || mask || increment)) {
+        print_error("--prince 不能和 --markov/--mask/--increment 同时使用");
+        return 1;
+    }
+    if (combinator_file && rule_file) {
+        print_error("--combinator 不能和 --rules 同时使用");
+        return 1;
+    }
+    if (separator_count > 0 && !combinator_file) {
+        print_error("--separator 需要和 --combinator 一起使用");
+        return 1;
+    }
+    
     // 显示横幅
     print_banner();
     
@@ -111,7 +388,7 @@ int main(int argc, char *argv[]) {
     }
     
     // 检查字典文件
-    if (mode == ATTACK_DICTIONARY || mode == ATTACK_HYBRID) {
+    if (!has_keys && (mode == ATTACK_DICTIONARY || mode == ATTACK_HYBRID)) {
         if (!file_exists(dict_file)) {
             print_error("字典文件不存在: %s", dict_file);
             return 1;
@@ -148,7 +425,7 @@ int main(int argc, char *argv[]) {
         print_info("检测到伪加密，正在修复...");
         char fixed_filename[256];
         snprintf(fixed_filename, sizeof(fixed_filename), "fixed_%s", target_file);
-        if (fix_fake_encryption(target_file, fixed_filename)) {
+        if (fix_fake_encryption(info, fixed_filename)) {
             print_success("伪加密修复完成: %s", fixed_filename);
             free_archive_info(info);
             return 0;
@@ -166,21 +443,75 @@ int main(int argc, char *argv[]) {
     print_info("攻击模式: %s", 
                mode == ATTACK_DICTIONARY ? "字典攻击" :
                mode == ATTACK_BRUTEFORCE ? "暴力破解" :
-               mode == ATTACK_CRC32 ? "CRC32攻击" : "混合攻击");
+               mode == ATTACK_CRC32 ? "CRC32攻击" :
+               mode == ATTACK_PLAINTEXT ? "已知明文攻击" : "混合攻击");
     print_info("使用线程数: %d", thread_count);
     
-    g_thread_pool = create_thread_pool(thread_count, target_file, dict_file, mode);
+    // 线程池持有同一个压缩包模型的引用，不再重复解析
+    g_thread_pool = create_thread_pool(thread_count, info, dict_file, mode);
+    free_archive_info(info);
     if (!g_thread_pool) {
         print_error("创建线程池失败");
-        free_archive_info(info);
         return 1;
     }
     
+    g_thread_pool->max_length = max_length;
+    g_thread_pool->output_dir = output_dir;
+    g_thread_pool->extract_test = extract_test;
+    
+    // 掩码、规则和各种词表模型确认需要破解后才构建，直接交给线程池，出错时随线程池一起释放
+    bool models_ok = true;
+    if (mask || increment) {
+        g_thread_pool->masks = mask_list_parse(mask ? mask : "?d?d?d?d?d?d?d?d", custom_charsets,
+                                               increment ? (increment_min ? increment_min : 1) : 0,
+                                               increment_max);
+        if (!g_thread_pool->masks) {
+            print_error("无法解析掩码: %s", mask ? mask : "?d?d?d?d?d?d?d?d");
+            models_ok = false;
+        }
+    }
+    if (models_ok && rule_file) {
+        g_thread_pool->rules = rule_set_load(rule_file);
+        models_ok = g_thread_pool->rules != NULL;
+    }
+    if (models_ok && markov_file) {
+        g_thread_pool->markov = markov_train(markov_file, markov_min, markov_max, markov_threshold);
+        models_ok = g_thread_pool->markov != NULL;
+    }
+    if (models_ok && combinator_file) {
+        g_thread_pool->combinator = combinator_create(combinator_file, separators, separator_count);
+        models_ok = g_thread_pool->combinator != NULL;
+    }
+    if (models_ok && prince_file) {
+        g_thread_pool->prince = prince_build(prince_file, prince_min, prince_max, prince_elements);
+        models_ok = g_thread_pool->prince != NULL;
+    }
+    if (!models_ok) {
+        free_thread_pool(g_thread_pool);
+        g_thread_pool = NULL;
+        return 1;
+    }
+    if (g_thread_pool->rules) {
+        print_info("已加载 %u 条规则，字典中的每个词依次应用", g_thread_pool->rules->count);
+    }
+    g_thread_pool->charset = charset ? strdup(charset) : NULL;
+    if (has_keys) {
+        g_thread_pool->has_keys = true;
+        g_thread_pool->keys = keys;
+    }
+    
+    if (plain_file) {
+        g_thread_pool->plaintext = load_known_plaintext(plain_file, plain_entry, plain_offset);
+        if (!g_thread_pool->plaintext) {
+            print_error("无法加载已知明文，需要同时指定 --plaintext 和 --plain-entry");
+        }
+    }
+    
     start_attack(g_thread_pool);
     
     // 清理资源
     free_thread_pool(g_thread_pool);
-    free_archive_info(info);
+    g_thread_pool = NULL;
     
     return 0;
 }
\ No newline at end of file
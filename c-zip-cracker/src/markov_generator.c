@@ -0,0 +1,390 @@
+#include "../include/zip_cracker.h"
+#include <math.h>
+
+// 训练时表示“词的开头”的前一个字符
+#define MARKOV_START 256
+
+// 级别表的下标：位置pos、前一个字符prev（model->char_count表示开头）、字符c
+#define LEVEL_AT(m, pos, prev, c) \
+    ((((size_t)(pos) * ((m)->char_count + 1u)) + (prev)) * (m)->char_count + (c))
+
+// 补全表的下标：位置pos、前一个字符prev、剩余级别rem
+#define COMPLETION_AT(m, pos, prev, rem) \
+    ((((size_t)(pos) * ((m)->char_count + 1u)) + (prev)) * ((size_t)(m)->max_level + 1) + (rem))
+
+// 饱和加法，超出2^64的组不会被枚举，只需要知道它们超出
+static uint64_t add_saturated(uint64_t a, uint64_t b) {
+    return a > UINT64_MAX - b ? UINT64_MAX : a + b;
+}
+
+// 解码hashcat potfile中的$HEX[...]，返回解码后的长度，不是这种格式时返回原长度
+static size_t decode_hex_plain(const char *plain, size_t len, char *out) {
+    if (len < 6 || memcmp(plain, "$HEX[", 5) != 0 || plain[len - 1] != ']' || (len - 6) % 2 != 0) {
+        memcpy(out, plain, len);
+        return len;
+    }
+
+    size_t n = 0;
+    for (size_t i = 5; i + 1 < len; i += 2) {
+        unsigned int byte;
+        if (sscanf(plain + i, "%2x", &byte) != 1) {
+            memcpy(out, plain, len);
+            return len;
+        }
+        out[n++] = (char)byte;
+    }
+    return n;
+}
+
+// 统计一个词各位置的转移次数，超出最大长度的部分不计
+static void count_word(uint64_t *counts, const uint8_t *word, size_t len, int max_length) {
+    size_t prev = MARKOV_START;
+    for (size_t pos = 0; pos < len && pos < (size_t)max_length; pos++) {
+        counts[(pos * (MARKOV_START + 1) + prev) * 256 + word[pos]]++;
+        prev = word[pos];
+    }
+}
+
+// 读入训练文件统计转移次数；.pot/.potfile按"哈希:密码"取最后一个冒号之后的部分
+static bool markov_count(uint64_t *counts, const char *train_file, int max_length, uint64_t *words) {
+    dict_source_t *source = dict_source_open(train_file, 1);
+    if (!source) {
+        print_error("无法打开训练文件: %s", train_file);
+        return false;
+    }
+
+    const char *ext = strrchr(train_file, '.');
+    bool potfile = ext && (strcmp(ext, ".pot") == 0 || strcmp(ext, ".potfile") == 0);
+
+    dict_chunk_t chunk;
+    memset(&chunk, 0, sizeof(chunk));
+    const char *line;
+    size_t len;
+    char plain[MAX_CANDIDATE_LENGTH + 1];
+
+    while (dict_source_next_chunk(source, &chunk)) {
+        while (dict_chunk_next_line(&chunk, &line, &len)) {
+            if (potfile) {
+                const char *colon = memrchr(line, ':', len);
+                if (!colon) continue;
+                len -= (size_t)(colon + 1 - line);
+                line = colon + 1;
+                if (len > MAX_CANDIDATE_LENGTH) continue;
+                len = decode_hex_plain(line, len, plain);
+                line = plain;
+            }
+            if (len == 0) continue;
+            count_word(counts, (const uint8_t *)line, len, max_length);
+            (*words)++;
+        }
+    }
+
+    dict_source_close(source);
+    return true;
+}
+
+// 由转移次数得到字符表和级别表：加一平滑后概率p的级别为floor(-log2 p)，最高MARKOV_LEVELS-1；
+// 每个上下文的后继按级别从小到大排序，级别相同时按字符顺序
+static bool markov_build_levels(markov_model_t *model, const uint64_t *counts) {
+    int index[256];
+    for (int c = 0; c < 256; c++) {
+        index[c] = -1;
+    }
+    for (size_t i = 0; i < (size_t)model->max_length * (MARKOV_START + 1) * 256; i++) {
+        if (counts[i] && index[i % 256] < 0) {
+            index[i % 256] = 0;
+        }
+    }
+    for (int c = 0; c < 256; c++) {
+        if (index[c] == 0) {
+            index[c] = model->char_count;
+            model->chars[model->char_count++] = (uint8_t)c;
+        }
+    }
+    if (model->char_count == 0) {
+        print_error("训练文件中没有可用的词");
+        return false;
+    }
+
+    uint32_t k = model->char_count;
+    size_t table = (size_t)model->max_length * (k + 1) * k;
+    model->levels = malloc(table);
+    model->successors = malloc(table);
+    if (!model->levels || !model->successors) return false;
+
+    for (int pos = 0; pos < model->max_length; pos++) {
+        for (uint32_t prev = 0; prev <= k; prev++) {
+            size_t raw_prev = prev == k ? MARKOV_START : model->chars[prev];
+            const uint64_t *row = &counts[((size_t)pos * (MARKOV_START + 1) + raw_prev) * 256];
+            uint64_t total = 0;
+            for (uint32_t c = 0; c < k; c++) {
+                total += row[model->chars[c]];
+            }
+
+            uint8_t *levels = &model->levels[LEVEL_AT(model, pos, prev, 0)];
+            for (uint32_t c = 0; c < k; c++) {
+                double p = (double)(row[model->chars[c]] + 1) / (double)(total + k);
+                double level = floor(-log2(p));
+                levels[c] = (uint8_t)(level < MARKOV_LEVELS - 1 ? level : MARKOV_LEVELS - 1);
+            }
+
+            // 按级别做计数排序，保持字符顺序稳定
+            uint8_t *successors = &model->successors[LEVEL_AT(model, pos, prev, 0)];
+            uint32_t n = 0;
+            for (int level = 0; level < MARKOV_LEVELS; level++) {
+                for (uint32_t c = 0; c < k; c++) {
+                    if (levels[c] == level) successors[n++] = (uint8_t)c;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// 计算长度len的补全表：从位置pos开始、前一个字符为prev、级别之和恰好为rem的补全数
+static bool markov_build_completions(markov_model_t *model, int len) {
+    uint32_t k = model->char_count;
+    size_t size = COMPLETION_AT(model, len + 1, 0, 0);
+    uint64_t *table = calloc(size, sizeof(uint64_t));
+    if (!table) return false;
+
+    for (uint32_t prev = 0; prev <= k; prev++) {
+        table[COMPLETION_AT(model, len, prev, 0)] = 1;
+    }
+    for (int pos = len - 1; pos >= 0; pos--) {
+        // 第一个位置只有开头一个上下文
+        uint32_t first = pos == 0 ? k : 0;
+        for (uint32_t prev = first; prev <= k; prev++) {
+            const uint8_t *levels = &model->levels[LEVEL_AT(model, pos, prev, 0)];
+            uint64_t *out = &table[COMPLETION_AT(model, pos, prev, 0)];
+            for (uint32_t c = 0; c < k; c++) {
+                const uint64_t *next = &table[COMPLETION_AT(model, pos + 1, c, 0)];
+                for (int rem = levels[c]; rem <= model->max_level; rem++) {
+                    out[rem] = add_saturated(out[rem], next[rem - levels[c]]);
+                }
+            }
+        }
+    }
+
+    model->completions[len] = table;
+    return true;
+}
+
+// 按级别之和从小到大、同级别按长度从短到长排出候选组；阈值未指定时取总数不超过2^64的最大级别
+static bool markov_build_groups(markov_model_t *model, bool auto_threshold) {
+    model->groups = calloc((size_t)(model->threshold + 1) * MARKOV_MAX_LENGTH, sizeof(markov_group_t));
+    if (!model->groups) return false;
+
+    for (int level = 0; level <= model->threshold; level++) {
+        uint64_t keyspace = model->keyspace;
+        uint32_t first = model->group_count;
+        bool overflow = false;
+
+        for (int len = model->min_length; len <= model->max_length; len++) {
+            uint64_t count = model->completions[len][COMPLETION_AT(model, 0, model->char_count, level)];
+            if (count == 0) continue;
+            if (count == UINT64_MAX || keyspace > UINT64_MAX - count) {
+                overflow = true;
+                break;
+            }
+            markov_group_t *group = &model->groups[model->group_count++];
+            group->level = (uint16_t)level;
+            group->length = (uint16_t)len;
+            group->keyspace = count;
+            group->offset = keyspace;
+            keyspace += count;
+        }
+
+        if (overflow) {
+            if (!auto_threshold) {
+                print_error("Markov候选空间超过2^64，请降低阈值");
+                return false;
+            }
+            // 丢掉这一级已经排好的组，阈值停在上一级
+            model->group_count = first;
+            model->threshold = level - 1;
+            break;
+        }
+        model->keyspace = keyspace;
+    }
+
+    if (model->keyspace == 0) {
+        print_error("Markov阈值内没有候选密码");
+        return false;
+    }
+    return true;
+}
+
+// 从训练文件（字典或potfile）训练按位置的转移表，枚举长度在[min_len, max_len]、
+// 级别之和不超过threshold的候选；threshold小于0时自动选取
+markov_model_t* markov_train(const char *train_file, int min_len, int max_len, int threshold) {
+    if (!train_file || min_len <= 0 || max_len < min_len || max_len > MARKOV_MAX_LENGTH) {
+        print_error("Markov长度必须在1到%d之间", MARKOV_MAX_LENGTH);
+        return NULL;
+    }
+
+    markov_model_t *model = calloc(1, sizeof(markov_model_t));
+    uint64_t *counts = calloc((size_t)max_len * (MARKOV_START + 1) * 256, sizeof(uint64_t));
+    if (!model || !counts) {
+        free(model);
+        free(counts);
+        return NULL;
+    }
+    model->min_length = min_len;
+    model->max_length = max_len;
+
+    bool auto_threshold = threshold < 0;
+    int max_threshold = (MARKOV_LEVELS - 1) * max_len;
+    model->threshold = auto_threshold || threshold > max_threshold ? max_threshold : threshold;
+    model->max_level = model->threshold;
+
+    uint64_t words = 0;
+    bool ok = markov_count(counts, train_file, max_len, &words) && markov_build_levels(model, counts);
+    free(counts);
+
+    for (int len = min_len; ok && len <= max_len; len++) {
+        ok = markov_build_completions(model, len);
+    }
+    ok = ok && markov_build_groups(model, auto_threshold);
+
+    if (!ok) {
+        markov_model_free(model);
+        return NULL;
+    }
+
+    print_info("Markov模型: 训练 %lu 个词，%u 个字符，长度 %d-%d，阈值 %d，候选数 %lu",
+               words, model->char_count, min_len, max_len, model->threshold, model->keyspace);
+    return model;
+}
+
+// 二分查找下标所在的组
+static uint32_t find_group(const markov_model_t *model, uint64_t index) {
+    uint32_t lo = 0, hi = model->group_count - 1;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (model->groups[mid].offset <= index) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+// 从位置pos开始展开组内的第index个补全：按级别从小到大试每个后继，跳过整棵子树的补全数
+static void cursor_descend(markov_cursor_t *cursor, int pos, uint64_t index) {
+    const markov_model_t *model = cursor->model;
+    const markov_group_t *group = &model->groups[cursor->group];
+    const uint64_t *completions = model->completions[group->length];
+    uint32_t k = model->char_count;
+
+    for (; pos < group->length; pos++) {
+        uint32_t prev = pos > 0 ? cursor->symbols[pos - 1] : k;
+        const uint8_t *levels = &model->levels[LEVEL_AT(model, pos, prev, 0)];
+        const uint8_t *successors = &model->successors[LEVEL_AT(model, pos, prev, 0)];
+        int rem = cursor->budget[pos];
+
+        for (uint32_t rank = 0; rank < k; rank++) {
+            uint8_t c = successors[rank];
+            if (levels[c] > rem) break;
+            uint64_t n = completions[COMPLETION_AT(model, pos + 1, c, rem - levels[c])];
+            if (index < n) {
+                cursor->ranks[pos] = (uint16_t)rank;
+                cursor->symbols[pos] = c;
+                cursor->budget[pos + 1] = (uint16_t)(rem - levels[c]);
+                cursor->password[pos] = (char)model->chars[c];
+                break;
+            }
+            index -= n;
+        }
+    }
+    cursor->password[group->length] = '\0';
+}
+
+// 定位到组内的第index个候选
+static void cursor_seek(markov_cursor_t *cursor, uint32_t group, uint64_t index) {
+    cursor->group = group;
+    cursor->budget[0] = cursor->model->groups[group].level;
+    cursor_descend(cursor, 0, index);
+}
+
+// 定位到下标start，之后最多生成count个候选密码
+bool markov_cursor_init(markov_cursor_t *cursor, const markov_model_t *model, uint64_t start, uint64_t count) {
+    if (!cursor || !model) {
+        return false;
+    }
+
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->model = model;
+    if (start >= model->keyspace) {
+        return true;
+    }
+    cursor->remaining = count < model->keyspace - start ? count : model->keyspace - start;
+
+    uint32_t group = find_group(model, start);
+    cursor_seek(cursor, group, start - model->groups[group].offset);
+    return true;
+}
+
+// 递增到组内的下一个候选：从最后一个位置往前找还能换成下一个后继的位置，之后的位置取最可能的补全；
+// 当前组用完时换到下一组
+static void cursor_advance(markov_cursor_t *cursor) {
+    const markov_model_t *model = cursor->model;
+    const markov_group_t *group = &model->groups[cursor->group];
+    const uint64_t *completions = model->completions[group->length];
+    uint32_t k = model->char_count;
+
+    for (int pos = group->length - 1; pos >= 0; pos--) {
+        uint32_t prev = pos > 0 ? cursor->symbols[pos - 1] : k;
+        const uint8_t *levels = &model->levels[LEVEL_AT(model, pos, prev, 0)];
+        const uint8_t *successors = &model->successors[LEVEL_AT(model, pos, prev, 0)];
+        int rem = cursor->budget[pos];
+
+        for (uint32_t rank = cursor->ranks[pos] + 1u; rank < k; rank++) {
+            uint8_t c = successors[rank];
+            if (levels[c] > rem) break;
+            if (completions[COMPLETION_AT(model, pos + 1, c, rem - levels[c])] == 0) continue;
+
+            cursor->ranks[pos] = (uint16_t)rank;
+            cursor->symbols[pos] = c;
+            cursor->budget[pos + 1] = (uint16_t)(rem - levels[c]);
+            cursor->password[pos] = (char)model->chars[c];
+            cursor_descend(cursor, pos + 1, 0);
+            return;
+        }
+    }
+
+    if (cursor->group + 1 < model->group_count) {
+        cursor_seek(cursor, cursor->group + 1, 0);
+    }
+}
+
+// 取下一个候选密码，返回的指针在下一次调用前有效
+bool markov_cursor_next(markov_cursor_t *cursor, const char **password, size_t *len) {
+    if (!cursor || cursor->remaining == 0) {
+        return false;
+    }
+
+    if (cursor->started) {
+        cursor_advance(cursor);
+    }
+    cursor->started = true;
+    cursor->remaining--;
+
+    *password = cursor->password;
+    *len = cursor->model->groups[cursor->group].length;
+    return true;
+}
+
+// 释放Markov模型
+void markov_model_free(markov_model_t *model) {
+    if (!model) return;
+
+    for (int len = 0; len <= MARKOV_MAX_LENGTH; len++) {
+        free(model->completions[len]);
+    }
+    free(model->levels);
+    free(model->successors);
+    free(model->groups);
+    free(model);
+}
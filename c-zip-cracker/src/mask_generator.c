@@ -0,0 +1,376 @@
+#include "../include/zip_cracker.h"
+
+// 内置字符集
+static const char charset_lower[] = "abcdefghijklmnopqrstuvwxyz";
+static const char charset_upper[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static const char charset_digit[] = "0123456789";
+static const char charset_special[] = " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+static const char charset_hex_lower[] = "0123456789abcdef";
+static const char charset_hex_upper[] = "0123456789ABCDEF";
+
+// .hcmask文件单行的最大长度
+#define MASK_LINE_SIZE 4096
+
+// 向字符集追加字符，重复的字符只保留第一次出现的位置
+static void charset_add(mask_charset_t *set, bool seen[256], const uint8_t *chars, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (!seen[chars[i]]) {
+            seen[chars[i]] = true;
+            set->chars[set->size++] = chars[i];
+        }
+    }
+}
+
+// 追加一个内置字符集（?l ?u ?d ?s ?a ?h ?H ?b），不认识的名字返回false
+static bool charset_add_builtin(mask_charset_t *set, bool seen[256], char name) {
+    switch (name) {
+        case 'l':
+            charset_add(set, seen, (const uint8_t *)charset_lower, sizeof(charset_lower) - 1);
+            return true;
+        case 'u':
+            charset_add(set, seen, (const uint8_t *)charset_upper, sizeof(charset_upper) - 1);
+            return true;
+        case 'd':
+            charset_add(set, seen, (const uint8_t *)charset_digit, sizeof(charset_digit) - 1);
+            return true;
+        case 's':
+            charset_add(set, seen, (const uint8_t *)charset_special, sizeof(charset_special) - 1);
+            return true;
+        case 'a':
+            charset_add_builtin(set, seen, 'l');
+            charset_add_builtin(set, seen, 'u');
+            charset_add_builtin(set, seen, 'd');
+            return charset_add_builtin(set, seen, 's');
+        case 'h':
+            charset_add(set, seen, (const uint8_t *)charset_hex_lower, sizeof(charset_hex_lower) - 1);
+            return true;
+        case 'H':
+            charset_add(set, seen, (const uint8_t *)charset_hex_upper, sizeof(charset_hex_upper) - 1);
+            return true;
+        case 'b':
+            // 不含0x00：密码在libzip/libarchive和输出中都按\0结尾的字符串传递
+            for (int c = 1; c < 256; c++) {
+                uint8_t byte = (uint8_t)c;
+                charset_add(set, seen, &byte, 1);
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+// 展开自定义字符集的定义（如"?l?d_"），可以引用内置字符集，"??"表示问号本身
+static bool expand_custom_charset(const char *spec, mask_charset_t *set) {
+    bool seen[256] = { false };
+    memset(set, 0, sizeof(*set));
+
+    for (const char *p = spec; *p; p++) {
+        if (*p != '?') {
+            charset_add(set, seen, (const uint8_t *)p, 1);
+            continue;
+        }
+        p++;
+        if (*p == '?') {
+            charset_add(set, seen, (const uint8_t *)"?", 1);
+        } else if (*p == '\0' || !charset_add_builtin(set, seen, *p)) {
+            print_error("无效的自定义字符集: %s", spec);
+            return false;
+        }
+    }
+    if (set->size == 0) {
+        print_error("自定义字符集为空");
+        return false;
+    }
+    return true;
+}
+
+// 在字符集池中查找或加入一个字符集，返回下标
+static int list_add_charset(mask_list_t *list, const mask_charset_t *set, uint32_t *capacity) {
+    for (uint32_t i = 0; i < list->charset_count; i++) {
+        const mask_charset_t *have = &list->charsets[i];
+        if (have->size == set->size && memcmp(have->chars, set->chars, set->size) == 0) {
+            return (int)i;
+        }
+    }
+    if (list->charset_count >= UINT16_MAX) {
+        return -1;
+    }
+
+    if (list->charset_count == *capacity) {
+        uint32_t new_capacity = *capacity ? *capacity * 2 : 16;
+        mask_charset_t *sets = realloc(list->charsets, new_capacity * sizeof(mask_charset_t));
+        if (!sets) return -1;
+        list->charsets = sets;
+        *capacity = new_capacity;
+    }
+    list->charsets[list->charset_count] = *set;
+    return (int)list->charset_count++;
+}
+
+// 解析一个掩码并按增量范围加入队列，每个长度一条
+static bool list_add_mask(mask_list_t *list, uint32_t *set_capacity, uint32_t *mask_capacity,
+                          const char *mask, const char *const custom[MASK_CUSTOM_CHARSETS],
+                          int min_len, int max_len) {
+    mask_charset_t customs[MASK_CUSTOM_CHARSETS];
+    bool defined[MASK_CUSTOM_CHARSETS] = { false };
+    for (int i = 0; i < MASK_CUSTOM_CHARSETS; i++) {
+        if (custom && custom[i]) {
+            if (!expand_custom_charset(custom[i], &customs[i])) return false;
+            defined[i] = true;
+        }
+    }
+
+    mask_t parsed;
+    memset(&parsed, 0, sizeof(parsed));
+    for (const char *p = mask; *p; p++) {
+        if (parsed.length >= MASK_MAX_LENGTH) {
+            print_error("掩码超过%d个位置: %s", MASK_MAX_LENGTH, mask);
+            return false;
+        }
+
+        mask_charset_t set;
+        bool seen[256] = { false };
+        memset(&set, 0, sizeof(set));
+        if (*p != '?') {
+            charset_add(&set, seen, (const uint8_t *)p, 1);
+        } else {
+            p++;
+            if (*p == '?') {
+                charset_add(&set, seen, (const uint8_t *)"?", 1);
+            } else if (*p >= '1' && *p < '1' + MASK_CUSTOM_CHARSETS && defined[*p - '1']) {
+                set = customs[*p - '1'];
+            } else if (*p == '\0' || !charset_add_builtin(&set, seen, *p)) {
+                print_error("无效的掩码: %s", mask);
+                return false;
+            }
+        }
+
+        int index = list_add_charset(list, &set, set_capacity);
+        if (index < 0) return false;
+        parsed.sets[parsed.length++] = (uint16_t)index;
+    }
+    if (parsed.length == 0) {
+        print_error("掩码为空");
+        return false;
+    }
+
+    // 不使用增量模式时只有完整长度一条
+    int first = parsed.length, last = parsed.length;
+    if (min_len > 0 || max_len > 0) {
+        first = min_len > 0 ? min_len : 1;
+        last = max_len > 0 && max_len < parsed.length ? max_len : parsed.length;
+    }
+
+    for (int len = first; len <= last; len++) {
+        mask_t m = parsed;
+        m.length = len;
+        m.keyspace = 1;
+        for (int i = 0; i < len; i++) {
+            uint64_t size = list->charsets[m.sets[i]].size;
+            if (m.keyspace > UINT64_MAX / size) {
+                print_error("掩码空间超过2^64: %s", mask);
+                return false;
+            }
+            m.keyspace *= size;
+        }
+
+        if (list->count == *mask_capacity) {
+            uint32_t new_capacity = *mask_capacity ? *mask_capacity * 2 : 16;
+            mask_t *masks = realloc(list->masks, new_capacity * sizeof(mask_t));
+            if (!masks) return false;
+            list->masks = masks;
+            *mask_capacity = new_capacity;
+        }
+        list->masks[list->count++] = m;
+    }
+    return true;
+}
+
+// 按逗号拆分.hcmask的一行："[字符集1,][字符集2,]...掩码"，"\,"表示逗号本身
+static int split_hcmask_line(char *line, char *fields[MASK_CUSTOM_CHARSETS + 1]) {
+    int count = 0;
+    char *out = line;
+    fields[count++] = out;
+    for (char *p = line; *p; p++) {
+        if (*p == '\\' && (p[1] == ',' || p[1] == '\\')) {
+            *out++ = *++p;
+        } else if (*p == ',' && count < MASK_CUSTOM_CHARSETS + 1) {
+            *out++ = '\0';
+            fields[count++] = out;
+        } else {
+            *out++ = *p;
+        }
+    }
+    *out = '\0';
+    return count;
+}
+
+// 依次加入.hcmask文件中的每个掩码，行内的字符集覆盖命令行指定的
+static bool list_add_file(mask_list_t *list, uint32_t *set_capacity, uint32_t *mask_capacity,
+                          const char *filename, const char *const custom[MASK_CUSTOM_CHARSETS],
+                          int min_len, int max_len) {
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        print_error("无法打开掩码文件: %s", filename);
+        return false;
+    }
+
+    char line[MASK_LINE_SIZE];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+
+        char *fields[MASK_CUSTOM_CHARSETS + 1];
+        int count = split_hcmask_line(line, fields);
+        const char *line_custom[MASK_CUSTOM_CHARSETS];
+        for (int i = 0; i < MASK_CUSTOM_CHARSETS; i++) {
+            line_custom[i] = i < count - 1 ? fields[i] : (custom ? custom[i] : NULL);
+        }
+        ok = list_add_mask(list, set_capacity, mask_capacity, fields[count - 1], line_custom, min_len, max_len);
+    }
+
+    fclose(file);
+    return ok;
+}
+
+// 解析掩码（或.hcmask文件）为按顺序排队的掩码列表；min_len/max_len大于0时启用增量模式
+mask_list_t* mask_list_parse(const char *spec, const char *const custom[MASK_CUSTOM_CHARSETS],
+                             int min_len, int max_len) {
+    if (!spec || (min_len > 0 && max_len > 0 && min_len > max_len)) {
+        return NULL;
+    }
+
+    mask_list_t *list = calloc(1, sizeof(mask_list_t));
+    if (!list) return NULL;
+
+    uint32_t set_capacity = 0, mask_capacity = 0;
+    bool ok = file_exists(spec)
+        ? list_add_file(list, &set_capacity, &mask_capacity, spec, custom, min_len, max_len)
+        : list_add_mask(list, &set_capacity, &mask_capacity, spec, custom, min_len, max_len);
+
+    // 记录每个掩码在整个队列中的起始下标
+    for (uint32_t i = 0; ok && i < list->count; i++) {
+        if (list->keyspace > UINT64_MAX - list->masks[i].keyspace) {
+            print_error("掩码队列总空间超过2^64");
+            ok = false;
+            break;
+        }
+        list->masks[i].offset = list->keyspace;
+        list->keyspace += list->masks[i].keyspace;
+    }
+
+    if (!ok || list->count == 0) {
+        mask_list_free(list);
+        return NULL;
+    }
+    return list;
+}
+
+// 二分查找下标所在的掩码
+static uint32_t find_mask(const mask_list_t *list, uint64_t index) {
+    uint32_t lo = 0, hi = list->count - 1;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (list->masks[mid].offset <= index) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+// 把掩码内的下标按混合进制展开为各位置的字符序号，最右边的位置变化最快
+static void decode_index(const mask_list_t *list, const mask_t *m, uint64_t index,
+                         uint16_t *digits, char *out) {
+    for (int i = m->length - 1; i >= 0; i--) {
+        const mask_charset_t *set = &list->charsets[m->sets[i]];
+        uint16_t digit = (uint16_t)(index % set->size);
+        index /= set->size;
+        if (digits) digits[i] = digit;
+        out[i] = (char)set->chars[digit];
+    }
+    out[m->length] = '\0';
+}
+
+// 取队列中第index个候选密码，代价与长度成正比；out至少MASK_MAX_LENGTH+1字节
+bool mask_list_candidate(const mask_list_t *list, uint64_t index, char *out, size_t *len) {
+    if (!list || !out || index >= list->keyspace) {
+        return false;
+    }
+
+    const mask_t *m = &list->masks[find_mask(list, index)];
+    decode_index(list, m, index - m->offset, NULL, out);
+    if (len) *len = (size_t)m->length;
+    return true;
+}
+
+// 定位到下标start，之后最多生成count个候选密码
+bool mask_cursor_init(mask_cursor_t *cursor, const mask_list_t *list, uint64_t start, uint64_t count) {
+    if (!cursor || !list) {
+        return false;
+    }
+
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->list = list;
+    if (start >= list->keyspace) {
+        return true;
+    }
+    cursor->remaining = count < list->keyspace - start ? count : list->keyspace - start;
+    cursor->mask = find_mask(list, start);
+
+    const mask_t *m = &list->masks[cursor->mask];
+    decode_index(list, m, start - m->offset, cursor->digits, cursor->password);
+    return true;
+}
+
+// 里程表式递增：最右边的位置加一并向左进位，当前掩码用完时换到队列中的下一个
+static void cursor_advance(mask_cursor_t *cursor) {
+    const mask_list_t *list = cursor->list;
+    const mask_t *m = &list->masks[cursor->mask];
+
+    for (int i = m->length - 1; i >= 0; i--) {
+        const mask_charset_t *set = &list->charsets[m->sets[i]];
+        if (++cursor->digits[i] < set->size) {
+            cursor->password[i] = (char)set->chars[cursor->digits[i]];
+            return;
+        }
+        cursor->digits[i] = 0;
+        cursor->password[i] = (char)set->chars[0];
+    }
+
+    if (++cursor->mask < list->count) {
+        m = &list->masks[cursor->mask];
+        memset(cursor->digits, 0, sizeof(cursor->digits));
+        decode_index(list, m, 0, cursor->digits, cursor->password);
+    }
+}
+
+// 取下一个候选密码，返回的指针在下一次调用前有效
+bool mask_cursor_next(mask_cursor_t *cursor, const char **password, size_t *len) {
+    if (!cursor || cursor->remaining == 0) {
+        return false;
+    }
+
+    if (cursor->started) {
+        cursor_advance(cursor);
+    }
+    cursor->started = true;
+    cursor->remaining--;
+
+    *password = cursor->password;
+    *len = (size_t)cursor->list->masks[cursor->mask].length;
+    return true;
+}
+
+// 释放掩码队列
+void mask_list_free(mask_list_t *list) {
+    if (!list) return;
+
+    free(list->charsets);
+    free(list->masks);
+    free(list);
+}
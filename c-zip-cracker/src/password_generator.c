@@ -5,16 +5,25 @@ struct password_generator {
     enum {
         GEN_DICT,
         GEN_NUMERIC,
-        GEN_ALPHA,
-        GEN_ALPHANUM
+        GEN_MASK,
+        GEN_MARKOV,
+        GEN_PRINCE
     } type;
     
     union {
         struct {
-            FILE *file;
-            char *buffer;
-            size_t buffer_size;
-            bool eof_reached;
+            dict_source_t *source;
+            dict_chunk_t chunk;
+            bool owns_source;        // 单独打开的字典由生成器负责关闭
+            bool finished;
+            const rule_set_t *rules; // 为空时只尝试原词
+            uint32_t rule;           // 当前基础词下一条要应用的规则
+            const char *word;        // 当前基础词，指向字典块，直到用完所有规则才领取下一行
+            size_t word_len;
+            const combinator_t *combinator;  // 为空时不做组合
+            uint32_t separator;      // 当前左词下一个要用的分隔符
+            int right_len;           // 右字典下一个词所在的长度桶
+            uint64_t right_index;    // 右字典下一个词在桶中的下标
         } dict;
         
         struct {
@@ -24,34 +33,60 @@ struct password_generator {
             char *current_password;
             bool finished;
         } numeric;
+        
+        struct {
+            mask_cursor_t cursor;
+            mask_list_t *owned;      // 字母/字母数字生成器自己建立的掩码
+        } mask;
+        
+        markov_cursor_t markov;
+        prince_cursor_t prince;
     } data;
 };
 
-// 创建字典密码生成器
-password_generator_t* create_dict_generator(const char *dict_file) {
-    if (!dict_file || !file_exists(dict_file)) {
-        return NULL;
-    }
+// 创建从共享字典领取块的生成器，多个线程的生成器合起来每行只读一次；
+// 指定了规则时每个基础词依次展开成所有规则的结果
+password_generator_t* create_shared_dict_generator(dict_source_t *source, const rule_set_t *rules) {
+    if (!source) return NULL;
     
     password_generator_t *gen = calloc(1, sizeof(password_generator_t));
     if (!gen) return NULL;
     
     gen->type = GEN_DICT;
-    gen->data.dict.file = fopen(dict_file, "r");
-    if (!gen->data.dict.file) {
-        free(gen);
+    gen->data.dict.source = source;
+    gen->data.dict.owns_source = false;
+    gen->data.dict.finished = false;
+    gen->data.dict.rules = rules;
+    gen->data.dict.rule = rules ? rules->count : 0;
+    
+    return gen;
+}
+
+// 创建组合攻击生成器：从共享字典领取左词，每个左词依次接上所有分隔符和右字典的词
+password_generator_t* create_combinator_generator(dict_source_t *source, const combinator_t *comb) {
+    if (!comb) return NULL;
+    
+    password_generator_t *gen = create_shared_dict_generator(source, NULL);
+    if (!gen) return NULL;
+    
+    gen->data.dict.combinator = comb;
+    gen->data.dict.separator = comb->separator_count;
+    return gen;
+}
+
+// 创建字典密码生成器，独自读完整个字典
+password_generator_t* create_dict_generator(const char *dict_file) {
+    if (!dict_file || !file_exists(dict_file)) {
         return NULL;
     }
     
-    gen->data.dict.buffer_size = 1024;
-    gen->data.dict.buffer = malloc(gen->data.dict.buffer_size);
-    if (!gen->data.dict.buffer) {
-        fclose(gen->data.dict.file);
-        free(gen);
+    dict_source_t *source = dict_source_open(dict_file, 1);
+    password_generator_t *gen = create_shared_dict_generator(source, NULL);
+    if (!gen) {
+        dict_source_close(source);
         return NULL;
     }
-    
-    gen->data.dict.eof_reached = false;
+    gen->data.dict.owns_source = true;
     
     return gen;
 }
@@ -86,27 +121,98 @@ password_generator_t* create_numeric_generator(int min_len, int max_len) {
     return gen;
 }
 
-// 获取下一个字典密码
-static char* get_next_dict_password(password_generator_t *gen) {
-    if (gen->data.dict.eof_reached) {
-        return NULL;
+// 取下一行字典，当前块用完后领取下一块
+static bool next_dict_line(password_generator_t *gen, const char **line, size_t *len) {
+    while (!gen->data.dict.finished) {
+        if (dict_chunk_next_line(&gen->data.dict.chunk, line, len)) {
+            return true;
+        }
+        if (!dict_source_next_chunk(gen->data.dict.source, &gen->data.dict.chunk)) {
+            gen->data.dict.finished = true;
+        }
     }
+    return false;
+}
+
+// 取下一个应用规则后的候选写进out，被拒绝的结果直接跳过；当前基础词的规则用完后才领取下一行
+static bool next_rule_candidate(password_generator_t *gen, char *out, size_t *len) {
+    const rule_set_t *rules = gen->data.dict.rules;
     
-    if (fgets(gen->data.dict.buffer, gen->data.dict.buffer_size, gen->data.dict.file)) {
-        // 移除换行符
-        size_t len = strlen(gen->data.dict.buffer);
-        if (len > 0 && gen->data.dict.buffer[len-1] == '\n') {
-            gen->data.dict.buffer[len-1] = '\0';
+    for (;;) {
+        while (gen->data.dict.rule < rules->count) {
+            int n = rule_apply(rules, gen->data.dict.rule++, gen->data.dict.word,
+                               gen->data.dict.word_len, out);
+            if (n >= 0) {
+                out[n] = '\0';
+                *len = (size_t)n;
+                return true;
+            }
         }
-        if (len > 1 && gen->data.dict.buffer[len-2] == '\r') {
-            gen->data.dict.buffer[len-2] = '\0';
+        
+        if (!next_dict_line(gen, &gen->data.dict.word, &gen->data.dict.word_len)) {
+            return false;
+        }
+        gen->data.dict.rule = 0;
+    }
+}
+
+// 取下一个组合候选写进out：右字典按长度桶从短到长，拼起来超长时这个分隔符剩下的右词都跳过；
+// 当前左词的分隔符用完后才领取下一行
+static bool next_combinator_candidate(password_generator_t *gen, char *out, size_t *len) {
+    const combinator_t *comb = gen->data.dict.combinator;
+    const word_list_t *right = comb->right;
+    
+    for (;;) {
+        while (gen->data.dict.separator < comb->separator_count) {
+            size_t sep_len = comb->separator_lens[gen->data.dict.separator];
+            size_t prefix = gen->data.dict.word_len + sep_len;
+            int right_len = gen->data.dict.right_len;
+            
+            while (right_len <= right->max_length && prefix + (size_t)right_len <= MAX_CANDIDATE_LENGTH) {
+                if (gen->data.dict.right_index < right->bucket_count[right_len]) {
+                    memcpy(out, gen->data.dict.word, gen->data.dict.word_len);
+                    memcpy(out + gen->data.dict.word_len, comb->separators[gen->data.dict.separator], sep_len);
+                    memcpy(out + prefix, right->data + right->bucket_offset[right_len] +
+                           gen->data.dict.right_index++ * (uint64_t)right_len, (size_t)right_len);
+                    gen->data.dict.right_len = right_len;
+                    *len = prefix + (size_t)right_len;
+                    out[*len] = '\0';
+                    return true;
+                }
+                right_len++;
+                gen->data.dict.right_index = 0;
+            }
+            
+            gen->data.dict.separator++;
+            gen->data.dict.right_len = right->min_length;
+            gen->data.dict.right_index = 0;
         }
         
-        return strdup(gen->data.dict.buffer);
-    } else {
-        gen->data.dict.eof_reached = true;
+        if (!next_dict_line(gen, &gen->data.dict.word, &gen->data.dict.word_len)) {
+            return false;
+        }
+        gen->data.dict.separator = 0;
+        gen->data.dict.right_len = right->min_length;
+        gen->data.dict.right_index = 0;
+    }
+}
+
+// 获取下一个字典密码
+static char* get_next_dict_password(password_generator_t *gen) {
+    if (gen->data.dict.rules || gen->data.dict.combinator) {
+        char password[MAX_CANDIDATE_LENGTH + 1];
+        size_t len;
+        bool more = gen->data.dict.rules ? next_rule_candidate(gen, password, &len) :
+                    next_combinator_candidate(gen, password, &len);
+        return more ? strndup(password, len) : NULL;
+    }
+    
+    const char *line;
+    size_t len;
+    if (!next_dict_line(gen, &line, &len)) {
         return NULL;
     }
+    return strndup(line, len);
 }
 
 // 递增数字密码
@@ -159,47 +265,132 @@ char* get_next_password(password_generator_t *gen) {
             return get_next_dict_password(gen);
         case GEN_NUMERIC:
             return get_next_numeric_password(gen);
+        case GEN_MASK: {
+            const char *password;
+            size_t len;
+            if (!mask_cursor_next(&gen->data.mask.cursor, &password, &len)) {
+                return NULL;
+            }
+            return strndup(password, len);
+        }
+        case GEN_MARKOV: {
+            const char *password;
+            size_t len;
+            if (!markov_cursor_next(&gen->data.markov, &password, &len)) {
+                return NULL;
+            }
+            return strndup(password, len);
+        }
+        case GEN_PRINCE: {
+            const char *password;
+            size_t len;
+            if (!prince_cursor_next(&gen->data.prince, &password, &len)) {
+                return NULL;
+            }
+            return strndup(password, len);
+        }
         default:
             return NULL;
     }
 }
 
+// 填充一批候选密码：字典直接引用映射，掩码、规则和组合的结果以及压缩字典写进批次的存储，都不为每个密码分配内存
+int fill_password_batch(password_generator_t *gen, password_batch_t *batch) {
+    batch->count = 0;
+    if (!gen) return 0;
+    
+    while (batch->count < ZIP_CRYPTO_BATCH_SIZE) {
+        char *slot = batch->storage[batch->count];
+        size_t len;
+        
+        if (gen->type == GEN_DICT && (gen->data.dict.rules || gen->data.dict.combinator)) {
+            // 规则和组合直接在批次的存储里展开基础词
+            bool more = gen->data.dict.rules ? next_rule_candidate(gen, slot, &len) :
+                        next_combinator_candidate(gen, slot, &len);
+            if (!more) break;
+            batch->passwords[batch->count] = slot;
+            batch->lens[batch->count++] = len;
+            continue;
+        }
+        
+        if (gen->type == GEN_DICT) {
+            // 字典行直接引用映射，不复制；压缩字典的解压块领取下一块时就会被复用，必须复制
+            const char *line;
+            if (!next_dict_line(gen, &line, &len)) break;
+            if (len > MAX_CANDIDATE_LENGTH) continue;
+            if (gen->data.dict.source->stream) {
+                memcpy(slot, line, len);
+                slot[len] = '\0';
+                line = slot;
+            }
+            batch->passwords[batch->count] = line;
+            batch->lens[batch->count++] = len;
+            continue;
+        }
+        
+        if (gen->type == GEN_MASK || gen->type == GEN_MARKOV || gen->type == GEN_PRINCE) {
+            const char *password;
+            bool more = gen->type == GEN_MASK ?
+                        mask_cursor_next(&gen->data.mask.cursor, &password, &len) :
+                        gen->type == GEN_MARKOV ?
+                        markov_cursor_next(&gen->data.markov, &password, &len) :
+                        prince_cursor_next(&gen->data.prince, &password, &len);
+            if (!more) break;
+            memcpy(slot, password, len);
+            slot[len] = '\0';
+        } else {
+            char *password = get_next_password(gen);
+            if (!password) break;
+            len = strlen(password);
+            if (len > MAX_CANDIDATE_LENGTH) {
+                free(password);
+                continue;
+            }
+            memcpy(slot, password, len + 1);
+            free(password);
+        }
+        
+        batch->passwords[batch->count] = slot;
+        batch->lens[batch->count++] = len;
+    }
+    return batch->count;
+}
+
 // 释放密码生成器
 void free_password_generator(password_generator_t *gen) {
     if (!gen) return;
     
     switch (gen->type) {
         case GEN_DICT:
-            if (gen->data.dict.file) {
-                fclose(gen->data.dict.file);
+            if (gen->data.dict.owns_source) {
+                dict_source_close(gen->data.dict.source);
             }
-            free(gen->data.dict.buffer);
             break;
         case GEN_NUMERIC:
             free(gen->data.numeric.current_password);
             break;
+        case GEN_MASK:
+            mask_list_free(gen->data.mask.owned);
+            break;
+        case GEN_MARKOV:
+        case GEN_PRINCE:
+            break;
     }
     
     free(gen);
 }
 
-// 计算字典中的密码数量
+// 计算字典中的密码数量，映射后多线程统计换行符
 uint64_t count_passwords_in_dict(const char *dict_file) {
     if (!dict_file || !file_exists(dict_file)) {
         return 0;
     }
     
-    FILE *file = fopen(dict_file, "r");
-    if (!file) return 0;
-    
-    uint64_t count = 0;
-    char buffer[1024];
-    
-    while (fgets(buffer, sizeof(buffer), file)) {
-        count++;
-    }
+    dict_source_t *source = dict_source_open(dict_file, 1);
+    if (!source) return 0;
     
-    fclose(file);
+    uint64_t count = dict_source_count_lines(source, get_cpu_count());
+    dict_source_close(source);
     return count;
 }
 
@@ -216,14 +407,81 @@ uint64_t count_numeric_passwords(int min_len, int max_len) {
     return total;
 }
 
+// 创建掩码生成器，生成队列中[start, start + count)范围的候选密码；掩码队列由调用者持有
+password_generator_t* create_mask_generator(const mask_list_t *list, uint64_t start, uint64_t count) {
+    if (!list) return NULL;
+    
+    password_generator_t *gen = calloc(1, sizeof(password_generator_t));
+    if (!gen) return NULL;
+    
+    gen->type = GEN_MASK;
+    if (!mask_cursor_init(&gen->data.mask.cursor, list, start, count)) {
+        free(gen);
+        return NULL;
+    }
+    return gen;
+}
+
+// 创建Markov生成器，生成按概率排序的候选空间中[start, start + count)范围的候选；模型由调用者持有
+password_generator_t* create_markov_generator(const markov_model_t *model, uint64_t start, uint64_t count) {
+    if (!model) return NULL;
+    
+    password_generator_t *gen = calloc(1, sizeof(password_generator_t));
+    if (!gen) return NULL;
+    
+    gen->type = GEN_MARKOV;
+    if (!markov_cursor_init(&gen->data.markov, model, start, count)) {
+        free(gen);
+        return NULL;
+    }
+    return gen;
+}
+
+// 创建PRINCE生成器，生成按链排好序的候选空间中[start, start + count)范围的候选；模型由调用者持有
+password_generator_t* create_prince_generator(const prince_model_t *model, uint64_t start, uint64_t count) {
+    if (!model) return NULL;
+    
+    password_generator_t *gen = calloc(1, sizeof(password_generator_t));
+    if (!gen) return NULL;
+    
+    gen->type = GEN_PRINCE;
+    if (!prince_cursor_init(&gen->data.prince, model, start, count)) {
+        free(gen);
+        return NULL;
+    }
+    return gen;
+}
+
+// 用单个自定义字符集重复max_len次的增量掩码建立生成器
+static password_generator_t* create_charset_generator(const char *charset, int min_len, int max_len) {
+    if (min_len <= 0 || max_len <= 0 || min_len > max_len || max_len > MASK_MAX_LENGTH) {
+        return NULL;
+    }
+    
+    char mask[2 * MASK_MAX_LENGTH + 1];
+    for (int i = 0; i < max_len; i++) {
+        mask[2 * i] = '?';
+        mask[2 * i + 1] = '1';
+    }
+    mask[2 * max_len] = '\0';
+    
+    const char *custom[MASK_CUSTOM_CHARSETS] = { charset, NULL, NULL, NULL };
+    mask_list_t *list = mask_list_parse(mask, custom, min_len, max_len);
+    password_generator_t *gen = create_mask_generator(list, 0, list ? list->keyspace : 0);
+    if (!gen) {
+        mask_list_free(list);
+        return NULL;
+    }
+    gen->data.mask.owned = list;
+    return gen;
+}
+
 // 创建字母密码生成器
 password_generator_t* create_alpha_generator(int min_len, int max_len, bool include_uppercase) {
-    // TODO: 实现字母密码生成器
-    return NULL;
+    return create_charset_generator(include_uppercase ? "?l?u" : "?l", min_len, max_len);
 }
 
 // 创建字母数字密码生成器
 password_generator_t* create_alphanum_generator(int min_len, int max_len) {
-    // TODO: 实现字母数字密码生成器
-    return NULL;
-}
\ No newline at end of file
+    return create_charset_generator("?l?u?d", min_len, max_len);
+}
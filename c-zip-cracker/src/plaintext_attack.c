@@ -0,0 +1,738 @@
+#include "../include/zip_cracker.h"
+#include <unistd.h>
+
+// Biham-Kocher已知明文攻击
+// 记号：X=key0, Y=key1, Z=key2，下标i表示处理第i个明文字节之前的状态
+
+#define PT_CONTIGUOUS_SIZE 8
+#define PT_ATTACK_SIZE     12
+#define PT_HEADER_SIZE     12
+
+#define MULT    0x08088405u
+#define MULTINV 0xD94FA8CDu
+
+#define MASK_2_32  0xFFFFFFFCu
+#define MASK_8_32  0xFFFFFF00u
+#define MASK_10_32 0xFFFFFC00u
+#define MASK_24_32 0xFF000000u
+#define MASK_26_32 0xFC000000u
+
+// A = B[x,32) + b（b为一个字节）时 A 与 B[x,32) 的最大差值
+#define MAXDIFF(x) ((((uint32_t)1 << (x)) - 1) + 0xFF)
+
+// 每次从共享游标领取的Z候选数量
+#define PT_WORK_CHUNK 256
+
+// Z削减阶段的跟踪阈值
+#define PT_TRACK_THRESHOLD (1u << 16)
+#define PT_WAIT_THRESHOLD  (1u << 8)
+
+// 攻击用到的查找表
+static const uint32_t *crc_tab;
+static uint32_t crcinv_tab[256];
+static uint16_t ks_inv[256][64];            // 每个密钥流字节对应的64个Z[2,16)值（升序）
+static uint8_t ks_group[256][65];           // 按Z[10,16)分组的起始下标
+static uint32_t multinv_tab[256];
+static uint8_t fiber2[256][8];
+static uint8_t fiber2_count[256];
+static uint8_t fiber3[256][12];
+static uint8_t fiber3_count[256];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+// 常见文件类型签名（只对存储条目有效）
+typedef struct {
+    const char *extension;
+    const uint8_t *bytes;
+    size_t size;
+    int64_t offset;          // 非负为距文件开头，负数为距文件结尾
+} file_signature_t;
+
+static const uint8_t sig_png[] = {
+    0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 'I', 'H', 'D', 'R'
+};
+static const uint8_t sig_jpeg[] = {
+    0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00, 0x01
+};
+static const uint8_t sig_xml[] = "<?xml version=\"1.0\" ";
+static const uint8_t sig_pdf[] = "%PDF-1.";
+static const uint8_t sig_pdf_eof[] = "%%EOF\n";
+static const uint8_t sig_zip[] = { 'P', 'K', 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x08, 0x00 };
+static const uint8_t sig_zip_eocd[] = { 'P', 'K', 0x05, 0x06, 0x00, 0x00, 0x00, 0x00 };
+static const uint8_t sig_exe[] = {
+    'M', 'Z', 0x90, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0xFF, 0xFF
+};
+
+// 每种文件类型的明文假设：第一项为连续明文，第二项（可选）为额外明文
+static const struct {
+    file_signature_t primary;
+    file_signature_t extra;
+} signatures[] = {
+    { {".png", sig_png, sizeof(sig_png), 0}, {NULL, NULL, 0, 0} },
+    { {".jpg", sig_jpeg, sizeof(sig_jpeg), 0}, {NULL, NULL, 0, 0} },
+    { {".jpeg", sig_jpeg, sizeof(sig_jpeg), 0}, {NULL, NULL, 0, 0} },
+    { {".xml", sig_xml, sizeof(sig_xml) - 1, 0}, {NULL, NULL, 0, 0} },
+    { {".svg", sig_xml, sizeof(sig_xml) - 1, 0}, {NULL, NULL, 0, 0} },
+    { {".exe", sig_exe, sizeof(sig_exe), 0}, {NULL, NULL, 0, 0} },
+    { {".dll", sig_exe, sizeof(sig_exe), 0}, {NULL, NULL, 0, 0} },
+    { {".pdf", sig_pdf, sizeof(sig_pdf) - 1, 0},
+      {".pdf", sig_pdf_eof, sizeof(sig_pdf_eof) - 1, -(int64_t)(sizeof(sig_pdf_eof) - 1)} },
+    { {".zip", sig_zip, sizeof(sig_zip), 0},
+      {".zip", sig_zip_eocd, sizeof(sig_zip_eocd), -22} },
+    { {".docx", sig_zip, sizeof(sig_zip), 0},
+      {".docx", sig_zip_eocd, sizeof(sig_zip_eocd), -22} },
+    { {".xlsx", sig_zip, sizeof(sig_zip), 0},
+      {".xlsx", sig_zip_eocd, sizeof(sig_zip_eocd), -22} },
+};
+
+// 攻击输入数据
+typedef struct {
+    uint8_t *ciphertext;     // 从加密头开始的密文
+    size_t cipher_size;
+    const uint8_t *plaintext;
+    size_t plain_size;
+    uint8_t *keystream;
+    size_t offset;           // 连续明文在密文中的位置
+    size_t index;            // Z削减后的攻击位置
+    size_t extra_count;
+    size_t *extra_pos;       // 额外明文在密文中的位置
+    const uint8_t *extra_bytes;
+    uint32_t *candidates;    // Z[2,32)候选
+    size_t candidate_count;
+} pt_data_t;
+
+// 共享的工作分配状态
+typedef struct {
+    pt_data_t *data;
+    size_t next;
+    bool found;
+    zip_crypto_keys_t keys;
+    attack_status_t *status;
+    pthread_mutex_t lock;
+} pt_shared_t;
+
+// 单个线程的递归状态
+typedef struct {
+    pt_shared_t *shared;
+    const pt_data_t *data;
+    uint32_t zlist[8];
+    uint32_t ylist[8];
+    uint32_t xlist[8];
+} pt_worker_t;
+
+static inline uint8_t lsb(uint32_t x) { return (uint8_t)x; }
+static inline uint8_t msb(uint32_t x) { return (uint8_t)(x >> 24); }
+
+static inline uint32_t crc32_step(uint32_t pval, uint8_t b) {
+    return (pval >> 8) ^ crc_tab[lsb(pval) ^ b];
+}
+
+static inline uint32_t crc32_inv(uint32_t crc, uint8_t b) {
+    return (crc << 8) ^ crcinv_tab[msb(crc)] ^ b;
+}
+
+// 由Z{i}和Z{i-1}得到Y{i}[24,32)
+static inline uint32_t get_yi_24_32(uint32_t zi, uint32_t zim1) {
+    return (crc32_inv(zi, 0) ^ zim1) << 24;
+}
+
+// 由Z{i}[2,32)得到Z{i-1}[10,32)
+static inline uint32_t get_zim1_10_32(uint32_t zi_2_32) {
+    return crc32_inv(zi_2_32, 0) & MASK_10_32;
+}
+
+static inline uint8_t keystream_byte(uint32_t z) {
+    uint16_t temp = (uint16_t)(z | 2);
+    return (uint8_t)(((uint32_t)temp * (temp ^ 1)) >> 8);
+}
+
+// 密钥流字节k且Z[10,16)给定时可能的Z[2,16)值
+static inline const uint16_t* ks_filter(uint8_t k, uint32_t zi_10_32, int *count) {
+    int group = (int)((zi_10_32 & 0xFFFF) >> 10);
+    *count = ks_group[k][group + 1] - ks_group[k][group];
+    return &ks_inv[k][ks_group[k][group]];
+}
+
+// 初始化所有查找表
+static void init_tables(void) {
+    crc_tab = zip_crypto_get_crc_table();
+    for (int b = 0; b < 256; b++) {
+        crcinv_tab[crc_tab[b] >> 24] = (crc_tab[b] << 8) ^ (uint32_t)b;
+    }
+
+    int count[256] = {0};
+    int group_count[256][64];
+    memset(group_count, 0, sizeof(group_count));
+    for (uint32_t z_2_16 = 0; z_2_16 < (1u << 16); z_2_16 += 4) {
+        uint8_t k = keystream_byte(z_2_16);
+        ks_inv[k][count[k]++] = (uint16_t)z_2_16;
+        group_count[k][z_2_16 >> 10]++;
+    }
+    for (int k = 0; k < 256; k++) {
+        ks_group[k][0] = 0;
+        for (int g = 0; g < 64; g++) {
+            ks_group[k][g + 1] = (uint8_t)(ks_group[k][g] + group_count[k][g]);
+        }
+    }
+
+    uint32_t prodinv = 0;
+    for (int x = 0; x < 256; x++, prodinv += MULTINV) {
+        multinv_tab[x] = prodinv;
+        uint8_t m = msb(prodinv);
+        fiber2[m][fiber2_count[m]++] = (uint8_t)x;
+        fiber2[(uint8_t)(m + 1)][fiber2_count[(uint8_t)(m + 1)]++] = (uint8_t)x;
+        fiber3[(uint8_t)(m - 1)][fiber3_count[(uint8_t)(m - 1)]++] = (uint8_t)x;
+        fiber3[m][fiber3_count[m]++] = (uint8_t)x;
+        fiber3[(uint8_t)(m + 1)][fiber3_count[(uint8_t)(m + 1)]++] = (uint8_t)x;
+    }
+}
+
+// 用明文字节正向更新密钥
+static inline void keys_update(zip_crypto_keys_t *k, uint8_t p) {
+    k->key0 = crc32_step(k->key0, p);
+    k->key1 = (k->key1 + lsb(k->key0)) * MULT + 1;
+    k->key2 = crc32_step(k->key2, msb(k->key1));
+}
+
+// 用密文字节反向更新密钥
+static inline void keys_update_backward(zip_crypto_keys_t *k, uint8_t c) {
+    k->key2 = crc32_inv(k->key2, msb(k->key1));
+    k->key1 = (k->key1 - 1) * MULTINV - lsb(k->key0);
+    k->key0 = crc32_inv(k->key0, c ^ keystream_byte(k->key2));
+}
+
+// 记录找到的密钥
+static void report_keys(pt_worker_t *w, const zip_crypto_keys_t *keys) {
+    pthread_mutex_lock(&w->shared->lock);
+    if (!w->shared->found) {
+        w->shared->found = true;
+        w->shared->keys = *keys;
+    }
+    pthread_mutex_unlock(&w->shared->lock);
+}
+
+// X列表完整后用剩余明文双向验证
+static void test_xlist(pt_worker_t *w) {
+    const pt_data_t *d = w->data;
+    const uint8_t *p = d->plaintext;
+    const uint8_t *c = d->ciphertext + d->offset;
+    size_t index = d->index;
+
+    // 计算X7
+    for (int i = 5; i <= 7; i++) {
+        w->xlist[i] = (crc32_step(w->xlist[i - 1], p[index + i - 1]) & MASK_8_32) | lsb(w->xlist[i]);
+    }
+
+    // 计算X3
+    uint32_t x = w->xlist[7];
+    for (int i = 6; i >= 3; i--) {
+        x = crc32_inv(x, p[index + i]);
+    }
+
+    // 检查X3与Y1[26,32)是否相容
+    uint32_t y1_26_32 = get_yi_24_32(w->zlist[1], w->zlist[0]) & MASK_26_32;
+    if (((w->ylist[3] - 1) * MULTINV - lsb(x) - 1) * MULTINV - y1_26_32 > MAXDIFF(26)) {
+        return;
+    }
+
+    // 向后验证剩余连续明文
+    zip_crypto_keys_t fwd = { w->xlist[7], w->ylist[7], w->zlist[7] };
+    keys_update(&fwd, p[index + 7]);
+    for (size_t i = index + 8; i < d->plain_size; i++) {
+        if ((uint8_t)(c[i] ^ keystream_byte(fwd.key2)) != p[i]) {
+            return;
+        }
+        keys_update(&fwd, p[i]);
+    }
+
+    // 向前验证并回退到加密头起点
+    zip_crypto_keys_t bwd = { x, w->ylist[3], w->zlist[3] };
+    for (size_t i = index + 3; i-- > 0; ) {
+        keys_update_backward(&bwd, c[i]);
+        if ((uint8_t)(c[i] ^ keystream_byte(bwd.key2)) != p[i]) {
+            return;
+        }
+    }
+    for (size_t i = d->offset; i-- > 0; ) {
+        keys_update_backward(&bwd, d->ciphertext[i]);
+    }
+
+    // 用额外明文过滤
+    if (d->extra_count > 0) {
+        zip_crypto_keys_t k = bwd;
+        size_t e = 0;
+        for (size_t i = 0; i < d->cipher_size && e < d->extra_count; i++) {
+            uint8_t plain = d->ciphertext[i] ^ keystream_byte(k.key2);
+            if (i == d->extra_pos[e]) {
+                if (plain != d->extra_bytes[e]) {
+                    return;
+                }
+                e++;
+            }
+            keys_update(&k, plain);
+        }
+    }
+
+    report_keys(w, &bwd);
+}
+
+// 由Y7..Y3推出X的低字节
+static void explore_ylists(pt_worker_t *w, int i) {
+    if (i == 3) {
+        test_xlist(w);
+        return;
+    }
+
+    uint32_t fy = (w->ylist[i] - 1) * MULTINV;
+    uint32_t ffy = (fy - 1) * MULTINV;
+    uint8_t m = msb(ffy - (w->ylist[i - 2] & MASK_24_32));
+
+    for (int f = 0; f < fiber2_count[m]; f++) {
+        uint8_t xi_0_8 = fiber2[m][f];
+        uint32_t yim1 = fy - xi_0_8;
+
+        if (ffy - multinv_tab[xi_0_8] - (w->ylist[i - 2] & MASK_24_32) <= MAXDIFF(24) &&
+            msb(yim1) == msb(w->ylist[i - 1])) {
+            w->ylist[i - 1] = yim1;
+            w->xlist[i] = xi_0_8;
+            explore_ylists(w, i - 1);
+        }
+    }
+}
+
+// 由Z7[2,32)逐步推出完整的Z列表，再猜测Y7
+static void explore_zlists(pt_worker_t *w, int i) {
+    if (w->shared->found) return;
+
+    const pt_data_t *d = w->data;
+
+    if (i != 0) {
+        uint32_t zim1_10_32 = get_zim1_10_32(w->zlist[i]);
+        int count;
+        const uint16_t *zim1_2_16 = ks_filter(d->keystream[d->index + i - 1], zim1_10_32, &count);
+
+        for (int j = 0; j < count; j++) {
+            w->zlist[i - 1] = zim1_10_32 | zim1_2_16[j];
+
+            // 由CRC32逆运算确定Z{i}[0,2)
+            w->zlist[i] &= MASK_2_32;
+            w->zlist[i] |= (crc32_inv(w->zlist[i], 0) ^ w->zlist[i - 1]) >> 8;
+
+            if (i < 7) {
+                w->ylist[i + 1] = get_yi_24_32(w->zlist[i + 1], w->zlist[i]);
+            }
+
+            explore_zlists(w, i - 1);
+        }
+        return;
+    }
+
+    // Z列表完整，枚举Y7[8,24)，prod 保持等于 (Y7[8,32) - 1) * MULTINV
+    uint32_t y7_24_32 = w->ylist[7] & MASK_24_32;
+    uint32_t prod = (multinv_tab[msb(w->ylist[7])] << 24) - MULTINV;
+    for (uint32_t y7_8_24 = 0; y7_8_24 < (1u << 24); y7_8_24 += 1u << 8, prod += MULTINV << 8) {
+        uint8_t m = (uint8_t)(msb(w->ylist[6]) - msb(prod));
+        for (int f = 0; f < fiber3_count[m]; f++) {
+            uint8_t y7_0_8 = fiber3[m][f];
+            if (prod + multinv_tab[y7_0_8] - (w->ylist[6] & MASK_24_32) <= MAXDIFF(24)) {
+                w->ylist[7] = y7_0_8 | y7_8_24 | y7_24_32;
+                explore_ylists(w, 7);
+            }
+        }
+    }
+}
+
+// 生成并削减Z[2,32)候选
+static bool reduce_candidates(pt_data_t *d) {
+    size_t index = d->plain_size - 1;
+    uint32_t *current = malloc(sizeof(uint32_t) * (1u << 22));
+    uint32_t *next = malloc(sizeof(uint32_t) * (1u << 22));
+    uint32_t *best = malloc(sizeof(uint32_t) * (1u << 22));
+    uint8_t *seen = malloc((1u << 22) / 8);
+    uint32_t *zim1_list = malloc(sizeof(uint32_t) * (1u << 22));
+    if (!current || !next || !best || !seen || !zim1_list) {
+        free(current);
+        free(next);
+        free(best);
+        free(seen);
+        free(zim1_list);
+        return false;
+    }
+
+    // 由最后一个密钥流字节生成约2^22个候选
+    size_t current_count = 0;
+    for (uint32_t zi_10_32_shifted = 0; zi_10_32_shifted < (1u << 22); zi_10_32_shifted++) {
+        int count;
+        const uint16_t *zi_2_16 = ks_filter(d->keystream[index], zi_10_32_shifted << 10, &count);
+        for (int j = 0; j < count; j++) {
+            current[current_count++] = (zi_10_32_shifted << 10) | zi_2_16[j];
+        }
+    }
+
+    // 沿连续明文向前削减，记录候选最少的位置
+    bool tracking = false;
+    size_t best_index = index;
+    size_t best_size = PT_TRACK_THRESHOLD;
+    size_t best_count = 0;
+    bool waiting = false;
+    size_t wait = 0;
+
+    for (size_t i = index; i >= PT_CONTIGUOUS_SIZE; i--) {
+        size_t zim1_count = 0;
+        size_t number_of_zim1_2_32 = 0;
+        memset(seen, 0, (1u << 22) / 8);
+
+        for (size_t j = 0; j < current_count; j++) {
+            uint32_t zim1_10_32 = get_zim1_10_32(current[j]);
+            uint32_t bit = zim1_10_32 >> 10;
+            int count;
+            ks_filter(d->keystream[i - 1], zim1_10_32, &count);
+            if (!(seen[bit >> 3] & (1 << (bit & 7))) && count > 0) {
+                seen[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+                zim1_list[zim1_count++] = zim1_10_32;
+                number_of_zim1_2_32 += (size_t)count;
+            }
+        }
+
+        if (number_of_zim1_2_32 <= best_size) {
+            tracking = true;
+            best_index = i - 1;
+            best_size = number_of_zim1_2_32;
+            waiting = false;
+        } else if (tracking) {
+            if (best_index == i) {
+                // 到达极小值，保存副本
+                memcpy(best, current, current_count * sizeof(uint32_t));
+                best_count = current_count;
+                if (best_size <= PT_WAIT_THRESHOLD) {
+                    waiting = true;
+                    wait = best_size * 4;
+                }
+            }
+            if (waiting && --wait == 0) {
+                break;
+            }
+        }
+
+        size_t next_count = 0;
+        for (size_t j = 0; j < zim1_count; j++) {
+            int count;
+            const uint16_t *zim1_2_16 = ks_filter(d->keystream[i - 1], zim1_list[j], &count);
+            for (int k = 0; k < count; k++) {
+                next[next_count++] = zim1_list[j] | zim1_2_16[k];
+            }
+        }
+
+        uint32_t *swap = current;
+        current = next;
+        next = swap;
+        current_count = next_count;
+    }
+
+    if (tracking && best_index != PT_CONTIGUOUS_SIZE - 1) {
+        free(current);
+        current = best;
+        current_count = best_count;
+        best = NULL;
+    }
+
+    d->index = (tracking ? best_index : PT_CONTIGUOUS_SIZE - 1) + 1 - PT_CONTIGUOUS_SIZE;
+    d->candidates = current;
+    d->candidate_count = current_count;
+
+    free(next);
+    free(best);
+    free(seen);
+    free(zim1_list);
+    return true;
+}
+
+// 攻击线程：从共享游标领取Z候选
+static void* plaintext_worker(void *arg) {
+    pt_shared_t *shared = (pt_shared_t*)arg;
+    pt_worker_t w;
+    memset(&w, 0, sizeof(w));
+    w.shared = shared;
+    w.data = shared->data;
+
+    while (!shared->found && !shared->status->stop) {
+        pthread_mutex_lock(&shared->lock);
+        size_t start = shared->next;
+        shared->next += PT_WORK_CHUNK;
+        pthread_mutex_unlock(&shared->lock);
+
+        if (start >= w.data->candidate_count) {
+            break;
+        }
+
+        size_t end = start + PT_WORK_CHUNK;
+        if (end > w.data->candidate_count) {
+            end = w.data->candidate_count;
+        }
+
+        for (size_t i = start; i < end && !shared->found; i++) {
+            w.zlist[7] = w.data->candidates[i];
+            explore_zlists(&w, 7);
+        }
+
+        pthread_mutex_lock(&shared->status->lock);
+        shared->status->tried_passwords += end - start;
+        pthread_mutex_unlock(&shared->status->lock);
+    }
+
+    return NULL;
+}
+
+// 查找明文所属的ZipCrypto条目
+static const zip_crypto_entry_t* find_entry(const zip_crypto_ctx_t *ctx, const char *name) {
+    for (uint32_t i = 0; i < ctx->entry_count; i++) {
+        if (name && strcmp(ctx->entries[i].filename, name) == 0) {
+            return &ctx->entries[i];
+        }
+    }
+    return NULL;
+}
+
+// 执行已知明文攻击，工作线程使用线程池的线程；成功时把加密头之前（即处理完密码后）的内部密钥存入pool->keys
+bool plaintext_attack(thread_pool_t *pool, const known_plaintext_t *pt) {
+    if (!pool || !pt || !pool->zip_crypto || !pool->zip_crypto->image) {
+        return false;
+    }
+    const zip_crypto_ctx_t *ctx = pool->zip_crypto;
+    attack_status_t *status = pool->status;
+
+    pthread_once(&tables_once, init_tables);
+
+    const zip_crypto_entry_t *entry = find_entry(ctx, pt->entry_name);
+    if (!entry) {
+        print_error("已知明文对应的条目不存在或未使用ZipCrypto加密: %s",
+                    pt->entry_name ? pt->entry_name : "(未指定)");
+        return false;
+    }
+
+    if (pt->size < PT_CONTIGUOUS_SIZE || pt->size + pt->extra_count < PT_ATTACK_SIZE ||
+        pt->offset + PT_HEADER_SIZE < 0) {
+        print_error("已知明文不足：需要至少%d字节，其中%d字节连续", PT_ATTACK_SIZE, PT_CONTIGUOUS_SIZE);
+        return false;
+    }
+
+    pt_data_t data;
+    memset(&data, 0, sizeof(data));
+    data.plaintext = pt->data;
+    data.plain_size = pt->size;
+    data.offset = (size_t)(pt->offset + PT_HEADER_SIZE);
+    data.extra_count = pt->extra_count;
+    data.extra_bytes = pt->extra_bytes;
+
+    // 读取覆盖所有明文位置的密文
+    size_t needed = data.offset + data.plain_size;
+    data.extra_pos = calloc(pt->extra_count ? pt->extra_count : 1, sizeof(size_t));
+    for (size_t i = 0; data.extra_pos && i < pt->extra_count; i++) {
+        data.extra_pos[i] = (size_t)(pt->extra_offsets[i] + PT_HEADER_SIZE);
+        if (data.extra_pos[i] + 1 > needed) {
+            needed = data.extra_pos[i] + 1;
+        }
+    }
+
+    if (!data.extra_pos || needed > entry->compressed_size || entry->data_offset + needed > ctx->image->size) {
+        print_error("已知明文超出了条目 %s 的数据范围", entry->filename);
+        free(data.extra_pos);
+        return false;
+    }
+
+    data.cipher_size = needed;
+    data.ciphertext = malloc(needed);
+    data.keystream = malloc(data.plain_size);
+    if (!data.ciphertext || !data.keystream) {
+        free(data.ciphertext);
+        free(data.keystream);
+        free(data.extra_pos);
+        return false;
+    }
+    memcpy(data.ciphertext, ctx->image->data + entry->data_offset, needed);
+
+    for (size_t i = 0; i < data.plain_size; i++) {
+        data.keystream[i] = data.plaintext[i] ^ data.ciphertext[data.offset + i];
+    }
+
+    print_info("已知明文攻击: 条目 %s，%zu 字节连续明文，%zu 字节额外明文 (%s)",
+               entry->filename, pt->size, pt->extra_count, pt->source ? pt->source : "用户提供");
+
+    bool found = false;
+    if (reduce_candidates(&data)) {
+        print_info("Z削减完成，剩余 %zu 个候选 (位置 %zu)", data.candidate_count, data.index + 7);
+
+        pt_shared_t shared;
+        memset(&shared, 0, sizeof(shared));
+        shared.data = &data;
+        shared.status = status;
+        pthread_mutex_init(&shared.lock, NULL);
+
+        pthread_mutex_lock(&status->lock);
+        status->tried_passwords = 0;
+        status->total_passwords = data.candidate_count;
+        status->start_time = time(NULL);
+        pthread_mutex_unlock(&status->lock);
+
+        int started = 0;
+        for (int i = 0; i < pool->thread_count; i++) {
+            if (pthread_create(&pool->threads[i], NULL, plaintext_worker, &shared) == 0) {
+                started++;
+            } else {
+                break;
+            }
+        }
+        for (int i = 0; i < started; i++) {
+            pthread_join(pool->threads[i], NULL);
+        }
+
+        found = shared.found;
+        if (found) {
+            pool->keys = shared.keys;
+        }
+        pthread_mutex_destroy(&shared.lock);
+        free(data.candidates);
+    }
+
+    free(data.ciphertext);
+    free(data.keystream);
+    free(data.extra_pos);
+    return found;
+}
+
+// 分配一个明文假设
+static known_plaintext_t* new_plaintext(const char *entry_name, const uint8_t *bytes, size_t size,
+                                        int64_t offset, const char *source) {
+    known_plaintext_t *pt = calloc(1, sizeof(known_plaintext_t));
+    if (!pt) return NULL;
+
+    pt->entry_name = strdup(entry_name);
+    pt->data = malloc(size ? size : 1);
+    pt->source = source;
+    if (!pt->entry_name || !pt->data) {
+        free_known_plaintext(pt);
+        return NULL;
+    }
+    memcpy(pt->data, bytes, size);
+    pt->size = size;
+    pt->offset = offset;
+    return pt;
+}
+
+// 在连续明文前加上加密头最后的校验字节（偏移-1）
+static known_plaintext_t* new_plaintext_with_check(const zip_crypto_entry_t *entry,
+                                                   const uint8_t *bytes, size_t size,
+                                                   const char *source) {
+    uint8_t buffer[64];
+    if (size + 1 > sizeof(buffer)) {
+        size = sizeof(buffer) - 1;
+    }
+    buffer[0] = entry->check_byte;
+    memcpy(buffer + 1, bytes, size);
+    return new_plaintext(entry->filename, buffer, size + 1, -1, source);
+}
+
+// 追加额外明文字节
+static bool add_extra(known_plaintext_t *pt, const uint8_t *bytes, size_t size, int64_t offset) {
+    int64_t *offsets = realloc(pt->extra_offsets, (pt->extra_count + size) * sizeof(int64_t));
+    if (!offsets) return false;
+    pt->extra_offsets = offsets;
+
+    uint8_t *extra = realloc(pt->extra_bytes, pt->extra_count + size);
+    if (!extra) return false;
+    pt->extra_bytes = extra;
+
+    for (size_t i = 0; i < size; i++) {
+        pt->extra_offsets[pt->extra_count] = offset + (int64_t)i;
+        pt->extra_bytes[pt->extra_count] = bytes[i];
+        pt->extra_count++;
+    }
+    return true;
+}
+
+// 检查文件名后缀
+static bool has_extension(const char *filename, const char *extension) {
+    size_t len = strlen(filename);
+    size_t ext_len = strlen(extension);
+    return len >= ext_len && strcasecmp(filename + len - ext_len, extension) == 0;
+}
+
+// 自动收集已知明文：存储条目的文件类型签名
+known_plaintext_t** collect_known_plaintext(const zip_crypto_ctx_t *ctx, int *count) {
+    *count = 0;
+    if (!ctx) return NULL;
+
+    size_t capacity = ctx->entry_count + 1;
+    known_plaintext_t **list = calloc(capacity, sizeof(known_plaintext_t*));
+    if (!list) return NULL;
+
+    for (uint32_t i = 0; i < ctx->entry_count; i++) {
+        const zip_crypto_entry_t *entry = &ctx->entries[i];
+
+        // 签名只对存储条目有效（压缩条目的明文是压缩流）
+        if (entry->compression_method != 0) continue;
+
+        for (size_t s = 0; s < sizeof(signatures) / sizeof(signatures[0]); s++) {
+            const file_signature_t *primary = &signatures[s].primary;
+            if (!has_extension(entry->filename, primary->extension) ||
+                entry->uncompressed_size < primary->size) {
+                continue;
+            }
+
+            known_plaintext_t *pt = new_plaintext_with_check(entry, primary->bytes, primary->size,
+                                                             primary->extension);
+            if (!pt) continue;
+
+            const file_signature_t *extra = &signatures[s].extra;
+            if (extra->bytes && entry->uncompressed_size >= (uint64_t)(-extra->offset)) {
+                add_extra(pt, extra->bytes, extra->size,
+                          (int64_t)entry->uncompressed_size + extra->offset);
+            }
+
+            if ((size_t)*count < capacity) {
+                list[(*count)++] = pt;
+            } else {
+                free_known_plaintext(pt);
+            }
+            break;
+        }
+    }
+
+    // 明文越多越快，按总字节数降序排列
+    for (int a = 0; a < *count; a++) {
+        for (int b = a + 1; b < *count; b++) {
+            if (list[b]->size + list[b]->extra_count > list[a]->size + list[a]->extra_count) {
+                known_plaintext_t *swap = list[a];
+                list[a] = list[b];
+                list[b] = swap;
+            }
+        }
+    }
+
+    return list;
+}
+
+// 从文件加载用户提供的已知明文
+known_plaintext_t* load_known_plaintext(const char *plain_file, const char *entry_name, long offset) {
+    if (!plain_file || !entry_name) return NULL;
+
+    FILE *file = fopen(plain_file, "rb");
+    if (!file) return NULL;
+
+    uint8_t buffer[4096];
+    size_t size = fread(buffer, 1, sizeof(buffer), file);
+    fclose(file);
+    if (size == 0) return NULL;
+
+    return new_plaintext(entry_name, buffer, size, offset, "用户提供的明文文件");
+}
+
+// 释放明文假设
+void free_known_plaintext(known_plaintext_t *pt) {
+    if (!pt) return;
+
+    free(pt->entry_name);
+    free(pt->data);
+    free(pt->extra_offsets);
+    free(pt->extra_bytes);
+    free(pt);
+}
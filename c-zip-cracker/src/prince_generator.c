@@ -0,0 +1,236 @@
+#include "../include/zip_cracker.h"
+
+// 一个候选长度的所有链，排序后再接到模型后面
+typedef struct {
+    prince_chain_t *chains;
+    uint64_t count;
+    uint64_t capacity;
+} chain_list_t;
+
+// 饱和乘法，超出2^64的链不会被枚举，只需要知道它们超出
+static uint64_t mul_saturated(uint64_t a, uint64_t b) {
+    return b != 0 && a > UINT64_MAX / b ? UINT64_MAX : a * b;
+}
+
+// 把剩余长度rem拆成若干个有词的元素长度，每种拆法是一条链
+static bool collect_chains(const word_list_t *elements, int max_elements, prince_chain_t *chain,
+                           int rem, chain_list_t *out) {
+    if (rem == 0) {
+        if (out->count == out->capacity) {
+            uint64_t capacity = out->capacity ? out->capacity * 2 : 256;
+            prince_chain_t *chains = realloc(out->chains, capacity * sizeof(prince_chain_t));
+            if (!chains) return false;
+            out->chains = chains;
+            out->capacity = capacity;
+        }
+        out->chains[out->count++] = *chain;
+        return true;
+    }
+    if (chain->count == max_elements) {
+        return true;
+    }
+
+    for (int len = 1; len <= rem && len <= elements->max_length; len++) {
+        if (elements->bucket_count[len] == 0) continue;
+
+        prince_chain_t next = *chain;
+        next.lengths[next.count++] = (uint8_t)len;
+        next.keyspace = mul_saturated(chain->keyspace, elements->bucket_count[len]);
+        if (!collect_chains(elements, max_elements, &next, rem - len, out)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 候选数少的链在前，相同时按元素长度排列，保证顺序固定
+static int compare_chains(const void *a, const void *b) {
+    const prince_chain_t *x = (const prince_chain_t *)a;
+    const prince_chain_t *y = (const prince_chain_t *)b;
+    if (x->keyspace != y->keyspace) return x->keyspace < y->keyspace ? -1 : 1;
+    if (x->count != y->count) return x->count < y->count ? -1 : 1;
+    return memcmp(x->lengths, y->lengths, sizeof(x->lengths));
+}
+
+// 按候选长度从短到长排出所有链，同长度按候选数从少到多；总数超过2^64时停在最后一条放得下的链
+static bool prince_build_chains(prince_model_t *model) {
+    chain_list_t list = { NULL, 0, 0 };
+
+    for (int len = model->min_length; len <= model->max_length; len++) {
+        prince_chain_t empty;
+        memset(&empty, 0, sizeof(empty));
+        empty.length = (uint8_t)len;
+        empty.keyspace = 1;
+
+        list.count = 0;
+        if (!collect_chains(model->elements, model->max_elements, &empty, len, &list)) {
+            free(list.chains);
+            return false;
+        }
+        qsort(list.chains, list.count, sizeof(prince_chain_t), compare_chains);
+
+        prince_chain_t *chains = realloc(model->chains, (model->chain_count + list.count + 1) *
+                                         sizeof(prince_chain_t));
+        if (!chains) {
+            free(list.chains);
+            return false;
+        }
+        model->chains = chains;
+
+        for (uint64_t i = 0; i < list.count; i++) {
+            prince_chain_t *chain = &list.chains[i];
+            if (chain->keyspace == UINT64_MAX || model->keyspace > UINT64_MAX - chain->keyspace) {
+                print_info("PRINCE候选空间超过2^64，只枚举到长度 %d 的前 %lu 条链", len, i);
+                free(list.chains);
+                return true;
+            }
+            chain->offset = model->keyspace;
+            model->keyspace += chain->keyspace;
+            model->chains[model->chain_count++] = *chain;
+        }
+    }
+
+    free(list.chains);
+    return true;
+}
+
+// 读入元素词表，建立由最多max_elements个元素组成、长度在[min_len, max_len]的链
+prince_model_t* prince_build(const char *word_file, int min_len, int max_len, int max_elements) {
+    if (!word_file || min_len <= 0 || max_len < min_len || max_len > PRINCE_MAX_LENGTH) {
+        print_error("PRINCE长度必须在1到%d之间", PRINCE_MAX_LENGTH);
+        return NULL;
+    }
+    if (max_elements <= 0 || max_elements > PRINCE_MAX_ELEMENTS) {
+        print_error("PRINCE元素个数必须在1到%d之间", PRINCE_MAX_ELEMENTS);
+        return NULL;
+    }
+
+    prince_model_t *model = calloc(1, sizeof(prince_model_t));
+    if (!model) return NULL;
+    model->min_length = min_len;
+    model->max_length = max_len;
+    model->max_elements = max_elements;
+
+    // 比最大长度还长的词不可能出现在任何链中，不必读进内存
+    model->elements = word_list_load(word_file, max_len);
+    if (!model->elements || !prince_build_chains(model)) {
+        prince_model_free(model);
+        return NULL;
+    }
+
+    if (model->keyspace == 0) {
+        print_error("词表中的词拼不出长度 %d-%d 的候选", min_len, max_len);
+        prince_model_free(model);
+        return NULL;
+    }
+
+    print_info("PRINCE: %lu 个元素，长度 %d-%d，每个候选最多 %d 个元素，%lu 条链，候选数 %lu",
+               model->elements->count, min_len, max_len, max_elements, model->chain_count,
+               model->keyspace);
+    return model;
+}
+
+// 二分查找下标所在的链
+static uint64_t find_chain(const prince_model_t *model, uint64_t index) {
+    uint64_t lo = 0, hi = model->chain_count - 1;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo + 1) / 2;
+        if (model->chains[mid].offset <= index) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+// 把第i个元素的当前词写到候选中它的位置
+static void cursor_write(prince_cursor_t *cursor, const prince_chain_t *chain, int i) {
+    const word_list_t *elements = cursor->model->elements;
+    size_t len = chain->lengths[i];
+    memcpy(cursor->password + cursor->positions[i],
+           elements->data + elements->bucket_offset[len] + cursor->digits[i] * len, len);
+}
+
+// 定位到链内的第index个候选：最后一个元素是最低位
+static void cursor_seek(prince_cursor_t *cursor, uint64_t chain_index, uint64_t index) {
+    const prince_chain_t *chain = &cursor->model->chains[chain_index];
+    const word_list_t *elements = cursor->model->elements;
+    cursor->chain = chain_index;
+
+    uint8_t pos = 0;
+    for (int i = 0; i < chain->count; i++) {
+        cursor->positions[i] = pos;
+        pos += chain->lengths[i];
+    }
+    for (int i = chain->count - 1; i >= 0; i--) {
+        uint64_t radix = elements->bucket_count[chain->lengths[i]];
+        cursor->digits[i] = index % radix;
+        index /= radix;
+        cursor_write(cursor, chain, i);
+    }
+    cursor->password[chain->length] = '\0';
+}
+
+// 定位到下标start，之后最多生成count个候选密码
+bool prince_cursor_init(prince_cursor_t *cursor, const prince_model_t *model, uint64_t start, uint64_t count) {
+    if (!cursor || !model) {
+        return false;
+    }
+
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->model = model;
+    if (start >= model->keyspace) {
+        return true;
+    }
+    cursor->remaining = count < model->keyspace - start ? count : model->keyspace - start;
+
+    uint64_t chain = find_chain(model, start);
+    cursor_seek(cursor, chain, start - model->chains[chain].offset);
+    return true;
+}
+
+// 递增到下一个候选：从最后一个元素往前进位，只重写变化的元素；当前链用完时换到下一条链
+static void cursor_advance(prince_cursor_t *cursor) {
+    const prince_model_t *model = cursor->model;
+    const prince_chain_t *chain = &model->chains[cursor->chain];
+
+    for (int i = chain->count - 1; i >= 0; i--) {
+        bool carry = ++cursor->digits[i] == model->elements->bucket_count[chain->lengths[i]];
+        if (carry) {
+            cursor->digits[i] = 0;
+        }
+        cursor_write(cursor, chain, i);
+        if (!carry) return;
+    }
+
+    if (cursor->chain + 1 < model->chain_count) {
+        cursor_seek(cursor, cursor->chain + 1, 0);
+    }
+}
+
+// 取下一个候选密码，返回的指针在下一次调用前有效
+bool prince_cursor_next(prince_cursor_t *cursor, const char **password, size_t *len) {
+    if (!cursor || cursor->remaining == 0) {
+        return false;
+    }
+
+    if (cursor->started) {
+        cursor_advance(cursor);
+    }
+    cursor->started = true;
+    cursor->remaining--;
+
+    *password = cursor->password;
+    *len = cursor->model->chains[cursor->chain].length;
+    return true;
+}
+
+// 释放PRINCE模型
+void prince_model_free(prince_model_t *model) {
+    if (!model) return;
+
+    word_list_free(model->elements);
+    free(model->chains);
+    free(model);
+}
@@ -0,0 +1,720 @@
+#include "../include/zip_cracker.h"
+#include <zlib.h>
+#include <openssl/evp.h>
+
+// RAR 1.5-4.x签名和块类型
+#define RAR3_SIGNATURE_SIZE 7
+#define RAR3_SFX_SEARCH     (1 << 20)
+#define RAR3_BLOCK_HEAD_SIZE 7
+#define RAR3_HEAD_MARK      0x72
+#define RAR3_HEAD_MAIN      0x73
+#define RAR3_HEAD_FILE      0x74
+#define RAR3_HEAD_ENDARC    0x7b
+
+// 块标志
+#define RAR3_MHD_PASSWORD  0x0080
+#define RAR3_LHD_SPLIT_BEFORE 0x0001
+#define RAR3_LHD_SPLIT_AFTER  0x0002
+#define RAR3_LHD_PASSWORD  0x0004
+#define RAR3_LHD_SOLID     0x0010
+#define RAR3_LHD_DIRECTORY 0x00E0
+#define RAR3_LHD_LARGE     0x0100
+#define RAR3_LHD_UNICODE   0x0200
+#define RAR3_LHD_SALT      0x0400
+#define RAR3_LONG_BLOCK    0x8000
+
+#define RAR3_FILE_HEAD_SIZE 32    // 通用头7字节 + 文件头固定部分25字节
+#define RAR3_METHOD_STORE   0x30
+#define RAR3_MIN_AES_VER    29    // 2.9之前的版本使用旧的私有算法
+#define RAR3_UNPACK_VER     29    // RAR 2.9压缩算法，大于2GB的文件记为36
+#define RAR3_UNPACK_VER_BIG 36
+
+// 第二阶段：分块解密，压缩数据先试解开头，加密头最多检查这么多个
+#define RAR3_VERIFY_CHUNK   (1 << 16)
+#define RAR3_VERIFY_HEADERS 4
+
+// 密钥派生参数
+#define RAR3_SALT_SIZE   8
+#define RAR3_HASH_ROUNDS 0x40000
+#define RAR3_IV_STEP     (RAR3_HASH_ROUNDS / 16)
+#define RAR3_KEY_SIZE    16
+#define RAR3_MAX_UNIT    (MAX_PASSWORD_UTF16_BYTES + RAR3_SALT_SIZE + 3)
+
+// 标准SHA-1之外的RAR 2.9变体：直接从输入处理的整块会被扩展后的消息字覆盖
+typedef struct {
+    uint32_t state[5];
+    uint64_t count;
+    uint8_t buffer[64];
+} rar29_sha1_t;
+
+static const uint8_t rar3_signature[RAR3_SIGNATURE_SIZE] = { 'R', 'a', 'r', '!', 0x1A, 0x07, 0x00 };
+
+static uint16_t read_le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// 文件条目的校验强度：小的存储文件直接比较CRC，压缩文件试解开头，大的存储文件第一阶段无法检查
+static int entry_rank(const rar3_ctx_t *ctx) {
+    if (ctx->method == RAR3_METHOD_STORE && ctx->unpacked_size <= ctx->cipher_len) return 3;
+    if (ctx->method != RAR3_METHOD_STORE) return 2;
+    return 1;
+}
+
+static void crc_output(void *opaque, const uint8_t *data, size_t len) {
+    uint32_t *crc = opaque;
+    *crc = (uint32_t)crc32(*crc, data, (uInt)len);
+}
+
+// 在压缩包模型的内存映像上解析RAR3头：加密的头优先，否则选校验最强的AES加密文件。
+// 固实文件依赖前一个文件的解压状态，分卷文件的数据不完整，都无法单独确认
+rar3_ctx_t* rar3_load(const archive_info_t *info) {
+    if (!info || !info->image || info->type != ARCHIVE_RAR) return NULL;
+
+    // 自解压文件的签名在前缀之后
+    const uint8_t *data = info->image->data;
+    size_t size = info->image->size;
+    size_t search = size < RAR3_SFX_SEARCH + RAR3_SIGNATURE_SIZE ? size : RAR3_SFX_SEARCH + RAR3_SIGNATURE_SIZE;
+    const uint8_t *sig = memmem(data, search, rar3_signature, RAR3_SIGNATURE_SIZE);
+    if (!sig) return NULL;
+
+    rar3_ctx_t best;
+    bool found = false;
+    size_t pos = (size_t)(sig - data) + RAR3_SIGNATURE_SIZE;
+
+    while ((!found || entry_rank(&best) < 3) && pos + RAR3_BLOCK_HEAD_SIZE <= size) {
+        const uint8_t *header = data + pos;
+        uint8_t type = header[2];
+        uint16_t flags = read_le16(header + 3);
+        uint16_t head_size = read_le16(header + 5);
+        if (head_size < RAR3_BLOCK_HEAD_SIZE || type == RAR3_HEAD_ENDARC || head_size > size - pos ||
+            ((uint32_t)crc32(0, header + 2, head_size - 2) & 0xFFFF) != read_le16(header)) {
+            break;
+        }
+
+        uint64_t add_size = 0;
+        if ((flags & RAR3_LONG_BLOCK) && head_size >= RAR3_BLOCK_HEAD_SIZE + 4) {
+            add_size = read_le32(header + 7);
+        }
+        size_t next = pos + head_size;
+
+        if (type == RAR3_HEAD_MAIN && (flags & RAR3_MHD_PASSWORD)) {
+            // 之后的每个头都是 8字节盐 + AES-128-CBC密文
+            rar3_ctx_t st;
+            memset(&st, 0, sizeof(st));
+            if (next + RAR3_SALT_SIZE <= size) {
+                memcpy(st.salt, data + next, RAR3_SALT_SIZE);
+                size_t avail = size - next - RAR3_SALT_SIZE;
+                st.cipher_len = (avail < sizeof(st.cipher) ? avail : sizeof(st.cipher)) / 16 * 16;
+                memcpy(st.cipher, data + next + RAR3_SALT_SIZE, st.cipher_len);
+                st.has_salt = true;
+                st.is_header = true;
+                st.image = info->image;
+                st.data_offset = next;
+                if (st.cipher_len >= 16) {
+                    best = st;
+                    found = true;
+                }
+            }
+            break;
+        }
+
+        if (type == RAR3_HEAD_FILE && head_size >= RAR3_FILE_HEAD_SIZE &&
+            (flags & RAR3_LHD_PASSWORD) && (flags & RAR3_LHD_DIRECTORY) != RAR3_LHD_DIRECTORY &&
+            !(flags & (RAR3_LHD_SOLID | RAR3_LHD_SPLIT_BEFORE | RAR3_LHD_SPLIT_AFTER)) &&
+            header[24] >= RAR3_MIN_AES_VER) {
+            rar3_ctx_t st;
+            memset(&st, 0, sizeof(st));
+            st.pack_size = read_le32(header + 7);
+            st.unpacked_size = read_le32(header + 11);
+            st.file_crc = read_le32(header + 16);
+            st.unp_ver = header[24];
+            st.method = header[25];
+
+            size_t name_pos = RAR3_FILE_HEAD_SIZE;
+            if (flags & RAR3_LHD_LARGE) {
+                if (head_size >= RAR3_FILE_HEAD_SIZE + 8) {
+                    st.pack_size |= (uint64_t)read_le32(header + 32) << 32;
+                    st.unpacked_size |= (uint64_t)read_le32(header + 36) << 32;
+                }
+                name_pos += 8;
+            }
+            add_size = st.pack_size;
+            bool decodable = st.method == RAR3_METHOD_STORE ||
+                             st.unp_ver == RAR3_UNPACK_VER || st.unp_ver == RAR3_UNPACK_VER_BIG;
+
+            size_t salt_pos = name_pos + read_le16(header + 26);
+            if ((flags & RAR3_LHD_SALT) && salt_pos + RAR3_SALT_SIZE <= head_size) {
+                memcpy(st.salt, header + salt_pos, RAR3_SALT_SIZE);
+                st.has_salt = true;
+            }
+
+            size_t want = st.pack_size < sizeof(st.cipher) ? (size_t)st.pack_size : sizeof(st.cipher);
+            if (decodable && st.unpacked_size > 0 && want >= 16 && st.pack_size <= size - next) {
+                memcpy(st.cipher, data + next, want);
+                st.cipher_len = want / 16 * 16;
+                st.image = info->image;
+                st.data_offset = next;
+                // 同等强度时选数据最小的，第二阶段要解密并解压整个文件
+                if (!found || entry_rank(&st) > entry_rank(&best) ||
+                    (entry_rank(&st) == entry_rank(&best) && st.pack_size < best.pack_size)) {
+                    best = st;
+                    found = true;
+                }
+            }
+        }
+
+        if (add_size > size - next) {
+            break;
+        }
+        pos = next + (size_t)add_size;
+    }
+
+    if (!found) {
+        return NULL;
+    }
+
+    rar3_ctx_t *ctx = calloc(1, sizeof(rar3_ctx_t));
+    if (!ctx) return NULL;
+    *ctx = best;
+    ctx->kernel = zip_crypto_select_kernel();
+    return ctx;
+}
+
+// 只遍历内存映像中的块头建立模型，文件数据按PACK_SIZE直接跳过
+bool rar3_analyze(archive_info_t *info) {
+    const uint8_t *data = info->image->data;
+    size_t size = info->image->size;
+    size_t search = size < RAR3_SFX_SEARCH + RAR3_SIGNATURE_SIZE ? size : RAR3_SFX_SEARCH + RAR3_SIGNATURE_SIZE;
+    const uint8_t *sig = memmem(data, search, rar3_signature, RAR3_SIGNATURE_SIZE);
+    if (!sig) return false;
+
+    size_t pos = (size_t)(sig - data) + RAR3_SIGNATURE_SIZE;
+    bool ended = false;
+    while (pos + RAR3_BLOCK_HEAD_SIZE <= size) {
+        const uint8_t *header = data + pos;
+        uint8_t type = header[2];
+        uint16_t flags = read_le16(header + 3);
+        uint16_t head_size = read_le16(header + 5);
+        if (head_size < RAR3_BLOCK_HEAD_SIZE || head_size > size - pos ||
+            ((uint32_t)crc32(0, header + 2, head_size - 2) & 0xFFFF) != read_le16(header)) {
+            break;
+        }
+        if (type == RAR3_HEAD_ENDARC) {
+            ended = true;
+            break;
+        }
+
+        uint64_t add_size = 0;
+        if ((flags & RAR3_LONG_BLOCK) && head_size >= RAR3_BLOCK_HEAD_SIZE + 4) {
+            add_size = read_le32(header + 7);
+        }
+
+        if (type == RAR3_HEAD_MAIN && (flags & RAR3_MHD_PASSWORD)) {
+            // 后面的块头全部加密，每个块前有8字节盐
+            if ((size_t)head_size + RAR3_SALT_SIZE > size - pos) return false;
+            info->is_encrypted = info->headers_encrypted = true;
+            info->header_salt_len = RAR3_SALT_SIZE;
+            memcpy(info->header_salt, header + head_size, RAR3_SALT_SIZE);
+            return true;
+        }
+
+        if (type == RAR3_HEAD_FILE && head_size >= RAR3_FILE_HEAD_SIZE) {
+            file_entry_t *entry = archive_info_add_entry(info);
+            if (!entry) return false;
+
+            entry->compressed_size = read_le32(header + 7);
+            entry->uncompressed_size = read_le32(header + 11);
+            entry->crc32 = read_le32(header + 16);
+            entry->compression_method = header[25];
+            entry->flags = flags;
+
+            size_t name_pos = RAR3_FILE_HEAD_SIZE;
+            if (flags & RAR3_LHD_LARGE) {
+                if (head_size >= RAR3_FILE_HEAD_SIZE + 8) {
+                    entry->compressed_size |= (uint64_t)read_le32(header + 32) << 32;
+                    entry->uncompressed_size |= (uint64_t)read_le32(header + 36) << 32;
+                }
+                name_pos += 8;
+            }
+            add_size = entry->compressed_size;
+
+            // Unicode文件名字段是 ASCII名称 + 0 + 压缩的UTF-16，只取前半部分
+            size_t name_len = read_le16(header + 26);
+            if (name_pos + name_len > head_size) name_len = name_pos < head_size ? head_size - name_pos : 0;
+            if (flags & RAR3_LHD_UNICODE) name_len = strnlen((const char *)header + name_pos, name_len);
+            entry->filename = strndup((const char *)header + name_pos, name_len);
+
+            size_t salt_pos = name_pos + read_le16(header + 26);
+            if (flags & RAR3_LHD_PASSWORD) {
+                entry->is_encrypted = true;
+                info->is_encrypted = true;
+                if ((flags & RAR3_LHD_SALT) && salt_pos + RAR3_SALT_SIZE <= head_size) {
+                    entry->salt_len = RAR3_SALT_SIZE;
+                    memcpy(entry->salt, header + salt_pos, RAR3_SALT_SIZE);
+                }
+            }
+            info->total_size += entry->uncompressed_size;
+        }
+
+        if (add_size > size - pos - head_size) break;
+        pos += head_size + (size_t)add_size;
+    }
+
+    // 分卷可能没有结束块，至少要读到一个文件
+    return ended || info->file_count > 0;
+}
+
+static void rar29_transform(rar29_sha1_t *c, const uint8_t *block, uint32_t tail[16]) {
+    uint32_t words[16];
+    for (int t = 0; t < 16; t++) {
+        const uint8_t *p = block + t * 4;
+        words[t] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+    sha1_compress_words(c->state, words, tail);
+}
+
+// RAR 2.9的sha1_process：quirk为真时把整块的W[64..79]按小端写回输入
+static void rar29_update(rar29_sha1_t *c, uint8_t *data, size_t len, bool quirk) {
+    size_t i, j = (size_t)(c->count & 63);
+    c->count += len;
+
+    if (j + len > 63) {
+        i = 64 - j;
+        memcpy(c->buffer + j, data, i);
+        rar29_transform(c, c->buffer, NULL);
+        for (; i + 63 < len; i += 64) {
+            uint32_t tail[16];
+            rar29_transform(c, data + i, tail);
+            for (int k = 0; quirk && k < 16; k++) {
+                data[i + k * 4] = (uint8_t)tail[k];
+                data[i + k * 4 + 1] = (uint8_t)(tail[k] >> 8);
+                data[i + k * 4 + 2] = (uint8_t)(tail[k] >> 16);
+                data[i + k * 4 + 3] = (uint8_t)(tail[k] >> 24);
+            }
+        }
+        j = 0;
+    } else {
+        i = 0;
+    }
+    memcpy(c->buffer + j, data + i, len - i);
+}
+
+static void rar29_final(rar29_sha1_t c, uint32_t digest[5]) {
+    uint8_t pad[72];
+    uint64_t bits = c.count * 8;
+    size_t pad_len = ((c.count & 63) < 56 ? 56 : 120) - (size_t)(c.count & 63);
+    memset(pad, 0, sizeof(pad));
+    pad[0] = 0x80;
+    for (int i = 0; i < 8; i++) {
+        pad[pad_len + i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    rar29_update(&c, pad, pad_len + 8, false);
+    memcpy(digest, c.state, sizeof(c.state));
+}
+
+// 标量路径：逐字节模拟RAR 2.9的SHA-1（密码较长时必须走这里）
+static void derive_scalar(const uint8_t *raw, size_t raw_len, uint8_t key[RAR3_KEY_SIZE], uint8_t iv[16]) {
+    uint8_t data[RAR3_MAX_UNIT];
+    rar29_sha1_t c;
+    memcpy(data, raw, raw_len);
+    memset(&c, 0, sizeof(c));
+    c.state[0] = 0x67452301;
+    c.state[1] = 0xEFCDAB89;
+    c.state[2] = 0x98BADCFE;
+    c.state[3] = 0x10325476;
+    c.state[4] = 0xC3D2E1F0;
+
+    uint32_t digest[5];
+    for (uint32_t i = 0; i < RAR3_HASH_ROUNDS; i++) {
+        uint8_t num[3] = { (uint8_t)i, (uint8_t)(i >> 8), (uint8_t)(i >> 16) };
+        rar29_update(&c, data, raw_len, true);
+        rar29_update(&c, num, 3, false);
+        if (i % RAR3_IV_STEP == 0) {
+            rar29_final(c, digest);
+            iv[i / RAR3_IV_STEP] = (uint8_t)digest[4];
+        }
+    }
+    rar29_final(c, digest);
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            key[i * 4 + j] = (uint8_t)(digest[i] >> (j * 8));
+        }
+    }
+}
+
+// 多路密钥派生：同一组的 UTF-16密码 + 盐 等长，每路单元为 密码 || 盐 || 3字节计数器
+static void derive_lanes(zip_crypto_kernel_t kernel, int lanes, uint8_t units[][RAR3_MAX_UNIT], size_t raw_len,
+                         uint8_t keys[][RAR3_KEY_SIZE], uint8_t ivs[][16]) {
+    static __thread sha_lanes_t l, tmp;
+    const uint8_t *ptrs[SHA_MAX_LANES];
+    uint8_t digests[SHA_MAX_LANES][32];
+
+    sha_lanes_init(&l, SHA_ALGO_SHA1, kernel, lanes);
+    for (int lane = 0; lane < lanes; lane++) {
+        ptrs[lane] = units[lane];
+    }
+
+    for (uint32_t i = 0; i < RAR3_HASH_ROUNDS; i++) {
+        for (int lane = 0; lane < lanes; lane++) {
+            units[lane][raw_len] = (uint8_t)i;
+            units[lane][raw_len + 1] = (uint8_t)(i >> 8);
+            units[lane][raw_len + 2] = (uint8_t)(i >> 16);
+        }
+        sha_lanes_update(&l, ptrs, raw_len + 3);
+
+        if (i % RAR3_IV_STEP == 0) {
+            tmp = l;
+            sha_lanes_final(&tmp, digests);
+            for (int lane = 0; lane < lanes; lane++) {
+                ivs[lane][i / RAR3_IV_STEP] = digests[lane][19];
+            }
+        }
+    }
+
+    sha_lanes_final(&l, digests);
+    for (int lane = 0; lane < lanes; lane++) {
+        // 密钥取前4个字并按小端排列
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                keys[lane][i * 4 + j] = digests[lane][i * 4 + 3 - j];
+            }
+        }
+    }
+}
+
+// 把密码转为派生单元，返回密码+盐的长度
+static size_t build_unit(const rar3_ctx_t *ctx, const char *password, size_t len, uint8_t unit[RAR3_MAX_UNIT]) {
+    size_t n = utf8_to_utf16le(password, len, unit, MAX_PASSWORD_UTF16_BYTES);
+    if (ctx->has_salt) {
+        memcpy(unit + n, ctx->salt, RAR3_SALT_SIZE);
+        n += RAR3_SALT_SIZE;
+    }
+    return n;
+}
+
+// AES-128-CBC解密开头len字节
+static bool decrypt_prefix(const rar3_ctx_t *ctx, EVP_CIPHER_CTX *cipher, const uint8_t key[RAR3_KEY_SIZE],
+                           const uint8_t iv[16], uint8_t *plain, size_t len) {
+    int out_len = 0;
+    return EVP_DecryptInit_ex(cipher, EVP_aes_128_cbc(), NULL, key, iv) == 1 &&
+           EVP_CIPHER_CTX_set_padding(cipher, 0) == 1 &&
+           EVP_DecryptUpdate(cipher, plain, &out_len, ctx->cipher, (int)len) == 1;
+}
+
+// 用派生出的密钥检查开头的密文：加密头比较头CRC，小的存储文件比较CRC32，
+// 压缩文件用原生解压器试解，数据全在缓存里时解完比较CRC32
+static bool check_key(const rar3_ctx_t *ctx, EVP_CIPHER_CTX *cipher, const uint8_t key[RAR3_KEY_SIZE],
+                      const uint8_t iv[16]) {
+    uint8_t plain[sizeof(ctx->cipher)];
+
+    if (ctx->is_header) {
+        // 解密后的块头：HEAD_CRC、HEAD_TYPE、HEAD_FLAGS、HEAD_SIZE
+        if (!decrypt_prefix(ctx, cipher, key, iv, plain, 16)) return false;
+        uint8_t type = plain[2];
+        uint16_t size = read_le16(plain + 5);
+        if (type < RAR3_HEAD_MARK || type > RAR3_HEAD_ENDARC || size < RAR3_BLOCK_HEAD_SIZE) {
+            return false;
+        }
+        if (size > ctx->cipher_len) {
+            // 缓存没满说明文件已经结束，放不下这个头；否则头CRC留给第二阶段
+            return ctx->cipher_len == sizeof(ctx->cipher);
+        }
+
+        if (!decrypt_prefix(ctx, cipher, key, iv, plain, ((size_t)size + 15) / 16 * 16)) return false;
+        return ((uint32_t)crc32(0, plain + 2, size - 2) & 0xFFFF) == read_le16(plain);
+    }
+
+    if (ctx->method == RAR3_METHOD_STORE) {
+        if (ctx->unpacked_size > ctx->cipher_len) return true;
+        size_t len = (size_t)(ctx->unpacked_size + 15) / 16 * 16;
+        if (!decrypt_prefix(ctx, cipher, key, iv, plain, len)) return false;
+        return (uint32_t)crc32(0, plain, (uInt)ctx->unpacked_size) == ctx->file_crc;
+    }
+
+    if (!decrypt_prefix(ctx, cipher, key, iv, plain, ctx->cipher_len)) return false;
+    bool partial = ctx->pack_size > ctx->cipher_len;
+    uint32_t crc = 0;
+    zip_verify_result_t result = rar3_unpack(plain, ctx->cipher_len, ctx->unpacked_size, partial,
+                                             partial ? NULL : crc_output, &crc);
+    if (result == ZIP_VERIFY_FAIL) return false;
+    return partial || result != ZIP_VERIFY_OK || crc == ctx->file_crc;
+}
+
+// 使用指定内核批量校验，按密码长度分组填满各路；通过的密码把密钥和IV留给第二阶段
+static int check_batch_with_kernel(const rar3_ctx_t *ctx, zip_crypto_kernel_t kernel,
+                                   const char *const *passwords, const size_t *lens,
+                                   int count, bool *results, rar3_key_t *out) {
+    int lanes = sha_kernel_lanes(kernel);
+    static __thread uint8_t units[ZIP_CRYPTO_BATCH_SIZE][RAR3_MAX_UNIT];
+    size_t raw_len[ZIP_CRYPTO_BATCH_SIZE];
+    bool done[ZIP_CRYPTO_BATCH_SIZE];
+    int passed = 0;
+
+    if (count > ZIP_CRYPTO_BATCH_SIZE) {
+        count = ZIP_CRYPTO_BATCH_SIZE;
+    }
+    for (int i = 0; i < count; i++) {
+        raw_len[i] = build_unit(ctx, passwords[i], lens[i], units[i]);
+        done[i] = false;
+        results[i] = false;
+    }
+
+    EVP_CIPHER_CTX *cipher = EVP_CIPHER_CTX_new();
+    if (!cipher) return 0;
+
+    for (int i = 0; i < count; i++) {
+        if (done[i]) continue;
+
+        uint8_t keys[SHA_MAX_LANES][RAR3_KEY_SIZE];
+        uint8_t ivs[SHA_MAX_LANES][16];
+        int group[SHA_MAX_LANES];
+        int n = 0;
+
+        if (raw_len[i] >= 64) {
+            // 超过一个块时RAR 2.9会改写输入，只能逐个模拟
+            group[n++] = i;
+            done[i] = true;
+            derive_scalar(units[i], raw_len[i], keys[0], ivs[0]);
+        } else {
+            static __thread uint8_t group_units[SHA_MAX_LANES][RAR3_MAX_UNIT];
+            for (int j = i; j < count && n < lanes; j++) {
+                if (!done[j] && raw_len[j] == raw_len[i]) {
+                    group[n++] = j;
+                    done[j] = true;
+                }
+            }
+            for (int lane = 0; lane < lanes; lane++) {
+                memcpy(group_units[lane], units[group[lane < n ? lane : 0]], raw_len[i]);
+            }
+            derive_lanes(kernel, lanes, group_units, raw_len[i], keys, ivs);
+        }
+
+        for (int lane = 0; lane < n; lane++) {
+            results[group[lane]] = check_key(ctx, cipher, keys[lane], ivs[lane]);
+            if (results[group[lane]]) {
+                passed++;
+                if (out) {
+                    memcpy(out[group[lane]].key, keys[lane], RAR3_KEY_SIZE);
+                    memcpy(out[group[lane]].iv, ivs[lane], 16);
+                }
+            }
+        }
+    }
+
+    EVP_CIPHER_CTX_free(cipher);
+    return passed;
+}
+
+// 批量校验密码，返回通过检查的数量；keys不为空时记录通过者的密钥
+int rar3_check_batch(const rar3_ctx_t *ctx, const char *const *passwords,
+                     const size_t *lens, int count, bool *results, rar3_key_t *keys) {
+    if (!ctx || !passwords || !lens || !results || count <= 0) {
+        return 0;
+    }
+    return check_batch_with_kernel(ctx, ctx->kernel, passwords, lens, count, results, keys);
+}
+
+// 检查单个密码
+bool rar3_check_password(const rar3_ctx_t *ctx, const char *password, size_t len) {
+    bool result = false;
+    rar3_check_batch(ctx, &password, &len, 1, &result, NULL);
+    return result;
+}
+
+// 解密映像中连续的几个加密头，逐个比较头CRC。每个头都从同一个IV开始独立加密，
+// 换了盐的头需要另外派生密钥，检查到那里为止
+static zip_verify_result_t verify_headers(const rar3_ctx_t *ctx, EVP_CIPHER_CTX *cipher, const rar3_key_t *key) {
+    const uint8_t *data = ctx->image->data;
+    size_t size = ctx->image->size;
+    size_t pos = ctx->data_offset;
+    uint8_t *plain = malloc(0x10000 + 16);
+    if (!plain) return ZIP_VERIFY_UNSUPPORTED;
+
+    int checked = 0;
+    bool ok = true;
+    while (checked < RAR3_VERIFY_HEADERS && pos + RAR3_SALT_SIZE + 16 <= size &&
+           memcmp(data + pos, ctx->salt, RAR3_SALT_SIZE) == 0) {
+        const uint8_t *src = data + pos + RAR3_SALT_SIZE;
+        int out_len = 0;
+        if (EVP_DecryptInit_ex(cipher, EVP_aes_128_cbc(), NULL, key->key, key->iv) != 1 ||
+            EVP_CIPHER_CTX_set_padding(cipher, 0) != 1 ||
+            EVP_DecryptUpdate(cipher, plain, &out_len, src, 16) != 1) {
+            ok = false;
+            break;
+        }
+        uint16_t head_size = read_le16(plain + 5);
+        size_t padded = ((size_t)head_size + 15) / 16 * 16;
+        if (head_size < RAR3_BLOCK_HEAD_SIZE || padded > size - pos - RAR3_SALT_SIZE ||
+            (padded > 16 && EVP_DecryptUpdate(cipher, plain + 16, &out_len, src + 16, (int)(padded - 16)) != 1) ||
+            ((uint32_t)crc32(0, plain + 2, head_size - 2) & 0xFFFF) != read_le16(plain)) {
+            ok = false;
+            break;
+        }
+        checked++;
+
+        uint8_t type = plain[2];
+        uint16_t flags = read_le16(plain + 3);
+        if (type == RAR3_HEAD_ENDARC) break;
+
+        // 跳过这个头携带的数据，加密文件的数据本身已是16字节的整数倍
+        uint64_t add_size = 0;
+        if ((flags & RAR3_LONG_BLOCK) && head_size >= RAR3_BLOCK_HEAD_SIZE + 4) {
+            add_size = read_le32(plain + 7);
+        }
+        if (type == RAR3_HEAD_FILE && (flags & RAR3_LHD_LARGE) && head_size >= RAR3_FILE_HEAD_SIZE + 8) {
+            add_size |= (uint64_t)read_le32(plain + 32) << 32;
+        }
+        size_t next = pos + RAR3_SALT_SIZE + padded;
+        if (add_size > size - next) break;
+        pos = next + (size_t)add_size;
+    }
+    free(plain);
+    return ok && checked > 0 ? ZIP_VERIFY_OK : ZIP_VERIFY_FAIL;
+}
+
+// 分块解密存储的文件并计算CRC32
+static zip_verify_result_t verify_stored(const rar3_ctx_t *ctx, EVP_CIPHER_CTX *cipher) {
+    if ((ctx->unpacked_size + 15) / 16 * 16 > ctx->pack_size) {
+        return ZIP_VERIFY_FAIL;
+    }
+
+    const uint8_t *src = ctx->image->data + ctx->data_offset;
+    uint8_t *plain = malloc(RAR3_VERIFY_CHUNK);
+    if (!plain) return ZIP_VERIFY_UNSUPPORTED;
+
+    uint64_t left = ctx->unpacked_size;
+    size_t offset = 0;
+    uint32_t crc = 0;
+    int out_len = 0;
+    while (left > 0) {
+        size_t chunk = left < RAR3_VERIFY_CHUNK ? (size_t)(left + 15) / 16 * 16 : RAR3_VERIFY_CHUNK;
+        if (EVP_DecryptUpdate(cipher, plain, &out_len, src + offset, (int)chunk) != 1) {
+            free(plain);
+            return ZIP_VERIFY_FAIL;
+        }
+        size_t used = left < chunk ? (size_t)left : chunk;
+        crc_output(&crc, plain, used);
+        offset += chunk;
+        left -= used;
+    }
+    free(plain);
+    return crc == ctx->file_crc ? ZIP_VERIFY_OK : ZIP_VERIFY_FAIL;
+}
+
+// 解密全部压缩数据后原生解压比较CRC32；错误的密钥通常在第一块就解不下去，先试解这一块
+static zip_verify_result_t verify_packed(const rar3_ctx_t *ctx, EVP_CIPHER_CTX *cipher) {
+    size_t packed = (size_t)(ctx->pack_size / 16 * 16);
+    uint8_t *plain = malloc(packed);
+    if (!plain) return ZIP_VERIFY_UNSUPPORTED;
+
+    int out_len = 0;
+    const uint8_t *src = ctx->image->data + ctx->data_offset;
+    for (size_t offset = 0; offset < packed; offset += RAR3_VERIFY_CHUNK) {
+        size_t chunk = packed - offset < RAR3_VERIFY_CHUNK ? packed - offset : RAR3_VERIFY_CHUNK;
+        if (EVP_DecryptUpdate(cipher, plain + offset, &out_len, src + offset, (int)chunk) != 1 ||
+            (offset == 0 && chunk < packed &&
+             rar3_unpack(plain, chunk, ctx->unpacked_size, true, NULL, NULL) == ZIP_VERIFY_FAIL)) {
+            free(plain);
+            return ZIP_VERIFY_FAIL;
+        }
+    }
+
+    uint32_t crc = 0;
+    zip_verify_result_t result = rar3_unpack(plain, packed, ctx->unpacked_size, false, crc_output, &crc);
+    free(plain);
+    if (result != ZIP_VERIFY_OK) {
+        return result;
+    }
+    return crc == ctx->file_crc ? ZIP_VERIFY_OK : ZIP_VERIFY_FAIL;
+}
+
+// 第二阶段：用第一阶段派生的密钥从映像解密完整数据。加密头比较连续几个头的CRC，
+// 文件比较解出内容的CRC32，压缩文件用原生的RAR 2.9解压器
+zip_verify_result_t rar3_verify_key(const rar3_ctx_t *ctx, const rar3_key_t *key) {
+    if (!ctx || !key || !ctx->image || ctx->data_offset > ctx->image->size ||
+        (!ctx->is_header && ctx->pack_size > ctx->image->size - ctx->data_offset)) {
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+
+    EVP_CIPHER_CTX *cipher = EVP_CIPHER_CTX_new();
+    if (!cipher) return ZIP_VERIFY_UNSUPPORTED;
+
+    zip_verify_result_t result;
+    if (ctx->is_header) {
+        result = verify_headers(ctx, cipher, key);
+    } else if (EVP_DecryptInit_ex(cipher, EVP_aes_128_cbc(), NULL, key->key, key->iv) != 1 ||
+               EVP_CIPHER_CTX_set_padding(cipher, 0) != 1) {
+        result = ZIP_VERIFY_UNSUPPORTED;
+    } else if (ctx->method == RAR3_METHOD_STORE) {
+        result = verify_stored(ctx, cipher);
+    } else {
+        result = verify_packed(ctx, cipher);
+    }
+    EVP_CIPHER_CTX_free(cipher);
+    return result;
+}
+
+// 派生密钥后走第二阶段的完整确认
+zip_verify_result_t rar3_verify_password(const rar3_ctx_t *ctx, const char *password, size_t len) {
+    if (!ctx || !password) {
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+
+    uint8_t unit[RAR3_MAX_UNIT];
+    rar3_key_t key;
+    size_t raw_len = build_unit(ctx, password, len, unit);
+    derive_scalar(unit, raw_len, key.key, key.iv);
+    return rar3_verify_key(ctx, &key);
+}
+
+// 测量每种内核的RAR3密钥派生吞吐量
+void rar3_benchmark(void) {
+    rar3_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.has_salt = true;
+    ctx.is_header = true;
+    ctx.cipher_len = 16;
+    for (int i = 0; i < RAR3_SALT_SIZE; i++) {
+        ctx.salt[i] = (uint8_t)(i * 29 + 3);
+    }
+
+    const int batch = 16;
+    char storage[16][16];
+    const char *passwords[16];
+    size_t lens[16];
+    bool results[16];
+    for (int i = 0; i < batch; i++) {
+        snprintf(storage[i], sizeof(storage[i]), "%08d", i * 7919);
+        passwords[i] = storage[i];
+        lens[i] = 8;
+    }
+
+    print_info("RAR3 校验吞吐量 (单线程, SHA-1 x2^18):");
+
+    zip_crypto_kernel_t kernels[] = {ZC_KERNEL_SCALAR, ZC_KERNEL_AVX2, ZC_KERNEL_AVX512};
+    zip_crypto_kernel_t best = zip_crypto_select_kernel();
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        if (kernels[k] > best) {
+            printf("  %-16s 不支持\n", zip_crypto_kernel_name(kernels[k]));
+            continue;
+        }
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        check_batch_with_kernel(&ctx, kernels[k], passwords, lens, batch, results, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("  %-16s %8.1f p/s\n", zip_crypto_kernel_name(kernels[k]), batch / elapsed);
+    }
+}
+
+// 释放RAR3上下文
+void rar3_free(rar3_ctx_t *ctx) {
+    free(ctx);
+}
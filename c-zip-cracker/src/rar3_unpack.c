@@ -0,0 +1,1727 @@
+#include "../include/zip_cracker.h"
+#include <zlib.h>
+
+// RAR 2.9压缩格式的哈夫曼表大小
+#define RAR3_NC        299   // 256个字面量 + 块结束 + 过滤器 + 重复 + 4个旧距离 + 8个短距离 + 28个长度槽
+#define RAR3_DC        60
+#define RAR3_LDC       17
+#define RAR3_RC        28
+#define RAR3_BC        20
+#define RAR3_HUFF_SIZE (RAR3_NC + RAR3_DC + RAR3_LDC + RAR3_RC)
+#define RAR3_CODE_BITS 15
+
+// 窗口和匹配的上限
+#define RAR3_MIN_WINDOW    (1u << 16)
+#define RAR3_MAX_DICT      (4u << 20)
+#define RAR3_MAX_MATCH     0x120
+#define RAR3_LOW_DIST_REP  16
+
+// 过滤器虚拟机：标准过滤器按代码的CRC识别，直接用C实现
+#define RAR3_VM_MEMSIZE       0x40000
+#define RAR3_VM_MEMMASK       (RAR3_VM_MEMSIZE - 1)
+#define RAR3_VM_GLOBAL_DATA   (0x2000 - 0x40)
+#define RAR3_MAX_FILTERS      8192
+#define RAR3_MAX_CHANNELS     1024
+#define RAR3_MAX_VM_CODE      0x10000
+
+// PPMd var.H的模型参数
+#define PPM_MAX_ORDER   64
+#define PPM_MAX_FREQ    124
+#define PPM_UNIT_SIZE   12
+#define PPM_N_INDEXES   38
+#define PPM_INT_BITS    7
+#define PPM_PERIOD_BITS 7
+#define PPM_BIN_SCALE   (1 << (PPM_INT_BITS + PPM_PERIOD_BITS))
+#define PPM_TOP         (1u << 24)
+#define PPM_BOT         (1u << 15)
+
+enum {
+    RAR3_FILTER_NONE,
+    RAR3_FILTER_E8,
+    RAR3_FILTER_E8E9,
+    RAR3_FILTER_ITANIUM,
+    RAR3_FILTER_DELTA,
+    RAR3_FILTER_RGB,
+    RAR3_FILTER_AUDIO
+};
+
+// 高位在前的位读取器，读到数据之外的部分按0返回并记录
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    uint64_t pos;
+    bool overrun;
+} bit_reader_t;
+
+typedef struct {
+    uint16_t count[RAR3_CODE_BITS + 1];
+    uint16_t symbol[RAR3_NC];
+} huff_table_t;
+
+// PPM状态：后继的32位引用拆成两半，一个状态只占6字节
+typedef struct {
+    uint8_t symbol;
+    uint8_t freq;
+    uint16_t successor_low;
+    uint16_t successor_high;
+} ppm_state_t;
+
+// PPM上下文占一个12字节的单元，只有一个符号时状态直接放在上下文里
+typedef struct {
+    uint16_t num_stats;
+    union {
+        ppm_state_t one;
+        struct {
+            uint16_t summ_freq;
+            uint16_t stats_low;
+            uint16_t stats_high;
+        } multi;
+    } u;
+    uint32_t suffix;
+} ppm_context_t;
+
+typedef struct {
+    uint16_t summ;
+    uint8_t shift;
+    uint8_t count;
+} ppm_see_t;
+
+// 模型和子分配器：引用是相对base的偏移，0表示空
+typedef struct {
+    uint8_t *base;
+    uint32_t size;
+    uint32_t align_offset;
+    uint8_t *lo_unit, *hi_unit, *text, *units_start;
+    uint32_t glue_count;
+    uint32_t free_list[PPM_N_INDEXES];
+    uint8_t indx2units[PPM_N_INDEXES];
+    uint8_t units2indx[128];
+    uint8_t ns2indx[256], ns2bs_indx[256], hb2flag[256];
+    ppm_context_t *min_context, *max_context;
+    ppm_state_t *found_state;
+    unsigned order_fall, init_esc, prev_success, max_order, hi_bits_flag;
+    int32_t run_length, init_rl;
+    ppm_see_t dummy_see, see[25][16];
+    uint16_t bin_summ[128][64];
+    uint32_t low, code, range;     // RAR的无进位区间解码器
+} ppm_model_t;
+
+// 过滤器程序只记录类型和上次的块长度
+typedef struct {
+    uint8_t type;
+    uint32_t old_length;
+} rar3_program_t;
+
+typedef struct {
+    uint64_t start;
+    uint32_t length;
+    uint32_t init_r[7];
+    uint8_t type;
+} rar3_filter_t;
+
+typedef struct {
+    huff_table_t ld, dd, ldd, rd;
+    uint8_t old_table[RAR3_HUFF_SIZE];
+    uint32_t old_dist[4];
+    uint32_t last_length;
+    uint32_t prev_low_dist;
+    int low_dist_rep;
+    bool ppm_block;
+    int esc_char;
+    ppm_model_t ppm;
+    uint8_t *window;
+    uint64_t mask;
+    uint64_t pos;                  // 已解出的字节数
+    uint64_t written;              // 已交给回调的字节数
+    uint64_t limit;                // 文件大小，超出部分不交给回调
+    rar3_program_t *programs;
+    size_t program_count, last_filter;
+    rar3_filter_t *filters;        // 等待执行的过滤器，按定义顺序
+    size_t filter_count;
+    uint8_t *vm_mem;
+    uint8_t *vm_code;
+    bool opaque;                   // 出现了非标准的虚拟机程序，输出无法还原
+    bool no_memory;
+    rar_output_fn output;
+    void *opaque_arg;
+} rar3_unpack_t;
+
+static const uint8_t length_base[28] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 14, 16, 20, 24, 28, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224
+};
+static const uint8_t length_bits[28] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5
+};
+static const uint8_t short_base[8] = { 0, 4, 8, 16, 32, 64, 128, 192 };
+static const uint8_t short_bits[8] = { 2, 2, 3, 4, 5, 6, 6, 6 };
+
+// 距离槽的附加位数：0位4个、1~15位各2个、16位14个、18位12个
+static const uint8_t dist_bit_counts[19] = { 4, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 14, 0, 12 };
+
+static const uint8_t ppm_exp_escape[16] = { 25, 14, 9, 7, 5, 5, 4, 4, 4, 3, 3, 3, 2, 2, 2, 2 };
+static const uint16_t ppm_init_bin_esc[8] = { 0x3CDD, 0x1F3F, 0x59BF, 0x48F3, 0x64A1, 0x5ABC, 0x6632, 0x6051 };
+
+// 标准过滤器：代码长度、CRC32和类型
+static const struct {
+    uint32_t length;
+    uint32_t crc;
+    uint8_t type;
+} standard_filters[] = {
+    { 53,  0xAD576887, RAR3_FILTER_E8 },
+    { 57,  0x3CD7E57E, RAR3_FILTER_E8E9 },
+    { 120, 0x3769893F, RAR3_FILTER_ITANIUM },
+    { 29,  0x0E06077D, RAR3_FILTER_DELTA },
+    { 149, 0x1C2C5DC8, RAR3_FILTER_RGB },
+    { 216, 0xBC85E701, RAR3_FILTER_AUDIO },
+};
+
+static uint32_t dist_base[RAR3_DC];
+static uint8_t dist_bits[RAR3_DC];
+static pthread_once_t dist_once = PTHREAD_ONCE_INIT;
+
+static void init_dist_tables(void) {
+    uint32_t dist = 0;
+    int slot = 0;
+    for (int bits = 0; bits < (int)sizeof(dist_bit_counts); bits++) {
+        for (int j = 0; j < dist_bit_counts[bits]; j++, slot++) {
+            dist_base[slot] = dist;
+            dist_bits[slot] = (uint8_t)bits;
+            dist += 1u << bits;
+        }
+    }
+}
+
+static uint32_t peek_bits(const bit_reader_t *br, int n) {
+    size_t byte = (size_t)(br->pos >> 3);
+    uint32_t v = 0;
+    for (size_t i = 0; i < 4; i++) {
+        v = (v << 8) | (byte + i < br->size ? br->data[byte + i] : 0);
+    }
+    return (v << (br->pos & 7)) >> (32 - n);
+}
+
+// 前进n位，越过数据末尾时记录下来
+static void skip_bits(bit_reader_t *br, int n) {
+    br->pos += (uint64_t)n;
+    if (br->pos > (uint64_t)br->size * 8) {
+        br->overrun = true;
+    }
+}
+
+// 读取n位（n不超过16）
+static uint32_t read_bits(bit_reader_t *br, int n) {
+    if (n == 0) return 0;
+    uint32_t v = peek_bits(br, n);
+    skip_bits(br, n);
+    return v;
+}
+
+// PPM块和它的参数按字节读取
+static uint8_t read_byte(bit_reader_t *br) {
+    size_t byte = (size_t)(br->pos >> 3);
+    skip_bits(br, 8);
+    return byte < br->size ? br->data[byte] : 0;
+}
+
+// 由码长建立解码表，码长超额分配的表不可能由压缩器产生
+static bool build_table(huff_table_t *t, const uint8_t *lengths, int n) {
+    uint16_t offs[RAR3_CODE_BITS + 2];
+    memset(t->count, 0, sizeof(t->count));
+    for (int i = 0; i < n; i++) {
+        t->count[lengths[i]]++;
+    }
+    t->count[0] = 0;
+
+    int left = 1;
+    for (int len = 1; len <= RAR3_CODE_BITS; len++) {
+        left = (left << 1) - t->count[len];
+        if (left < 0) return false;
+    }
+
+    offs[1] = 0;
+    for (int len = 1; len <= RAR3_CODE_BITS; len++) {
+        offs[len + 1] = (uint16_t)(offs[len] + t->count[len]);
+    }
+    for (int i = 0; i < n; i++) {
+        if (lengths[i]) t->symbol[offs[lengths[i]]++] = (uint16_t)i;
+    }
+    return true;
+}
+
+// 逐位比较范式码，落到未分配的码字返回-1
+static int decode_symbol(bit_reader_t *br, const huff_table_t *t) {
+    uint32_t bits = peek_bits(br, RAR3_CODE_BITS);
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len <= RAR3_CODE_BITS; len++) {
+        code |= (int)((bits >> (RAR3_CODE_BITS - len)) & 1);
+        int count = t->count[len];
+        if (code - first < count) {
+            skip_bits(br, len);
+            return t->symbol[index + code - first];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+static uint32_t state_successor(const ppm_state_t *s) {
+    return s->successor_low | ((uint32_t)s->successor_high << 16);
+}
+
+static void set_successor(ppm_state_t *s, uint32_t v) {
+    s->successor_low = (uint16_t)v;
+    s->successor_high = (uint16_t)(v >> 16);
+}
+
+static uint32_t ppm_ref(const ppm_model_t *p, const void *ptr) {
+    return (uint32_t)((const uint8_t *)ptr - p->base);
+}
+
+static ppm_context_t *ppm_ctx(const ppm_model_t *p, uint32_t ref) {
+    return (ppm_context_t *)(p->base + ref);
+}
+
+static ppm_state_t *ppm_stats(const ppm_model_t *p, const ppm_context_t *c) {
+    return (ppm_state_t *)(p->base + (c->u.multi.stats_low | ((uint32_t)c->u.multi.stats_high << 16)));
+}
+
+static void set_stats(ppm_context_t *c, uint32_t ref) {
+    c->u.multi.stats_low = (uint16_t)ref;
+    c->u.multi.stats_high = (uint16_t)(ref >> 16);
+}
+
+static uint32_t load32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static void store32(uint8_t *p, uint32_t v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+static uint16_t load16(const uint8_t *p) {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static void store16(uint8_t *p, uint16_t v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+static unsigned units_to_index(const ppm_model_t *p, unsigned nu) {
+    return p->units2indx[nu - 1];
+}
+
+// 空闲块按大小分成单链表，链接存在块的前4字节
+static void insert_node(ppm_model_t *p, uint8_t *node, unsigned index) {
+    store32(node, p->free_list[index]);
+    p->free_list[index] = ppm_ref(p, node);
+}
+
+static uint8_t *remove_node(ppm_model_t *p, unsigned index) {
+    uint8_t *node = p->base + p->free_list[index];
+    p->free_list[index] = load32(node);
+    return node;
+}
+
+// 把大块切到新的大小，剩余部分放回空闲表
+static void split_block(ppm_model_t *p, uint8_t *ptr, unsigned old_index, unsigned new_index) {
+    unsigned nu = p->indx2units[old_index] - p->indx2units[new_index];
+    ptr += p->indx2units[new_index] * PPM_UNIT_SIZE;
+    unsigned i = units_to_index(p, nu);
+    if (p->indx2units[i] != nu) {
+        unsigned k = p->indx2units[--i];
+        insert_node(p, ptr + k * PPM_UNIT_SIZE, nu - k - 1);
+    }
+    insert_node(p, ptr, i);
+}
+
+// 合并相邻的空闲块再重新分到各个空闲表。节点格式：标记(2) 单元数(2) 后继(4) 前驱(4)
+static void glue_free_blocks(ppm_model_t *p) {
+    uint32_t head = p->align_offset + p->size;
+    uint32_t n = head;
+    p->glue_count = 255;
+
+    // 把所有空闲块串成双向链表，标记0表示空闲
+    for (unsigned i = 0; i < PPM_N_INDEXES; i++) {
+        uint16_t nu = p->indx2units[i];
+        uint32_t next = p->free_list[i];
+        p->free_list[i] = 0;
+        while (next != 0) {
+            uint8_t *node = p->base + next;
+            store32(node + 4, n);
+            store32(p->base + n + 8, next);
+            n = next;
+            next = load32(node);
+            store16(node, 0);
+            store16(node + 2, nu);
+        }
+    }
+    store16(p->base + head, 1);
+    store32(p->base + head + 4, n);
+    store32(p->base + n + 8, head);
+    if (p->lo_unit != p->hi_unit) {
+        store16(p->lo_unit, 1);
+    }
+
+    // 和紧随其后的空闲块合并
+    while (n != head) {
+        uint8_t *node = p->base + n;
+        uint32_t nu = load16(node + 2);
+        for (;;) {
+            uint8_t *node2 = node + nu * PPM_UNIT_SIZE;
+            nu += load16(node2 + 2);
+            if (load16(node2) != 0 || nu >= 0x10000) break;
+            store32(p->base + load32(node2 + 8) + 4, load32(node2 + 4));
+            store32(p->base + load32(node2 + 4) + 8, load32(node2 + 8));
+            store16(node + 2, (uint16_t)nu);
+        }
+        n = load32(node + 4);
+    }
+
+    for (n = load32(p->base + head + 4); n != head;) {
+        uint8_t *node = p->base + n;
+        uint32_t next = load32(node + 4);
+        unsigned nu = load16(node + 2);
+        for (; nu > 128; nu -= 128, node += 128 * PPM_UNIT_SIZE) {
+            insert_node(p, node, PPM_N_INDEXES - 1);
+        }
+        unsigned i = units_to_index(p, nu);
+        if (p->indx2units[i] != nu) {
+            unsigned k = p->indx2units[--i];
+            insert_node(p, node + k * PPM_UNIT_SIZE, nu - k - 1);
+        }
+        insert_node(p, node, i);
+        n = next;
+    }
+}
+
+// 空闲表和单元区都不够时先合并空闲块，再向文本区借用
+static void *alloc_units_rare(ppm_model_t *p, unsigned index) {
+    if (p->glue_count == 0) {
+        glue_free_blocks(p);
+        if (p->free_list[index] != 0) return remove_node(p, index);
+    }
+    unsigned i = index;
+    do {
+        if (++i == PPM_N_INDEXES) {
+            uint32_t bytes = p->indx2units[index] * PPM_UNIT_SIZE;
+            p->glue_count--;
+            if ((uint32_t)(p->units_start - p->text) > bytes) {
+                p->units_start -= bytes;
+                return p->units_start;
+            }
+            return NULL;
+        }
+    } while (p->free_list[i] == 0);
+    uint8_t *block = remove_node(p, i);
+    split_block(p, block, i, index);
+    return block;
+}
+
+static void *alloc_units(ppm_model_t *p, unsigned index) {
+    if (p->free_list[index] != 0) return remove_node(p, index);
+    uint32_t bytes = p->indx2units[index] * PPM_UNIT_SIZE;
+    if (bytes <= (uint32_t)(p->hi_unit - p->lo_unit)) {
+        uint8_t *block = p->lo_unit;
+        p->lo_unit += bytes;
+        return block;
+    }
+    return alloc_units_rare(p, index);
+}
+
+static void *shrink_units(ppm_model_t *p, uint8_t *old, unsigned old_nu, unsigned new_nu) {
+    unsigned i0 = units_to_index(p, old_nu);
+    unsigned i1 = units_to_index(p, new_nu);
+    if (i0 == i1) return old;
+    if (p->free_list[i1] != 0) {
+        uint8_t *block = remove_node(p, i1);
+        memcpy(block, old, new_nu * PPM_UNIT_SIZE);
+        insert_node(p, old, i0);
+        return block;
+    }
+    split_block(p, old, i0, i1);
+    return old;
+}
+
+// 清空内存重建只有0阶上下文的初始模型
+static void ppm_restart(ppm_model_t *p) {
+    memset(p->free_list, 0, sizeof(p->free_list));
+    p->text = p->base + p->align_offset;
+    p->hi_unit = p->text + p->size;
+    p->lo_unit = p->units_start = p->hi_unit - p->size / 8 / PPM_UNIT_SIZE * 7 * PPM_UNIT_SIZE;
+    p->glue_count = 0;
+
+    p->order_fall = p->max_order;
+    p->run_length = p->init_rl = -(int32_t)(p->max_order < 12 ? p->max_order : 12) - 1;
+    p->prev_success = 0;
+
+    p->hi_unit -= PPM_UNIT_SIZE;
+    p->min_context = p->max_context = (ppm_context_t *)p->hi_unit;
+    p->min_context->suffix = 0;
+    p->min_context->num_stats = 256;
+    p->min_context->u.multi.summ_freq = 256 + 1;
+    p->found_state = (ppm_state_t *)p->lo_unit;
+    set_stats(p->min_context, ppm_ref(p, p->found_state));
+    p->lo_unit += 256 / 2 * PPM_UNIT_SIZE;
+    for (int i = 0; i < 256; i++) {
+        ppm_state_t *s = &p->found_state[i];
+        s->symbol = (uint8_t)i;
+        s->freq = 1;
+        set_successor(s, 0);
+    }
+
+    for (int i = 0; i < 128; i++) {
+        for (int k = 0; k < 8; k++) {
+            uint16_t val = (uint16_t)(PPM_BIN_SCALE - ppm_init_bin_esc[k] / (i + 2));
+            for (int m = 0; m < 64; m += 8) {
+                p->bin_summ[i][k + m] = val;
+            }
+        }
+    }
+    for (int i = 0; i < 25; i++) {
+        for (int k = 0; k < 16; k++) {
+            ppm_see_t *s = &p->see[i][k];
+            s->shift = PPM_PERIOD_BITS - 4;
+            s->summ = (uint16_t)((5 * i + 10) << s->shift);
+            s->count = 4;
+        }
+    }
+}
+
+// 按(MaxMB+1)MB分配模型内存，大小不变时沿用
+static bool ppm_alloc(ppm_model_t *p, uint32_t size) {
+    if (p->base && p->size == size) return true;
+    free(p->base);
+    p->align_offset = 4 - (size & 3);
+    p->base = malloc(p->align_offset + size + PPM_UNIT_SIZE);
+    p->size = p->base ? size : 0;
+    return p->base != NULL;
+}
+
+static void ppm_init(ppm_model_t *p, unsigned max_order) {
+    unsigned i, k, m;
+    for (i = 0, k = 0; i < PPM_N_INDEXES; i++) {
+        unsigned step = i >= 12 ? 4 : (i >> 2) + 1;
+        do {
+            p->units2indx[k++] = (uint8_t)i;
+        } while (--step);
+        p->indx2units[i] = (uint8_t)k;
+    }
+    p->ns2bs_indx[0] = 0 << 1;
+    p->ns2bs_indx[1] = 1 << 1;
+    memset(p->ns2bs_indx + 2, 2 << 1, 9);
+    memset(p->ns2bs_indx + 11, 3 << 1, 256 - 11);
+    for (i = 0; i < 3; i++) {
+        p->ns2indx[i] = (uint8_t)i;
+    }
+    for (m = i, k = 1; i < 256; i++) {
+        p->ns2indx[i] = (uint8_t)m;
+        if (--k == 0) k = (++m) - 2;
+    }
+    memset(p->hb2flag, 0, 0x40);
+    memset(p->hb2flag + 0x40, 8, 0x100 - 0x40);
+
+    p->max_order = max_order;
+    ppm_restart(p);
+    p->dummy_see.shift = PPM_PERIOD_BITS;
+    p->dummy_see.summ = 0;
+    p->dummy_see.count = 64;
+}
+
+// 沿后缀链为当前符号补建上下文，返回最长的新上下文
+static ppm_context_t *create_successors(ppm_model_t *p, bool skip) {
+    ppm_context_t *c = p->min_context;
+    uint32_t up_branch = state_successor(p->found_state);
+    ppm_state_t *ps[PPM_MAX_ORDER];
+    unsigned num_ps = 0;
+
+    if (!skip) ps[num_ps++] = p->found_state;
+    while (c->suffix) {
+        ppm_state_t *s;
+        c = ppm_ctx(p, c->suffix);
+        if (c->num_stats != 1) {
+            for (s = ppm_stats(p, c); s->symbol != p->found_state->symbol; s++);
+        } else {
+            s = &c->u.one;
+        }
+        uint32_t successor = state_successor(s);
+        if (successor != up_branch) {
+            c = ppm_ctx(p, successor);
+            if (num_ps == 0) return c;
+            break;
+        }
+        if (num_ps == PPM_MAX_ORDER) return NULL;
+        ps[num_ps++] = s;
+    }
+
+    ppm_state_t up_state;
+    up_state.symbol = p->base[up_branch];
+    set_successor(&up_state, up_branch + 1);
+    if (c->num_stats == 1) {
+        up_state.freq = c->u.one.freq;
+    } else {
+        ppm_state_t *s;
+        for (s = ppm_stats(p, c); s->symbol != up_state.symbol; s++);
+        uint32_t cf = s->freq - 1u;
+        uint32_t s0 = c->u.multi.summ_freq - c->num_stats - cf;
+        up_state.freq = (uint8_t)(1 + ((2 * cf <= s0) ? (5 * cf > s0) : ((2 * cf + 3 * s0 - 1) / (2 * s0))));
+    }
+
+    do {
+        ppm_context_t *c1;
+        if (p->hi_unit != p->lo_unit) {
+            c1 = (ppm_context_t *)(p->hi_unit -= PPM_UNIT_SIZE);
+        } else if (p->free_list[0] != 0) {
+            c1 = (ppm_context_t *)remove_node(p, 0);
+        } else {
+            c1 = alloc_units_rare(p, 0);
+            if (!c1) return NULL;
+        }
+        c1->num_stats = 1;
+        c1->u.one = up_state;
+        c1->suffix = ppm_ref(p, c);
+        set_successor(ps[--num_ps], ppm_ref(p, c1));
+        c = c1;
+    } while (num_ps != 0);
+    return c;
+}
+
+static void swap_states(ppm_state_t *a, ppm_state_t *b) {
+    ppm_state_t t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// 把新符号加进从最长上下文到找到它的上下文之间的每一层
+static void update_model(ppm_model_t *p) {
+    uint32_t successor, f_successor = state_successor(p->found_state);
+    ppm_context_t *c;
+    unsigned s0, ns;
+
+    if (p->found_state->freq < PPM_MAX_FREQ / 4 && p->min_context->suffix != 0) {
+        c = ppm_ctx(p, p->min_context->suffix);
+        if (c->num_stats == 1) {
+            ppm_state_t *s = &c->u.one;
+            if (s->freq < 32) s->freq++;
+        } else {
+            ppm_state_t *s = ppm_stats(p, c);
+            if (s->symbol != p->found_state->symbol) {
+                do {
+                    s++;
+                } while (s->symbol != p->found_state->symbol);
+                if (s[0].freq >= s[-1].freq) {
+                    swap_states(&s[0], &s[-1]);
+                    s--;
+                }
+            }
+            if (s->freq < PPM_MAX_FREQ - 9) {
+                s->freq += 2;
+                c->u.multi.summ_freq += 2;
+            }
+        }
+    }
+
+    if (p->order_fall == 0) {
+        p->min_context = p->max_context = create_successors(p, true);
+        if (!p->min_context) {
+            ppm_restart(p);
+            return;
+        }
+        set_successor(p->found_state, ppm_ref(p, p->min_context));
+        return;
+    }
+
+    *p->text++ = p->found_state->symbol;
+    successor = ppm_ref(p, p->text);
+    if (p->text >= p->units_start) {
+        ppm_restart(p);
+        return;
+    }
+
+    if (f_successor) {
+        if (f_successor <= successor) {
+            // 后继还指向文本区，说明对应的上下文没有建立
+            ppm_context_t *cs = create_successors(p, false);
+            if (!cs) {
+                ppm_restart(p);
+                return;
+            }
+            f_successor = ppm_ref(p, cs);
+        }
+        if (--p->order_fall == 0) {
+            successor = f_successor;
+            p->text -= (p->max_context != p->min_context);
+        }
+    } else {
+        set_successor(p->found_state, successor);
+        f_successor = ppm_ref(p, p->min_context);
+    }
+
+    ns = p->min_context->num_stats;
+    s0 = p->min_context->u.multi.summ_freq - ns - (p->found_state->freq - 1u);
+
+    for (c = p->max_context; c != p->min_context; c = ppm_ctx(p, c->suffix)) {
+        unsigned ns1 = c->num_stats;
+        uint32_t cf, sf;
+        if (ns1 != 1) {
+            if ((ns1 & 1) == 0) {
+                // 状态数为偶数时正好占满单元，扩展一个单元
+                unsigned old_nu = ns1 >> 1;
+                unsigned i = units_to_index(p, old_nu);
+                if (i != units_to_index(p, old_nu + 1)) {
+                    uint8_t *ptr = alloc_units(p, i + 1);
+                    if (!ptr) {
+                        ppm_restart(p);
+                        return;
+                    }
+                    uint8_t *old = (uint8_t *)ppm_stats(p, c);
+                    memcpy(ptr, old, old_nu * PPM_UNIT_SIZE);
+                    insert_node(p, old, i);
+                    set_stats(c, ppm_ref(p, ptr));
+                }
+            }
+            c->u.multi.summ_freq = (uint16_t)(c->u.multi.summ_freq + (2 * ns1 < ns) +
+                2 * ((4 * ns1 <= ns) & (c->u.multi.summ_freq <= 8 * ns1)));
+        } else {
+            ppm_state_t *s = alloc_units(p, 0);
+            if (!s) {
+                ppm_restart(p);
+                return;
+            }
+            *s = c->u.one;
+            set_stats(c, ppm_ref(p, s));
+            if (s->freq < PPM_MAX_FREQ / 4 - 1) {
+                s->freq <<= 1;
+            } else {
+                s->freq = PPM_MAX_FREQ - 4;
+            }
+            c->u.multi.summ_freq = (uint16_t)(s->freq + p->init_esc + (ns > 3));
+        }
+
+        cf = 2 * (uint32_t)p->found_state->freq * (c->u.multi.summ_freq + 6u);
+        sf = (uint32_t)s0 + c->u.multi.summ_freq;
+        if (cf < 6 * sf) {
+            cf = 1 + (cf > sf) + (cf >= 4 * sf);
+            c->u.multi.summ_freq += 3;
+        } else {
+            cf = 4 + (cf >= 9 * sf) + (cf >= 12 * sf) + (cf >= 15 * sf);
+            c->u.multi.summ_freq = (uint16_t)(c->u.multi.summ_freq + cf);
+        }
+        ppm_state_t *s = ppm_stats(p, c) + ns1;
+        set_successor(s, successor);
+        s->symbol = p->found_state->symbol;
+        s->freq = (uint8_t)cf;
+        c->num_stats = (uint16_t)(ns1 + 1);
+    }
+    p->max_context = p->min_context = ppm_ctx(p, f_successor);
+}
+
+// 频率超过上限时全部减半，去掉降为0的状态
+static void rescale(ppm_model_t *p) {
+    ppm_context_t *mc = p->min_context;
+    ppm_state_t *stats = ppm_stats(p, mc);
+    ppm_state_t *s = p->found_state;
+    unsigned i, adder, sum_freq, esc_freq;
+
+    {
+        ppm_state_t tmp = *s;
+        for (; s != stats; s--) s[0] = s[-1];
+        *s = tmp;
+    }
+    esc_freq = mc->u.multi.summ_freq - s->freq;
+    s->freq += 4;
+    adder = p->order_fall != 0;
+    s->freq = (uint8_t)((s->freq + adder) >> 1);
+    sum_freq = s->freq;
+
+    i = mc->num_stats - 1u;
+    do {
+        esc_freq -= (++s)->freq;
+        s->freq = (uint8_t)((s->freq + adder) >> 1);
+        sum_freq += s->freq;
+        if (s[0].freq > s[-1].freq) {
+            ppm_state_t *s1 = s;
+            ppm_state_t tmp = *s1;
+            do {
+                s1[0] = s1[-1];
+            } while (--s1 != stats && tmp.freq > s1[-1].freq);
+            *s1 = tmp;
+        }
+    } while (--i);
+
+    if (s->freq == 0) {
+        unsigned num_stats = mc->num_stats;
+        do {
+            i++;
+        } while ((--s)->freq == 0);
+        esc_freq += i;
+        mc->num_stats = (uint16_t)(mc->num_stats - i);
+        if (mc->num_stats == 1) {
+            ppm_state_t tmp = *stats;
+            do {
+                tmp.freq = (uint8_t)(tmp.freq - (tmp.freq >> 1));
+                esc_freq >>= 1;
+            } while (esc_freq > 1);
+            insert_node(p, (uint8_t *)stats, units_to_index(p, (num_stats + 1) >> 1));
+            mc->u.one = tmp;
+            p->found_state = &mc->u.one;
+            return;
+        }
+        unsigned n0 = (num_stats + 1) >> 1;
+        unsigned n1 = (mc->num_stats + 1u) >> 1;
+        if (n0 != n1) {
+            set_stats(mc, ppm_ref(p, shrink_units(p, (uint8_t *)stats, n0, n1)));
+        }
+    }
+    mc->u.multi.summ_freq = (uint16_t)(sum_freq + esc_freq - (esc_freq >> 1));
+    p->found_state = ppm_stats(p, mc);
+}
+
+// 逃逸频率来自SEE上下文；与后缀比较时按unrar的有符号语义
+static ppm_see_t *make_esc_freq(ppm_model_t *p, unsigned num_masked, uint32_t *esc_freq) {
+    ppm_context_t *mc = p->min_context;
+    unsigned non_masked = mc->num_stats - num_masked;
+    if (mc->num_stats != 256) {
+        int suffix_diff = (int)ppm_ctx(p, mc->suffix)->num_stats - (int)mc->num_stats;
+        ppm_see_t *see = p->see[p->ns2indx[non_masked - 1]] +
+            ((int)non_masked < suffix_diff) +
+            2 * (mc->u.multi.summ_freq < 11 * mc->num_stats) +
+            4 * (num_masked > non_masked) +
+            p->hi_bits_flag;
+        unsigned r = see->summ >> see->shift;
+        see->summ = (uint16_t)(see->summ - r);
+        *esc_freq = r + (r == 0);
+        return see;
+    }
+    *esc_freq = 1;
+    return &p->dummy_see;
+}
+
+static void next_context(ppm_model_t *p) {
+    ppm_context_t *c = ppm_ctx(p, state_successor(p->found_state));
+    if (p->order_fall == 0 && (uint8_t *)c > p->text) {
+        p->min_context = p->max_context = c;
+    } else {
+        update_model(p);
+    }
+}
+
+static void update1(ppm_model_t *p) {
+    ppm_state_t *s = p->found_state;
+    s->freq += 4;
+    p->min_context->u.multi.summ_freq += 4;
+    if (s[0].freq > s[-1].freq) {
+        swap_states(&s[0], &s[-1]);
+        p->found_state = --s;
+        if (s->freq > PPM_MAX_FREQ) rescale(p);
+    }
+    next_context(p);
+}
+
+static void update1_0(ppm_model_t *p) {
+    p->prev_success = 2 * p->found_state->freq > p->min_context->u.multi.summ_freq;
+    p->run_length += (int32_t)p->prev_success;
+    p->min_context->u.multi.summ_freq += 4;
+    if ((p->found_state->freq += 4) > PPM_MAX_FREQ) rescale(p);
+    next_context(p);
+}
+
+static void update_bin(ppm_model_t *p) {
+    p->found_state->freq = (uint8_t)(p->found_state->freq + (p->found_state->freq < 128));
+    p->prev_success = 1;
+    p->run_length++;
+    next_context(p);
+}
+
+static void update2(ppm_model_t *p) {
+    p->found_state->freq += 4;
+    p->min_context->u.multi.summ_freq += 4;
+    if (p->found_state->freq > PPM_MAX_FREQ) rescale(p);
+    p->run_length = p->init_rl;
+    update_model(p);
+}
+
+// 区间解码：先按总频率缩小区间，区间已经小于总频率说明数据损坏
+static bool rc_threshold(ppm_model_t *p, uint32_t total, uint32_t *count) {
+    p->range /= total;
+    if (p->range == 0) return false;
+    *count = (p->code - p->low) / p->range;
+    return *count < total;
+}
+
+static void rc_decode(ppm_model_t *p, bit_reader_t *br, uint32_t start, uint32_t size) {
+    p->low += start * p->range;
+    p->range *= size;
+    while ((p->low ^ (p->low + p->range)) < PPM_TOP ||
+           (p->range < PPM_BOT && ((p->range = (0u - p->low) & (PPM_BOT - 1)), 1))) {
+        p->code = (p->code << 8) | read_byte(br);
+        p->range <<= 8;
+        p->low <<= 8;
+    }
+}
+
+// 二元上下文的概率槽
+static uint16_t *bin_summ(ppm_model_t *p) {
+    ppm_state_t *s = &p->min_context->u.one;
+    p->hi_bits_flag = p->hb2flag[p->found_state->symbol];
+    return &p->bin_summ[s->freq - 1][p->prev_success +
+        p->ns2bs_indx[ppm_ctx(p, p->min_context->suffix)->num_stats - 1] +
+        p->hi_bits_flag + 2 * p->hb2flag[s->symbol] + ((p->run_length >> 26) & 0x20)];
+}
+
+// 解出一个字节；从0阶上下文逃逸或区间越界返回-1
+static int ppm_decode_symbol(ppm_model_t *p, bit_reader_t *br) {
+    int8_t char_mask[256];
+    ppm_context_t *mc = p->min_context;
+    uint32_t count, hi_cnt;
+
+    if (mc->num_stats != 1) {
+        ppm_state_t *s = ppm_stats(p, mc);
+        if (!rc_threshold(p, mc->u.multi.summ_freq, &count)) return -1;
+        hi_cnt = s->freq;
+        if (count < hi_cnt) {
+            rc_decode(p, br, 0, s->freq);
+            p->found_state = s;
+            uint8_t symbol = s->symbol;
+            update1_0(p);
+            return symbol;
+        }
+        p->prev_success = 0;
+        unsigned i = mc->num_stats - 1u;
+        do {
+            if ((hi_cnt += (++s)->freq) > count) {
+                rc_decode(p, br, hi_cnt - s->freq, s->freq);
+                p->found_state = s;
+                uint8_t symbol = s->symbol;
+                update1(p);
+                return symbol;
+            }
+        } while (--i);
+        p->hi_bits_flag = p->hb2flag[p->found_state->symbol];
+        rc_decode(p, br, hi_cnt, mc->u.multi.summ_freq - hi_cnt);
+        memset(char_mask, -1, sizeof(char_mask));
+        char_mask[s->symbol] = 0;
+        i = mc->num_stats - 1u;
+        do {
+            char_mask[(--s)->symbol] = 0;
+        } while (--i);
+    } else {
+        uint16_t *prob = bin_summ(p);
+        if (!rc_threshold(p, PPM_BIN_SCALE, &count)) return -1;
+        if (count < *prob) {
+            rc_decode(p, br, 0, *prob);
+            *prob = (uint16_t)(*prob + (1 << PPM_INT_BITS) - ((*prob + (1 << (PPM_PERIOD_BITS - 2))) >> PPM_PERIOD_BITS));
+            p->found_state = &mc->u.one;
+            uint8_t symbol = mc->u.one.symbol;
+            update_bin(p);
+            return symbol;
+        }
+        rc_decode(p, br, *prob, PPM_BIN_SCALE - *prob);
+        *prob = (uint16_t)(*prob - ((*prob + (1 << (PPM_PERIOD_BITS - 2))) >> PPM_PERIOD_BITS));
+        p->init_esc = ppm_exp_escape[*prob >> 10];
+        memset(char_mask, -1, sizeof(char_mask));
+        char_mask[mc->u.one.symbol] = 0;
+        p->prev_success = 0;
+    }
+
+    for (;;) {
+        ppm_state_t *ps[256], *s;
+        uint32_t freq_sum;
+        unsigned i, num, num_masked = p->min_context->num_stats;
+        do {
+            p->order_fall++;
+            if (!p->min_context->suffix) return -1;
+            p->min_context = ppm_ctx(p, p->min_context->suffix);
+        } while (p->min_context->num_stats == num_masked);
+        if (p->min_context->num_stats < num_masked) return -1;
+
+        mc = p->min_context;
+        hi_cnt = 0;
+        s = ppm_stats(p, mc);
+        i = 0;
+        num = mc->num_stats - num_masked;
+        for (unsigned seen = 0; i != num; seen++, s++) {
+            if (seen == mc->num_stats) return -1;
+            int k = char_mask[s->symbol];
+            hi_cnt += s->freq & (uint32_t)k;
+            ps[i] = s;
+            i -= (unsigned)k;
+        }
+
+        ppm_see_t *see = make_esc_freq(p, num_masked, &freq_sum);
+        freq_sum += hi_cnt;
+        if (!rc_threshold(p, freq_sum, &count)) return -1;
+
+        if (count < hi_cnt) {
+            ppm_state_t **pps = ps;
+            for (hi_cnt = 0; (hi_cnt += (*pps)->freq) <= count; pps++);
+            s = *pps;
+            rc_decode(p, br, hi_cnt - s->freq, s->freq);
+            if (see->shift < PPM_PERIOD_BITS && --see->count == 0) {
+                see->summ = (uint16_t)(see->summ << 1);
+                see->count = (uint8_t)(3 << see->shift++);
+            }
+            p->found_state = s;
+            uint8_t symbol = s->symbol;
+            update2(p);
+            return symbol;
+        }
+        rc_decode(p, br, hi_cnt, freq_sum - hi_cnt);
+        see->summ = (uint16_t)(see->summ + freq_sum);
+        do {
+            char_mask[ps[--i]->symbol] = 0;
+        } while (i != 0);
+    }
+}
+
+// PPM块开头：标志字节（0x20重置模型，0x40带转义字符），随后是内存大小、转义字符和区间解码器的4字节
+static bool ppm_start(rar3_unpack_t *u, bit_reader_t *br) {
+    ppm_model_t *p = &u->ppm;
+    uint8_t flags = read_byte(br);
+    bool reset = (flags & 0x20) != 0;
+    uint32_t max_mb = 0;
+    if (reset) {
+        max_mb = read_byte(br);
+    } else if (!p->base) {
+        return false;
+    }
+    if (flags & 0x40) {
+        u->esc_char = read_byte(br);
+    }
+
+    p->low = p->code = 0;
+    p->range = 0xFFFFFFFF;
+    for (int i = 0; i < 4; i++) {
+        p->code = (p->code << 8) | read_byte(br);
+    }
+
+    if (reset) {
+        unsigned order = (flags & 0x1F) + 1u;
+        if (order > 16) order = 16 + (order - 16) * 3;
+        if (order == 1) {
+            free(p->base);
+            p->base = NULL;
+            return false;
+        }
+        if (!ppm_alloc(p, (max_mb + 1) << 20)) {
+            u->no_memory = true;
+            return false;
+        }
+        ppm_init(p, order);
+    }
+    return true;
+}
+
+// 读取块开头的表：最高位选择PPM块，否则是LZ块的位长表（可与上一张表做增量）
+static bool read_tables(bit_reader_t *br, rar3_unpack_t *u) {
+    br->pos = (br->pos + 7) & ~(uint64_t)7;
+    uint32_t flags = peek_bits(br, 16);
+    if (flags & 0x8000) {
+        u->ppm_block = true;
+        return ppm_start(u, br);
+    }
+
+    u->ppm_block = false;
+    u->prev_low_dist = 0;
+    u->low_dist_rep = 0;
+    if (!(flags & 0x4000)) {
+        memset(u->old_table, 0, sizeof(u->old_table));
+    }
+    skip_bits(br, 2);
+
+    uint8_t bit_lengths[RAR3_BC];
+    for (int i = 0; i < RAR3_BC; i++) {
+        uint8_t len = (uint8_t)read_bits(br, 4);
+        if (len == 15) {
+            int zeros = (int)read_bits(br, 4);
+            if (zeros == 0) {
+                bit_lengths[i] = 15;
+            } else {
+                for (zeros += 2; zeros > 0 && i < RAR3_BC; zeros--) bit_lengths[i++] = 0;
+                i--;
+            }
+        } else {
+            bit_lengths[i] = len;
+        }
+    }
+
+    huff_table_t bd;
+    if (!build_table(&bd, bit_lengths, RAR3_BC)) return false;
+
+    uint8_t table[RAR3_HUFF_SIZE];
+    for (int i = 0; i < RAR3_HUFF_SIZE;) {
+        int number = decode_symbol(br, &bd);
+        if (number < 0) return false;
+        if (number < 16) {
+            table[i] = (uint8_t)((number + u->old_table[i]) & 0xF);
+            i++;
+            continue;
+        }
+
+        int n = number == 16 || number == 18 ? (int)read_bits(br, 3) + 3 : (int)read_bits(br, 7) + 11;
+        if (number < 18) {
+            if (i == 0) return false;
+            for (; n > 0 && i < RAR3_HUFF_SIZE; n--, i++) table[i] = table[i - 1];
+        } else {
+            for (; n > 0 && i < RAR3_HUFF_SIZE; n--) table[i++] = 0;
+        }
+    }
+    memcpy(u->old_table, table, sizeof(table));
+
+    return build_table(&u->ld, table, RAR3_NC) &&
+           build_table(&u->dd, table + RAR3_NC, RAR3_DC) &&
+           build_table(&u->ldd, table + RAR3_NC + RAR3_DC, RAR3_LDC) &&
+           build_table(&u->rd, table + RAR3_NC + RAR3_DC + RAR3_LDC, RAR3_RC);
+}
+
+// 把窗口中n字节交给回调，超出文件大小的部分丢弃
+static void emit_window(rar3_unpack_t *u, uint64_t n) {
+    while (n > 0) {
+        uint64_t index = u->written & u->mask;
+        uint64_t chunk = u->mask + 1 - index < n ? u->mask + 1 - index : n;
+        if (u->output && u->written < u->limit) {
+            uint64_t keep = u->limit - u->written < chunk ? u->limit - u->written : chunk;
+            u->output(u->opaque_arg, u->window + index, (size_t)keep);
+        }
+        u->written += chunk;
+        n -= chunk;
+    }
+}
+
+static void emit_data(rar3_unpack_t *u, const uint8_t *data, uint32_t size) {
+    if (u->output && u->written < u->limit) {
+        uint64_t keep = u->limit - u->written < size ? u->limit - u->written : size;
+        u->output(u->opaque_arg, data, (size_t)keep);
+    }
+    u->written += size;
+}
+
+static uint32_t itanium_get_bits(const uint8_t *data, uint32_t bit_pos, uint32_t count) {
+    uint32_t addr = bit_pos / 8;
+    uint32_t field = (uint32_t)data[addr] | ((uint32_t)data[addr + 1] << 8) |
+                     ((uint32_t)data[addr + 2] << 16) | ((uint32_t)data[addr + 3] << 24);
+    return (field >> (bit_pos & 7)) & (0xFFFFFFFFu >> (32 - count));
+}
+
+static void itanium_set_bits(uint8_t *data, uint32_t field, uint32_t bit_pos, uint32_t count) {
+    uint32_t addr = bit_pos / 8;
+    uint32_t mask = ~((0xFFFFFFFFu >> (32 - count)) << (bit_pos & 7));
+    field <<= bit_pos & 7;
+    for (int i = 0; i < 4; i++) {
+        data[addr + i] = (uint8_t)((data[addr + i] & mask) | field);
+        mask = (mask >> 8) | 0xFF000000u;
+        field >>= 8;
+    }
+}
+
+// 执行标准过滤器：E8/E8E9/ITANIUM原地还原，DELTA/RGB/AUDIO输出到数据之后
+static bool run_filter(const rar3_filter_t *f, uint8_t *mem, uint32_t file_offset, const uint8_t **out) {
+    uint32_t size = f->init_r[4];
+    *out = mem;
+
+    if (f->type == RAR3_FILTER_E8 || f->type == RAR3_FILTER_E8E9) {
+        const uint32_t file_size = 0x1000000;
+        uint8_t cmp = f->type == RAR3_FILTER_E8E9 ? 0xE9 : 0xE8;
+        if (size > RAR3_VM_MEMSIZE || size < 4) return false;
+        for (uint32_t pos = 0; pos < size - 4;) {
+            uint8_t b = mem[pos++];
+            if (b != 0xE8 && b != cmp) continue;
+
+            uint32_t offset = pos + file_offset;
+            uint32_t addr = (uint32_t)mem[pos] | ((uint32_t)mem[pos + 1] << 8) |
+                            ((uint32_t)mem[pos + 2] << 16) | ((uint32_t)mem[pos + 3] << 24);
+            bool write = false;
+            if (addr & 0x80000000) {
+                if (((addr + offset) & 0x80000000) == 0) {
+                    addr += file_size;
+                    write = true;
+                }
+            } else if ((addr - file_size) & 0x80000000) {
+                addr -= offset;
+                write = true;
+            }
+            if (write) {
+                mem[pos] = (uint8_t)addr;
+                mem[pos + 1] = (uint8_t)(addr >> 8);
+                mem[pos + 2] = (uint8_t)(addr >> 16);
+                mem[pos + 3] = (uint8_t)(addr >> 24);
+            }
+            pos += 4;
+        }
+        return true;
+    }
+
+    if (f->type == RAR3_FILTER_ITANIUM) {
+        static const uint8_t masks[16] = { 4, 4, 6, 6, 0, 0, 7, 7, 4, 4, 0, 0, 4, 4, 0, 0 };
+        if (size > RAR3_VM_MEMSIZE || size < 21) return false;
+        file_offset >>= 4;
+        for (uint32_t pos = 0; pos < size - 21; pos += 16, file_offset++) {
+            uint8_t *data = mem + pos;
+            int b = (data[0] & 0x1F) - 0x10;
+            if (b < 0 || masks[b] == 0) continue;
+            for (uint32_t i = 0; i <= 2; i++) {
+                if (!(masks[b] & (1 << i))) continue;
+                uint32_t start = i * 41 + 5;
+                if (itanium_get_bits(data, start + 37, 4) == 5) {
+                    uint32_t offset = itanium_get_bits(data, start + 13, 20);
+                    itanium_set_bits(data, (offset - file_offset) & 0xFFFFF, start + 13, 20);
+                }
+            }
+        }
+        return true;
+    }
+
+    uint8_t *dst = mem + size;
+    *out = dst;
+    if (f->type == RAR3_FILTER_DELTA) {
+        uint32_t channels = f->init_r[0], src = 0;
+        if (size > RAR3_VM_MEMSIZE / 2 || channels > RAR3_MAX_CHANNELS || channels == 0) return false;
+        for (uint32_t channel = 0; channel < channels; channel++) {
+            uint8_t prev = 0;
+            for (uint32_t pos = channel; pos < size; pos += channels) {
+                prev = (uint8_t)(prev - mem[src++]);
+                dst[pos] = prev;
+            }
+        }
+        return true;
+    }
+
+    if (f->type == RAR3_FILTER_RGB) {
+        uint32_t width = f->init_r[0] - 3, pos_r = f->init_r[1];
+        const uint8_t *src = mem;
+        if (size > RAR3_VM_MEMSIZE / 2 || size < 3 || width > size || pos_r > 2) return false;
+        for (uint32_t channel = 0; channel < 3; channel++) {
+            uint32_t prev = 0;
+            for (uint32_t i = channel; i < size; i += 3) {
+                uint32_t predicted = prev;
+                if (i >= width + 3) {
+                    const uint8_t *upper = dst + i - width;
+                    uint32_t up = upper[0], up_left = upper[-3];
+                    predicted = prev + up - up_left;
+                    int pa = abs((int)(predicted - prev));
+                    int pb = abs((int)(predicted - up));
+                    int pc = abs((int)(predicted - up_left));
+                    if (pa <= pb && pa <= pc) {
+                        predicted = prev;
+                    } else if (pb <= pc) {
+                        predicted = up;
+                    } else {
+                        predicted = up_left;
+                    }
+                }
+                dst[i] = (uint8_t)(predicted - *src++);
+                prev = dst[i];
+            }
+        }
+        for (uint32_t i = pos_r; i + 2 < size; i += 3) {
+            uint8_t g = dst[i + 1];
+            dst[i] = (uint8_t)(dst[i] + g);
+            dst[i + 2] = (uint8_t)(dst[i + 2] + g);
+        }
+        return true;
+    }
+
+    if (f->type == RAR3_FILTER_AUDIO) {
+        uint32_t channels = f->init_r[0];
+        const uint8_t *src = mem;
+        if (size > RAR3_VM_MEMSIZE / 2 || channels > 128 || channels == 0) return false;
+        for (uint32_t channel = 0; channel < channels; channel++) {
+            uint32_t prev_byte = 0, prev_delta = 0, dif[7];
+            int d1 = 0, d2 = 0, d3, k1 = 0, k2 = 0, k3 = 0;
+            memset(dif, 0, sizeof(dif));
+            for (uint32_t i = channel, byte_count = 0; i < size; i += channels, byte_count++) {
+                d3 = d2;
+                d2 = (int)prev_delta - d1;
+                d1 = (int)prev_delta;
+                uint32_t predicted = 8 * prev_byte + (uint32_t)(k1 * d1 + k2 * d2 + k3 * d3);
+                predicted = (predicted >> 3) & 0xFF;
+                uint32_t cur = *src++;
+                predicted -= cur;
+                dst[i] = (uint8_t)predicted;
+                prev_delta = (uint32_t)(int8_t)(predicted - prev_byte);
+                prev_byte = predicted;
+
+                int d = (int)((uint32_t)(int8_t)cur << 3);
+                dif[0] += (uint32_t)abs(d);
+                dif[1] += (uint32_t)abs(d - d1);
+                dif[2] += (uint32_t)abs(d + d1);
+                dif[3] += (uint32_t)abs(d - d2);
+                dif[4] += (uint32_t)abs(d + d2);
+                dif[5] += (uint32_t)abs(d - d3);
+                dif[6] += (uint32_t)abs(d + d3);
+                if ((byte_count & 0x1F) == 0) {
+                    uint32_t min_dif = dif[0], num_min = 0;
+                    dif[0] = 0;
+                    for (uint32_t j = 1; j < 7; j++) {
+                        if (dif[j] < min_dif) {
+                            min_dif = dif[j];
+                            num_min = j;
+                        }
+                        dif[j] = 0;
+                    }
+                    switch (num_min) {
+                        case 1: if (k1 >= -16) k1--; break;
+                        case 2: if (k1 < 16) k1++; break;
+                        case 3: if (k2 >= -16) k2--; break;
+                        case 4: if (k2 < 16) k2++; break;
+                        case 5: if (k3 >= -16) k3--; break;
+                        case 6: if (k3 < 16) k3++; break;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+static void drop_filters(rar3_unpack_t *u, size_t index, size_t n) {
+    memmove(u->filters + index, u->filters + index + n, (u->filter_count - index - n) * sizeof(rar3_filter_t));
+    u->filter_count -= n;
+}
+
+// 把已解出的数据交给回调：按定义顺序处理已经到达的过滤区，过滤区还没解完就停下
+static bool flush_window(rar3_unpack_t *u) {
+    for (size_t i = 0; i < u->filter_count;) {
+        rar3_filter_t *f = &u->filters[i];
+        if (f->start < u->written) {
+            // 起点已经写出，和前面的过滤区重叠
+            drop_filters(u, i, 1);
+            continue;
+        }
+        if (f->start >= u->pos) {
+            i++;
+            continue;
+        }
+
+        emit_window(u, f->start - u->written);
+        if (f->start + f->length > u->pos) {
+            return true;
+        }
+        if (f->length > RAR3_VM_MEMSIZE) {
+            return false;
+        }
+        for (uint32_t j = 0; j < f->length; j++) {
+            u->vm_mem[j] = u->window[(f->start + j) & u->mask];
+        }
+
+        const uint8_t *data = u->vm_mem;
+        uint32_t size = f->length;
+        size_t n = 0;
+        while (true) {
+            const rar3_filter_t *g = &u->filters[i + n];
+            if (g->type == RAR3_FILTER_NONE) {
+                u->opaque = true;
+            } else {
+                if (data != u->vm_mem) memmove(u->vm_mem, data, size);
+                if (!run_filter(g, u->vm_mem, (uint32_t)u->written, &data)) return false;
+                size = g->init_r[4] & RAR3_VM_MEMMASK;
+            }
+            n++;
+
+            // 同一块上可以连续套用多个过滤器
+            if (i + n == u->filter_count) break;
+            const rar3_filter_t *next = &u->filters[i + n];
+            if (next->start != f->start || next->length != size) break;
+        }
+
+        uint64_t end = f->start + f->length;
+        emit_data(u, data, size);
+        u->written = end;
+        drop_filters(u, i, n);
+    }
+    emit_window(u, u->pos - u->written);
+    return true;
+}
+
+// 虚拟机参数中的数字：高2位选择4位、8位、16位或32位
+static uint32_t read_vm_data(bit_reader_t *br) {
+    uint32_t data = peek_bits(br, 16);
+    switch (data & 0xC000) {
+        case 0:
+            skip_bits(br, 6);
+            return (data >> 10) & 0xF;
+        case 0x4000:
+            if ((data & 0x3C00) == 0) {
+                skip_bits(br, 14);
+                return 0xFFFFFF00 | ((data >> 2) & 0xFF);
+            }
+            skip_bits(br, 10);
+            return (data >> 6) & 0xFF;
+        case 0x8000:
+            skip_bits(br, 2);
+            return read_bits(br, 16);
+        default:
+            skip_bits(br, 2);
+            data = read_bits(br, 16) << 16;
+            return data | read_bits(br, 16);
+    }
+}
+
+// 新程序：首字节是其余字节的异或校验，标准过滤器按长度和CRC32识别
+static uint8_t identify_program(const uint8_t *code, uint32_t size) {
+    uint8_t sum = 0;
+    for (uint32_t i = 1; i < size; i++) {
+        sum ^= code[i];
+    }
+    if (sum != code[0]) return RAR3_FILTER_NONE;
+
+    uint32_t crc = (uint32_t)crc32(0, code, size);
+    for (size_t i = 0; i < sizeof(standard_filters) / sizeof(standard_filters[0]); i++) {
+        if (standard_filters[i].length == size && standard_filters[i].crc == crc) {
+            return standard_filters[i].type;
+        }
+    }
+    return RAR3_FILTER_NONE;
+}
+
+// 解析一段过滤器定义：程序编号、块起点和长度、初始寄存器、新程序的代码和全局数据
+static bool add_vm_code(rar3_unpack_t *u, uint32_t first, const uint8_t *code, uint32_t size) {
+    bit_reader_t br = { code, size, 0, false };
+    size_t index;
+    if (first & 0x80) {
+        index = read_vm_data(&br);
+        if (index == 0) {
+            // 编号0清空所有程序和等待中的过滤器
+            u->program_count = 0;
+            u->last_filter = 0;
+            u->filter_count = 0;
+        } else {
+            index--;
+        }
+    } else {
+        index = u->last_filter;
+    }
+    if (index > u->program_count || index >= RAR3_MAX_FILTERS || u->filter_count == RAR3_MAX_FILTERS) {
+        return false;
+    }
+    u->last_filter = index;
+    bool new_program = index == u->program_count;
+    if (new_program) {
+        u->programs[index].type = RAR3_FILTER_NONE;
+        u->programs[index].old_length = 0;
+        u->program_count++;
+    }
+
+    rar3_filter_t f;
+    memset(&f, 0, sizeof(f));
+    uint32_t block_start = read_vm_data(&br);
+    if (first & 0x40) block_start += 258;
+    f.start = u->pos + block_start;
+    if (first & 0x20) {
+        f.length = read_vm_data(&br);
+        u->programs[index].old_length = f.length;
+    } else {
+        f.length = u->programs[index].old_length;
+    }
+    f.init_r[4] = f.length;
+    if (first & 0x10) {
+        uint32_t init_mask = read_bits(&br, 7);
+        for (int i = 0; i < 7; i++) {
+            if (init_mask & (1u << i)) f.init_r[i] = read_vm_data(&br);
+        }
+    }
+
+    if (new_program) {
+        uint32_t code_size = read_vm_data(&br);
+        if (code_size >= RAR3_MAX_VM_CODE || code_size == 0 || (br.pos >> 3) + code_size > size) {
+            return false;
+        }
+        uint8_t *prog = u->vm_code;
+        for (uint32_t i = 0; i < code_size; i++) {
+            prog[i] = (uint8_t)read_bits(&br, 8);
+        }
+        u->programs[index].type = identify_program(prog, code_size);
+    }
+    f.type = u->programs[index].type;
+
+    if (first & 8) {
+        uint32_t data_size = read_vm_data(&br);
+        if (data_size > RAR3_VM_GLOBAL_DATA) return false;
+        for (uint32_t i = 0; i < data_size; i++) {
+            read_bits(&br, 8);
+        }
+    }
+    if (br.overrun) return false;
+
+    u->filters[u->filter_count++] = f;
+    return true;
+}
+
+// LZ块中的过滤器定义：首字节的低3位给出长度
+static bool read_vm_code(bit_reader_t *br, rar3_unpack_t *u) {
+    uint32_t first = read_bits(br, 8);
+    uint32_t length = (first & 7) + 1;
+    if (length == 7) {
+        length = read_bits(br, 8) + 7;
+    } else if (length == 8) {
+        length = read_bits(br, 16);
+    }
+    if (length == 0) return false;
+
+    uint8_t *code = u->vm_code + RAR3_MAX_VM_CODE;
+    for (uint32_t i = 0; i < length; i++) {
+        code[i] = (uint8_t)read_bits(br, 8);
+    }
+    return add_vm_code(u, first, code, length);
+}
+
+// PPM块中的过滤器定义，每个字节都由模型解出
+static bool read_vm_code_ppm(bit_reader_t *br, rar3_unpack_t *u) {
+    int first = ppm_decode_symbol(&u->ppm, br);
+    if (first < 0) return false;
+    uint32_t length = ((uint32_t)first & 7) + 1;
+    if (length == 7) {
+        int b = ppm_decode_symbol(&u->ppm, br);
+        if (b < 0) return false;
+        length = (uint32_t)b + 7;
+    } else if (length == 8) {
+        int b1 = ppm_decode_symbol(&u->ppm, br);
+        if (b1 < 0) return false;
+        int b2 = ppm_decode_symbol(&u->ppm, br);
+        if (b2 < 0) return false;
+        length = (uint32_t)b1 * 256 + (uint32_t)b2;
+    }
+    if (length == 0) return false;
+
+    uint8_t *code = u->vm_code + RAR3_MAX_VM_CODE;
+    for (uint32_t i = 0; i < length; i++) {
+        int c = ppm_decode_symbol(&u->ppm, br);
+        if (c < 0) return false;
+        code[i] = (uint8_t)c;
+    }
+    return add_vm_code(u, (uint32_t)first, code, length);
+}
+
+// 非固实的流里距离不能超出已解出的数据
+static bool copy_string(rar3_unpack_t *u, uint32_t length, uint32_t distance) {
+    if (distance == 0 || distance > u->pos || distance > u->mask + 1) {
+        return false;
+    }
+    for (uint32_t i = 0; i < length; i++) {
+        u->window[(u->pos + i) & u->mask] = u->window[(u->pos + i - distance) & u->mask];
+    }
+    u->pos += length;
+    return true;
+}
+
+static void insert_old_dist(rar3_unpack_t *u, uint32_t distance) {
+    memmove(u->old_dist + 1, u->old_dist, 3 * sizeof(u->old_dist[0]));
+    u->old_dist[0] = distance;
+}
+
+// 块结束符号：1表示换表，01表示文件结束，00表示文件结束且下个文件换表
+static bool read_end_of_block(bit_reader_t *br, rar3_unpack_t *u, bool *end_of_file) {
+    uint32_t bits = peek_bits(br, 2);
+    if (bits & 2) {
+        skip_bits(br, 1);
+        return read_tables(br, u);
+    }
+    skip_bits(br, 2);
+    *end_of_file = true;
+    return true;
+}
+
+// PPM块中的一个字节：转义字符之后的字节选择换表、结束、过滤器或匹配
+static bool decode_ppm(bit_reader_t *br, rar3_unpack_t *u, bool *end_of_file) {
+    int ch = ppm_decode_symbol(&u->ppm, br);
+    if (ch < 0) return false;
+    if (ch == u->esc_char) {
+        int next = ppm_decode_symbol(&u->ppm, br);
+        if (next < 0) return false;
+        switch (next) {
+            case 0:
+                return read_tables(br, u);
+            case 2:
+                *end_of_file = true;
+                return true;
+            case 3:
+                return read_vm_code_ppm(br, u);
+            case 4: {
+                uint32_t distance = 0;
+                for (int i = 0; i < 3; i++) {
+                    int b = ppm_decode_symbol(&u->ppm, br);
+                    if (b < 0) return false;
+                    distance = (distance << 8) + (uint32_t)b;
+                }
+                int length = ppm_decode_symbol(&u->ppm, br);
+                if (length < 0) return false;
+                return copy_string(u, (uint32_t)length + 32, distance + 2);
+            }
+            case 5: {
+                int length = ppm_decode_symbol(&u->ppm, br);
+                if (length < 0) return false;
+                return copy_string(u, (uint32_t)length + 4, 1);
+            }
+            default:
+                // 1表示转义字符本身
+                break;
+        }
+    }
+    u->window[u->pos & u->mask] = (uint8_t)ch;
+    u->pos++;
+    return true;
+}
+
+// LZ块中的一个符号
+static bool decode_lz(bit_reader_t *br, rar3_unpack_t *u, bool *end_of_file) {
+    int sym = decode_symbol(br, &u->ld);
+    if (sym < 0) {
+        return false;
+    }
+    if (sym < 256) {
+        u->window[u->pos & u->mask] = (uint8_t)sym;
+        u->pos++;
+        return true;
+    }
+
+    if (sym >= 271) {
+        int slot = sym - 271;
+        uint32_t length = length_base[slot] + 3u + read_bits(br, length_bits[slot]);
+        int dist_slot = decode_symbol(br, &u->dd);
+        if (dist_slot < 0) return false;
+
+        uint32_t distance = dist_base[dist_slot] + 1;
+        int bits = dist_bits[dist_slot];
+        if (dist_slot > 9) {
+            // 低4位单独用一张表编码，16表示重复上一次的低位
+            if (bits > 4) distance += read_bits(br, bits - 4) << 4;
+            if (u->low_dist_rep > 0) {
+                u->low_dist_rep--;
+                distance += u->prev_low_dist;
+            } else {
+                int low = decode_symbol(br, &u->ldd);
+                if (low < 0) return false;
+                if (low == 16) {
+                    u->low_dist_rep = RAR3_LOW_DIST_REP - 1;
+                    distance += u->prev_low_dist;
+                } else {
+                    distance += (uint32_t)low;
+                    u->prev_low_dist = (uint32_t)low;
+                }
+            }
+        } else {
+            distance += read_bits(br, bits);
+        }
+
+        if (distance >= 0x2000) {
+            length++;
+            if (distance >= 0x40000) length++;
+        }
+        insert_old_dist(u, distance);
+        u->last_length = length;
+        return copy_string(u, length, distance);
+    }
+    if (sym == 256) {
+        return read_end_of_block(br, u, end_of_file);
+    }
+    if (sym == 257) {
+        return read_vm_code(br, u);
+    }
+    if (sym == 258) {
+        return u->last_length == 0 || copy_string(u, u->last_length, u->old_dist[0]);
+    }
+    if (sym < 263) {
+        // 259~262：使用第N个旧距离，并把它移到最前
+        int num = sym - 259;
+        uint32_t distance = u->old_dist[num];
+        for (int i = num; i > 0; i--) u->old_dist[i] = u->old_dist[i - 1];
+        u->old_dist[0] = distance;
+
+        int length_slot = decode_symbol(br, &u->rd);
+        if (length_slot < 0) return false;
+        uint32_t length = length_base[length_slot] + 2u + read_bits(br, length_bits[length_slot]);
+        u->last_length = length;
+        return copy_string(u, length, distance);
+    }
+
+    // 263~270：长度为2的短距离匹配
+    int slot = sym - 263;
+    uint32_t distance = short_base[slot] + 1u + read_bits(br, short_bits[slot]);
+    insert_old_dist(u, distance);
+    u->last_length = 2;
+    return copy_string(u, 2, distance);
+}
+
+// 解到文件大小或文件结束标记为止，返回false表示数据损坏
+static bool decode_stream(bit_reader_t *br, rar3_unpack_t *u) {
+    if (!read_tables(br, u)) {
+        return false;
+    }
+
+    uint64_t room = u->mask + 1 - RAR3_MAX_MATCH;
+    bool end_of_file = false;
+    while (u->pos < u->limit && !end_of_file) {
+        if (br->overrun) {
+            return false;
+        }
+        if (u->pos - u->written > room) {
+            if (!flush_window(u) || u->pos - u->written > room) return false;
+        }
+        bool ok = u->ppm_block ? decode_ppm(br, u, &end_of_file) : decode_lz(br, u, &end_of_file);
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 解压一个非固实文件的RAR 2.9数据，解出的内容交给output。
+// partial为真表示data只是开头的一部分：数据读完之前没有出错即为OK；
+// 出现非标准的虚拟机程序时输出无法还原，返回UNSUPPORTED
+zip_verify_result_t rar3_unpack(const uint8_t *data, size_t size, uint64_t unpacked_size, bool partial,
+                                rar_output_fn output, void *opaque) {
+    pthread_once(&dist_once, init_dist_tables);
+
+    uint64_t need = unpacked_size < RAR3_MAX_DICT ? unpacked_size : RAR3_MAX_DICT;
+    if (unpacked_size > need && need < 2 * RAR3_VM_MEMSIZE) need = 2 * RAR3_VM_MEMSIZE;
+    uint64_t window = RAR3_MIN_WINDOW;
+    while (window < need + 2 * RAR3_MAX_MATCH) {
+        window <<= 1;
+    }
+
+    rar3_unpack_t *u = calloc(1, sizeof(rar3_unpack_t));
+    if (!u) return ZIP_VERIFY_UNSUPPORTED;
+    u->window = malloc((size_t)window);
+    u->programs = malloc(RAR3_MAX_FILTERS * sizeof(rar3_program_t));
+    u->filters = malloc(RAR3_MAX_FILTERS * sizeof(rar3_filter_t));
+    u->vm_mem = calloc(1, RAR3_VM_MEMSIZE + 4);
+    u->vm_code = malloc(2 * RAR3_MAX_VM_CODE);
+    zip_verify_result_t result = ZIP_VERIFY_UNSUPPORTED;
+    if (u->window && u->programs && u->filters && u->vm_mem && u->vm_code) {
+        u->mask = window - 1;
+        u->limit = unpacked_size;
+        u->esc_char = 2;
+        u->output = output;
+        u->opaque_arg = opaque;
+
+        bit_reader_t br = { data, size, 0, false };
+        bool ok = decode_stream(&br, u);
+        if (u->no_memory) {
+            result = ZIP_VERIFY_UNSUPPORTED;
+        } else if (br.overrun) {
+            // 读到了给定数据之外：只有开头一部分时不下结论
+            result = partial ? ZIP_VERIFY_OK : ZIP_VERIFY_FAIL;
+        } else if (!ok || u->pos < u->limit) {
+            result = ZIP_VERIFY_FAIL;
+        } else if (!flush_window(u) || u->written < u->limit) {
+            result = ZIP_VERIFY_FAIL;
+        } else {
+            result = u->opaque ? ZIP_VERIFY_UNSUPPORTED : ZIP_VERIFY_OK;
+        }
+    }
+
+    free(u->ppm.base);
+    free(u->vm_code);
+    free(u->vm_mem);
+    free(u->filters);
+    free(u->programs);
+    free(u->window);
+    free(u);
+    return result;
+}
@@ -0,0 +1,947 @@
+#include "../include/zip_cracker.h"
+#include <zlib.h>
+#include <openssl/evp.h>
+
+// RAR5签名和头类型
+#define RAR5_SIGNATURE_SIZE 8
+#define RAR5_SFX_SEARCH     (1 << 20)
+#define RAR5_HEAD_MAIN      1
+#define RAR5_HEAD_FILE      2
+#define RAR5_HEAD_SERVICE   3
+#define RAR5_HEAD_CRYPT     4
+#define RAR5_HEAD_END       5
+
+// 通用头标志
+#define RAR5_HFL_EXTRA       0x0001
+#define RAR5_HFL_DATA        0x0002
+#define RAR5_HFL_SPLIT_AFTER 0x0010
+
+// 文件头标志和扩展记录
+#define RAR5_FHFL_UTIME      0x0002
+#define RAR5_FHFL_CRC32      0x0004
+#define RAR5_FHFL_UNPUNKNOWN 0x0008
+#define RAR5_FHEXTRA_CRYPT   0x01
+#define RAR5_FHEXTRA_HASH    0x02
+#define RAR5_HASH_BLAKE2     0
+#define RAR5_CRYPT_PSWCHECK  0x0001
+#define RAR5_CRYPT_HASHMAC   0x0002
+#define RAR5_COMP_SOLID      0x40
+
+// 密钥派生参数
+#define RAR5_SALT_SIZE       16
+#define RAR5_CHECK_SIZE      8
+#define RAR5_CHECK_SUM_SIZE  4
+#define RAR5_MAX_KDF_LOG2    24
+#define RAR5_EXTRA_ROUNDS    16   // 密钥之后再迭代16次得到HashKey，再16次得到校验值
+#define RAR5_MAX_HEADER_SIZE (2u << 20)
+
+#define SHA256_BLOCK_SIZE  64
+#define SHA256_DIGEST_SIZE 32
+
+// 第二阶段按块解密存储的文件
+#define RAR5_VERIFY_CHUNK  65536
+
+// BLAKE2sp：8路BLAKE2s叶子按64字节块轮流分配，再由根节点合并
+#define BLAKE2S_BLOCK_SIZE 64
+#define BLAKE2SP_LEAVES    8
+
+typedef struct {
+    uint32_t h[8];
+    uint64_t t;
+    uint8_t buf[BLAKE2S_BLOCK_SIZE];
+    size_t buf_len;
+    bool last_node;
+} blake2s_state_t;
+
+typedef struct {
+    blake2s_state_t leaves[BLAKE2SP_LEAVES];
+    blake2s_state_t root;
+    uint64_t total;
+} blake2sp_state_t;
+
+// 第二阶段解出数据的校验和
+typedef struct {
+    bool use_blake2;
+    uint32_t crc;
+    blake2sp_state_t blake2;
+} rar5_digest_t;
+
+static const uint8_t rar5_signature[RAR5_SIGNATURE_SIZE] = { 'R', 'a', 'r', '!', 0x1A, 0x07, 0x01, 0x00 };
+
+static uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// RAR5变长整数：每字节低7位，最高位表示后续还有字节
+static bool read_vint(const uint8_t *data, size_t size, size_t *pos, uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && *pos < size; shift += 7) {
+        uint8_t b = data[(*pos)++];
+        *value |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+// 单路SHA-256（用于超长密码的HMAC密钥和校验值自身的校验和）
+static void sha256_digest(const uint8_t *data, size_t len, uint8_t out[SHA256_DIGEST_SIZE]) {
+    sha_lanes_t l;
+    uint8_t digest[1][32];
+    sha_lanes_init(&l, SHA_ALGO_SHA256, ZC_KERNEL_SCALAR, 1);
+    sha_lanes_update(&l, &data, len);
+    sha_lanes_final(&l, digest);
+    memcpy(out, digest[0], SHA256_DIGEST_SIZE);
+}
+
+// 解析加密参数：版本、标志、迭代次数、盐、[IV]、[校验值]
+static bool parse_crypt_record(const uint8_t *data, size_t size, size_t pos, bool has_iv, rar5_ctx_t *ctx) {
+    uint64_t version, flags;
+    if (!read_vint(data, size, &pos, &version) || version != 0 ||
+        !read_vint(data, size, &pos, &flags) || pos + 1 + RAR5_SALT_SIZE > size) {
+        return false;
+    }
+
+    ctx->kdf_log2 = data[pos++];
+    if (ctx->kdf_log2 > RAR5_MAX_KDF_LOG2) return false;
+    memcpy(ctx->salt, data + pos, RAR5_SALT_SIZE);
+    pos += RAR5_SALT_SIZE;
+
+    if (has_iv) {
+        if (pos + 16 > size) return false;
+        memcpy(ctx->iv, data + pos, 16);
+        pos += 16;
+    }
+
+    ctx->has_check = false;
+    ctx->use_mac = (flags & RAR5_CRYPT_HASHMAC) != 0;
+    if (flags & RAR5_CRYPT_PSWCHECK) {
+        if (pos + RAR5_CHECK_SIZE + RAR5_CHECK_SUM_SIZE > size) return false;
+
+        // 校验值后面是它自己SHA-256的前4字节，不一致说明头部损坏
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        sha256_digest(data + pos, RAR5_CHECK_SIZE, digest);
+        if (memcmp(digest, data + pos + RAR5_CHECK_SIZE, RAR5_CHECK_SUM_SIZE) == 0) {
+            memcpy(ctx->check, data + pos, RAR5_CHECK_SIZE);
+            ctx->has_check = true;
+        }
+    }
+    return true;
+}
+
+// 在文件头的扩展区中查找加密记录和BLAKE2摘要，并读取压缩信息；entry非空时同时记录文件名和大小
+static bool parse_file_header(const uint8_t *data, size_t size, size_t pos, uint64_t extra_size,
+                              rar5_ctx_t *ctx, file_entry_t *entry) {
+    if (extra_size > size) return false;
+
+    uint64_t file_flags, unpacked, attr, comp_info;
+    if (!read_vint(data, size, &pos, &file_flags) ||
+        !read_vint(data, size, &pos, &unpacked) ||
+        !read_vint(data, size, &pos, &attr)) {
+        return false;
+    }
+    if (file_flags & RAR5_FHFL_UTIME) pos += 4;
+    if (file_flags & RAR5_FHFL_CRC32) {
+        if (pos + 4 > size) return false;
+        ctx->has_crc = true;
+        ctx->data_crc = read_le32(data + pos);
+        pos += 4;
+    }
+    ctx->unpacked_size = (file_flags & RAR5_FHFL_UNPUNKNOWN) ? UINT64_MAX : unpacked;
+    if (pos > size || !read_vint(data, size, &pos, &comp_info)) return false;
+    ctx->comp_info = comp_info;
+    ctx->method = (uint8_t)((comp_info >> 7) & 7);
+
+    uint64_t host_os, name_len;
+    if (entry) {
+        entry->uncompressed_size = unpacked;
+        entry->crc32 = ctx->data_crc;
+        entry->compression_method = ctx->method;
+        if (read_vint(data, size, &pos, &host_os) && read_vint(data, size, &pos, &name_len) &&
+            name_len <= size - pos) {
+            entry->filename = strndup((const char *)data + pos, (size_t)name_len);
+        }
+    }
+
+    size_t extra = size - (size_t)extra_size;
+    bool encrypted = false;
+    while (extra < size) {
+        uint64_t rec_size, rec_type, hash_type;
+        if (!read_vint(data, size, &extra, &rec_size) || rec_size > size - extra) return false;
+
+        size_t rec_end = extra + (size_t)rec_size;
+        if (!read_vint(data, rec_end, &extra, &rec_type)) return false;
+        if (rec_type == RAR5_FHEXTRA_CRYPT) {
+            if (!parse_crypt_record(data, rec_end, extra, true, ctx)) return false;
+            encrypted = true;
+        } else if (rec_type == RAR5_FHEXTRA_HASH && read_vint(data, rec_end, &extra, &hash_type) &&
+                   hash_type == RAR5_HASH_BLAKE2 && rec_end - extra >= sizeof(ctx->blake2)) {
+            ctx->has_blake2 = true;
+            memcpy(ctx->blake2, data + extra, sizeof(ctx->blake2));
+        }
+        extra = rec_end;
+    }
+    return encrypted;
+}
+
+// 条目的可确认程度：有校验值 > 小的存储文件（批量阶段就比较CRC）> 压缩文件（批量检查块头和表）
+// > 大的存储文件或分卷的压缩文件（每个候选都要在第二阶段解密全部数据）
+static int entry_rank(const rar5_ctx_t *st) {
+    if (st->has_check) return 4;
+    if (st->comp_info & RAR5_COMP_SOLID) return 0;
+    if (st->method == 0) {
+        if (st->split || (!st->has_crc && !st->has_blake2)) return 0;
+        return st->has_crc && st->unpacked_size <= sizeof(st->cipher) ? 3 : 1;
+    }
+    return st->split ? 1 : 2;
+}
+
+// 在压缩包模型的内存映像上解析RAR5头：加密的头优先，否则取最容易确认的加密文件
+rar5_ctx_t* rar5_load(const archive_info_t *info) {
+    if (!info || !info->image || info->type != ARCHIVE_RAR) return NULL;
+
+    // 自解压文件的签名在前缀之后
+    const uint8_t *data = info->image->data;
+    size_t size = info->image->size;
+    size_t search = size < RAR5_SFX_SEARCH + RAR5_SIGNATURE_SIZE ? size : RAR5_SFX_SEARCH + RAR5_SIGNATURE_SIZE;
+    const uint8_t *sig = memmem(data, search, rar5_signature, RAR5_SIGNATURE_SIZE);
+    if (!sig) return NULL;
+
+    rar5_ctx_t best;
+    bool found = false;
+    size_t pos = (size_t)(sig - data) + RAR5_SIGNATURE_SIZE;
+
+    while ((!found || entry_rank(&best) < 4) && pos + 4 < size) {
+        size_t vpos = pos + 4;
+        uint64_t head_size;
+        if (!read_vint(data, size, &vpos, &head_size) || head_size == 0 ||
+            head_size > RAR5_MAX_HEADER_SIZE || head_size > size - vpos ||
+            (uint32_t)crc32(0, data + pos + 4, (uInt)(vpos - pos - 4 + head_size)) != read_le32(data + pos)) {
+            break;
+        }
+
+        const uint8_t *header = data + vpos;
+        size_t hp = 0;
+        uint64_t type, flags, extra_size = 0, data_size = 0;
+        bool ok = read_vint(header, head_size, &hp, &type) && read_vint(header, head_size, &hp, &flags);
+        if (ok && (flags & RAR5_HFL_EXTRA)) ok = read_vint(header, head_size, &hp, &extra_size);
+        if (ok && (flags & RAR5_HFL_DATA)) ok = read_vint(header, head_size, &hp, &data_size);
+        size_t data_pos = vpos + (size_t)head_size;
+
+        if (!ok || type == RAR5_HEAD_END) {
+            break;
+        }
+
+        if (type == RAR5_HEAD_CRYPT) {
+            // 之后的每个头都是 16字节IV + AES-256-CBC密文
+            rar5_ctx_t st;
+            memset(&st, 0, sizeof(st));
+            if (parse_crypt_record(header, head_size, hp, false, &st) && data_pos + 16 <= size) {
+                memcpy(st.iv, data + data_pos, 16);
+                size_t avail = size - data_pos - 16;
+                st.cipher_len = (avail < sizeof(st.cipher) ? avail : sizeof(st.cipher)) / 16 * 16;
+                memcpy(st.cipher, data + data_pos + 16, st.cipher_len);
+                st.data_offset = data_pos + 16;
+                st.data_size = size - st.data_offset;
+                st.is_header = true;
+                if (st.cipher_len >= 16) {
+                    best = st;
+                    found = true;
+                }
+            }
+            break;
+        }
+
+        if (data_size > size - data_pos) {
+            break;
+        }
+
+        if (type == RAR5_HEAD_FILE || type == RAR5_HEAD_SERVICE) {
+            rar5_ctx_t st;
+            memset(&st, 0, sizeof(st));
+            size_t want = data_size < sizeof(st.cipher) ? (size_t)data_size : sizeof(st.cipher);
+            if (parse_file_header(header, head_size, hp, extra_size, &st, NULL) && data_size >= 16) {
+                memcpy(st.cipher, data + data_pos, want);
+                st.cipher_len = want / 16 * 16;
+                st.data_offset = data_pos;
+                st.data_size = data_size;
+                st.split = (flags & RAR5_HFL_SPLIT_AFTER) != 0;
+                if (!found || entry_rank(&st) > entry_rank(&best)) {
+                    best = st;
+                    found = true;
+                }
+            }
+        }
+
+        pos = data_pos + (size_t)data_size;
+    }
+
+    if (!found) return NULL;
+
+    rar5_ctx_t *ctx = calloc(1, sizeof(rar5_ctx_t));
+    if (!ctx) return NULL;
+    *ctx = best;
+    ctx->image = info->image;
+    ctx->kernel = zip_crypto_select_kernel();
+    return ctx;
+}
+
+// 只遍历内存映像中的头部块建立模型，数据区按记录的大小直接跳过
+bool rar5_analyze(archive_info_t *info) {
+    const uint8_t *data = info->image->data;
+    size_t size = info->image->size;
+    size_t search = size < RAR5_SFX_SEARCH + RAR5_SIGNATURE_SIZE ? size : RAR5_SFX_SEARCH + RAR5_SIGNATURE_SIZE;
+    const uint8_t *sig = memmem(data, search, rar5_signature, RAR5_SIGNATURE_SIZE);
+    if (!sig) return false;
+
+    size_t pos = (size_t)(sig - data) + RAR5_SIGNATURE_SIZE;
+    bool ended = false;
+    while (pos + 4 < size) {
+        size_t vpos = pos + 4;
+        uint64_t head_size;
+        if (!read_vint(data, size, &vpos, &head_size) || head_size == 0 ||
+            head_size > RAR5_MAX_HEADER_SIZE || head_size > size - vpos ||
+            (uint32_t)crc32(0, data + pos + 4, (uInt)(vpos - pos - 4 + head_size)) != read_le32(data + pos)) {
+            break;
+        }
+
+        const uint8_t *header = data + vpos;
+        size_t hp = 0;
+        uint64_t type, flags, extra_size = 0, data_size = 0;
+        bool ok = read_vint(header, head_size, &hp, &type) && read_vint(header, head_size, &hp, &flags);
+        if (ok && (flags & RAR5_HFL_EXTRA)) ok = read_vint(header, head_size, &hp, &extra_size);
+        if (ok && (flags & RAR5_HFL_DATA)) ok = read_vint(header, head_size, &hp, &data_size);
+        if (!ok) break;
+
+        if (type == RAR5_HEAD_END) {
+            ended = true;
+            break;
+        }
+
+        if (type == RAR5_HEAD_CRYPT) {
+            // 后面的头全部加密，文件列表只有知道密码才能读到
+            rar5_ctx_t st;
+            memset(&st, 0, sizeof(st));
+            if (!parse_crypt_record(header, head_size, hp, false, &st)) return false;
+            info->is_encrypted = info->headers_encrypted = true;
+            info->header_salt_len = RAR5_SALT_SIZE;
+            memcpy(info->header_salt, st.salt, RAR5_SALT_SIZE);
+            return true;
+        }
+
+        if (type == RAR5_HEAD_FILE) {
+            file_entry_t *entry = archive_info_add_entry(info);
+            if (!entry) return false;
+
+            rar5_ctx_t st;
+            memset(&st, 0, sizeof(st));
+            entry->compressed_size = data_size;
+            if (parse_file_header(header, head_size, hp, extra_size, &st, entry)) {
+                entry->is_encrypted = true;
+                entry->salt_len = RAR5_SALT_SIZE;
+                memcpy(entry->salt, st.salt, RAR5_SALT_SIZE);
+                info->is_encrypted = true;
+            }
+            if (!entry->filename) entry->filename = strdup("");
+            info->total_size += entry->uncompressed_size;
+        }
+
+        size_t next = vpos + (size_t)head_size;
+        if (data_size > size - next) break;
+        pos = next + (size_t)data_size;
+    }
+
+    // 多卷压缩包的分卷可能没有结束块，至少要读到一个文件
+    return ended || info->file_count > 0;
+}
+
+// 把转置布局的摘要取出为字节
+static void store_digest(const uint32_t digest[8][SHA_MAX_LANES], int lane, uint8_t out[SHA256_DIGEST_SIZE]) {
+    for (int j = 0; j < 8; j++) {
+        out[j * 4] = (uint8_t)(digest[j][lane] >> 24);
+        out[j * 4 + 1] = (uint8_t)(digest[j][lane] >> 16);
+        out[j * 4 + 2] = (uint8_t)(digest[j][lane] >> 8);
+        out[j * 4 + 3] = (uint8_t)digest[j][lane];
+    }
+}
+
+// 多路PBKDF2-HMAC-SHA256：输出密钥(2^N次)，按需输出HashKey(2^N+16次)和密码校验值(2^N+32次)
+static void derive_lanes(const rar5_ctx_t *ctx, zip_crypto_kernel_t kernel, int lanes,
+                         const char *const *passwords, const size_t *lens, int count,
+                         uint8_t keys[][SHA256_DIGEST_SIZE], uint8_t hash_keys[][SHA256_DIGEST_SIZE],
+                         uint8_t checks[][RAR5_CHECK_SIZE]) {
+    static __thread uint32_t ipad[8][SHA_MAX_LANES], opad[8][SHA_MAX_LANES];
+    static __thread uint32_t u[8][SHA_MAX_LANES], fn[8][SHA_MAX_LANES];
+    static __thread uint32_t state[8][SHA_MAX_LANES], words[16][SHA_MAX_LANES];
+    sha_lanes_t l;
+
+    // HMAC密钥块：超过64字节的密码先做一次SHA-256
+    uint8_t key_block[SHA_MAX_LANES][SHA256_BLOCK_SIZE];
+    for (int lane = 0; lane < lanes; lane++) {
+        int src = lane < count ? lane : 0;
+        memset(key_block[lane], 0, SHA256_BLOCK_SIZE);
+        if (lens[src] > SHA256_BLOCK_SIZE) {
+            sha256_digest((const uint8_t*)passwords[src], lens[src], key_block[lane]);
+        } else {
+            memcpy(key_block[lane], passwords[src], lens[src]);
+        }
+    }
+
+    uint32_t (*pads[2])[SHA_MAX_LANES] = { ipad, opad };
+    const uint32_t pad_bytes[2] = { 0x36363636, 0x5c5c5c5c };
+    for (int p = 0; p < 2; p++) {
+        sha_lanes_init(&l, SHA_ALGO_SHA256, kernel, lanes);
+        for (int t = 0; t < 16; t++) {
+            for (int lane = 0; lane < lanes; lane++) {
+                const uint8_t *b = key_block[lane] + t * 4;
+                words[t][lane] = (((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) |
+                                  ((uint32_t)b[2] << 8) | b[3]) ^ pad_bytes[p];
+            }
+        }
+        sha256_compress_lanes(kernel, lanes, l.state, (const uint32_t (*)[SHA_MAX_LANES])words);
+        memcpy(pads[p], l.state, sizeof(ipad));
+    }
+
+    // U1 = HMAC(P, salt || INT(1))：内层消息20字节，填充后一个块
+    for (int t = 0; t < 16; t++) {
+        uint32_t w = 0;
+        if (t < 4) {
+            w = ((uint32_t)ctx->salt[t * 4] << 24) | ((uint32_t)ctx->salt[t * 4 + 1] << 16) |
+                ((uint32_t)ctx->salt[t * 4 + 2] << 8) | ctx->salt[t * 4 + 3];
+        } else if (t == 4) {
+            w = 1;
+        } else if (t == 5) {
+            w = 0x80000000;
+        } else if (t == 15) {
+            w = (SHA256_BLOCK_SIZE + RAR5_SALT_SIZE + 4) * 8;
+        }
+        for (int lane = 0; lane < SHA_MAX_LANES; lane++) words[t][lane] = w;
+    }
+    memcpy(state, ipad, sizeof(state));
+    sha256_compress_lanes(kernel, lanes, state, (const uint32_t (*)[SHA_MAX_LANES])words);
+
+    // 之后每次HMAC的消息都是32字节摘要，填充部分固定
+    for (int t = 8; t < 16; t++) {
+        uint32_t w = t == 8 ? 0x80000000 : t == 15 ? (SHA256_BLOCK_SIZE + SHA256_DIGEST_SIZE) * 8 : 0;
+        for (int lane = 0; lane < SHA_MAX_LANES; lane++) words[t][lane] = w;
+    }
+    memcpy(words, state, sizeof(state));
+    memcpy(u, opad, sizeof(u));
+    sha256_compress_lanes(kernel, lanes, u, (const uint32_t (*)[SHA_MAX_LANES])words);
+    memcpy(fn, u, sizeof(fn));
+
+    uint64_t key_rounds = (uint64_t)1 << ctx->kdf_log2;
+    if (key_rounds == 1) {
+        for (int lane = 0; lane < count; lane++) store_digest(fn, lane, keys[lane]);
+    }
+
+    // 不需要的派生值不必多迭代
+    uint64_t total = key_rounds + (checks ? 2 * RAR5_EXTRA_ROUNDS : hash_keys ? RAR5_EXTRA_ROUNDS : 0);
+    for (uint64_t iter = 2; iter <= total; iter++) {
+        memcpy(words, u, sizeof(u));
+        memcpy(state, ipad, sizeof(state));
+        sha256_compress_lanes(kernel, lanes, state, (const uint32_t (*)[SHA_MAX_LANES])words);
+
+        memcpy(words, state, sizeof(state));
+        memcpy(u, opad, sizeof(u));
+        sha256_compress_lanes(kernel, lanes, u, (const uint32_t (*)[SHA_MAX_LANES])words);
+
+        for (int j = 0; j < 8; j++) {
+            for (int lane = 0; lane < lanes; lane++) fn[j][lane] ^= u[j][lane];
+        }
+
+        if (iter == key_rounds) {
+            for (int lane = 0; lane < count; lane++) store_digest(fn, lane, keys[lane]);
+        } else if (hash_keys && iter == key_rounds + RAR5_EXTRA_ROUNDS) {
+            for (int lane = 0; lane < count; lane++) store_digest(fn, lane, hash_keys[lane]);
+        }
+    }
+
+    // 32字节派生值折叠为8字节校验值
+    for (int lane = 0; checks && lane < count; lane++) {
+        uint8_t value[SHA256_DIGEST_SIZE];
+        store_digest(fn, lane, value);
+        memset(checks[lane], 0, RAR5_CHECK_SIZE);
+        for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+            checks[lane][i % RAR5_CHECK_SIZE] ^= value[i];
+        }
+    }
+}
+
+// 用单路SHA-256计算HMAC-SHA256，消息不超过一个摘要长
+static void hmac_sha256(const uint8_t key[SHA256_DIGEST_SIZE], const uint8_t *msg, size_t len,
+                        uint8_t out[SHA256_DIGEST_SIZE]) {
+    uint8_t block[SHA256_BLOCK_SIZE + SHA256_DIGEST_SIZE];
+    uint8_t inner[SHA256_DIGEST_SIZE];
+    memset(block, 0x36, SHA256_BLOCK_SIZE);
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++) block[i] ^= key[i];
+    memcpy(block + SHA256_BLOCK_SIZE, msg, len);
+    sha256_digest(block, SHA256_BLOCK_SIZE + len, inner);
+
+    memset(block, 0x5C, SHA256_BLOCK_SIZE);
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++) block[i] ^= key[i];
+    memcpy(block + SHA256_BLOCK_SIZE, inner, SHA256_DIGEST_SIZE);
+    sha256_digest(block, SHA256_BLOCK_SIZE + SHA256_DIGEST_SIZE, out);
+}
+
+// HASHMAC模式下存储的CRC是HMAC-SHA256(HashKey, CRC)按字节折叠成的32位
+static uint32_t crc_to_mac(const uint8_t hash_key[SHA256_DIGEST_SIZE], uint32_t crc) {
+    uint8_t raw[4] = { (uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24) };
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    hmac_sha256(hash_key, raw, sizeof(raw), digest);
+
+    uint32_t mac = 0;
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+        mac ^= (uint32_t)digest[i] << ((i & 3) * 8);
+    }
+    return mac;
+}
+
+static const uint32_t blake2s_iv[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+static const uint8_t blake2s_sigma[10][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+};
+
+// 每轮先对四列、再对四条对角线做G函数
+static const uint8_t blake2s_columns[8][4] = {
+    { 0, 4,  8, 12 }, { 1, 5,  9, 13 }, { 2, 6, 10, 14 }, { 3, 7, 11, 15 },
+    { 0, 5, 10, 15 }, { 1, 6, 11, 12 }, { 2, 7,  8, 13 }, { 3, 4,  9, 14 },
+};
+
+static uint32_t rotr32(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static void blake2s_compress(blake2s_state_t *s, const uint8_t block[BLAKE2S_BLOCK_SIZE], bool final) {
+    uint32_t m[16], v[16];
+    for (int i = 0; i < 16; i++) {
+        m[i] = read_le32(block + i * 4);
+    }
+    for (int i = 0; i < 8; i++) {
+        v[i] = s->h[i];
+        v[i + 8] = blake2s_iv[i];
+    }
+    v[12] ^= (uint32_t)s->t;
+    v[13] ^= (uint32_t)(s->t >> 32);
+    if (final) {
+        v[14] = ~v[14];
+        if (s->last_node) v[15] = ~v[15];
+    }
+
+    for (int r = 0; r < 10; r++) {
+        const uint8_t *sg = blake2s_sigma[r];
+        for (int g = 0; g < 8; g++) {
+            const uint8_t *idx = blake2s_columns[g];
+            uint32_t *a = &v[idx[0]], *b = &v[idx[1]], *c = &v[idx[2]], *d = &v[idx[3]];
+            *a += *b + m[sg[2 * g]];
+            *d = rotr32(*d ^ *a, 16);
+            *c += *d;
+            *b = rotr32(*b ^ *c, 12);
+            *a += *b + m[sg[2 * g + 1]];
+            *d = rotr32(*d ^ *a, 8);
+            *c += *d;
+            *b = rotr32(*b ^ *c, 7);
+        }
+    }
+
+    for (int i = 0; i < 8; i++) {
+        s->h[i] ^= v[i] ^ v[i + 8];
+    }
+}
+
+// BLAKE2sp的参数块：32字节摘要、扇出8、深度2，节点偏移和深度区分叶子与根
+static void blake2s_init_node(blake2s_state_t *s, uint32_t node_offset, uint32_t node_depth, bool last_node) {
+    memset(s, 0, sizeof(*s));
+    memcpy(s->h, blake2s_iv, sizeof(s->h));
+    s->h[0] ^= 0x02080020;
+    s->h[2] ^= node_offset;
+    s->h[3] ^= (node_depth << 16) | ((uint32_t)SHA256_DIGEST_SIZE << 24);
+    s->last_node = last_node;
+}
+
+// 最后一个块留到结束时压缩
+static void blake2s_update(blake2s_state_t *s, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        if (s->buf_len == BLAKE2S_BLOCK_SIZE) {
+            s->t += BLAKE2S_BLOCK_SIZE;
+            blake2s_compress(s, s->buf, false);
+            s->buf_len = 0;
+        }
+        size_t take = BLAKE2S_BLOCK_SIZE - s->buf_len < len ? BLAKE2S_BLOCK_SIZE - s->buf_len : len;
+        memcpy(s->buf + s->buf_len, data, take);
+        s->buf_len += take;
+        data += take;
+        len -= take;
+    }
+}
+
+static void blake2s_final(blake2s_state_t *s, uint8_t out[SHA256_DIGEST_SIZE]) {
+    s->t += s->buf_len;
+    memset(s->buf + s->buf_len, 0, BLAKE2S_BLOCK_SIZE - s->buf_len);
+    blake2s_compress(s, s->buf, true);
+    for (int i = 0; i < 8; i++) {
+        out[i * 4] = (uint8_t)s->h[i];
+        out[i * 4 + 1] = (uint8_t)(s->h[i] >> 8);
+        out[i * 4 + 2] = (uint8_t)(s->h[i] >> 16);
+        out[i * 4 + 3] = (uint8_t)(s->h[i] >> 24);
+    }
+}
+
+static void blake2sp_init(blake2sp_state_t *s) {
+    for (uint32_t i = 0; i < BLAKE2SP_LEAVES; i++) {
+        blake2s_init_node(&s->leaves[i], i, 0, i == BLAKE2SP_LEAVES - 1);
+    }
+    blake2s_init_node(&s->root, 0, 1, true);
+    s->total = 0;
+}
+
+// 第i个64字节块交给第i%8个叶子
+static void blake2sp_update(blake2sp_state_t *s, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        size_t leaf = (size_t)(s->total / BLAKE2S_BLOCK_SIZE) % BLAKE2SP_LEAVES;
+        size_t room = BLAKE2S_BLOCK_SIZE - (size_t)(s->total % BLAKE2S_BLOCK_SIZE);
+        size_t take = room < len ? room : len;
+        blake2s_update(&s->leaves[leaf], data, take);
+        s->total += take;
+        data += take;
+        len -= take;
+    }
+}
+
+static void blake2sp_final(blake2sp_state_t *s, uint8_t out[SHA256_DIGEST_SIZE]) {
+    for (int i = 0; i < BLAKE2SP_LEAVES; i++) {
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        blake2s_final(&s->leaves[i], digest);
+        blake2s_update(&s->root, digest, sizeof(digest));
+    }
+    blake2s_final(&s->root, out);
+}
+
+static void digest_output(void *opaque, const uint8_t *data, size_t len) {
+    rar5_digest_t *d = opaque;
+    if (d->use_blake2) {
+        blake2sp_update(&d->blake2, data, len);
+    } else {
+        d->crc = (uint32_t)crc32(d->crc, data, (uInt)len);
+    }
+}
+
+// 与文件头记录的CRC32或BLAKE2sp比较，HASHMAC模式先做同样的变换
+static bool digest_matches(const rar5_ctx_t *ctx, rar5_digest_t *d, const uint8_t hash_key[SHA256_DIGEST_SIZE]) {
+    if (!d->use_blake2) {
+        return (ctx->use_mac ? crc_to_mac(hash_key, d->crc) : d->crc) == ctx->data_crc;
+    }
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    blake2sp_final(&d->blake2, digest);
+    if (ctx->use_mac) {
+        hmac_sha256(hash_key, digest, sizeof(digest), digest);
+    }
+    return memcmp(digest, ctx->blake2, sizeof(digest)) == 0;
+}
+
+// 解密加密头的开头，检查长度、类型和头CRC
+static bool check_header_block(const rar5_ctx_t *ctx, EVP_CIPHER_CTX *cipher,
+                               const uint8_t key[SHA256_DIGEST_SIZE]) {
+    uint8_t plain[sizeof(ctx->cipher)];
+    int out_len = 0;
+    if (EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), NULL, key, ctx->iv) != 1 ||
+        EVP_CIPHER_CTX_set_padding(cipher, 0) != 1 ||
+        EVP_DecryptUpdate(cipher, plain, &out_len, ctx->cipher, 16) != 1) {
+        return false;
+    }
+
+    size_t pos = 4;
+    uint64_t head_size, type;
+    if (!read_vint(plain, 16, &pos, &head_size) || head_size == 0 || head_size > RAR5_MAX_HEADER_SIZE) {
+        return false;
+    }
+    size_t total = pos + (size_t)head_size;
+    if (total > ctx->cipher_len) {
+        // 头比缓存长，先只检查类型，CRC留给第二阶段
+        return read_vint(plain, 16, &pos, &type) && type >= RAR5_HEAD_MAIN && type <= RAR5_HEAD_END &&
+               type != RAR5_HEAD_CRYPT;
+    }
+
+    size_t rest = (total + 15) / 16 * 16 - 16;
+    if (rest > 0 && EVP_DecryptUpdate(cipher, plain + 16, &out_len, ctx->cipher + 16, (int)rest) != 1) {
+        return false;
+    }
+    return (uint32_t)crc32(0, plain + 4, (uInt)(total - 4)) == read_le32(plain);
+}
+
+// 解密文件数据的开头：压缩数据检查第一个块头和哈夫曼表，小的存储文件直接比较CRC32
+static bool check_data_block(const rar5_ctx_t *ctx, EVP_CIPHER_CTX *cipher,
+                             const uint8_t key[SHA256_DIGEST_SIZE], const uint8_t *hash_key) {
+    bool whole = ctx->method == 0 && ctx->has_crc && ctx->unpacked_size <= ctx->cipher_len;
+    if (ctx->method == 0 && !whole) {
+        return true;
+    }
+
+    uint8_t plain[sizeof(ctx->cipher)];
+    int out_len = 0;
+    int len = whole ? (int)((ctx->unpacked_size + 15) / 16 * 16) : (int)ctx->cipher_len;
+    if (EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), NULL, key, ctx->iv) != 1 ||
+        EVP_CIPHER_CTX_set_padding(cipher, 0) != 1 ||
+        (len > 0 && EVP_DecryptUpdate(cipher, plain, &out_len, ctx->cipher, len) != 1)) {
+        return false;
+    }
+
+    if (whole) {
+        uint32_t crc = (uint32_t)crc32(0, plain, (uInt)ctx->unpacked_size);
+        return (ctx->use_mac ? crc_to_mac(hash_key, crc) : crc) == ctx->data_crc;
+    }
+    return rar5_probe_block(plain, (size_t)len, ctx->comp_info);
+}
+
+// 使用指定内核批量校验
+static int check_batch_with_kernel(const rar5_ctx_t *ctx, zip_crypto_kernel_t kernel,
+                                   const char *const *passwords, const size_t *lens,
+                                   int count, bool *results) {
+    int lanes = sha_kernel_lanes(kernel);
+    int passed = 0;
+    EVP_CIPHER_CTX *cipher = ctx->has_check ? NULL : EVP_CIPHER_CTX_new();
+    if (!ctx->has_check && !cipher) return 0;
+
+    // 只有HASHMAC模式下整块比较存储文件的CRC才需要HashKey
+    bool need_hash_key = !ctx->has_check && !ctx->is_header && ctx->use_mac && ctx->method == 0;
+
+    for (int i = 0; i < count; i += lanes) {
+        int n = count - i < lanes ? count - i : lanes;
+        uint8_t keys[SHA_MAX_LANES][SHA256_DIGEST_SIZE];
+        uint8_t hash_keys[SHA_MAX_LANES][SHA256_DIGEST_SIZE];
+        uint8_t checks[SHA_MAX_LANES][RAR5_CHECK_SIZE];
+        derive_lanes(ctx, kernel, lanes, passwords + i, lens + i, n, keys,
+                     need_hash_key ? hash_keys : NULL, ctx->has_check ? checks : NULL);
+
+        for (int j = 0; j < n; j++) {
+            if (ctx->has_check) {
+                results[i + j] = memcmp(checks[j], ctx->check, RAR5_CHECK_SIZE) == 0;
+            } else if (ctx->is_header) {
+                results[i + j] = check_header_block(ctx, cipher, keys[j]);
+            } else {
+                results[i + j] = check_data_block(ctx, cipher, keys[j], need_hash_key ? hash_keys[j] : NULL);
+            }
+            if (results[i + j]) passed++;
+        }
+    }
+
+    EVP_CIPHER_CTX_free(cipher);
+    return passed;
+}
+
+// 批量校验密码，返回通过校验的数量
+int rar5_check_batch(const rar5_ctx_t *ctx, const char *const *passwords,
+                     const size_t *lens, int count, bool *results) {
+    if (!ctx || !passwords || !lens || !results || count <= 0) {
+        return 0;
+    }
+    return check_batch_with_kernel(ctx, ctx->kernel, passwords, lens, count, results);
+}
+
+// 检查单个密码
+bool rar5_check_password(const rar5_ctx_t *ctx, const char *password, size_t len) {
+    bool result = false;
+    rar5_check_batch(ctx, &password, &len, 1, &result);
+    return result;
+}
+
+// 解密映像中的完整第一个头并比较头CRC
+static zip_verify_result_t verify_header(const rar5_ctx_t *ctx, EVP_CIPHER_CTX *cipher,
+                                         const uint8_t key[SHA256_DIGEST_SIZE]) {
+    const uint8_t *src = ctx->image->data + ctx->data_offset;
+    uint8_t first[16];
+    int out_len = 0;
+    if (ctx->data_size < 16 ||
+        EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), NULL, key, ctx->iv) != 1 ||
+        EVP_CIPHER_CTX_set_padding(cipher, 0) != 1 ||
+        EVP_DecryptUpdate(cipher, first, &out_len, src, 16) != 1) {
+        return ZIP_VERIFY_FAIL;
+    }
+
+    size_t pos = 4;
+    uint64_t head_size;
+    if (!read_vint(first, 16, &pos, &head_size) || head_size == 0 || head_size > RAR5_MAX_HEADER_SIZE ||
+        pos + head_size > ctx->data_size) {
+        return ZIP_VERIFY_FAIL;
+    }
+    size_t total = pos + (size_t)head_size;
+    size_t padded = (total + 15) / 16 * 16;
+    if (padded > ctx->data_size) {
+        return ZIP_VERIFY_FAIL;
+    }
+
+    uint8_t *plain = malloc(padded);
+    if (!plain) return ZIP_VERIFY_UNSUPPORTED;
+    memcpy(plain, first, 16);
+    zip_verify_result_t result = ZIP_VERIFY_FAIL;
+    if (padded == 16 || EVP_DecryptUpdate(cipher, plain + 16, &out_len, src + 16, (int)(padded - 16)) == 1) {
+        result = (uint32_t)crc32(0, plain + 4, (uInt)(total - 4)) == read_le32(plain) ? ZIP_VERIFY_OK
+                                                                                        : ZIP_VERIFY_FAIL;
+    }
+    free(plain);
+    return result;
+}
+
+// 分块解密存储的文件并计算校验和
+static zip_verify_result_t verify_stored(const rar5_ctx_t *ctx, EVP_CIPHER_CTX *cipher,
+                                         rar5_digest_t *digest, const uint8_t hash_key[SHA256_DIGEST_SIZE]) {
+    if (ctx->split || (!ctx->has_crc && !ctx->has_blake2) || ctx->unpacked_size == UINT64_MAX) {
+        // 没有校验和或者数据不全，本卷里没有可比较的东西
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+    if ((ctx->unpacked_size + 15) / 16 * 16 > ctx->data_size) {
+        return ZIP_VERIFY_FAIL;
+    }
+
+    const uint8_t *src = ctx->image->data + ctx->data_offset;
+    uint8_t *plain = malloc(RAR5_VERIFY_CHUNK);
+    if (!plain) return ZIP_VERIFY_UNSUPPORTED;
+
+    uint64_t left = ctx->unpacked_size;
+    size_t offset = 0;
+    int out_len = 0;
+    while (left > 0) {
+        size_t chunk = left < RAR5_VERIFY_CHUNK ? (size_t)(left + 15) / 16 * 16 : RAR5_VERIFY_CHUNK;
+        if (EVP_DecryptUpdate(cipher, plain, &out_len, src + offset, (int)chunk) != 1) {
+            free(plain);
+            return ZIP_VERIFY_FAIL;
+        }
+        size_t used = left < chunk ? (size_t)left : chunk;
+        digest_output(digest, plain, used);
+        offset += chunk;
+        left -= used;
+    }
+    free(plain);
+    return digest_matches(ctx, digest, hash_key) ? ZIP_VERIFY_OK : ZIP_VERIFY_FAIL;
+}
+
+// 解密全部压缩数据后原生解压，比较CRC32或BLAKE2sp
+static zip_verify_result_t verify_packed(const rar5_ctx_t *ctx, EVP_CIPHER_CTX *cipher,
+                                         rar5_digest_t *digest, const uint8_t hash_key[SHA256_DIGEST_SIZE]) {
+    size_t packed = (size_t)(ctx->data_size / 16 * 16);
+    uint8_t *plain = malloc(packed);
+    if (!plain) return ZIP_VERIFY_UNSUPPORTED;
+
+    int out_len = 0;
+    const uint8_t *src = ctx->image->data + ctx->data_offset;
+    for (size_t offset = 0; offset < packed; offset += RAR5_VERIFY_CHUNK) {
+        size_t chunk = packed - offset < RAR5_VERIFY_CHUNK ? packed - offset : RAR5_VERIFY_CHUNK;
+        if (EVP_DecryptUpdate(cipher, plain + offset, &out_len, src + offset, (int)chunk) != 1) {
+            free(plain);
+            return ZIP_VERIFY_FAIL;
+        }
+    }
+
+    zip_verify_result_t result = rar5_unpack(plain, packed, ctx->comp_info, ctx->unpacked_size, ctx->split,
+                                             digest_output, digest);
+    free(plain);
+
+    // 分卷文件的校验和在最后一卷，没有校验和的文件以完整解出为准
+    if (result != ZIP_VERIFY_OK || ctx->split || (!ctx->has_crc && !ctx->has_blake2)) {
+        return result;
+    }
+    return digest_matches(ctx, digest, hash_key) ? ZIP_VERIFY_OK : ZIP_VERIFY_FAIL;
+}
+
+// 第二阶段：64位校验值直接确认；否则从映像解密完整的头或文件数据，比较头CRC，
+// 或者解出文件内容比较CRC32/BLAKE2sp
+zip_verify_result_t rar5_verify_password(const rar5_ctx_t *ctx, const char *password, size_t len) {
+    if (!ctx || !password) {
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+
+    uint8_t key[1][SHA256_DIGEST_SIZE];
+    uint8_t hash_key[1][SHA256_DIGEST_SIZE];
+    uint8_t check[1][RAR5_CHECK_SIZE];
+    if (ctx->has_check) {
+        derive_lanes(ctx, ZC_KERNEL_SCALAR, 1, &password, &len, 1, key, NULL, check);
+        return memcmp(check[0], ctx->check, RAR5_CHECK_SIZE) == 0 ? ZIP_VERIFY_OK : ZIP_VERIFY_FAIL;
+    }
+    if (!ctx->image || ctx->data_offset > ctx->image->size ||
+        ctx->data_size > ctx->image->size - ctx->data_offset) {
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+    derive_lanes(ctx, ZC_KERNEL_SCALAR, 1, &password, &len, 1, key, ctx->use_mac ? hash_key : NULL, NULL);
+
+    EVP_CIPHER_CTX *cipher = EVP_CIPHER_CTX_new();
+    if (!cipher) return ZIP_VERIFY_UNSUPPORTED;
+
+    zip_verify_result_t result;
+    if (ctx->is_header) {
+        result = verify_header(ctx, cipher, key[0]);
+    } else if (EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), NULL, key[0], ctx->iv) != 1 ||
+               EVP_CIPHER_CTX_set_padding(cipher, 0) != 1) {
+        result = ZIP_VERIFY_UNSUPPORTED;
+    } else {
+        rar5_digest_t *digest = calloc(1, sizeof(rar5_digest_t));
+        if (digest) {
+            digest->use_blake2 = !ctx->has_crc && ctx->has_blake2;
+            blake2sp_init(&digest->blake2);
+            result = ctx->method == 0 ? verify_stored(ctx, cipher, digest, hash_key[0])
+                                      : verify_packed(ctx, cipher, digest, hash_key[0]);
+        } else {
+            result = ZIP_VERIFY_UNSUPPORTED;
+        }
+        free(digest);
+    }
+    EVP_CIPHER_CTX_free(cipher);
+    return result;
+}
+
+// 测量每种内核的PBKDF2-HMAC-SHA256吞吐量
+void rar5_benchmark(void) {
+    rar5_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.kdf_log2 = 15;
+    ctx.has_check = true;
+    for (int i = 0; i < RAR5_SALT_SIZE; i++) {
+        ctx.salt[i] = (uint8_t)(i * 29 + 3);
+    }
+
+    const int batch = 16;
+    char storage[16][16];
+    const char *passwords[16];
+    size_t lens[16];
+    bool results[16];
+    for (int i = 0; i < batch; i++) {
+        snprintf(storage[i], sizeof(storage[i]), "%08d", i * 7919);
+        passwords[i] = storage[i];
+        lens[i] = 8;
+    }
+
+    print_info("RAR5 校验吞吐量 (单线程, PBKDF2-HMAC-SHA256 x2^%d):", ctx.kdf_log2);
+
+    zip_crypto_kernel_t kernels[] = {ZC_KERNEL_SCALAR, ZC_KERNEL_AVX2, ZC_KERNEL_AVX512};
+    zip_crypto_kernel_t best = zip_crypto_select_kernel();
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        if (kernels[k] > best) {
+            printf("  %-16s 不支持\n", zip_crypto_kernel_name(kernels[k]));
+            continue;
+        }
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        check_batch_with_kernel(&ctx, kernels[k], passwords, lens, batch, results);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("  %-16s %8.1f p/s\n", zip_crypto_kernel_name(kernels[k]), batch / elapsed);
+    }
+}
+
+// 释放RAR5上下文
+void rar5_free(rar5_ctx_t *ctx) {
+    free(ctx);
+}
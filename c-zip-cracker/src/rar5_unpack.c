@@ -0,0 +1,565 @@
+#include "../include/zip_cracker.h"
+
+// RAR5压缩格式的哈夫曼表大小
+#define RAR5_NC        306   // 256个字面量 + 过滤器 + 重复 + 4个旧距离 + 44个长度槽
+#define RAR5_DC        64
+#define RAR5_DC_EXT    80    // 算法版本1（RAR7）的距离槽更多
+#define RAR5_LDC       16
+#define RAR5_RC        44
+#define RAR5_BC        20
+#define RAR5_HUFF_MAX  (RAR5_NC + RAR5_DC_EXT + RAR5_LDC + RAR5_RC)
+#define RAR5_CODE_BITS 15
+
+// 窗口、匹配和过滤器的上限
+#define RAR5_MIN_WINDOW      (1u << 16)
+#define RAR5_MAX_WINDOW      ((uint64_t)1 << 30)
+#define RAR5_FILTER_WINDOW   (8u << 20)   // 不小于两倍过滤块，过滤区总能在窗口里凑齐
+#define RAR5_MAX_MATCH       0x1100
+#define RAR5_MAX_FILTERS     8192
+#define RAR5_MAX_FILTER_SIZE 0x400000
+#define RAR5_MAX_SYMBOL_BITS 128          // 一个符号连同附加位最多读取的位数（留有余量）
+
+#define RAR5_ALGO_VERSION_MASK 0x3F
+#define RAR5_COMP_SOLID        0x40
+
+enum {
+    RAR5_FILTER_DELTA,
+    RAR5_FILTER_E8,
+    RAR5_FILTER_E8E9,
+    RAR5_FILTER_ARM
+};
+
+// 高位在前的位读取器，越界部分按0读出并记录
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    uint64_t pos;
+    bool overrun;
+} bit_reader_t;
+
+// 范式哈夫曼表：每种码长的数量和按码长排序的符号
+typedef struct {
+    uint16_t count[RAR5_CODE_BITS + 1];
+    uint16_t symbol[RAR5_NC];
+} huff_table_t;
+
+typedef struct {
+    uint64_t start;
+    uint32_t length;
+    uint8_t type;
+    uint8_t channels;
+} rar5_filter_t;
+
+typedef struct {
+    bool last;
+    bool table;
+    uint64_t end_bits;             // 块内最后一位之后的位置
+} block_header_t;
+
+typedef struct {
+    huff_table_t ld, dd, ldd, rd;
+    uint8_t *window;
+    uint64_t mask;
+    uint64_t pos;                  // 已解出的字节数
+    uint64_t written;              // 已交给回调的字节数
+    rar5_filter_t *filters;
+    size_t filter_head, filter_count;
+    uint8_t *filter_buf;           // 过滤区的源数据和DELTA的输出
+    rar_output_fn output;
+    void *opaque;
+} rar5_unpack_t;
+
+static uint32_t peek_bits(bit_reader_t *br, int n) {
+    size_t byte = (size_t)(br->pos >> 3);
+    uint32_t v;
+    if (byte + 4 <= br->size) {
+        v = ((uint32_t)br->data[byte] << 24) | ((uint32_t)br->data[byte + 1] << 16) |
+            ((uint32_t)br->data[byte + 2] << 8) | br->data[byte + 3];
+    } else {
+        v = 0;
+        for (size_t i = 0; i < 4; i++) {
+            v = (v << 8) | (byte + i < br->size ? br->data[byte + i] : 0);
+        }
+    }
+    if (((br->pos + (uint64_t)n + 7) >> 3) > br->size) {
+        br->overrun = true;
+    }
+    return (v << (br->pos & 7)) >> (32 - n);
+}
+
+// 读取n位（n不超过25）
+static uint32_t read_bits(bit_reader_t *br, int n) {
+    if (n == 0) return 0;
+    uint32_t v = peek_bits(br, n);
+    br->pos += (uint64_t)n;
+    return v;
+}
+
+// 读取较长的距离附加位
+static uint64_t read_long_bits(bit_reader_t *br, int n) {
+    uint64_t v = 0;
+    while (n > 0) {
+        int take = n < 16 ? n : 16;
+        v = (v << take) | read_bits(br, take);
+        n -= take;
+    }
+    return v;
+}
+
+// 由码长建立解码表，码长超额分配的表不可能由压缩器产生
+static bool build_table(huff_table_t *t, const uint8_t *lengths, int n) {
+    uint16_t offs[RAR5_CODE_BITS + 2];
+    memset(t->count, 0, sizeof(t->count));
+    for (int i = 0; i < n; i++) {
+        t->count[lengths[i]]++;
+    }
+    t->count[0] = 0;
+
+    int left = 1;
+    for (int len = 1; len <= RAR5_CODE_BITS; len++) {
+        left = (left << 1) - t->count[len];
+        if (left < 0) return false;
+    }
+
+    offs[1] = 0;
+    for (int len = 1; len <= RAR5_CODE_BITS; len++) {
+        offs[len + 1] = (uint16_t)(offs[len] + t->count[len]);
+    }
+    for (int i = 0; i < n; i++) {
+        if (lengths[i]) t->symbol[offs[lengths[i]]++] = (uint16_t)i;
+    }
+    return true;
+}
+
+// 逐位比较范式码，落到未分配的码字返回-1
+static int decode_symbol(bit_reader_t *br, const huff_table_t *t) {
+    uint32_t bits = peek_bits(br, RAR5_CODE_BITS);
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len <= RAR5_CODE_BITS; len++) {
+        code |= (int)((bits >> (RAR5_CODE_BITS - len)) & 1);
+        int count = t->count[len];
+        if (code - first < count) {
+            br->pos += (uint64_t)len;
+            return t->symbol[index + code - first];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+// 块头按字节对齐：标志、校验和、1~3字节的块大小
+static bool read_block_header(bit_reader_t *br, block_header_t *h) {
+    br->pos = (br->pos + 7) & ~(uint64_t)7;
+    size_t p = (size_t)(br->pos >> 3);
+    if (p + 2 > br->size) return false;
+
+    uint8_t flags = br->data[p];
+    int byte_count = ((flags >> 3) & 3) + 1;
+    if (byte_count == 4 || p + 2 + (size_t)byte_count > br->size) return false;
+
+    uint32_t block_size = 0;
+    uint8_t sum = 0x5A ^ flags;
+    for (int i = 0; i < byte_count; i++) {
+        block_size |= (uint32_t)br->data[p + 2 + i] << (i * 8);
+        sum ^= br->data[p + 2 + i];
+    }
+    if (sum != br->data[p + 1] || block_size == 0) return false;
+
+    uint64_t start = p + 2 + (size_t)byte_count;
+    h->last = (flags & 0x40) != 0;
+    h->table = (flags & 0x80) != 0;
+    h->end_bits = (start + block_size - 1) * 8 + (flags & 7) + 1;
+    br->pos = start * 8;
+    return true;
+}
+
+// 读取块开头的四张哈夫曼表：先是20个4位码长（15为转义），再用它解出全部码长
+static bool read_tables(bit_reader_t *br, rar5_unpack_t *u, int dc) {
+    uint8_t bit_lengths[RAR5_BC];
+    for (int i = 0; i < RAR5_BC; i++) {
+        uint8_t len = (uint8_t)read_bits(br, 4);
+        if (len == 15) {
+            int zeros = (int)read_bits(br, 4);
+            if (zeros == 0) {
+                bit_lengths[i] = 15;
+            } else {
+                for (zeros += 2; zeros > 0 && i < RAR5_BC; zeros--) bit_lengths[i++] = 0;
+                i--;
+            }
+        } else {
+            bit_lengths[i] = len;
+        }
+    }
+
+    huff_table_t bd;
+    if (!build_table(&bd, bit_lengths, RAR5_BC)) return false;
+
+    uint8_t table[RAR5_HUFF_MAX];
+    int size = RAR5_NC + dc + RAR5_LDC + RAR5_RC;
+    for (int i = 0; i < size;) {
+        int number = decode_symbol(br, &bd);
+        if (number < 0) return false;
+        if (number < 16) {
+            table[i++] = (uint8_t)number;
+            continue;
+        }
+
+        int n = number == 16 || number == 18 ? (int)read_bits(br, 3) + 3 : (int)read_bits(br, 7) + 11;
+        if (number < 18) {
+            // 重复前一个码长，不能出现在开头
+            if (i == 0) return false;
+            for (; n > 0 && i < size; n--, i++) table[i] = table[i - 1];
+        } else {
+            for (; n > 0 && i < size; n--) table[i++] = 0;
+        }
+    }
+
+    return build_table(&u->ld, table, RAR5_NC) &&
+           build_table(&u->dd, table + RAR5_NC, dc) &&
+           build_table(&u->ldd, table + RAR5_NC + dc, RAR5_LDC) &&
+           build_table(&u->rd, table + RAR5_NC + dc + RAR5_LDC, RAR5_RC);
+}
+
+// 只检查第一个块的头和哈夫曼表；数据不够读完表时不下结论
+bool rar5_probe_block(const uint8_t *data, size_t size, uint64_t comp_info) {
+    uint8_t version = (uint8_t)(comp_info & RAR5_ALGO_VERSION_MASK);
+    if (version > 1) return true;
+
+    bit_reader_t br = { data, size, 0, false };
+    block_header_t block;
+    if (!read_block_header(&br, &block)) return false;
+    if (!block.table) {
+        // 固实文件可以沿用前一个文件的表
+        return (comp_info & RAR5_COMP_SOLID) != 0;
+    }
+
+    rar5_unpack_t u;
+    bool ok = read_tables(&br, &u, version ? RAR5_DC_EXT : RAR5_DC) && br.pos <= block.end_bits;
+    return ok || br.overrun;
+}
+
+// 把窗口中n字节交给回调
+static void emit_window(rar5_unpack_t *u, uint64_t n) {
+    while (n > 0) {
+        uint64_t index = u->written & u->mask;
+        uint64_t chunk = u->mask + 1 - index < n ? u->mask + 1 - index : n;
+        u->output(u->opaque, u->window + index, (size_t)chunk);
+        u->written += chunk;
+        n -= chunk;
+    }
+}
+
+// 还原过滤区：E8/E8E9把绝对地址换回相对地址，ARM还原BL指令，DELTA按通道累加
+static const uint8_t *apply_filter(rar5_unpack_t *u, const rar5_filter_t *f) {
+    uint8_t *data = u->filter_buf;
+    uint32_t size = f->length;
+    for (uint32_t i = 0; i < size; i++) {
+        data[i] = u->window[(f->start + i) & u->mask];
+    }
+
+    uint32_t file_offset = (uint32_t)f->start;
+    if (f->type == RAR5_FILTER_E8 || f->type == RAR5_FILTER_E8E9) {
+        const uint32_t file_size = 0x1000000;
+        uint8_t cmp = f->type == RAR5_FILTER_E8E9 ? 0xE9 : 0xE8;
+        for (uint32_t pos = 0; pos + 4 < size;) {
+            uint8_t b = data[pos++];
+            if (b != 0xE8 && b != cmp) continue;
+
+            uint32_t offset = (pos + file_offset) % file_size;
+            uint32_t addr = (uint32_t)data[pos] | ((uint32_t)data[pos + 1] << 8) |
+                            ((uint32_t)data[pos + 2] << 16) | ((uint32_t)data[pos + 3] << 24);
+            bool write = false;
+            if (addr & 0x80000000) {
+                if (((addr + offset) & 0x80000000) == 0) {
+                    addr += file_size;
+                    write = true;
+                }
+            } else if ((addr - file_size) & 0x80000000) {
+                addr -= offset;
+                write = true;
+            }
+            if (write) {
+                data[pos] = (uint8_t)addr;
+                data[pos + 1] = (uint8_t)(addr >> 8);
+                data[pos + 2] = (uint8_t)(addr >> 16);
+                data[pos + 3] = (uint8_t)(addr >> 24);
+            }
+            pos += 4;
+        }
+    } else if (f->type == RAR5_FILTER_ARM) {
+        for (uint32_t pos = 0; pos + 3 < size; pos += 4) {
+            uint8_t *d = data + pos;
+            if (d[3] != 0xEB) continue;
+            uint32_t offset = d[0] + ((uint32_t)d[1] << 8) + ((uint32_t)d[2] << 16);
+            offset -= (file_offset + pos) / 4;
+            d[0] = (uint8_t)offset;
+            d[1] = (uint8_t)(offset >> 8);
+            d[2] = (uint8_t)(offset >> 16);
+        }
+    } else {
+        uint8_t *dst = data + RAR5_MAX_FILTER_SIZE;
+        uint32_t src = 0;
+        for (uint32_t channel = 0; channel < f->channels; channel++) {
+            uint8_t prev = 0;
+            for (uint32_t pos = channel; pos < size; pos += f->channels) {
+                prev = (uint8_t)(prev - data[src++]);
+                dst[pos] = prev;
+            }
+        }
+        return dst;
+    }
+    return data;
+}
+
+// 把已解出的数据交给回调，遇到还没解完的过滤区就停下
+static void flush_window(rar5_unpack_t *u) {
+    while (u->written < u->pos) {
+        if (u->filter_head == u->filter_count) {
+            emit_window(u, u->pos - u->written);
+            break;
+        }
+
+        const rar5_filter_t *f = &u->filters[u->filter_head];
+        if (u->written < f->start) {
+            emit_window(u, (f->start < u->pos ? f->start : u->pos) - u->written);
+            continue;
+        }
+        if (u->pos < f->start + f->length) {
+            break;
+        }
+        u->output(u->opaque, apply_filter(u, f), f->length);
+        u->written += f->length;
+        u->filter_head++;
+    }
+
+    // 零长度的过滤器可能停在已写出的位置上
+    while (u->filter_head < u->filter_count &&
+           u->filters[u->filter_head].length == 0 && u->filters[u->filter_head].start <= u->written) {
+        u->filter_head++;
+    }
+    if (u->filter_head == u->filter_count) {
+        u->filter_head = u->filter_count = 0;
+    }
+}
+
+// 过滤器参数中的数字：2位字节数减1，之后低字节在前
+static uint32_t read_filter_data(bit_reader_t *br) {
+    int byte_count = (int)read_bits(br, 2) + 1;
+    uint32_t data = 0;
+    for (int i = 0; i < byte_count; i++) {
+        data |= read_bits(br, 8) << (i * 8);
+    }
+    return data;
+}
+
+static bool read_filter(bit_reader_t *br, rar5_unpack_t *u) {
+    uint32_t start = read_filter_data(br);
+    uint32_t length = read_filter_data(br);
+    rar5_filter_t f;
+    f.start = u->pos + start;
+    f.length = length;
+    f.type = (uint8_t)read_bits(br, 3);
+    f.channels = f.type == RAR5_FILTER_DELTA ? (uint8_t)(read_bits(br, 5) + 1) : 0;
+    if (f.type > RAR5_FILTER_ARM || length > RAR5_MAX_FILTER_SIZE) {
+        return false;
+    }
+
+    // 过滤区按顺序出现且互不重叠
+    if (u->filter_count > 0) {
+        const rar5_filter_t *prev = &u->filters[u->filter_count - 1];
+        if (f.start < prev->start + prev->length) return false;
+    }
+    if (u->filter_count == RAR5_MAX_FILTERS) {
+        flush_window(u);
+        if (u->filter_count == RAR5_MAX_FILTERS) return false;
+    }
+    if (!u->filter_buf) {
+        u->filter_buf = malloc(2 * RAR5_MAX_FILTER_SIZE);
+        if (!u->filter_buf) return false;
+    }
+    u->filters[u->filter_count++] = f;
+    return true;
+}
+
+static uint32_t slot_to_length(bit_reader_t *br, int slot) {
+    if (slot < 8) {
+        return 2 + (uint32_t)slot;
+    }
+    int bits = slot / 4 - 1;
+    return 2 + ((uint32_t)(4 | (slot & 3)) << bits) + read_bits(br, bits);
+}
+
+// 非固实的流里距离不能超出已解出的数据
+static bool copy_string(rar5_unpack_t *u, uint32_t length, uint64_t distance) {
+    if (distance == 0 || distance > u->pos || distance > u->mask + 1) {
+        return false;
+    }
+    for (uint32_t i = 0; i < length; i++) {
+        u->window[(u->pos + i) & u->mask] = u->window[(u->pos + i - distance) & u->mask];
+    }
+    u->pos += length;
+    return true;
+}
+
+// 解出一个压缩块序列中的所有符号，返回false表示数据损坏；*truncated表示数据在本卷结束
+static bool decode_stream(bit_reader_t *br, rar5_unpack_t *u, int dc, uint64_t limit, bool *truncated) {
+    block_header_t block;
+    if (!read_block_header(br, &block) || !block.table || !read_tables(br, u, dc)) {
+        return false;
+    }
+
+    uint64_t avail_bits = (uint64_t)br->size * 8;
+    uint64_t old_dist[4] = { 0, 0, 0, 0 };
+    uint32_t last_length = 0;
+    uint64_t room = u->mask + 1 - RAR5_MAX_MATCH;
+
+    while (true) {
+        if (br->pos >= block.end_bits) {
+            if (block.last) return true;
+            if (((br->pos + 7) >> 3) + 5 > br->size) {
+                *truncated = true;
+                return true;
+            }
+            if (!read_block_header(br, &block) || (block.table && !read_tables(br, u, dc))) {
+                return false;
+            }
+            continue;
+        }
+        if (br->pos + RAR5_MAX_SYMBOL_BITS > avail_bits) {
+            if (block.end_bits <= avail_bits) {
+                // 块完整时只允许最后几个符号读到末尾
+                if (br->pos > avail_bits) return false;
+            } else {
+                *truncated = true;
+                return true;
+            }
+        }
+        if (u->pos > limit) {
+            return false;
+        }
+        if (u->pos - u->written > room) {
+            flush_window(u);
+            if (u->pos - u->written > room) return false;
+        }
+
+        int sym = decode_symbol(br, &u->ld);
+        if (sym < 0) {
+            return false;
+        }
+        if (sym < 256) {
+            u->window[u->pos & u->mask] = (uint8_t)sym;
+            u->pos++;
+            continue;
+        }
+
+        if (sym >= 262) {
+            uint32_t length = slot_to_length(br, sym - 262);
+            int dist_slot = decode_symbol(br, &u->dd);
+            if (dist_slot < 0) return false;
+
+            uint64_t distance = 1;
+            int dbits;
+            if (dist_slot < 4) {
+                dbits = 0;
+                distance += (uint64_t)dist_slot;
+            } else {
+                dbits = dist_slot / 2 - 1;
+                distance += (uint64_t)(2 | (dist_slot & 1)) << dbits;
+            }
+            if (dbits >= 4) {
+                if (dbits > 4) distance += read_long_bits(br, dbits - 4) << 4;
+                int low = decode_symbol(br, &u->ldd);
+                if (low < 0) return false;
+                distance += (uint64_t)low;
+            } else if (dbits > 0) {
+                distance += read_bits(br, dbits);
+            }
+
+            // 远距离的匹配隐含更长的最短长度
+            if (distance > 0x100) {
+                length++;
+                if (distance > 0x2000) {
+                    length++;
+                    if (distance > 0x40000) length++;
+                }
+            }
+            memmove(old_dist + 1, old_dist, 3 * sizeof(old_dist[0]));
+            old_dist[0] = distance;
+            last_length = length;
+            if (!copy_string(u, length, distance)) return false;
+        } else if (sym == 256) {
+            if (!read_filter(br, u)) return false;
+        } else if (sym == 257) {
+            if (last_length != 0 && !copy_string(u, last_length, old_dist[0])) return false;
+        } else {
+            // 258~261：使用第N个旧距离，并把它移到最前
+            int num = sym - 258;
+            uint64_t distance = old_dist[num];
+            for (int i = num; i > 0; i--) old_dist[i] = old_dist[i - 1];
+            old_dist[0] = distance;
+
+            int length_slot = decode_symbol(br, &u->rd);
+            if (length_slot < 0) return false;
+            uint32_t length = slot_to_length(br, length_slot);
+            last_length = length;
+            if (!copy_string(u, length, distance)) return false;
+        }
+    }
+}
+
+// 解压一个非固实文件的RAR5数据，解出的内容交给output；
+// 干净地解到最后一个块且大小正确返回OK，split表示数据延续到下一卷，读完本卷没有错误即为OK
+zip_verify_result_t rar5_unpack(const uint8_t *data, size_t size, uint64_t comp_info, uint64_t unpacked_size,
+                                bool split, rar_output_fn output, void *opaque) {
+    uint8_t version = (uint8_t)(comp_info & RAR5_ALGO_VERSION_MASK);
+    if (version > 1 || (comp_info & RAR5_COMP_SOLID)) {
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+
+    // 字典大小：128KB << N，版本1还有1/32为单位的小数部分，这里只取上界
+    unsigned shift = (unsigned)(comp_info >> 10) & (version ? 31 : 15);
+    uint64_t dict = ((uint64_t)0x20000 << shift) * (version ? 2 : 1);
+    uint64_t need = dict > RAR5_FILTER_WINDOW ? dict : RAR5_FILTER_WINDOW;
+    if (unpacked_size < need) need = unpacked_size;
+    uint64_t window = RAR5_MIN_WINDOW;
+    while (window < need + 2 * RAR5_MAX_MATCH && window <= RAR5_MAX_WINDOW) {
+        window <<= 1;
+    }
+    if (window > RAR5_MAX_WINDOW) {
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+
+    rar5_unpack_t *u = calloc(1, sizeof(rar5_unpack_t));
+    if (!u) return ZIP_VERIFY_UNSUPPORTED;
+    u->window = malloc((size_t)window);
+    u->filters = malloc(RAR5_MAX_FILTERS * sizeof(rar5_filter_t));
+    if (!u->window || !u->filters) {
+        free(u->window);
+        free(u->filters);
+        free(u);
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+    u->mask = window - 1;
+    u->output = output;
+    u->opaque = opaque;
+
+    bit_reader_t br = { data, size, 0, false };
+    bool truncated = false;
+    bool ok = decode_stream(&br, u, version ? RAR5_DC_EXT : RAR5_DC, unpacked_size, &truncated);
+    zip_verify_result_t result = ZIP_VERIFY_FAIL;
+    if (ok && truncated) {
+        result = split ? ZIP_VERIFY_OK : ZIP_VERIFY_FAIL;
+    } else if (ok) {
+        flush_window(u);
+        bool sized = unpacked_size == UINT64_MAX || u->pos == unpacked_size;
+        result = sized && u->written == u->pos ? ZIP_VERIFY_OK : ZIP_VERIFY_FAIL;
+    }
+
+    free(u->filter_buf);
+    free(u->filters);
+    free(u->window);
+    free(u);
+    return result;
+}
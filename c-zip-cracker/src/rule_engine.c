@@ -0,0 +1,472 @@
+#include "../include/zip_cracker.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// 规则文件单行的最大长度
+#define RULE_LINE_SIZE 1024
+// 一条规则最多的操作数
+#define RULE_MAX_OPS 256
+
+// 操作的参数类型：N为位置（0-9A-Z），X/Y为字符；不支持的操作返回NULL
+static const char* rule_args(char op) {
+    switch (op) {
+        case 'l': case 'u': case 'c': case 'C': case 't': case 'r': case 'd': case 'f':
+        case '{': case '}': case '[': case ']': case 'q': case 'k': case 'K': case 'E':
+            return "";
+        case 'T': case 'p': case 'D': case '\'': case 'z': case 'Z': case 'L': case 'R':
+        case '+': case '-': case '.': case ',': case 'y': case 'Y': case '<': case '>':
+        case '_':
+            return "N";
+        case '$': case '^': case '@': case 'e': case '!': case '/': case '(': case ')':
+            return "X";
+        case 'x': case 'O': case '*':
+            return "NN";
+        case 'i': case 'o': case '=': case '%': case '3':
+            return "NX";
+        case 's':
+            return "XX";
+        default:
+            return NULL;
+    }
+}
+
+// 位置参数：0-9表示0-9，A-Z表示10-35
+static int rule_position(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+    return -1;
+}
+
+// 把一条规则解析成指令追加到规则集，语法错误时返回false；空格和:是空操作
+static bool rule_set_add(rule_set_t *set, const char *rule, uint32_t *capacity) {
+    uint32_t start = set->offsets[set->count];
+    uint32_t n = start;
+
+    for (const char *p = rule; *p; p++) {
+        if (*p == ' ' || *p == ':') continue;
+
+        const char *args = rule_args(*p);
+        if (!args || n - start >= RULE_MAX_OPS) return false;
+
+        rule_insn_t insn = { (uint8_t)*p, 0, 0 };
+        for (int i = 0; args[i]; i++) {
+            char c = *++p;
+            if (c == '\0') return false;
+            int value = args[i] == 'N' ? rule_position(c) : (uint8_t)c;
+            if (value < 0) return false;
+            if (i == 0) {
+                insn.a = (uint8_t)value;
+            } else {
+                insn.b = (uint8_t)value;
+            }
+        }
+
+        if (n == *capacity) {
+            uint32_t grown = *capacity ? *capacity * 2 : 1024;
+            rule_insn_t *code = realloc(set->code, grown * sizeof(rule_insn_t));
+            if (!code) return false;
+            set->code = code;
+            *capacity = grown;
+        }
+        set->code[n++] = insn;
+    }
+
+    set->offsets[++set->count] = n;
+    return true;
+}
+
+// 读入规则文件：每行一条规则，忽略空行和#开头的注释，跳过无法解析的规则
+rule_set_t* rule_set_load(const char *rule_file) {
+    FILE *file = fopen(rule_file, "r");
+    if (!file) {
+        print_error("无法打开规则文件: %s", rule_file);
+        return NULL;
+    }
+
+    rule_set_t *set = calloc(1, sizeof(rule_set_t));
+    uint32_t offset_capacity = 1024;
+    uint32_t code_capacity = 0;
+    if (set) {
+        set->offsets = calloc(offset_capacity + 1, sizeof(uint32_t));
+    }
+    if (!set || !set->offsets) {
+        fclose(file);
+        rule_set_free(set);
+        return NULL;
+    }
+
+    char line[RULE_LINE_SIZE];
+    int line_number = 0;
+    uint32_t skipped = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        if (set->count == offset_capacity) {
+            uint32_t *offsets = realloc(set->offsets, (offset_capacity * 2 + 1) * sizeof(uint32_t));
+            if (!offsets) break;
+            set->offsets = offsets;
+            offset_capacity *= 2;
+        }
+        if (!rule_set_add(set, line, &code_capacity)) {
+            if (skipped++ < 10) {
+                print_error("规则文件第%d行无法解析，已跳过: %s", line_number, line);
+            }
+        }
+    }
+    fclose(file);
+
+    if (skipped > 10) {
+        print_error("共跳过 %u 条无法解析的规则", skipped);
+    }
+    if (set->count == 0) {
+        print_error("规则文件中没有可用的规则: %s", rule_file);
+        rule_set_free(set);
+        return NULL;
+    }
+    return set;
+}
+
+// 翻转大小写：upper为真时把小写转成大写，lower为真时把大写转成小写；SSE2一次处理16字节
+static void flip_case(char *buf, size_t len, bool upper, bool lower) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i bit = _mm_set1_epi8(0x20);
+    const __m128i a = _mm_set1_epi8('a' - 1), z = _mm_set1_epi8('z' + 1);
+    const __m128i A = _mm_set1_epi8('A' - 1), Z = _mm_set1_epi8('Z' + 1);
+    const __m128i want_upper = _mm_set1_epi8(upper ? -1 : 0);
+    const __m128i want_lower = _mm_set1_epi8(lower ? -1 : 0);
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        __m128i is_lower = _mm_and_si128(_mm_cmpgt_epi8(v, a), _mm_cmplt_epi8(v, z));
+        __m128i is_upper = _mm_and_si128(_mm_cmpgt_epi8(v, A), _mm_cmplt_epi8(v, Z));
+        __m128i flip = _mm_or_si128(_mm_and_si128(is_lower, want_upper), _mm_and_si128(is_upper, want_lower));
+        _mm_storeu_si128((__m128i *)(buf + i), _mm_xor_si128(v, _mm_and_si128(flip, bit)));
+    }
+#endif
+    for (; i < len; i++) {
+        if ((upper && buf[i] >= 'a' && buf[i] <= 'z') || (lower && buf[i] >= 'A' && buf[i] <= 'Z')) {
+            buf[i] ^= 0x20;
+        }
+    }
+}
+
+// 把所有from替换成to；SSE2一次处理16字节
+static void replace_all(char *buf, size_t len, char from, char to) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i vfrom = _mm_set1_epi8(from);
+    const __m128i vto = _mm_set1_epi8(to);
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        __m128i hit = _mm_cmpeq_epi8(v, vfrom);
+        v = _mm_or_si128(_mm_and_si128(hit, vto), _mm_andnot_si128(hit, v));
+        _mm_storeu_si128((__m128i *)(buf + i), v);
+    }
+#endif
+    for (; i < len; i++) {
+        if (buf[i] == from) buf[i] = to;
+    }
+}
+
+// 单个字符转大写
+static char to_upper(char c) {
+    return c >= 'a' && c <= 'z' ? (char)(c ^ 0x20) : c;
+}
+
+// 原地反转
+static void reverse(char *buf, size_t len) {
+    for (size_t i = 0, j = len; i + 1 < j; i++, j--) {
+        char c = buf[i];
+        buf[i] = buf[j - 1];
+        buf[j - 1] = c;
+    }
+}
+
+// 统计字符出现的次数
+static size_t count_char(const char *buf, size_t len, char c) {
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++) {
+        count += buf[i] == c;
+    }
+    return count;
+}
+
+// 对一个基础词应用第index条规则，结果写进out（至少MAX_CANDIDATE_LENGTH + 1字节），
+// 返回结果长度，被拒绝规则过滤掉时返回-1。和hashcat一样，会超出最大长度的操作不生效
+int rule_apply(const rule_set_t *set, uint32_t index, const char *word, size_t len, char *out) {
+    const rule_insn_t *pc = set->code + set->offsets[index];
+    const rule_insn_t *end = set->code + set->offsets[index + 1];
+    const size_t max = MAX_CANDIDATE_LENGTH;
+
+    if (len > max) return -1;
+    memcpy(out, word, len);
+    size_t n = len;
+
+    for (; pc < end; pc++) {
+        size_t a = pc->a;
+        size_t b = pc->b;
+        char x = (char)pc->a;
+
+        switch (pc->op) {
+            case 'l':
+                flip_case(out, n, false, true);
+                break;
+            case 'u':
+                flip_case(out, n, true, false);
+                break;
+            case 'c':
+                flip_case(out, n, false, true);
+                if (n > 0) out[0] = to_upper(out[0]);
+                break;
+            case 'C':
+                flip_case(out, n, true, false);
+                if (n > 0 && out[0] >= 'A' && out[0] <= 'Z') out[0] ^= 0x20;
+                break;
+            case 't':
+                flip_case(out, n, true, true);
+                break;
+            case 'T':
+                if (a < n) flip_case(out + a, 1, true, true);
+                break;
+            case '3': {
+                // 和hashcat一样：第N个X之后第一个不是X的字符切换大小写
+                size_t seen = 0;
+                bool toggle_next = false;
+                for (size_t i = 0; i < n; i++) {
+                    if (out[i] == (char)b) {
+                        if (seen == a) {
+                            toggle_next = true;
+                        } else {
+                            seen++;
+                        }
+                        continue;
+                    }
+                    if (toggle_next) {
+                        flip_case(out + i, 1, true, true);
+                        break;
+                    }
+                }
+                break;
+            }
+            case 'E':
+            case 'e': {
+                char separator = pc->op == 'E' ? ' ' : x;
+                flip_case(out, n, false, true);
+                for (size_t i = 0; i < n; i++) {
+                    if (i == 0 || out[i - 1] == separator) out[i] = to_upper(out[i]);
+                }
+                break;
+            }
+            case 'r':
+                reverse(out, n);
+                break;
+            case 'd':
+                if (n * 2 <= max) {
+                    memcpy(out + n, out, n);
+                    n *= 2;
+                }
+                break;
+            case 'p':
+                if (n * (a + 1) <= max) {
+                    for (size_t i = 0; i < a; i++) {
+                        memcpy(out + n * (i + 1), out, n);
+                    }
+                    n *= a + 1;
+                }
+                break;
+            case 'f':
+                if (n * 2 <= max) {
+                    memcpy(out + n, out, n);
+                    reverse(out + n, n);
+                    n *= 2;
+                }
+                break;
+            case '{':
+                if (n > 1) {
+                    char c = out[0];
+                    memmove(out, out + 1, n - 1);
+                    out[n - 1] = c;
+                }
+                break;
+            case '}':
+                if (n > 1) {
+                    char c = out[n - 1];
+                    memmove(out + 1, out, n - 1);
+                    out[0] = c;
+                }
+                break;
+            case '$':
+                if (n < max) out[n++] = x;
+                break;
+            case '^':
+                if (n < max) {
+                    memmove(out + 1, out, n);
+                    out[0] = x;
+                    n++;
+                }
+                break;
+            case '[':
+                if (n > 0) memmove(out, out + 1, --n);
+                break;
+            case ']':
+                if (n > 0) n--;
+                break;
+            case 'D':
+                if (a < n) {
+                    memmove(out + a, out + a + 1, n - a - 1);
+                    n--;
+                }
+                break;
+            case 'x':
+                if (a + b <= n) {
+                    memmove(out, out + a, b);
+                    n = b;
+                }
+                break;
+            case 'O':
+                if (a + b <= n) {
+                    memmove(out + a, out + a + b, n - a - b);
+                    n -= b;
+                }
+                break;
+            case 'i':
+                if (a <= n && n < max) {
+                    memmove(out + a + 1, out + a, n - a);
+                    out[a] = (char)b;
+                    n++;
+                }
+                break;
+            case 'o':
+                if (a < n) out[a] = (char)b;
+                break;
+            case '\'':
+                if (a < n) n = a;
+                break;
+            case 's':
+                replace_all(out, n, x, (char)b);
+                break;
+            case '@': {
+                size_t kept = 0;
+                for (size_t i = 0; i < n; i++) {
+                    if (out[i] != x) out[kept++] = out[i];
+                }
+                n = kept;
+                break;
+            }
+            case 'z':
+                if (n > 0 && n + a <= max) {
+                    memmove(out + a, out, n);
+                    memset(out, out[a], a);
+                    n += a;
+                }
+                break;
+            case 'Z':
+                if (n > 0 && n + a <= max) {
+                    memset(out + n, out[n - 1], a);
+                    n += a;
+                }
+                break;
+            case 'q':
+                if (n * 2 <= max) {
+                    for (size_t i = n; i-- > 0; ) {
+                        out[2 * i] = out[2 * i + 1] = out[i];
+                    }
+                    n *= 2;
+                }
+                break;
+            case 'y':
+                if (a <= n && n + a <= max) {
+                    memmove(out + a, out, n);
+                    n += a;
+                }
+                break;
+            case 'Y':
+                if (a <= n && n + a <= max) {
+                    memcpy(out + n, out + n - a, a);
+                    n += a;
+                }
+                break;
+            case 'k':
+                if (n > 1) {
+                    char c = out[0];
+                    out[0] = out[1];
+                    out[1] = c;
+                }
+                break;
+            case 'K':
+                if (n > 1) {
+                    char c = out[n - 1];
+                    out[n - 1] = out[n - 2];
+                    out[n - 2] = c;
+                }
+                break;
+            case '*':
+                if (a < n && b < n) {
+                    char c = out[a];
+                    out[a] = out[b];
+                    out[b] = c;
+                }
+                break;
+            case 'L':
+                if (a < n) out[a] = (char)((uint8_t)out[a] << 1);
+                break;
+            case 'R':
+                if (a < n) out[a] = (char)((uint8_t)out[a] >> 1);
+                break;
+            case '+':
+                if (a < n) out[a]++;
+                break;
+            case '-':
+                if (a < n) out[a]--;
+                break;
+            case '.':
+                if (a + 1 < n) out[a] = out[a + 1];
+                break;
+            case ',':
+                if (a >= 1 && a < n) out[a] = out[a - 1];
+                break;
+            // 拒绝规则：不满足条件的候选整个丢弃
+            case '<':
+                if (n > a) return -1;
+                break;
+            case '>':
+                if (n < a) return -1;
+                break;
+            case '_':
+                if (n != a) return -1;
+                break;
+            case '!':
+                if (memchr(out, x, n)) return -1;
+                break;
+            case '/':
+                if (!memchr(out, x, n)) return -1;
+                break;
+            case '(':
+                if (n == 0 || out[0] != x) return -1;
+                break;
+            case ')':
+                if (n == 0 || out[n - 1] != x) return -1;
+                break;
+            case '=':
+                if (a >= n || out[a] != (char)b) return -1;
+                break;
+            case '%':
+                if (count_char(out, n, (char)b) < a) return -1;
+                break;
+            default:
+                break;
+        }
+    }
+    return (int)n;
+}
+
+// 释放规则集
+void rule_set_free(rule_set_t *set) {
+    if (!set) return;
+    free(set->code);
+    free(set->offsets);
+    free(set);
+}
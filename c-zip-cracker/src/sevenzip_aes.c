@@ -0,0 +1,1339 @@
+#include "../include/zip_cracker.h"
+#include <zlib.h>
+#include <lzma.h>
+#include <openssl/evp.h>
+
+// 7z签名头
+#define SZ_SIGNATURE_SIZE   6
+#define SZ_START_HEADER_SIZE 32
+
+// 头部属性ID
+#define SZ_ID_END                0x00
+#define SZ_ID_HEADER             0x01
+#define SZ_ID_ARCHIVE_PROPERTIES 0x02
+#define SZ_ID_ADDITIONAL_STREAMS 0x03
+#define SZ_ID_MAIN_STREAMS       0x04
+#define SZ_ID_FILES_INFO         0x05
+#define SZ_ID_PACK_INFO          0x06
+#define SZ_ID_UNPACK_INFO        0x07
+#define SZ_ID_SUBSTREAMS_INFO    0x08
+#define SZ_ID_SIZE               0x09
+#define SZ_ID_CRC                0x0A
+#define SZ_ID_FOLDER             0x0B
+#define SZ_ID_CODERS_UNPACK_SIZE 0x0C
+#define SZ_ID_NUM_UNPACK_STREAM  0x0D
+#define SZ_ID_EMPTY_STREAM       0x0E
+#define SZ_ID_EMPTY_FILE         0x0F
+#define SZ_ID_NAME               0x11
+#define SZ_ID_ENCODED_HEADER     0x17
+
+// 解析限制
+#define SZ_MAX_CODERS      4
+#define SZ_MAX_PROPS       64
+#define SZ_MAX_FOLDERS     65536
+#define SZ_MAX_HEADER_SIZE (64u << 20)
+
+// 7zAES密钥派生
+#define SZ_AES_BLOCK     16
+#define SZ_KEY_SIZE      32
+#define SZ_MAX_UNIT      (16 + MAX_PASSWORD_UTF16_BYTES + 8)
+
+// 流式验证的缓冲区大小
+#define SZ_IN_CHUNK  4096
+#define SZ_OUT_CHUNK 16384
+#define SZ_MIN_DICT_SIZE 4096
+
+static const uint8_t sz_signature[SZ_SIGNATURE_SIZE] = { '7', 'z', 0xBC, 0xAF, 0x27, 0x1C };
+
+static const uint8_t coder_aes[] = { 0x06, 0xF1, 0x07, 0x01 };
+static const uint8_t coder_lzma[] = { 0x03, 0x01, 0x01 };
+static const uint8_t coder_lzma2[] = { 0x21 };
+static const uint8_t coder_copy[] = { 0x00 };
+
+// 头部字节流读取器
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+    bool error;
+} sz_reader_t;
+
+// 文件夹中的一个编码器
+typedef struct {
+    uint8_t id[15];
+    uint8_t id_len;
+    uint32_t num_in;
+    uint32_t num_out;
+    uint8_t props[SZ_MAX_PROPS];
+    uint32_t props_len;
+} sz_coder_t;
+
+// 文件夹（一组串联的编码器）
+typedef struct {
+    sz_coder_t coders[SZ_MAX_CODERS];
+    uint32_t num_coders;
+    uint32_t bind_in[SZ_MAX_CODERS];
+    uint32_t bind_out[SZ_MAX_CODERS];
+    uint32_t num_bind_pairs;
+    uint32_t packed_in[SZ_MAX_CODERS];
+    uint32_t num_packed;
+    uint64_t unpack_sizes[SZ_MAX_CODERS];
+    uint32_t num_out_total;
+    bool has_crc;
+    uint32_t crc;
+    uint32_t first_pack_index;
+    uint64_t num_substreams;
+    uint64_t first_sub_size;
+    bool first_sub_has_crc;
+    uint32_t first_sub_crc;
+    bool supported;
+} sz_folder_t;
+
+// 数据流信息
+typedef struct {
+    uint64_t pack_pos;
+    uint64_t num_pack_streams;
+    uint64_t *pack_sizes;
+    uint32_t num_folders;
+    sz_folder_t *folders;
+    uint64_t *sub_sizes;         // 按文件夹顺序排列的全部子流大小
+    uint64_t num_sub_sizes;
+} sz_streams_t;
+
+// 小端读取
+static uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t read_le64(const uint8_t *p) {
+    return (uint64_t)read_le32(p) | ((uint64_t)read_le32(p + 4) << 32);
+}
+
+static uint8_t reader_byte(sz_reader_t *r) {
+    if (r->pos >= r->size) {
+        r->error = true;
+        return 0;
+    }
+    return r->data[r->pos++];
+}
+
+// 7z变长整数：第一个字节的高位1的个数表示后续字节数
+static uint64_t reader_number(sz_reader_t *r) {
+    uint8_t first = reader_byte(r);
+    uint8_t mask = 0x80;
+    uint64_t value = 0;
+
+    for (int i = 0; i < 8; i++) {
+        if ((first & mask) == 0) {
+            uint64_t high = first & (mask - 1);
+            return value + (high << (i * 8));
+        }
+        value |= (uint64_t)reader_byte(r) << (8 * i);
+        mask >>= 1;
+    }
+    return value;
+}
+
+static uint32_t reader_uint32(sz_reader_t *r) {
+    if (r->pos + 4 > r->size) {
+        r->error = true;
+        return 0;
+    }
+    uint32_t v = read_le32(r->data + r->pos);
+    r->pos += 4;
+    return v;
+}
+
+static void reader_skip(sz_reader_t *r, uint64_t n) {
+    if (n > r->size - r->pos) {
+        r->error = true;
+        return;
+    }
+    r->pos += (size_t)n;
+}
+
+// 读取位图（AllAreDefined为0时）
+static void reader_bits(sz_reader_t *r, uint64_t count, bool *bits) {
+    uint8_t all = reader_byte(r);
+    uint8_t mask = 0, byte = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        if (all) {
+            bits[i] = true;
+            continue;
+        }
+        if (mask == 0) {
+            byte = reader_byte(r);
+            mask = 0x80;
+        }
+        bits[i] = (byte & mask) != 0;
+        mask >>= 1;
+    }
+}
+
+static bool coder_is(const sz_coder_t *coder, const uint8_t *id, size_t len) {
+    return coder->id_len == len && memcmp(coder->id, id, len) == 0;
+}
+
+// 解析一个文件夹的编码器和绑定关系
+static void parse_folder(sz_reader_t *r, sz_folder_t *f) {
+    uint64_t num_coders = reader_number(r);
+    if (num_coders == 0 || num_coders > SZ_MAX_CODERS) {
+        r->error = true;
+        return;
+    }
+    f->num_coders = (uint32_t)num_coders;
+    f->supported = true;
+
+    uint32_t num_in_total = 0;
+    f->num_out_total = 0;
+    for (uint32_t i = 0; i < f->num_coders && !r->error; i++) {
+        sz_coder_t *c = &f->coders[i];
+        uint8_t flags = reader_byte(r);
+        c->id_len = flags & 0x0F;
+        for (uint8_t j = 0; j < c->id_len; j++) {
+            c->id[j] = reader_byte(r);
+        }
+
+        c->num_in = c->num_out = 1;
+        if (flags & 0x10) {
+            c->num_in = (uint32_t)reader_number(r);
+            c->num_out = (uint32_t)reader_number(r);
+            f->supported = false;
+        }
+        if (flags & 0x20) {
+            uint64_t len = reader_number(r);
+            if (len > SZ_MAX_PROPS) {
+                reader_skip(r, len);
+                f->supported = false;
+            } else {
+                c->props_len = (uint32_t)len;
+                for (uint32_t j = 0; j < c->props_len; j++) {
+                    c->props[j] = reader_byte(r);
+                }
+            }
+        }
+        if (flags & 0x80) {
+            r->error = true;
+            return;
+        }
+        num_in_total += c->num_in;
+        f->num_out_total += c->num_out;
+    }
+
+    if (f->num_out_total == 0 || f->num_out_total > SZ_MAX_CODERS || num_in_total > SZ_MAX_CODERS) {
+        r->error = true;
+        return;
+    }
+
+    f->num_bind_pairs = f->num_out_total - 1;
+    for (uint32_t i = 0; i < f->num_bind_pairs; i++) {
+        f->bind_in[i] = (uint32_t)reader_number(r);
+        f->bind_out[i] = (uint32_t)reader_number(r);
+    }
+
+    if (num_in_total < f->num_bind_pairs) {
+        r->error = true;
+        return;
+    }
+    f->num_packed = num_in_total - f->num_bind_pairs;
+    if (f->num_packed == 1) {
+        for (uint32_t i = 0; i < num_in_total; i++) {
+            bool bound = false;
+            for (uint32_t j = 0; j < f->num_bind_pairs; j++) {
+                if (f->bind_in[j] == i) bound = true;
+            }
+            if (!bound) {
+                f->packed_in[0] = i;
+                break;
+            }
+        }
+    } else {
+        for (uint32_t i = 0; i < f->num_packed; i++) {
+            f->packed_in[i] = (uint32_t)reader_number(r);
+        }
+        f->supported = false;
+    }
+}
+
+// 解析PackInfo
+static void parse_pack_info(sz_reader_t *r, sz_streams_t *s) {
+    s->pack_pos = reader_number(r);
+    s->num_pack_streams = reader_number(r);
+    if (s->num_pack_streams > SZ_MAX_FOLDERS * SZ_MAX_CODERS) {
+        r->error = true;
+        return;
+    }
+    s->pack_sizes = calloc(s->num_pack_streams ? s->num_pack_streams : 1, sizeof(uint64_t));
+    if (!s->pack_sizes) {
+        r->error = true;
+        return;
+    }
+
+    while (!r->error) {
+        uint8_t id = reader_byte(r);
+        if (id == SZ_ID_END) break;
+        if (id == SZ_ID_SIZE) {
+            for (uint64_t i = 0; i < s->num_pack_streams; i++) {
+                s->pack_sizes[i] = reader_number(r);
+            }
+        } else if (id == SZ_ID_CRC) {
+            bool *defined = calloc(s->num_pack_streams ? s->num_pack_streams : 1, sizeof(bool));
+            if (!defined) {
+                r->error = true;
+                return;
+            }
+            reader_bits(r, s->num_pack_streams, defined);
+            for (uint64_t i = 0; i < s->num_pack_streams; i++) {
+                if (defined[i]) reader_uint32(r);
+            }
+            free(defined);
+        } else {
+            reader_skip(r, reader_number(r));
+        }
+    }
+}
+
+// 解析UnpackInfo（文件夹列表、各输出流大小和CRC）
+static void parse_unpack_info(sz_reader_t *r, sz_streams_t *s) {
+    if (reader_byte(r) != SZ_ID_FOLDER) {
+        r->error = true;
+        return;
+    }
+    uint64_t num_folders = reader_number(r);
+    if (num_folders == 0 || num_folders > SZ_MAX_FOLDERS || reader_byte(r) != 0) {
+        r->error = true;
+        return;
+    }
+
+    s->num_folders = (uint32_t)num_folders;
+    s->folders = calloc(s->num_folders, sizeof(sz_folder_t));
+    if (!s->folders) {
+        r->error = true;
+        return;
+    }
+
+    uint32_t pack_index = 0;
+    for (uint32_t i = 0; i < s->num_folders && !r->error; i++) {
+        parse_folder(r, &s->folders[i]);
+        s->folders[i].first_pack_index = pack_index;
+        s->folders[i].num_substreams = 1;
+        pack_index += s->folders[i].num_packed;
+    }
+
+    if (reader_byte(r) != SZ_ID_CODERS_UNPACK_SIZE) {
+        r->error = true;
+        return;
+    }
+    for (uint32_t i = 0; i < s->num_folders && !r->error; i++) {
+        for (uint32_t j = 0; j < s->folders[i].num_out_total; j++) {
+            s->folders[i].unpack_sizes[j] = reader_number(r);
+        }
+    }
+
+    while (!r->error) {
+        uint8_t id = reader_byte(r);
+        if (id == SZ_ID_END) break;
+        if (id == SZ_ID_CRC) {
+            bool *defined = calloc(s->num_folders, sizeof(bool));
+            if (!defined) {
+                r->error = true;
+                return;
+            }
+            reader_bits(r, s->num_folders, defined);
+            for (uint32_t i = 0; i < s->num_folders; i++) {
+                s->folders[i].has_crc = defined[i];
+                if (defined[i]) s->folders[i].crc = reader_uint32(r);
+            }
+            free(defined);
+        } else {
+            reader_skip(r, reader_number(r));
+        }
+    }
+}
+
+// 文件夹最终输出流（没有被绑定的输出流）
+static uint32_t folder_main_out(const sz_folder_t *f) {
+    for (uint32_t i = 0; i < f->num_out_total; i++) {
+        bool bound = false;
+        for (uint32_t j = 0; j < f->num_bind_pairs; j++) {
+            if (f->bind_out[j] == i) bound = true;
+        }
+        if (!bound) return i;
+    }
+    return 0;
+}
+
+static uint64_t folder_unpack_size(const sz_folder_t *f) {
+    return f->unpack_sizes[folder_main_out(f)];
+}
+
+// 解析SubStreamsInfo：记录全部子流大小，CRC只保留每个文件夹第一个子流的
+static void parse_substreams_info(sz_reader_t *r, sz_streams_t *s) {
+    uint8_t id = reader_byte(r);
+
+    if (id == SZ_ID_NUM_UNPACK_STREAM) {
+        for (uint32_t i = 0; i < s->num_folders; i++) {
+            s->folders[i].num_substreams = reader_number(r);
+        }
+        id = reader_byte(r);
+    }
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < s->num_folders; i++) {
+        s->folders[i].first_sub_size = folder_unpack_size(&s->folders[i]);
+        total += s->folders[i].num_substreams;
+        if (total > SZ_MAX_HEADER_SIZE) {
+            r->error = true;
+            return;
+        }
+    }
+    s->sub_sizes = calloc(total ? total : 1, sizeof(uint64_t));
+    if (!s->sub_sizes) {
+        r->error = true;
+        return;
+    }
+    s->num_sub_sizes = total;
+
+    // 每个文件夹最后一个子流的大小不存储，由文件夹大小减去前面的子流得到
+    uint64_t k = 0;
+    for (uint32_t i = 0; i < s->num_folders && !r->error; i++) {
+        sz_folder_t *f = &s->folders[i];
+        uint64_t sum = 0;
+        for (uint64_t j = 1; j < f->num_substreams && id == SZ_ID_SIZE; j++) {
+            uint64_t size = reader_number(r);
+            if (j == 1) f->first_sub_size = size;
+            s->sub_sizes[k++] = size;
+            sum += size;
+        }
+        if (f->num_substreams > 0) {
+            uint64_t unpack = folder_unpack_size(f);
+            s->sub_sizes[k++] = unpack >= sum ? unpack - sum : 0;
+        }
+    }
+    if (id == SZ_ID_SIZE) {
+        id = reader_byte(r);
+    }
+
+    while (!r->error && id != SZ_ID_END) {
+        if (id == SZ_ID_CRC) {
+            // 只有一个子流且文件夹已有CRC的不再重复存储
+            uint64_t count = 0;
+            for (uint32_t i = 0; i < s->num_folders; i++) {
+                const sz_folder_t *f = &s->folders[i];
+                if (!(f->num_substreams == 1 && f->has_crc)) count += f->num_substreams;
+            }
+            if (count > SZ_MAX_HEADER_SIZE) {
+                r->error = true;
+                return;
+            }
+            bool *defined = calloc(count ? count : 1, sizeof(bool));
+            if (!defined) {
+                r->error = true;
+                return;
+            }
+            reader_bits(r, count, defined);
+
+            uint64_t k = 0;
+            for (uint32_t i = 0; i < s->num_folders; i++) {
+                sz_folder_t *f = &s->folders[i];
+                if (f->num_substreams == 1 && f->has_crc) {
+                    f->first_sub_has_crc = true;
+                    f->first_sub_crc = f->crc;
+                    continue;
+                }
+                for (uint64_t j = 0; j < f->num_substreams; j++, k++) {
+                    uint32_t crc = defined[k] ? reader_uint32(r) : 0;
+                    if (j == 0 && defined[k]) {
+                        f->first_sub_has_crc = true;
+                        f->first_sub_crc = crc;
+                    }
+                }
+            }
+            free(defined);
+        } else {
+            reader_skip(r, reader_number(r));
+        }
+        id = reader_byte(r);
+    }
+}
+
+// 解析StreamsInfo
+static void parse_streams_info(sz_reader_t *r, sz_streams_t *s) {
+    while (!r->error) {
+        uint8_t id = reader_byte(r);
+        if (id == SZ_ID_END) break;
+
+        if (id == SZ_ID_PACK_INFO) {
+            parse_pack_info(r, s);
+        } else if (id == SZ_ID_UNPACK_INFO) {
+            parse_unpack_info(r, s);
+        } else if (id == SZ_ID_SUBSTREAMS_INFO && s->folders) {
+            parse_substreams_info(r, s);
+        } else {
+            r->error = true;
+        }
+    }
+
+    // 只有一个子流时沿用文件夹的CRC
+    for (uint32_t i = 0; !r->error && i < s->num_folders; i++) {
+        sz_folder_t *f = &s->folders[i];
+        if (f->num_substreams == 1 && f->has_crc && !f->first_sub_has_crc) {
+            f->first_sub_has_crc = true;
+            f->first_sub_crc = f->crc;
+            f->first_sub_size = folder_unpack_size(f);
+        }
+    }
+}
+
+static void free_streams(sz_streams_t *s) {
+    free(s->pack_sizes);
+    free(s->folders);
+    free(s->sub_sizes);
+    memset(s, 0, sizeof(*s));
+}
+
+// 文件夹第一个打包流在文件中的偏移
+static uint64_t folder_pack_offset(const sz_streams_t *s, const sz_folder_t *f) {
+    uint64_t offset = SZ_START_HEADER_SIZE + s->pack_pos;
+    for (uint32_t i = 0; i < f->first_pack_index && i < s->num_pack_streams; i++) {
+        offset += s->pack_sizes[i];
+    }
+    return offset;
+}
+
+// 查找消费某个输出流的编码器
+static int coder_consuming(const sz_folder_t *f, uint32_t out_index) {
+    for (uint32_t j = 0; j < f->num_bind_pairs; j++) {
+        if (f->bind_out[j] == out_index) return (int)f->bind_in[j];
+    }
+    return -1;
+}
+
+static void set_next_coder(sevenzip_stream_t *st, const sz_coder_t *next) {
+    if (coder_is(next, coder_lzma, sizeof(coder_lzma)) && next->props_len == 5) {
+        st->next_coder = SZ_CODER_LZMA;
+    } else if (coder_is(next, coder_lzma2, sizeof(coder_lzma2)) && next->props_len == 1) {
+        st->next_coder = SZ_CODER_LZMA2;
+    } else if (coder_is(next, coder_copy, sizeof(coder_copy))) {
+        st->next_coder = SZ_CODER_COPY;
+    } else {
+        st->next_coder = SZ_CODER_OTHER;
+    }
+    st->coder_props_len = (uint8_t)(next->props_len <= sizeof(st->coder_props) ? next->props_len : 0);
+    memcpy(st->coder_props, next->props, st->coder_props_len);
+}
+
+// 解析AES编码器属性：循环次数、盐和IV
+static bool parse_aes_props(const sz_coder_t *aes, sevenzip_stream_t *st) {
+    if (aes->props_len < 1) return false;
+
+    uint8_t b0 = aes->props[0];
+    st->num_cycles_power = b0 & 0x3F;
+    memset(st->iv, 0, sizeof(st->iv));
+    st->salt_len = 0;
+
+    if ((b0 & 0xC0) == 0) {
+        return aes->props_len == 1;
+    }
+    if (aes->props_len < 2) return false;
+
+    uint8_t b1 = aes->props[1];
+    uint32_t salt_len = ((b0 >> 7) & 1) + (b1 >> 4);
+    uint32_t iv_len = ((b0 >> 6) & 1) + (b1 & 0x0F);
+    if (aes->props_len != 2 + salt_len + iv_len || salt_len > 16 || iv_len > 16) {
+        return false;
+    }
+
+    st->salt_len = (uint8_t)salt_len;
+    memcpy(st->salt, aes->props + 2, salt_len);
+    memcpy(st->iv, aes->props + 2 + salt_len, iv_len);
+    return st->num_cycles_power <= 24 || st->num_cycles_power == 0x3F;
+}
+
+// 从一个文件夹提取AES流参数，返回false表示文件夹没有AES编码器
+static bool folder_to_stream(const sz_streams_t *s, const sz_folder_t *f, sevenzip_stream_t *st) {
+    if (!f->supported || f->num_packed != 1) return false;
+
+    // 每个编码器都是单输入单输出，输入流编号等于编码器编号
+    uint32_t aes_index = f->packed_in[0];
+    if (aes_index >= f->num_coders || !coder_is(&f->coders[aes_index], coder_aes, sizeof(coder_aes))) {
+        return false;
+    }
+
+    memset(st, 0, sizeof(*st));
+    if (!parse_aes_props(&f->coders[aes_index], st)) return false;
+
+    uint64_t pack_index = f->first_pack_index;
+    if (pack_index >= s->num_pack_streams) return false;
+
+    st->pack_offset = folder_pack_offset(s, f);
+    st->pack_size = s->pack_sizes[pack_index];
+    st->aes_size = f->unpack_sizes[aes_index];
+    if (st->pack_size < SZ_AES_BLOCK || st->pack_size % SZ_AES_BLOCK != 0 || st->aes_size > st->pack_size) {
+        return false;
+    }
+
+    int next = coder_consuming(f, aes_index);
+    if (next < 0) {
+        // AES直接输出（理论上不会出现）
+        st->next_coder = SZ_CODER_COPY;
+        st->direct = true;
+    } else {
+        set_next_coder(st, &f->coders[next]);
+        st->direct = coder_consuming(f, (uint32_t)next) < 0 && st->next_coder != SZ_CODER_OTHER;
+    }
+
+    st->unpack_size = folder_unpack_size(f);
+    if (f->first_sub_has_crc) {
+        st->has_crc = true;
+        st->check_crc = f->first_sub_crc;
+        st->check_size = f->first_sub_size;
+    } else if (f->has_crc) {
+        st->has_crc = true;
+        st->check_crc = f->crc;
+        st->check_size = st->unpack_size;
+    }
+    return true;
+}
+
+// 压缩头所在文件夹的打包流大小，超出限制或不是单个编码器时返回false
+static bool plain_folder_pack_size(const sz_streams_t *s, const sz_folder_t *f, uint64_t *pack_size) {
+    if (!f->supported || f->num_coders != 1 || f->first_pack_index >= s->num_pack_streams) {
+        return false;
+    }
+    *pack_size = s->pack_sizes[f->first_pack_index];
+    return *pack_size <= SZ_MAX_HEADER_SIZE && folder_unpack_size(f) <= SZ_MAX_HEADER_SIZE;
+}
+
+// 解码未加密的文件夹（压缩的头），只支持单个LZMA/LZMA2/Copy编码器；
+// packed是已读入的完整打包流
+static uint8_t* decode_plain_folder(const uint8_t *packed, const sz_streams_t *s, const sz_folder_t *f,
+                                    size_t *out_len) {
+    uint64_t pack_size;
+    if (!plain_folder_pack_size(s, f, &pack_size)) {
+        return NULL;
+    }
+
+    uint64_t unpack_size = folder_unpack_size(f);
+    uint8_t *out = malloc(unpack_size ? unpack_size : 1);
+    if (!out) {
+        return NULL;
+    }
+
+    const sz_coder_t *c = &f->coders[0];
+    bool ok = false;
+    if (coder_is(c, coder_copy, sizeof(coder_copy))) {
+        ok = pack_size >= unpack_size;
+        if (ok) memcpy(out, packed, unpack_size);
+    } else {
+        lzma_filter filters[2];
+        filters[0].id = coder_is(c, coder_lzma2, sizeof(coder_lzma2)) ? LZMA_FILTER_LZMA2 : LZMA_FILTER_LZMA1;
+        filters[0].options = NULL;
+        filters[1].id = LZMA_VLI_UNKNOWN;
+
+        if ((coder_is(c, coder_lzma, sizeof(coder_lzma)) || coder_is(c, coder_lzma2, sizeof(coder_lzma2))) &&
+            lzma_properties_decode(&filters[0], NULL, c->props, c->props_len) == LZMA_OK) {
+            lzma_stream lz = LZMA_STREAM_INIT;
+            if (lzma_raw_decoder(&lz, filters) == LZMA_OK) {
+                lz.next_in = packed;
+                lz.avail_in = pack_size;
+                lz.next_out = out;
+                lz.avail_out = unpack_size;
+                lzma_ret ret = lzma_code(&lz, LZMA_RUN);
+                ok = (ret == LZMA_OK || ret == LZMA_STREAM_END) && lz.avail_out == 0;
+                lzma_end(&lz);
+            }
+            free(filters[0].options);
+        }
+    }
+
+    if (ok && f->has_crc && (uint32_t)crc32(0, out, (uInt)unpack_size) != f->crc) {
+        ok = false;
+    }
+    if (!ok) {
+        free(out);
+        return NULL;
+    }
+    *out_len = (size_t)unpack_size;
+    return out;
+}
+
+// 选择验证代价最低的加密文件夹：可原生验证的优先，其次按打包大小
+static bool pick_folder(const sz_streams_t *s, sevenzip_stream_t *best) {
+    bool found = false;
+    for (uint32_t i = 0; i < s->num_folders; i++) {
+        sevenzip_stream_t st;
+        if (!folder_to_stream(s, &s->folders[i], &st)) continue;
+
+        bool better = !found ||
+                      (st.direct && st.has_crc) > (best->direct && best->has_crc) ||
+                      ((st.direct && st.has_crc) == (best->direct && best->has_crc) &&
+                       st.pack_size < best->pack_size);
+        if (better) {
+            *best = st;
+            found = true;
+        }
+    }
+    return found;
+}
+
+// 在主头中找到MainStreamsInfo；成功时读取位置停在FilesInfo（如果有）之前
+static bool parse_main_header(sz_reader_t *r, sz_streams_t *s) {
+    if (reader_byte(r) != SZ_ID_HEADER) return false;
+
+    while (!r->error) {
+        uint8_t id = reader_byte(r);
+        if (id == SZ_ID_END) break;
+        if (id == SZ_ID_FILES_INFO) {
+            // 只有空文件和目录的压缩包没有MainStreamsInfo
+            r->pos--;
+            return true;
+        }
+
+        if (id == SZ_ID_ARCHIVE_PROPERTIES) {
+            while (!r->error) {
+                uint8_t type = reader_byte(r);
+                if (type == 0) break;
+                reader_skip(r, reader_number(r));
+            }
+        } else if (id == SZ_ID_ADDITIONAL_STREAMS) {
+            sz_streams_t extra;
+            memset(&extra, 0, sizeof(extra));
+            parse_streams_info(r, &extra);
+            free_streams(&extra);
+        } else if (id == SZ_ID_MAIN_STREAMS) {
+            parse_streams_info(r, s);
+            return !r->error;
+        } else {
+            return false;
+        }
+    }
+    return false;
+}
+
+// 从映像中缓存第一个块和最后两个块的密文
+static bool load_blocks(const archive_image_t *image, sevenzip_stream_t *st) {
+    if (st->pack_offset > image->size || st->pack_size > image->size - st->pack_offset ||
+        st->pack_size < SZ_AES_BLOCK) {
+        return false;
+    }
+    const uint8_t *pack = image->data + st->pack_offset;
+    memcpy(st->first_block, pack, SZ_AES_BLOCK);
+    if (st->pack_size >= 2 * SZ_AES_BLOCK) {
+        memcpy(st->last_blocks, pack + st->pack_size - 2 * SZ_AES_BLOCK, 2 * SZ_AES_BLOCK);
+        return true;
+    }
+    memcpy(st->last_blocks, st->iv, SZ_AES_BLOCK);
+    memcpy(st->last_blocks + SZ_AES_BLOCK, st->first_block, SZ_AES_BLOCK);
+    return true;
+}
+
+// 在压缩包模型的内存映像上解析7z头，找出验证代价最低的AES流（加密的头优先）
+sevenzip_ctx_t* sevenzip_load(const archive_info_t *info) {
+    if (!info || !info->image || info->type != ARCHIVE_7Z) return NULL;
+
+    const uint8_t *data = info->image->data;
+    size_t size = info->image->size;
+    if (size < SZ_START_HEADER_SIZE || memcmp(data, sz_signature, SZ_SIGNATURE_SIZE) != 0 ||
+        (uint32_t)crc32(0, data + 12, 20) != read_le32(data + 8)) {
+        return NULL;
+    }
+
+    uint64_t next_offset = read_le64(data + 12);
+    uint64_t next_size = read_le64(data + 20);
+    if (next_size == 0 || next_size > SZ_MAX_HEADER_SIZE ||
+        next_offset > size - SZ_START_HEADER_SIZE || next_size > size - SZ_START_HEADER_SIZE - next_offset) {
+        return NULL;
+    }
+
+    const uint8_t *header = data + SZ_START_HEADER_SIZE + next_offset;
+    size_t header_size = (size_t)next_size;
+    if ((uint32_t)crc32(0, header, (uInt)header_size) != read_le32(data + 28)) {
+        return NULL;
+    }
+
+    sevenzip_stream_t stream;
+    bool found = false;
+    uint8_t *decoded = NULL;
+
+    // 压缩（可能加密）的头：最多解开一层
+    if (header[0] == SZ_ID_ENCODED_HEADER) {
+        sz_reader_t r = { header, header_size, 1, false };
+        sz_streams_t s;
+        memset(&s, 0, sizeof(s));
+        parse_streams_info(&r, &s);
+
+        if (!r.error && s.num_folders > 0) {
+            if (folder_to_stream(&s, &s.folders[0], &stream)) {
+                stream.is_header = true;
+                found = true;
+            } else {
+                size_t decoded_len = 0;
+                uint64_t pack_size;
+                uint64_t offset = folder_pack_offset(&s, &s.folders[0]);
+                if (plain_folder_pack_size(&s, &s.folders[0], &pack_size) && offset <= size &&
+                    pack_size <= size - offset) {
+                    decoded = decode_plain_folder(data + offset, &s, &s.folders[0], &decoded_len);
+                }
+                header = decoded;
+                header_size = decoded_len;
+            }
+        }
+        free_streams(&s);
+    }
+
+    if (!found && header && header_size > 0 && header[0] == SZ_ID_HEADER) {
+        sz_reader_t r = { header, header_size, 0, false };
+        sz_streams_t s;
+        memset(&s, 0, sizeof(s));
+        if (parse_main_header(&r, &s)) {
+            found = pick_folder(&s, &stream);
+        }
+        free_streams(&s);
+    }
+    free(decoded);
+
+    if (!found || !load_blocks(info->image, &stream)) {
+        return NULL;
+    }
+
+    sevenzip_ctx_t *ctx = calloc(1, sizeof(sevenzip_ctx_t));
+    if (!ctx) return NULL;
+    ctx->stream = stream;
+    ctx->kernel = zip_crypto_select_kernel();
+    ctx->image = info->image;
+    return ctx;
+}
+
+// 读取不带AllAreDefined前缀的位图（kEmptyStream/kEmptyFile）
+static uint64_t reader_raw_bits(sz_reader_t *r, uint64_t count, bool *bits) {
+    uint8_t mask = 0, byte = 0;
+    uint64_t set = 0;
+    for (uint64_t i = 0; i < count && !r->error; i++) {
+        if (mask == 0) {
+            byte = reader_byte(r);
+            mask = 0x80;
+        }
+        bits[i] = (byte & mask) != 0;
+        set += bits[i];
+        mask >>= 1;
+    }
+    return set;
+}
+
+// 把以0结尾的UTF-16LE文件名转换为UTF-8，consumed返回占用的字节数（含结尾）
+static char* utf16le_name(const uint8_t *p, size_t len, size_t *consumed) {
+    char *name = malloc(len / 2 * 3 + 1);
+    if (!name) return NULL;
+
+    size_t pos = 0, n = 0;
+    while (pos + 2 <= len) {
+        uint32_t c = (uint32_t)p[pos] | ((uint32_t)p[pos + 1] << 8);
+        pos += 2;
+        if (c == 0) break;
+        if (c >= 0xD800 && c < 0xDC00 && pos + 2 <= len) {
+            uint32_t low = (uint32_t)p[pos] | ((uint32_t)p[pos + 1] << 8);
+            if (low >= 0xDC00 && low < 0xE000) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                pos += 2;
+            }
+        }
+        if (c < 0x80) {
+            name[n++] = (char)c;
+        } else if (c < 0x800) {
+            name[n++] = (char)(0xC0 | (c >> 6));
+            name[n++] = (char)(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            name[n++] = (char)(0xE0 | (c >> 12));
+            name[n++] = (char)(0x80 | ((c >> 6) & 0x3F));
+            name[n++] = (char)(0x80 | (c & 0x3F));
+        } else {
+            name[n++] = (char)(0xF0 | (c >> 18));
+            name[n++] = (char)(0x80 | ((c >> 12) & 0x3F));
+            name[n++] = (char)(0x80 | ((c >> 6) & 0x3F));
+            name[n++] = (char)(0x80 | (c & 0x3F));
+        }
+    }
+    name[n] = '\0';
+    *consumed = pos;
+    return name;
+}
+
+// 文件夹中任意位置的AES编码器参数，没有AES时返回false
+static bool folder_aes(const sz_folder_t *f, sevenzip_stream_t *st) {
+    for (uint32_t i = 0; i < f->num_coders; i++) {
+        if (coder_is(&f->coders[i], coder_aes, sizeof(coder_aes))) {
+            memset(st, 0, sizeof(*st));
+            parse_aes_props(&f->coders[i], st);
+            return true;
+        }
+    }
+    return false;
+}
+
+// 解析FilesInfo：文件名、空流位图，按顺序把非空文件对应到各文件夹的子流
+static bool parse_files_info(sz_reader_t *r, const sz_streams_t *s, archive_info_t *info) {
+    if (reader_byte(r) != SZ_ID_FILES_INFO) return false;
+
+    uint64_t num_files = reader_number(r);
+    if (r->error || num_files > r->size) return false;
+
+    bool *empty_stream = calloc(num_files ? num_files : 1, sizeof(bool));
+    if (!empty_stream) return false;
+
+    const uint8_t *names = NULL;
+    size_t names_len = 0;
+    while (!r->error) {
+        uint8_t type = reader_byte(r);
+        if (type == SZ_ID_END) break;
+
+        uint64_t size = reader_number(r);
+        if (r->error || size > r->size - r->pos) {
+            r->error = true;
+            break;
+        }
+        size_t end = r->pos + (size_t)size;
+        if (type == SZ_ID_EMPTY_STREAM) {
+            reader_raw_bits(r, num_files, empty_stream);
+        } else if (type == SZ_ID_NAME && size > 0 && r->data[r->pos] == 0) {
+            names = r->data + r->pos + 1;
+            names_len = (size_t)size - 1;
+        }
+        r->pos = end;
+    }
+
+    uint32_t folder = 0;
+    uint64_t left = s->num_folders > 0 ? s->folders[0].num_substreams : 0;
+    uint64_t sub = 0;
+    for (uint64_t i = 0; i < num_files && !r->error; i++) {
+        file_entry_t *entry = archive_info_add_entry(info);
+        if (!entry) {
+            r->error = true;
+            break;
+        }
+
+        if (names) {
+            size_t used = 0;
+            entry->filename = utf16le_name(names, names_len, &used);
+            names += used;
+            names_len -= used;
+        } else {
+            entry->filename = strdup("");
+        }
+        if (empty_stream[i]) continue;
+
+        // 跳过没有子流的文件夹
+        while (left == 0 && ++folder < s->num_folders) {
+            left = s->folders[folder].num_substreams;
+        }
+        if (folder >= s->num_folders) {
+            r->error = true;
+            break;
+        }
+
+        const sz_folder_t *f = &s->folders[folder];
+        entry->uncompressed_size = s->sub_sizes ? s->sub_sizes[sub] : folder_unpack_size(f);
+        sub++;
+        left--;
+
+        sevenzip_stream_t st;
+        if (folder_aes(f, &st)) {
+            entry->is_encrypted = true;
+            entry->salt_len = st.salt_len;
+            memcpy(entry->salt, st.salt, st.salt_len);
+            info->is_encrypted = true;
+        }
+        info->total_size += entry->uncompressed_size;
+    }
+
+    free(empty_stream);
+    return !r->error;
+}
+
+// 只读签名头和尾部的头信息建立模型，不论数据区多大都只触及几KB；
+// 头被加密时只能得到加密状态和盐
+bool sevenzip_analyze(archive_info_t *info) {
+    const uint8_t *data = info->image->data;
+    size_t size = info->image->size;
+    if (size < SZ_START_HEADER_SIZE || memcmp(data, sz_signature, SZ_SIGNATURE_SIZE) != 0 ||
+        (uint32_t)crc32(0, data + 12, 20) != read_le32(data + 8)) {
+        return false;
+    }
+
+    uint64_t next_offset = read_le64(data + 12);
+    uint64_t next_size = read_le64(data + 20);
+    if (next_size == 0 || next_size > SZ_MAX_HEADER_SIZE ||
+        next_offset > size - SZ_START_HEADER_SIZE || next_size > size - SZ_START_HEADER_SIZE - next_offset) {
+        return false;
+    }
+
+    const uint8_t *header = data + SZ_START_HEADER_SIZE + next_offset;
+    size_t header_size = (size_t)next_size;
+    if ((uint32_t)crc32(0, header, (uInt)header_size) != read_le32(data + 28)) {
+        return false;
+    }
+
+    uint8_t *decoded = NULL;
+    if (header[0] == SZ_ID_ENCODED_HEADER) {
+        sz_reader_t r = { header, header_size, 1, false };
+        sz_streams_t s;
+        memset(&s, 0, sizeof(s));
+        parse_streams_info(&r, &s);
+
+        sevenzip_stream_t st;
+        uint64_t pack_size;
+        if (r.error || s.num_folders == 0) {
+            free_streams(&s);
+            return false;
+        }
+        if (folder_aes(&s.folders[0], &st)) {
+            info->is_encrypted = info->headers_encrypted = true;
+            info->header_salt_len = st.salt_len;
+            memcpy(info->header_salt, st.salt, st.salt_len);
+            free_streams(&s);
+            return true;
+        }
+
+        size_t decoded_len = 0;
+        uint64_t offset = folder_pack_offset(&s, &s.folders[0]);
+        if (plain_folder_pack_size(&s, &s.folders[0], &pack_size) && offset <= size && pack_size <= size - offset) {
+            decoded = decode_plain_folder(data + offset, &s, &s.folders[0], &decoded_len);
+        }
+        free_streams(&s);
+        if (!decoded) return false;
+        header = decoded;
+        header_size = decoded_len;
+    }
+
+    sz_reader_t r = { header, header_size, 0, false };
+    sz_streams_t s;
+    memset(&s, 0, sizeof(s));
+    bool ok = header_size > 0 && parse_main_header(&r, &s);
+    if (ok) {
+        for (uint32_t i = 0; i < s.num_folders; i++) {
+            sevenzip_stream_t st;
+            if (folder_aes(&s.folders[i], &st)) info->is_encrypted = true;
+        }
+        ok = r.pos == r.size || r.data[r.pos] == SZ_ID_END || parse_files_info(&r, &s, info);
+    }
+    free_streams(&s);
+    free(decoded);
+    return ok;
+}
+
+// 7zAES密钥派生：SHA-256(重复2^N次的 盐 || UTF-16LE密码 || 8字节计数器)
+// 同一组内的密码UTF-16长度相同，所有路的分块位置一致
+static void derive_keys(const sevenzip_stream_t *st, zip_crypto_kernel_t kernel, int lanes,
+                        const uint8_t pw16[][MAX_PASSWORD_UTF16_BYTES], size_t pw16_len,
+                        uint8_t keys[][SZ_KEY_SIZE]) {
+    if (st->num_cycles_power == 0x3F) {
+        for (int lane = 0; lane < lanes; lane++) {
+            memset(keys[lane], 0, SZ_KEY_SIZE);
+            size_t n = 0;
+            for (size_t i = 0; i < st->salt_len && n < SZ_KEY_SIZE; i++) keys[lane][n++] = st->salt[i];
+            for (size_t i = 0; i < pw16_len && n < SZ_KEY_SIZE; i++) keys[lane][n++] = pw16[lane][i];
+        }
+        return;
+    }
+
+    static __thread sha_lanes_t l;
+    sha_lanes_init(&l, SHA_ALGO_SHA256, kernel, lanes);
+
+    size_t unit_len = st->salt_len + pw16_len + 8;
+    uint8_t unit[SHA_MAX_LANES][SZ_MAX_UNIT];
+    const uint8_t *ptrs[SHA_MAX_LANES];
+    for (int lane = 0; lane < lanes; lane++) {
+        memcpy(unit[lane], st->salt, st->salt_len);
+        memcpy(unit[lane] + st->salt_len, pw16[lane], pw16_len);
+        memset(unit[lane] + st->salt_len + pw16_len, 0, 8);
+        ptrs[lane] = unit[lane];
+    }
+
+    uint64_t rounds = (uint64_t)1 << st->num_cycles_power;
+    for (uint64_t round = 0; round < rounds; round++) {
+        sha_lanes_update(&l, ptrs, unit_len);
+
+        // 小端计数器加一
+        uint8_t *counter = unit[0] + st->salt_len + pw16_len;
+        for (int i = 0; i < 8 && ++counter[i] == 0; i++) {
+        }
+        for (int lane = 1; lane < lanes; lane++) {
+            memcpy(unit[lane] + st->salt_len + pw16_len, counter, 8);
+        }
+    }
+    sha_lanes_final(&l, keys);
+}
+
+// AES-256-CBC解密单个块
+static bool decrypt_block(EVP_CIPHER_CTX *cipher, const uint8_t key[SZ_KEY_SIZE], const uint8_t *iv,
+                          const uint8_t *in, uint8_t *out) {
+    int out_len = 0;
+    return EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), NULL, key, iv) == 1 &&
+           EVP_CIPHER_CTX_set_padding(cipher, 0) == 1 &&
+           EVP_DecryptUpdate(cipher, out, &out_len, in, SZ_AES_BLOCK) == 1 &&
+           out_len == SZ_AES_BLOCK;
+}
+
+// 用派生出的密钥解密第一个块和最后一个块做结构检查
+static bool check_key(const sevenzip_stream_t *st, EVP_CIPHER_CTX *cipher, const uint8_t key[SZ_KEY_SIZE]) {
+    uint8_t plain[SZ_AES_BLOCK];
+    if (!decrypt_block(cipher, key, st->iv, st->first_block, plain)) {
+        return false;
+    }
+
+    switch (st->next_coder) {
+        case SZ_CODER_LZMA:
+            // LZMA区间编码器的第一个字节总是0
+            if (plain[0] != 0) return false;
+            break;
+        case SZ_CODER_LZMA2:
+            // 第一个块必须重置字典：未压缩块(1)或带属性的LZMA块(0xE0-0xFF)
+            if (plain[0] != 0x01 && plain[0] < 0xE0) return false;
+            if (plain[0] >= 0xE0 && plain[5] >= 225) return false;
+            break;
+        case SZ_CODER_COPY:
+            if (st->is_header && plain[0] != SZ_ID_HEADER) return false;
+            break;
+        default:
+            break;
+    }
+
+    // 最后一个块不足16字节的部分由7-Zip补零
+    size_t tail = (size_t)(st->aes_size % SZ_AES_BLOCK);
+    if (tail != 0 && st->aes_size + SZ_AES_BLOCK > st->pack_size) {
+        if (!decrypt_block(cipher, key, st->last_blocks, st->last_blocks + SZ_AES_BLOCK, plain)) {
+            return false;
+        }
+        for (size_t i = tail; i < SZ_AES_BLOCK; i++) {
+            if (plain[i] != 0) return false;
+        }
+    }
+    return true;
+}
+
+// 使用指定内核批量校验，按UTF-16长度分组填满各路
+static int check_batch_with_kernel(const sevenzip_ctx_t *ctx, zip_crypto_kernel_t kernel,
+                                   const char *const *passwords, const size_t *lens,
+                                   int count, bool *results) {
+    int lanes = sha_kernel_lanes(kernel);
+    static __thread uint8_t pw16[ZIP_CRYPTO_BATCH_SIZE][MAX_PASSWORD_UTF16_BYTES];
+    size_t pw16_len[ZIP_CRYPTO_BATCH_SIZE];
+    bool done[ZIP_CRYPTO_BATCH_SIZE];
+    int passed = 0;
+
+    if (count > ZIP_CRYPTO_BATCH_SIZE) {
+        count = ZIP_CRYPTO_BATCH_SIZE;
+    }
+    for (int i = 0; i < count; i++) {
+        pw16_len[i] = utf8_to_utf16le(passwords[i], lens[i], pw16[i], MAX_PASSWORD_UTF16_BYTES);
+        done[i] = false;
+        results[i] = false;
+    }
+
+    EVP_CIPHER_CTX *cipher = EVP_CIPHER_CTX_new();
+    if (!cipher) return 0;
+
+    for (int i = 0; i < count; i++) {
+        if (done[i]) continue;
+
+        // 收集与第i个密码等长的一组
+        int group[SHA_MAX_LANES];
+        int n = 0;
+        for (int j = i; j < count && n < lanes; j++) {
+            if (!done[j] && pw16_len[j] == pw16_len[i]) {
+                group[n++] = j;
+                done[j] = true;
+            }
+        }
+
+        uint8_t group_pw[SHA_MAX_LANES][MAX_PASSWORD_UTF16_BYTES];
+        uint8_t keys[SHA_MAX_LANES][SZ_KEY_SIZE];
+        for (int lane = 0; lane < lanes; lane++) {
+            memcpy(group_pw[lane], pw16[group[lane < n ? lane : 0]], pw16_len[i]);
+        }
+        derive_keys(&ctx->stream, kernel, lanes, (const uint8_t (*)[MAX_PASSWORD_UTF16_BYTES])group_pw,
+                    pw16_len[i], keys);
+
+        for (int lane = 0; lane < n; lane++) {
+            results[group[lane]] = check_key(&ctx->stream, cipher, keys[lane]);
+            if (results[group[lane]]) passed++;
+        }
+    }
+
+    EVP_CIPHER_CTX_free(cipher);
+    return passed;
+}
+
+// 批量校验密码，返回通过首块/填充检查的数量
+int sevenzip_check_batch(const sevenzip_ctx_t *ctx, const char *const *passwords,
+                         const size_t *lens, int count, bool *results) {
+    if (!ctx || !passwords || !lens || !results || count <= 0) {
+        return 0;
+    }
+    return check_batch_with_kernel(ctx, ctx->kernel, passwords, lens, count, results);
+}
+
+// 检查单个密码
+bool sevenzip_check_password(const sevenzip_ctx_t *ctx, const char *password, size_t len) {
+    bool result = false;
+    sevenzip_check_batch(ctx, &password, &len, 1, &result);
+    return result;
+}
+
+// 第二阶段验证：解密整个打包流并解码，比较第一个子流（或加密头）的CRC32
+zip_verify_result_t sevenzip_verify_password(const sevenzip_ctx_t *ctx, const char *password, size_t len) {
+    if (!ctx || !ctx->image || !password) {
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+
+    const sevenzip_stream_t *st = &ctx->stream;
+    if (!st->direct || !st->has_crc || st->check_size > st->unpack_size ||
+        st->pack_offset > ctx->image->size || st->pack_size > ctx->image->size - st->pack_offset) {
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+
+    uint8_t pw16[1][MAX_PASSWORD_UTF16_BYTES];
+    uint8_t key[1][SZ_KEY_SIZE];
+    size_t pw16_len = utf8_to_utf16le(password, len, pw16[0], MAX_PASSWORD_UTF16_BYTES);
+    derive_keys(st, ZC_KERNEL_SCALAR, 1, (const uint8_t (*)[MAX_PASSWORD_UTF16_BYTES])pw16, pw16_len, key);
+
+    EVP_CIPHER_CTX *cipher = EVP_CIPHER_CTX_new();
+    if (!cipher) return ZIP_VERIFY_UNSUPPORTED;
+    if (EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), NULL, key[0], st->iv) != 1 ||
+        EVP_CIPHER_CTX_set_padding(cipher, 0) != 1) {
+        EVP_CIPHER_CTX_free(cipher);
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+
+    lzma_stream lz = LZMA_STREAM_INIT;
+    bool use_lzma = st->next_coder == SZ_CODER_LZMA || st->next_coder == SZ_CODER_LZMA2;
+    if (use_lzma) {
+        lzma_filter filters[2];
+        filters[0].id = st->next_coder == SZ_CODER_LZMA2 ? LZMA_FILTER_LZMA2 : LZMA_FILTER_LZMA1;
+        filters[0].options = NULL;
+        filters[1].id = LZMA_VLI_UNKNOWN;
+        if (lzma_properties_decode(&filters[0], NULL, st->coder_props, st->coder_props_len) != LZMA_OK) {
+            EVP_CIPHER_CTX_free(cipher);
+            return ZIP_VERIFY_FAIL;
+        }
+
+        // 错误密码可能解出任意字典大小，按解压大小限制
+        lzma_options_lzma *opts = (lzma_options_lzma*)filters[0].options;
+        uint64_t dict_limit = st->unpack_size < SZ_MIN_DICT_SIZE ? SZ_MIN_DICT_SIZE : st->unpack_size;
+        if (opts->dict_size > dict_limit) {
+            opts->dict_size = (uint32_t)dict_limit;
+        }
+
+        lzma_ret ret = lzma_raw_decoder(&lz, filters);
+        free(filters[0].options);
+        if (ret != LZMA_OK) {
+            EVP_CIPHER_CTX_free(cipher);
+            return ZIP_VERIFY_FAIL;
+        }
+    }
+
+    uint8_t plain[SZ_IN_CHUNK];
+    uint8_t out[SZ_OUT_CHUNK];
+    uint64_t remaining = st->pack_size;
+    uint64_t plain_left = st->aes_size;
+    uint64_t need = st->check_size;
+    const uint8_t *in = ctx->image->data + st->pack_offset;
+    uint32_t crc = 0;
+    bool ok = true;
+
+    while (ok && need > 0 && remaining > 0) {
+        size_t want = remaining < SZ_IN_CHUNK ? (size_t)remaining : SZ_IN_CHUNK;
+        int plain_len = 0;
+        if (EVP_DecryptUpdate(cipher, plain, &plain_len, in, (int)want) != 1) {
+            ok = false;
+            break;
+        }
+        in += want;
+        remaining -= want;
+
+        size_t usable = (uint64_t)plain_len < plain_left ? (size_t)plain_len : (size_t)plain_left;
+        plain_left -= usable;
+
+        if (!use_lzma) {
+            size_t take = usable < need ? usable : (size_t)need;
+            crc = (uint32_t)crc32(crc, plain, (uInt)take);
+            need -= take;
+            continue;
+        }
+
+        lz.next_in = plain;
+        lz.avail_in = usable;
+        do {
+            lz.next_out = out;
+            lz.avail_out = sizeof(out);
+            lzma_ret ret = lzma_code(&lz, LZMA_RUN);
+            if (ret != LZMA_OK && ret != LZMA_STREAM_END) {
+                ok = false;
+                break;
+            }
+            size_t produced = sizeof(out) - lz.avail_out;
+            size_t take = produced < need ? produced : (size_t)need;
+            crc = (uint32_t)crc32(crc, out, (uInt)take);
+            need -= take;
+            if (ret == LZMA_STREAM_END) break;
+        } while (need > 0 && (lz.avail_in > 0 || lz.avail_out == 0));
+    }
+
+    if (use_lzma) {
+        lzma_end(&lz);
+    }
+    EVP_CIPHER_CTX_free(cipher);
+
+    if (!ok || need != 0 || crc != st->check_crc) {
+        return ZIP_VERIFY_FAIL;
+    }
+    return ZIP_VERIFY_OK;
+}
+
+// 测量每种内核的7zAES密钥派生吞吐量
+void sevenzip_benchmark(void) {
+    sevenzip_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.stream.num_cycles_power = 19;
+    ctx.stream.salt_len = 0;
+    ctx.stream.next_coder = SZ_CODER_LZMA;
+    ctx.stream.aes_size = ctx.stream.pack_size = 4 * SZ_AES_BLOCK;
+
+    const int batch = 16;
+    char storage[16][16];
+    const char *passwords[16];
+    size_t lens[16];
+    bool results[16];
+    for (int i = 0; i < batch; i++) {
+        snprintf(storage[i], sizeof(storage[i]), "%08d", i * 7919);
+        passwords[i] = storage[i];
+        lens[i] = 8;
+    }
+
+    print_info("7-Zip AES-256 校验吞吐量 (单线程, SHA-256 x2^%d):", ctx.stream.num_cycles_power);
+
+    zip_crypto_kernel_t kernels[] = {ZC_KERNEL_SCALAR, ZC_KERNEL_AVX2, ZC_KERNEL_AVX512};
+    zip_crypto_kernel_t best = zip_crypto_select_kernel();
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        if (kernels[k] > best) {
+            printf("  %-16s 不支持\n", zip_crypto_kernel_name(kernels[k]));
+            continue;
+        }
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        check_batch_with_kernel(&ctx, kernels[k], passwords, lens, batch, results);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("  %-16s %8.1f p/s\n", zip_crypto_kernel_name(kernels[k]), batch / elapsed);
+    }
+}
+
+// 释放7z上下文
+void sevenzip_free(sevenzip_ctx_t *ctx) {
+    if (!ctx) return;
+
+    free(ctx);
+}
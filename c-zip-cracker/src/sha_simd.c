@@ -0,0 +1,427 @@
+#include "../include/zip_cracker.h"
+#include <immintrin.h>
+
+#define SHA_BLOCK_SIZE 64
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t sha256_iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint32_t sha1_iv[5] = {
+    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+
+static const uint32_t sha1_k[4] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline uint32_t rotr32(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static inline uint32_t rotl32(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+// SHA-1压缩函数（单路，消息为大端字）
+void sha1_compress_words(uint32_t state[5], const uint32_t block[16], uint32_t tail[16]) {
+    uint32_t w[80];
+    memcpy(w, block, 16 * sizeof(uint32_t));
+    for (int t = 16; t < 80; t++) {
+        w[t] = rotl32(w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16], 1);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (int t = 0; t < 80; t++) {
+        uint32_t f;
+        if (t < 20) f = d ^ (b & (c ^ d));
+        else if (t < 40) f = b ^ c ^ d;
+        else if (t < 60) f = (b & c) | (d & (b | c));
+        else f = b ^ c ^ d;
+        uint32_t temp = rotl32(a, 5) + f + e + sha1_k[t / 20] + w[t];
+        e = d;
+        d = c;
+        c = rotl32(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d; state[4] += e;
+    if (tail) {
+        memcpy(tail, w + 64, 16 * sizeof(uint32_t));
+    }
+}
+
+// SHA-256压缩函数（单路，消息为大端字）
+static void sha256_compress(uint32_t state[8], const uint32_t block[16]) {
+    uint32_t w[64];
+    memcpy(w, block, 16 * sizeof(uint32_t));
+    for (int t = 16; t < 64; t++) {
+        uint32_t s0 = rotr32(w[t - 15], 7) ^ rotr32(w[t - 15], 18) ^ (w[t - 15] >> 3);
+        uint32_t s1 = rotr32(w[t - 2], 17) ^ rotr32(w[t - 2], 19) ^ (w[t - 2] >> 10);
+        w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int t = 0; t < 64; t++) {
+        uint32_t t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) +
+                      (g ^ (e & (f ^ g))) + sha256_k[t] + w[t];
+        uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) +
+                      ((a & b) | (c & (a | b)));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#define ROTL256(x, n) _mm256_or_si256(_mm256_slli_epi32((x), (n)), _mm256_srli_epi32((x), 32 - (n)))
+
+// AVX2多路SHA-1压缩：8个独立状态，完整的16字消息
+__attribute__((target("avx2")))
+static void sha1_compress_x8(uint32_t state[][SHA_MAX_LANES], const uint32_t words[16][SHA_MAX_LANES]) {
+    __m256i w[16];
+    for (int t = 0; t < 16; t++) {
+        w[t] = _mm256_loadu_si256((const __m256i*)words[t]);
+    }
+
+    __m256i a = _mm256_loadu_si256((const __m256i*)state[0]);
+    __m256i b = _mm256_loadu_si256((const __m256i*)state[1]);
+    __m256i c = _mm256_loadu_si256((const __m256i*)state[2]);
+    __m256i d = _mm256_loadu_si256((const __m256i*)state[3]);
+    __m256i e = _mm256_loadu_si256((const __m256i*)state[4]);
+    for (int t = 0; t < 80; t++) {
+        if (t >= 16) {
+            __m256i x = _mm256_xor_si256(_mm256_xor_si256(w[(t - 3) & 15], w[(t - 8) & 15]),
+                                         _mm256_xor_si256(w[(t - 14) & 15], w[t & 15]));
+            w[t & 15] = ROTL256(x, 1);
+        }
+
+        __m256i f;
+        if (t < 20) {
+            f = _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d)));
+        } else if (t < 40 || t >= 60) {
+            f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+        } else {
+            f = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(d, _mm256_or_si256(b, c)));
+        }
+        __m256i temp = _mm256_add_epi32(_mm256_add_epi32(ROTL256(a, 5), f),
+                                        _mm256_add_epi32(_mm256_add_epi32(e, _mm256_set1_epi32((int)sha1_k[t / 20])),
+                                                         w[t & 15]));
+        e = d;
+        d = c;
+        c = ROTL256(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    __m256i out[5] = {a, b, c, d, e};
+    for (int j = 0; j < 5; j++) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)state[j]);
+        _mm256_storeu_si256((__m256i*)state[j], _mm256_add_epi32(s, out[j]));
+    }
+}
+
+// AVX-512多路SHA-1压缩：16个独立状态，使用循环移位和三元逻辑指令
+__attribute__((target("avx512f")))
+static void sha1_compress_x16(uint32_t state[][SHA_MAX_LANES], const uint32_t words[16][SHA_MAX_LANES]) {
+    __m512i w[16];
+    for (int t = 0; t < 16; t++) {
+        w[t] = _mm512_loadu_si512((const void*)words[t]);
+    }
+
+    __m512i a = _mm512_loadu_si512((const void*)state[0]);
+    __m512i b = _mm512_loadu_si512((const void*)state[1]);
+    __m512i c = _mm512_loadu_si512((const void*)state[2]);
+    __m512i d = _mm512_loadu_si512((const void*)state[3]);
+    __m512i e = _mm512_loadu_si512((const void*)state[4]);
+    for (int t = 0; t < 80; t++) {
+        if (t >= 16) {
+            __m512i x = _mm512_ternarylogic_epi32(w[(t - 3) & 15], w[(t - 8) & 15], w[(t - 14) & 15], 0x96);
+            w[t & 15] = _mm512_rol_epi32(_mm512_xor_si512(x, w[t & 15]), 1);
+        }
+
+        __m512i f;
+        if (t < 20) {
+            f = _mm512_ternarylogic_epi32(b, c, d, 0xCA);
+        } else if (t < 40 || t >= 60) {
+            f = _mm512_ternarylogic_epi32(b, c, d, 0x96);
+        } else {
+            f = _mm512_ternarylogic_epi32(b, c, d, 0xE8);
+        }
+        __m512i temp = _mm512_add_epi32(_mm512_add_epi32(_mm512_rol_epi32(a, 5), f),
+                                        _mm512_add_epi32(_mm512_add_epi32(e, _mm512_set1_epi32((int)sha1_k[t / 20])),
+                                                         w[t & 15]));
+        e = d;
+        d = c;
+        c = _mm512_rol_epi32(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    __m512i out[5] = {a, b, c, d, e};
+    for (int j = 0; j < 5; j++) {
+        __m512i s = _mm512_loadu_si512((const void*)state[j]);
+        _mm512_storeu_si512((void*)state[j], _mm512_add_epi32(s, out[j]));
+    }
+}
+
+#define ROTR256(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+
+// AVX2多路SHA-256压缩：8个独立状态，状态和消息均为转置布局
+__attribute__((target("avx2")))
+static void sha256_compress_x8(uint32_t state[8][SHA_MAX_LANES], const uint32_t words[16][SHA_MAX_LANES]) {
+    __m256i w[16];
+    for (int t = 0; t < 16; t++) {
+        w[t] = _mm256_loadu_si256((const __m256i*)words[t]);
+    }
+
+    __m256i a = _mm256_loadu_si256((const __m256i*)state[0]);
+    __m256i b = _mm256_loadu_si256((const __m256i*)state[1]);
+    __m256i c = _mm256_loadu_si256((const __m256i*)state[2]);
+    __m256i d = _mm256_loadu_si256((const __m256i*)state[3]);
+    __m256i e = _mm256_loadu_si256((const __m256i*)state[4]);
+    __m256i f = _mm256_loadu_si256((const __m256i*)state[5]);
+    __m256i g = _mm256_loadu_si256((const __m256i*)state[6]);
+    __m256i h = _mm256_loadu_si256((const __m256i*)state[7]);
+    for (int t = 0; t < 64; t++) {
+        if (t >= 16) {
+            __m256i w15 = w[(t - 15) & 15], w2 = w[(t - 2) & 15];
+            __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(ROTR256(w15, 7), ROTR256(w15, 18)),
+                                          _mm256_srli_epi32(w15, 3));
+            __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(ROTR256(w2, 17), ROTR256(w2, 19)),
+                                          _mm256_srli_epi32(w2, 10));
+            w[t & 15] = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], s0),
+                                         _mm256_add_epi32(w[(t - 7) & 15], s1));
+        }
+
+        __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(ROTR256(e, 6), ROTR256(e, 11)), ROTR256(e, 25));
+        __m256i ch = _mm256_xor_si256(g, _mm256_and_si256(e, _mm256_xor_si256(f, g)));
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, s1),
+                                      _mm256_add_epi32(_mm256_add_epi32(ch, _mm256_set1_epi32((int)sha256_k[t])),
+                                                       w[t & 15]));
+        __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(ROTR256(a, 2), ROTR256(a, 13)), ROTR256(a, 22));
+        __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+        __m256i t2 = _mm256_add_epi32(s0, maj);
+        h = g;
+        g = f;
+        f = e;
+        e = _mm256_add_epi32(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm256_add_epi32(t1, t2);
+    }
+
+    __m256i out[8] = {a, b, c, d, e, f, g, h};
+    for (int j = 0; j < 8; j++) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)state[j]);
+        _mm256_storeu_si256((__m256i*)state[j], _mm256_add_epi32(s, out[j]));
+    }
+}
+
+// AVX-512多路SHA-256压缩：16个独立状态，使用循环移位和三元逻辑指令
+__attribute__((target("avx512f")))
+static void sha256_compress_x16(uint32_t state[8][SHA_MAX_LANES], const uint32_t words[16][SHA_MAX_LANES]) {
+    __m512i w[16];
+    for (int t = 0; t < 16; t++) {
+        w[t] = _mm512_loadu_si512((const void*)words[t]);
+    }
+
+    __m512i a = _mm512_loadu_si512((const void*)state[0]);
+    __m512i b = _mm512_loadu_si512((const void*)state[1]);
+    __m512i c = _mm512_loadu_si512((const void*)state[2]);
+    __m512i d = _mm512_loadu_si512((const void*)state[3]);
+    __m512i e = _mm512_loadu_si512((const void*)state[4]);
+    __m512i f = _mm512_loadu_si512((const void*)state[5]);
+    __m512i g = _mm512_loadu_si512((const void*)state[6]);
+    __m512i h = _mm512_loadu_si512((const void*)state[7]);
+    for (int t = 0; t < 64; t++) {
+        if (t >= 16) {
+            __m512i w15 = w[(t - 15) & 15], w2 = w[(t - 2) & 15];
+            __m512i s0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w15, 7), _mm512_ror_epi32(w15, 18),
+                                                   _mm512_srli_epi32(w15, 3), 0x96);
+            __m512i s1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w2, 17), _mm512_ror_epi32(w2, 19),
+                                                   _mm512_srli_epi32(w2, 10), 0x96);
+            w[t & 15] = _mm512_add_epi32(_mm512_add_epi32(w[t & 15], s0),
+                                         _mm512_add_epi32(w[(t - 7) & 15], s1));
+        }
+
+        __m512i s1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(e, 6), _mm512_ror_epi32(e, 11),
+                                               _mm512_ror_epi32(e, 25), 0x96);
+        __m512i ch = _mm512_ternarylogic_epi32(e, f, g, 0xCA);
+        __m512i t1 = _mm512_add_epi32(_mm512_add_epi32(h, s1),
+                                      _mm512_add_epi32(_mm512_add_epi32(ch, _mm512_set1_epi32((int)sha256_k[t])),
+                                                       w[t & 15]));
+        __m512i s0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(a, 2), _mm512_ror_epi32(a, 13),
+                                               _mm512_ror_epi32(a, 22), 0x96);
+        __m512i maj = _mm512_ternarylogic_epi32(a, b, c, 0xE8);
+        __m512i t2 = _mm512_add_epi32(s0, maj);
+        h = g;
+        g = f;
+        f = e;
+        e = _mm512_add_epi32(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm512_add_epi32(t1, t2);
+    }
+
+    __m512i out[8] = {a, b, c, d, e, f, g, h};
+    for (int j = 0; j < 8; j++) {
+        __m512i s = _mm512_loadu_si512((const void*)state[j]);
+        _mm512_storeu_si512((void*)state[j], _mm512_add_epi32(s, out[j]));
+    }
+}
+
+#endif
+
+// 每种内核一次处理的路数
+int sha_kernel_lanes(zip_crypto_kernel_t kernel) {
+    return kernel == ZC_KERNEL_AVX512 ? 16 : kernel == ZC_KERNEL_AVX2 ? 8 : 1;
+}
+
+// 按内核压缩所有路的一个SHA-1消息块
+void sha1_compress_lanes(zip_crypto_kernel_t kernel, int lanes, uint32_t state[][SHA_MAX_LANES],
+                         const uint32_t words[16][SHA_MAX_LANES]) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (kernel == ZC_KERNEL_AVX512) {
+        sha1_compress_x16(state, words);
+        return;
+    }
+    if (kernel == ZC_KERNEL_AVX2) {
+        sha1_compress_x8(state, words);
+        return;
+    }
+#endif
+    for (int lane = 0; lane < lanes; lane++) {
+        uint32_t s[5], w[16];
+        for (int j = 0; j < 5; j++) s[j] = state[j][lane];
+        for (int t = 0; t < 16; t++) w[t] = words[t][lane];
+        sha1_compress_words(s, w, NULL);
+        for (int j = 0; j < 5; j++) state[j][lane] = s[j];
+    }
+}
+
+// 按内核压缩所有路的一个SHA-256消息块
+void sha256_compress_lanes(zip_crypto_kernel_t kernel, int lanes, uint32_t state[8][SHA_MAX_LANES],
+                           const uint32_t words[16][SHA_MAX_LANES]) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (kernel == ZC_KERNEL_AVX512) {
+        sha256_compress_x16(state, words);
+        return;
+    }
+    if (kernel == ZC_KERNEL_AVX2) {
+        sha256_compress_x8(state, words);
+        return;
+    }
+#endif
+    for (int lane = 0; lane < lanes; lane++) {
+        uint32_t s[8], w[16];
+        for (int j = 0; j < 8; j++) s[j] = state[j][lane];
+        for (int t = 0; t < 16; t++) w[t] = words[t][lane];
+        sha256_compress(s, w);
+        for (int j = 0; j < 8; j++) state[j][lane] = s[j];
+    }
+}
+
+// 初始化多路流式哈希
+void sha_lanes_init(sha_lanes_t *l, sha_algo_t algo, zip_crypto_kernel_t kernel, int lanes) {
+    l->algo = algo;
+    l->kernel = kernel;
+    l->lanes = lanes;
+    l->fill = 0;
+    l->total = 0;
+    for (int j = 0; j < 8; j++) {
+        uint32_t iv = algo == SHA_ALGO_SHA1 ? (j < 5 ? sha1_iv[j] : 0) : sha256_iv[j];
+        for (int lane = 0; lane < SHA_MAX_LANES; lane++) {
+            l->state[j][lane] = iv;
+        }
+    }
+}
+
+// 将所有路的当前块转为大端字并压缩
+static void lanes_compress(sha_lanes_t *l) {
+    for (int t = 0; t < 16; t++) {
+        for (int lane = 0; lane < l->lanes; lane++) {
+            l->words[t][lane] = read_be32(l->block[lane] + t * 4);
+        }
+    }
+    if (l->algo == SHA_ALGO_SHA1) {
+        sha1_compress_lanes(l->kernel, l->lanes, l->state, (const uint32_t (*)[SHA_MAX_LANES])l->words);
+    } else {
+        sha256_compress_lanes(l->kernel, l->lanes, l->state, (const uint32_t (*)[SHA_MAX_LANES])l->words);
+    }
+}
+
+// 每一路追加等长数据，所有路的分块位置保持一致
+void sha_lanes_update(sha_lanes_t *l, const uint8_t *const *data, size_t len) {
+    size_t off = 0;
+    l->total += len;
+    while (off < len) {
+        size_t take = len - off < SHA_BLOCK_SIZE - l->fill ? len - off : SHA_BLOCK_SIZE - l->fill;
+        for (int lane = 0; lane < l->lanes; lane++) {
+            memcpy(l->block[lane] + l->fill, data[lane] + off, take);
+        }
+        l->fill += take;
+        off += take;
+        if (l->fill == SHA_BLOCK_SIZE) {
+            lanes_compress(l);
+            l->fill = 0;
+        }
+    }
+}
+
+// 末尾填充并输出每一路的摘要（SHA-1为20字节，会修改状态）
+void sha_lanes_final(sha_lanes_t *l, uint8_t digests[][32]) {
+    uint64_t bits = l->total * 8;
+    for (int lane = 0; lane < l->lanes; lane++) {
+        l->block[lane][l->fill] = 0x80;
+        memset(l->block[lane] + l->fill + 1, 0, SHA_BLOCK_SIZE - l->fill - 1);
+    }
+    if (l->fill + 1 > SHA_BLOCK_SIZE - 8) {
+        lanes_compress(l);
+        for (int lane = 0; lane < l->lanes; lane++) memset(l->block[lane], 0, SHA_BLOCK_SIZE);
+    }
+    for (int lane = 0; lane < l->lanes; lane++) {
+        for (int i = 0; i < 8; i++) {
+            l->block[lane][SHA_BLOCK_SIZE - 1 - i] = (uint8_t)(bits >> (8 * i));
+        }
+    }
+    lanes_compress(l);
+
+    int digest_words = l->algo == SHA_ALGO_SHA1 ? 5 : 8;
+    for (int lane = 0; lane < l->lanes; lane++) {
+        for (int j = 0; j < digest_words; j++) {
+            uint32_t v = l->state[j][lane];
+            digests[lane][j * 4] = (uint8_t)(v >> 24);
+            digests[lane][j * 4 + 1] = (uint8_t)(v >> 16);
+            digests[lane][j * 4 + 2] = (uint8_t)(v >> 8);
+            digests[lane][j * 4 + 3] = (uint8_t)v;
+        }
+    }
+}
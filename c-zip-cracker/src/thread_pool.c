@@ -1,6 +1,7 @@
 #include "zip_cracker.h"
 #include <signal.h>
-#include <zip.h>
+#include <unistd.h>
+#include <errno.h>
 
 // 线程工作数据结构
 typedef struct {
@@ -9,55 +10,179 @@ typedef struct {
     password_generator_t *generator;
 } thread_work_data_t;
 
+// 后台计数线程的参数
+typedef struct {
+    attack_status_t *status;
+    dict_source_t *dict;
+    uint64_t base;                 // 总数中不属于字典的部分（混合模式的掩码空间）
+    uint64_t per_line;             // 每行字典展开成的候选数（规则数或组合数）
+} dict_count_data_t;
+
+// 只在内存中解压一遍，列出各条目的大小
+static void test_archive(const archive_info_t *info, const char *password) {
+    uint32_t count = 0;
+    extracted_file_t *files = extract_to_memory(info, password, &count);
+    if (!files) {
+        print_error("[!] 解压测试失败");
+        return;
+    }
+    
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (files[i].data) {
+            print_info("  %s (%zu 字节)", files[i].name, files[i].size);
+            total += files[i].size;
+        }
+    }
+    print_success("[*] 解压测试通过，共 %u 个条目，%lu 字节", count, total);
+    free_extracted_files(files, count);
+}
+
+// 解压到指定目录（未指定时用新的带时间戳的目录），"-"表示写到标准输出
+static void extract_archive(const thread_pool_t *pool, const archive_info_t *info, const char *password) {
+    if (pool->extract_test) {
+        test_archive(info, password);
+        return;
+    }
+    
+    char output_dir[256];
+    if (pool->output_dir) {
+        snprintf(output_dir, sizeof(output_dir), "%s", pool->output_dir);
+    } else {
+        snprintf(output_dir, sizeof(output_dir), "./extracted_%ld", time(NULL));
+    }
+    
+    if (strcmp(output_dir, "-") == 0) {
+        fflush(stdout);
+        if (!extract_with_password(info, password, output_dir)) {
+            print_error("[!] 文件解压失败");
+        }
+    } else if (extract_with_password(info, password, output_dir)) {
+        print_success("[*] 文件解压成功，输出目录: %s", output_dir);
+    } else {
+        print_error("[!] 文件解压失败");
+    }
+}
+
+// 密码确认成功后记录结果，等进度线程停止后再解压
+static void report_success(thread_pool_t *pool, const char *password) {
+    attack_status_t *status = pool->status;
+    
+    pthread_mutex_lock(&status->lock);
+    if (!status->stop) {
+        print_success("\n[*] 密码破解成功: %s", password);
+        pool->found_password = strdup(password);
+        status->stop = true;
+    }
+    pthread_mutex_unlock(&status->lock);
+}
+
+// 后台逐段修正字典行数，数完后总数变为精确值
+static void* dict_count_thread(void *arg) {
+    dict_count_data_t *data = (dict_count_data_t *)arg;
+    attack_status_t *status = data->status;
+    bool exact = false;
+    
+    pthread_mutex_lock(&status->lock);
+    uint64_t estimate = (status->total_passwords - data->base) / data->per_line;
+    pthread_mutex_unlock(&status->lock);
+    
+    while (!exact && !status->stop) {
+        exact = dict_source_refine(data->dict, &estimate);
+        
+        pthread_mutex_lock(&status->lock);
+        status->total_passwords = data->base + estimate * data->per_line;
+        status->total_estimated = !exact;
+        pthread_mutex_unlock(&status->lock);
+    }
+    return NULL;
+}
+
 // 工作线程函数
 static void* worker_thread(void *arg) {
     thread_work_data_t *data = (thread_work_data_t*)arg;
     thread_pool_t *pool = data->pool;
     attack_status_t *status = pool->status;
     
-    archive_type_t archive_type = detect_archive_type(pool->target_file);
+    archive_type_t archive_type = pool->info->type;
     
-    char *password;
-    while (!status->stop && (password = get_next_password(data->generator)) != NULL) {
-        // 更新当前尝试的密码
-        pthread_mutex_lock(&status->lock);
-        if (status->current_password) {
-            free(status->current_password);
+    // 每个线程在共享的内存映像上保留自己的读取句柄；libarchive解不开加密的RAR，RAR只用原生验证的结论
+    archive_reader_t reader;
+    bool has_reader = archive_type != ARCHIVE_RAR && archive_reader_init(&reader, pool->info->image, archive_type);
+    
+    // 批次的存储每个线程复用，取密码不再逐个分配
+    password_batch_t *candidates = malloc(sizeof(password_batch_t));
+    const char *const *batch = candidates ? candidates->passwords : NULL;
+    const size_t *lens = candidates ? candidates->lens : NULL;
+    bool passed[ZIP_CRYPTO_BATCH_SIZE];
+    rar3_key_t rar3_keys[ZIP_CRYPTO_BATCH_SIZE];
+    bool found = false;
+    
+    while (candidates && !status->stop && !found) {
+        // 从生成器取一批密码
+        int count = fill_password_batch(data->generator, candidates);
+        if (count == 0) {
+            break;
         }
-        status->current_password = strdup(password);
-        pthread_mutex_unlock(&status->lock);
         
-        // 尝试密码
-        if (try_password(pool->target_file, password, archive_type)) {
-            pthread_mutex_lock(&status->lock);
-            if (!status->stop) {
-                print_success("\n[*] 密码破解成功: %s", password);
-                
-                // 尝试解压文件
-                char output_dir[256];
-                snprintf(output_dir, sizeof(output_dir), "./extracted_%ld", time(NULL));
-                
-                if (extract_with_password(pool->target_file, password, output_dir, archive_type)) {
-                    print_success("[*] 文件解压成功，输出目录: %s", output_dir);
-                } else {
-                    print_error("[!] 文件解压失败");
-                }
-                
-                status->stop = true;
+        // ZipCrypto校验字节/AES校验值/7z首块/RAR5校验值/RAR3首块批量筛选，其余格式全部交给确认阶段
+        if (pool->zip_crypto) {
+            zip_crypto_check_batch(pool->zip_crypto, batch, lens, count, passed);
+        } else if (pool->zip_aes) {
+            zip_aes_check_batch(pool->zip_aes, batch, lens, count, passed);
+        } else if (pool->sevenzip) {
+            sevenzip_check_batch(pool->sevenzip, batch, lens, count, passed);
+        } else if (pool->rar5) {
+            rar5_check_batch(pool->rar5, batch, lens, count, passed);
+        } else if (pool->rar3) {
+            rar3_check_batch(pool->rar3, batch, lens, count, passed, rar3_keys);
+        } else {
+            memset(passed, true, sizeof(passed));
+        }
+        
+        // 通过快速校验的密码做第二阶段验证，无法原生验证时交给libzip/libarchive确认
+        for (int i = 0; i < count && !found && !status->stop; i++) {
+            if (!passed[i]) continue;
+            
+            // 字典候选直接指向映射，交给libzip/libarchive和输出前复制成以\0结尾的字符串
+            char password[MAX_CANDIDATE_LENGTH + 1];
+            memcpy(password, batch[i], lens[i]);
+            password[lens[i]] = '\0';
+            
+            zip_verify_result_t verdict = ZIP_VERIFY_UNSUPPORTED;
+            if (pool->zip_crypto) {
+                verdict = zip_crypto_verify_password(pool->zip_crypto, batch[i], lens[i]);
+            } else if (pool->zip_aes) {
+                verdict = zip_aes_verify_password(pool->zip_aes, batch[i], lens[i]);
+            } else if (pool->sevenzip) {
+                verdict = sevenzip_verify_password(pool->sevenzip, batch[i], lens[i]);
+            } else if (pool->rar5) {
+                verdict = rar5_verify_password(pool->rar5, batch[i], lens[i]);
+            } else if (pool->rar3) {
+                verdict = rar3_verify_key(pool->rar3, &rar3_keys[i]);
+            }
+            
+            if (verdict == ZIP_VERIFY_OK ||
+                (verdict == ZIP_VERIFY_UNSUPPORTED && has_reader && archive_reader_try(&reader, password))) {
+                report_success(pool, password);
+                found = true;
             }
-            pthread_mutex_unlock(&status->lock);
-            free(password);
-            break;
         }
         
-        // 更新尝试次数
+        // 每批同步一次尝试次数和当前密码
         pthread_mutex_lock(&status->lock);
-        status->tried_passwords++;
+        status->tried_passwords += count;
+        if (status->current_password) {
+            free(status->current_password);
+        }
+        status->current_password = strndup(batch[count - 1], lens[count - 1]);
         pthread_mutex_unlock(&status->lock);
-        
-        free(password);
     }
     
+    free(candidates);
+    if (has_reader) {
+        archive_reader_close(&reader);
+    }
     return NULL;
 }
 
@@ -66,50 +191,34 @@ static void* crc_attack_thread(void *arg) {
     thread_pool_t *pool = (thread_pool_t*)arg;
     attack_status_t *status = pool->status;
     
-    // 分析压缩包，寻找小文件
-    archive_info_t *info = analyze_archive(pool->target_file);
-    if (!info) {
-        print_error("无法分析压缩包进行CRC攻击");
-        return NULL;
-    }
-    
+    // 从共享模型中寻找小文件
+    const archive_info_t *info = pool->info;
     if (info->type != ARCHIVE_ZIP) {
         print_info("CRC攻击仅支持ZIP格式");
-        free_archive_info(info);
-        return NULL;
-    }
-    
-    // 打开ZIP文件查找小文件
-    int err;
-    zip_t *archive = zip_open(pool->target_file, ZIP_RDONLY, &err);
-    if (!archive) {
-        free_archive_info(info);
         return NULL;
     }
     
-    zip_uint64_t num_entries = zip_get_num_entries(archive, 0);
     bool found_small_file = false;
     
-    for (zip_uint64_t i = 0; i < num_entries && !status->stop; i++) {
-        zip_stat_t stat;
-        if (zip_stat_index(archive, i, 0, &stat) == 0) {
-            // 检查是否为小文件
-            if (stat.size <= 8 && stat.size > 0) {
-                print_info("发现小文件 %s (%lu 字节)，开始CRC32攻击", stat.name, (unsigned long)stat.size);
-                found_small_file = true;
+    for (uint32_t i = 0; i < info->file_count && !status->stop; i++) {
+        const file_entry_t *entry = &info->entries[i];
+        // 检查是否为小文件
+        if (entry->uncompressed_size <= 8 && entry->uncompressed_size > 0) {
+            print_info("发现小文件 %s (%lu 字节)，开始CRC32攻击", entry->filename,
+                       (unsigned long)entry->uncompressed_size);
+            found_small_file = true;
+            
+            char result[32];
+            if (crc32_attack(entry->filename, entry->crc32, (int)entry->uncompressed_size, result)) {
+                print_success("CRC32攻击成功，文件内容: %s", result);
+                
+                // 这里可以根据文件内容推测密码
+                // 例如，如果内容是"flag{"，密码可能包含相关信息
                 
-                char result[32];
-                if (crc32_attack(stat.name, stat.crc, (int)stat.size, result)) {
-                    print_success("CRC32攻击成功，文件内容: %s", result);
-                    
-                    // 这里可以根据文件内容推测密码
-                    // 例如，如果内容是"flag{"，密码可能包含相关信息
-                    
-                    pthread_mutex_lock(&status->lock);
-                    status->stop = true;
-                    pthread_mutex_unlock(&status->lock);
-                    break;
-                }
+                pthread_mutex_lock(&status->lock);
+                status->stop = true;
+                pthread_mutex_unlock(&status->lock);
+                break;
             }
         }
     }
@@ -118,29 +227,123 @@ static void* crc_attack_thread(void *arg) {
         print_info("未发现适合CRC攻击的小文件");
     }
     
-    zip_close(archive);
-    free_archive_info(info);
     return NULL;
 }
 
+// 已知内部密钥：反推密码，找不到时直接用密钥解密后解压
+static void recover_from_keys(thread_pool_t *pool) {
+    attack_status_t *status = pool->status;
+    char password[MAX_KEY_PASSWORD_LENGTH + 1];
+    
+    print_info("由内部密钥 %08x %08x %08x 反推密码 (最大长度 %d)",
+               pool->keys.key0, pool->keys.key1, pool->keys.key2, pool->max_length);
+    
+    status->stop = false;
+    pthread_t progress_thread_id;
+    pthread_create(&progress_thread_id, NULL, progress_thread, status);
+    
+    bool found = zip_crypto_recover_password(&pool->keys, pool->charset, pool->max_length,
+                                             pool->thread_count, status, password);
+    
+    status->stop = true;
+    pthread_join(progress_thread_id, NULL);
+    
+    if (found) {
+        print_success("\n[*] 密码破解成功: %s", password);
+        extract_archive(pool, pool->info, password);
+        return;
+    }
+    
+    // 未找到密码时仍可用密钥解密到临时文件，按-o解压后删除
+    print_info("\n未找到密码，直接使用内部密钥解密");
+    const char *tmpdir = getenv("TMPDIR");
+    char decrypted[1024];
+    snprintf(decrypted, sizeof(decrypted), "%s/zip-cracker-XXXXXX.zip", tmpdir && *tmpdir ? tmpdir : "/tmp");
+    int fd = mkstemps(decrypted, 4);
+    if (fd < 0) {
+        print_error("[!] 无法创建解密用的临时文件 %s: %s", decrypted, strerror(errno));
+        return;
+    }
+    close(fd);
+    
+    archive_info_t *plain = zip_crypto_decrypt_archive(pool->info, &pool->keys, decrypted) ?
+                            analyze_archive(decrypted) : NULL;
+    if (plain) {
+        print_info("已用内部密钥解密到临时文件，开始解压");
+        extract_archive(pool, plain, "");
+        free_archive_info(plain);
+    } else {
+        print_error("[!] 使用内部密钥解密失败");
+    }
+    unlink(decrypted);
+}
+
+// 已知明文攻击：依次尝试用户提供的明文和自动收集的明文
+static void run_plaintext_attack(thread_pool_t *pool) {
+    if (!pool->zip_crypto) {
+        print_error("已知明文攻击仅支持ZipCrypto加密的ZIP文件");
+        return;
+    }
+    
+    int count = 0;
+    known_plaintext_t **candidates = collect_known_plaintext(pool->zip_crypto, &count);
+    if (!pool->plaintext && count == 0) {
+        print_error("未能自动收集到足够的已知明文，请使用 --plaintext 指定");
+        free(candidates);
+        return;
+    }
+    
+    pthread_t progress_thread_id;
+    pthread_create(&progress_thread_id, NULL, progress_thread, pool->status);
+    
+    bool found = false;
+    if (pool->plaintext) {
+        found = plaintext_attack(pool, pool->plaintext);
+    }
+    for (int i = 0; i < count && !found && !pool->status->stop; i++) {
+        found = plaintext_attack(pool, candidates[i]);
+    }
+    
+    pool->status->stop = true;
+    pthread_join(progress_thread_id, NULL);
+    
+    for (int i = 0; i < count; i++) {
+        free_known_plaintext(candidates[i]);
+    }
+    free(candidates);
+    
+    if (found) {
+        pool->has_keys = true;
+        print_success("\n[*] 已恢复内部密钥: %08x %08x %08x",
+                      pool->keys.key0, pool->keys.key1, pool->keys.key2);
+        recover_from_keys(pool);
+    } else {
+        print_error("\n[!] 已知明文攻击完成，未找到密钥");
+    }
+}
+
 // 创建线程池
-thread_pool_t* create_thread_pool(int thread_count, const char *target_file, 
+thread_pool_t* create_thread_pool(int thread_count, archive_info_t *info, 
                                   const char *dict_file, attack_mode_t mode) {
-    if (thread_count <= 0 || !target_file) {
+    if (thread_count <= 0 || !info) {
         return NULL;
     }
+    const char *target_file = info->filename;
     
     thread_pool_t *pool = calloc(1, sizeof(thread_pool_t));
     if (!pool) return NULL;
     
     pool->thread_count = thread_count;
     pool->target_file = strdup(target_file);
+    pool->info = archive_info_retain(info);
     pool->dict_file = dict_file ? strdup(dict_file) : NULL;
     pool->mode = mode;
+    pool->max_length = DEFAULT_KEY_PASSWORD_LENGTH;
     
     // 初始化攻击状态
     pool->status = calloc(1, sizeof(attack_status_t));
     if (!pool->status) {
+        free_archive_info(pool->info);
         free(pool->target_file);
         free(pool->dict_file);
         free(pool);
@@ -154,33 +357,79 @@ thread_pool_t* create_thread_pool(int thread_count, const char *target_file,
     
     if (pthread_mutex_init(&pool->status->lock, NULL) != 0) {
         free(pool->status);
+        free_archive_info(pool->info);
         free(pool->target_file);
         free(pool->dict_file);
         free(pool);
         return NULL;
     }
     
-    // 计算总密码数
-    if (mode == ATTACK_DICTIONARY || mode == ATTACK_HYBRID) {
-        if (dict_file) {
-            pool->status->total_passwords = count_passwords_in_dict(dict_file);
+    // ZIP目标预先解析一次ZipCrypto加密头
+    if (info->type == ARCHIVE_ZIP) {
+        pool->zip_crypto = zip_crypto_load(info);
+        if (pool->zip_crypto) {
+            print_info("已加载 %u 个ZipCrypto加密条目，启用原生校验", pool->zip_crypto->entry_count);
+            zip_crypto_print_plan(pool->zip_crypto);
+        } else {
+            pool->zip_aes = zip_aes_load(info);
+            if (pool->zip_aes) {
+                print_info("已加载 %u 个WinZip AES加密条目，启用批量PBKDF2校验",
+                           pool->zip_aes->entry_count);
+            }
+        }
+    } else if (info->type == ARCHIVE_7Z) {
+        pool->sevenzip = sevenzip_load(info);
+        if (pool->sevenzip) {
+            print_info("已加载7z AES流（%s，2^%u次SHA-256），启用批量密钥派生校验",
+                       pool->sevenzip->stream.is_header ? "加密的头" : "数据",
+                       pool->sevenzip->stream.num_cycles_power);
+        }
+    } else if (info->type == ARCHIVE_RAR) {
+        pool->rar5 = rar5_load(info);
+        if (pool->rar5) {
+            print_info("已加载RAR5加密参数（%s，2^%u次PBKDF2%s），启用批量校验",
+                       pool->rar5->is_header ? "加密的头" : "文件",
+                       pool->rar5->kdf_log2,
+                       pool->rar5->has_check ? "，有校验值" : "");
+        } else {
+            pool->rar3 = rar3_load(info);
+            if (pool->rar3) {
+                print_info("已加载RAR3加密参数（%s，2^18次SHA-1），启用批量密钥派生校验",
+                           pool->rar3->is_header ? "加密的头" : "文件");
+            } else {
+                // libarchive解不开加密的RAR，没有原生可确认的条目时任何密码都无法确认
+                print_error("RAR压缩包中没有能原生确认密码的加密条目（固实、分卷或旧版加密）");
+                pthread_mutex_destroy(&pool->status->lock);
+                free(pool->status);
+                free_archive_info(pool->info);
+                free(pool->target_file);
+                free(pool->dict_file);
+                free(pool);
+                return NULL;
+            }
         }
     }
     
-    if (mode == ATTACK_BRUTEFORCE || mode == ATTACK_HYBRID) {
-        // 添加数字密码数量（1-8位）
-        for (int len = 1; len <= 8; len++) {
-            uint64_t count = 1;
-            for (int i = 0; i < len; i++) {
-                count *= 10;
-            }
-            pool->status->total_passwords += count;
+    // 字典的密码数先用抽样估计，不等读完整个文件；攻击开始后再由后台线程精确计数
+    if (mode == ATTACK_DICTIONARY || mode == ATTACK_HYBRID) {
+        dict_source_t *source = dict_file ? dict_source_open(dict_file, 1) : NULL;
+        if (source) {
+            bool exact;
+            pool->status->total_passwords = dict_source_estimate_lines(source, &exact);
+            pool->status->total_estimated = !exact;
+            dict_source_close(source);
         }
     }
     
     // 分配线程数组
     pool->threads = calloc(thread_count, sizeof(pthread_t));
     if (!pool->threads) {
+        zip_crypto_free(pool->zip_crypto);
+        zip_aes_free(pool->zip_aes);
+        sevenzip_free(pool->sevenzip);
+        rar5_free(pool->rar5);
+        rar3_free(pool->rar3);
+        free_archive_info(pool->info);
         pthread_mutex_destroy(&pool->status->lock);
         free(pool->status);
         free(pool->target_file);
@@ -196,7 +445,30 @@ thread_pool_t* create_thread_pool(int thread_count, const char *target_file,
 void start_attack(thread_pool_t *pool) {
     if (!pool) return;
     
-    print_info("开始攻击，总密码数: %lu", pool->status->total_passwords);
+    // 已经知道内部密钥时不需要猜测密码
+    if (pool->has_keys) {
+        recover_from_keys(pool);
+        return;
+    }
+    
+    // 暴力破解的掩码队列，未指定时沿用1-8位数字；指定了Markov模型或PRINCE链时改用它们
+    bool brute = pool->mode == ATTACK_BRUTEFORCE || pool->mode == ATTACK_HYBRID;
+    if (brute && !pool->masks && !pool->markov && !pool->prince) {
+        pool->masks = mask_list_parse("?d?d?d?d?d?d?d?d", NULL, 1, 8);
+    }
+    uint64_t brute_keyspace = !brute ? 0 : pool->markov ? pool->markov->keyspace :
+                              pool->prince ? pool->prince->keyspace :
+                              pool->masks ? pool->masks->keyspace : 0;
+    // 规则或组合把每行字典展开成多个候选
+    uint64_t per_line = pool->rules ? pool->rules->count :
+                        pool->combinator ? pool->combinator->per_word : 1;
+    pool->status->total_passwords *= per_line;
+    pool->status->total_passwords += brute_keyspace;
+    
+    print_info("开始攻击，总密码数: %s%lu", pool->status->total_estimated ? "约" : "",
+               pool->status->total_passwords);
+    // 词表模型在创建线程池之后才构建，速度从真正开始尝试时算起
+    pool->status->start_time = time(NULL);
     
     // 如果是CRC攻击或混合攻击，先尝试CRC攻击
     if (pool->mode == ATTACK_CRC32 || pool->mode == ATTACK_HYBRID) {
@@ -215,6 +487,11 @@ void start_attack(thread_pool_t *pool) {
         return;
     }
     
+    if (pool->mode == ATTACK_PLAINTEXT) {
+        run_plaintext_attack(pool);
+        return;
+    }
+    
     // 创建进度显示线程
     pthread_t progress_thread_id;
     pthread_create(&progress_thread_id, NULL, progress_thread, pool->status);
@@ -226,22 +503,50 @@ void start_attack(thread_pool_t *pool) {
         return;
     }
     
+    // 混合模式前一半线程跑字典，其余线程平分掩码空间
+    int dict_threads = pool->mode == ATTACK_DICTIONARY ? pool->thread_count :
+                       pool->mode == ATTACK_HYBRID ? pool->thread_count / 2 : 0;
+    int brute_threads = pool->thread_count - dict_threads;
+    
+    // 字典线程共享一个字典，各自领取不重叠的块
+    dict_source_t *dict = NULL;
+    if (dict_threads > 0 && pool->dict_file) {
+        dict = dict_source_open(pool->dict_file, dict_threads);
+        if (!dict) {
+            print_error("无法打开字典文件: %s", pool->dict_file);
+        } else if (dict->stream) {
+            print_info("字典为%s压缩格式，边解压边尝试", dict_compression_name(dict->compression));
+        }
+    }
+    
+    // 总数还是估计值时在后台精确计数，工作线程不必等待
+    dict_count_data_t count_data = { pool->status, dict, 0, per_line };
+    pthread_t count_thread_id;
+    bool counting = false;
+    if (dict && pool->status->total_estimated) {
+        count_data.base = brute_keyspace;
+        counting = pthread_create(&count_thread_id, NULL, dict_count_thread, &count_data) == 0;
+    }
+    
     // 创建密码生成器
     for (int i = 0; i < pool->thread_count; i++) {
         work_data[i].pool = pool;
         work_data[i].thread_id = i;
         
         // 根据攻击模式创建不同的密码生成器
-        if (pool->mode == ATTACK_DICTIONARY || 
-            (pool->mode == ATTACK_HYBRID && i < pool->thread_count / 2)) {
-            if (pool->dict_file) {
-                work_data[i].generator = create_dict_generator(pool->dict_file);
-            }
-        } else {
-            // 为不同线程分配不同长度的数字密码
-            int min_len = (i % 8) + 1;
-            int max_len = min_len;
-            work_data[i].generator = create_numeric_generator(min_len, max_len);
+        if (i < dict_threads) {
+            work_data[i].generator = pool->combinator ? create_combinator_generator(dict, pool->combinator) :
+                                     create_shared_dict_generator(dict, pool->rules);
+        } else if (pool->markov || pool->prince || pool->masks) {
+            // 每个线程取互不重叠的一段下标，余数分给前面的线程
+            uint64_t part = (uint64_t)(i - dict_threads);
+            uint64_t share = brute_keyspace / (uint64_t)brute_threads;
+            uint64_t extra = brute_keyspace % (uint64_t)brute_threads;
+            uint64_t start = part * share + (part < extra ? part : extra);
+            uint64_t count = share + (part < extra ? 1 : 0);
+            work_data[i].generator = pool->markov ? create_markov_generator(pool->markov, start, count) :
+                                     pool->prince ? create_prince_generator(pool->prince, start, count) :
+                                     create_mask_generator(pool->masks, start, count);
         }
         
         if (!work_data[i].generator) {
@@ -266,9 +571,12 @@ void start_attack(thread_pool_t *pool) {
         }
     }
     
-    // 停止进度显示线程
+    // 停止进度显示线程和后台计数
     pool->status->stop = true;
     pthread_join(progress_thread_id, NULL);
+    if (counting) {
+        pthread_join(count_thread_id, NULL);
+    }
     
     // 清理密码生成器
     for (int i = 0; i < pool->thread_count; i++) {
@@ -277,6 +585,12 @@ void start_attack(thread_pool_t *pool) {
         }
     }
     free(work_data);
+    dict_source_close(dict);
+    
+    // 进度显示停止后才解压，写到标准输出的数据不会夹进进度行
+    if (pool->found_password) {
+        extract_archive(pool, pool->info, pool->found_password);
+    }
     
     if (!pool->status->stop) {
         print_error("\n[!] 攻击完成，未找到正确密码");
@@ -302,6 +616,21 @@ void free_thread_pool(thread_pool_t *pool) {
         free(pool->status);
     }
     
+    free_known_plaintext(pool->plaintext);
+    free(pool->charset);
+    free(pool->found_password);
+    mask_list_free(pool->masks);
+    rule_set_free(pool->rules);
+    markov_model_free(pool->markov);
+    prince_model_free(pool->prince);
+    combinator_free(pool->combinator);
+    
+    zip_crypto_free(pool->zip_crypto);
+    zip_aes_free(pool->zip_aes);
+    sevenzip_free(pool->sevenzip);
+    rar5_free(pool->rar5);
+    rar3_free(pool->rar3);
+    free_archive_info(pool->info);
     free(pool->threads);
     free(pool->target_file);
     free(pool->dict_file);
@@ -15,6 +15,19 @@
 #define COLOR_WHITE   "\033[37m"
 #define COLOR_BOLD    "\033[1m"
 
+// 提示、进度等诊断信息的输出流，为空时用标准输出
+static FILE *g_message_stream = NULL;
+
+// 设置诊断信息的输出流；解压到标准输出时改为stderr，避免混进解压出的数据
+void set_message_stream(FILE *stream) {
+    g_message_stream = stream;
+}
+
+// 获取诊断信息的输出流
+FILE* message_stream(void) {
+    return g_message_stream ? g_message_stream : stdout;
+}
+
 // 获取CPU核心数
 int get_cpu_count(void) {
     return get_nprocs();
@@ -54,9 +67,9 @@ void print_error(const char *format, ...) {
     va_list args;
     va_start(args, format);
     
-    printf(COLOR_RED "[!] ");
-    vprintf(format, args);
-    printf(COLOR_RESET "\n");
+    fprintf(message_stream(), COLOR_RED "[!] ");
+    vfprintf(message_stream(), format, args);
+    fprintf(message_stream(), COLOR_RESET "\n");
     
     va_end(args);
 }
@@ -66,9 +79,9 @@ void print_info(const char *format, ...) {
     va_list args;
     va_start(args, format);
     
-    printf(COLOR_BLUE "[*] ");
-    vprintf(format, args);
-    printf(COLOR_RESET "\n");
+    fprintf(message_stream(), COLOR_BLUE "[*] ");
+    vfprintf(message_stream(), format, args);
+    fprintf(message_stream(), COLOR_RESET "\n");
     
     va_end(args);
 }
@@ -78,29 +91,29 @@ void print_success(const char *format, ...) {
     va_list args;
     va_start(args, format);
     
-    printf(COLOR_GREEN "[+] ");
-    vprintf(format, args);
-    printf(COLOR_RESET "\n");
+    fprintf(message_stream(), COLOR_GREEN "[+] ");
+    vfprintf(message_stream(), format, args);
+    fprintf(message_stream(), COLOR_RESET "\n");
     
     va_end(args);
 }
 
 // 打印横幅
 void print_banner(void) {
-    printf(COLOR_CYAN COLOR_BOLD);
-    printf("\n");
-    printf(" ██████╗    ███████╗██╗██████╗      ██████╗██████╗  █████╗  ██████╗██╗  ██╗███████╗██████╗ \n");
-    printf("██╔════╝    ╚══███╔╝██║██╔══██╗    ██╔════╝██╔══██╗██╔══██╗██╔════╝██║ ██╔╝██╔════╝██╔══██╗\n");
-    printf("██║           ███╔╝ ██║██████╔╝    ██║     ██████╔╝███████║██║     █████╔╝ █████╗  ██████╔╝\n");
-    printf("██║          ███╔╝  ██║██╔═══╝     ██║     ██╔══██╗██╔══██║██║     ██╔═██╗ ██╔══╝  ██╔══██╗\n");
-    printf("╚██████╗    ███████╗██║██║         ╚██████╗██║  ██║██║  ██║╚██████╗██║  ██╗███████╗██║  ██║\n");
-    printf(" ╚═════╝    ╚══════╝╚═╝╚═╝          ╚═════╝╚═╝  ╚═╝╚═╝  ╚═╝ ╚═════╝╚═╝  ╚═╝╚══════╝╚═╝  ╚═╝\n");
-    printf(COLOR_RESET);
-    printf("\n");
-    printf(COLOR_YELLOW "                    高性能压缩包密码破解工具 - C语言版本\n" COLOR_RESET);
-    printf(COLOR_MAGENTA "                    支持 ZIP/RAR/7Z 格式 | 多线程并行处理\n" COLOR_RESET);
-    printf(COLOR_CYAN "                    原作者: Asaotomo@Hx0-Team | C版本重构\n" COLOR_RESET);
-    printf("\n");
+    fprintf(message_stream(), COLOR_CYAN COLOR_BOLD);
+    fprintf(message_stream(), "\n");
+    fprintf(message_stream(), " ██████╗    ███████╗██╗██████╗      ██████╗██████╗  █████╗  ██████╗██╗  ██╗███████╗██████╗ \n");
+    fprintf(message_stream(), "██╔════╝    ╚══███╔╝██║██╔══██╗    ██╔════╝██╔══██╗██╔══██╗██╔════╝██║ ██╔╝██╔════╝██╔══██╗\n");
+    fprintf(message_stream(), "██║           ███╔╝ ██║██████╔╝    ██║     ██████╔╝███████║██║     █████╔╝ █████╗  ██████╔╝\n");
+    fprintf(message_stream(), "██║          ███╔╝  ██║██╔═══╝     ██║     ██╔══██╗██╔══██║██║     ██╔═██╗ ██╔══╝  ██╔══██╗\n");
+    fprintf(message_stream(), "╚██████╗    ███████╗██║██║         ╚██████╗██║  ██║██║  ██║╚██████╗██║  ██╗███████╗██║  ██║\n");
+    fprintf(message_stream(), " ╚═════╝    ╚══════╝╚═╝╚═╝          ╚═════╝╚═╝  ╚═╝╚═╝  ╚═╝ ╚═════╝╚═╝  ╚═╝╚══════╝╚═╝  ╚═╝\n");
+    fprintf(message_stream(), COLOR_RESET);
+    fprintf(message_stream(), "\n");
+    fprintf(message_stream(), COLOR_YELLOW "                    高性能压缩包密码破解工具 - C语言版本\n" COLOR_RESET);
+    fprintf(message_stream(), COLOR_MAGENTA "                    支持 ZIP/RAR/7Z 格式 | 多线程并行处理\n" COLOR_RESET);
+    fprintf(message_stream(), COLOR_CYAN "                    原作者: Asaotomo@Hx0-Team | C版本重构\n" COLOR_RESET);
+    fprintf(message_stream(), "\n");
 }
 
 // 进度显示线程
@@ -114,7 +127,7 @@ void* progress_thread(void *arg) {
     
     // 最后一次显示进度
     print_progress(status);
-    printf("\n");
+    fprintf(message_stream(), "\n");
     
     return NULL;
 }
@@ -125,6 +138,7 @@ void print_progress(attack_status_t *status) {
     
     uint64_t tried = status->tried_passwords;
     uint64_t total = status->total_passwords;
+    bool estimated = status->total_estimated;
     time_t current_time = time(NULL);
     time_t elapsed = current_time - status->start_time;
     
@@ -163,12 +177,14 @@ void print_progress(attack_status_t *status) {
     pthread_mutex_unlock(&status->lock);
     
     // 打印进度条
-    printf("\r" COLOR_YELLOW "[进度] " COLOR_RESET);
-    printf("%.2f%% | ", progress);
-    printf(COLOR_CYAN "剩余时间: %s" COLOR_RESET " | ", time_str);
-    printf(COLOR_GREEN "速度: %lu p/s" COLOR_RESET " | ", speed);
-    printf(COLOR_MAGENTA "当前: %-20s" COLOR_RESET, current_password);
-    fflush(stdout);
+    fprintf(message_stream(), "\r" COLOR_YELLOW "[进度] " COLOR_RESET);
+    // 总数还是估计值时进度和剩余时间前加~
+    const char *approx = estimated ? "~" : "";
+    fprintf(message_stream(), "%s%.2f%% | ", approx, progress);
+    fprintf(message_stream(), COLOR_CYAN "剩余时间: %s%s" COLOR_RESET " | ", remaining > 0 ? approx : "", time_str);
+    fprintf(message_stream(), COLOR_GREEN "速度: %lu p/s" COLOR_RESET " | ", speed);
+    fprintf(message_stream(), COLOR_MAGENTA "当前: %-20s" COLOR_RESET, current_password);
+    fflush(message_stream());
 }
 
 // 格式化字节大小
@@ -245,10 +261,10 @@ void print_system_info(void) {
     struct sysinfo si;
     if (sysinfo(&si) == 0) {
         print_info("系统信息:");
-        printf("  CPU核心数: %d\n", get_cpu_count());
-        printf("  总内存: %s\n", format_bytes(si.totalram * si.mem_unit));
-        printf("  可用内存: %s\n", format_bytes(si.freeram * si.mem_unit));
-        printf("  系统运行时间: %s\n", format_time(si.uptime));
+        fprintf(message_stream(), "  CPU核心数: %d\n", get_cpu_count());
+        fprintf(message_stream(), "  总内存: %s\n", format_bytes(si.totalram * si.mem_unit));
+        fprintf(message_stream(), "  可用内存: %s\n", format_bytes(si.freeram * si.mem_unit));
+        fprintf(message_stream(), "  系统运行时间: %s\n", format_time(si.uptime));
     }
 }
 
@@ -297,4 +313,45 @@ char* safe_strcat(const char *str1, const char *str2) {
     }
     
     return result;
+}
+
+// UTF-8密码转为UTF-16LE（7-Zip、RAR3的密钥派生输入），返回字节数，超长部分截断
+size_t utf8_to_utf16le(const char *password, size_t len, uint8_t *out, size_t max_bytes) {
+    size_t n = 0;
+    size_t i = 0;
+    while (i < len && n + 4 <= max_bytes) {
+        uint32_t cp = (uint8_t)password[i];
+        size_t extra = 0;
+        if (cp >= 0xF0 && cp < 0xF8) {
+            cp &= 0x07;
+            extra = 3;
+        } else if (cp >= 0xE0) {
+            cp &= 0x0F;
+            extra = 2;
+        } else if (cp >= 0xC0) {
+            cp &= 0x1F;
+            extra = 1;
+        }
+        if (cp >= 0x80 && extra == 0) {
+            cp = 0xFFFD;
+        }
+        i++;
+        for (size_t k = 0; k < extra && i < len; k++, i++) {
+            cp = (cp << 6) | ((uint8_t)password[i] & 0x3F);
+        }
+
+        if (cp >= 0x10000) {
+            cp -= 0x10000;
+            uint16_t hi = (uint16_t)(0xD800 | (cp >> 10));
+            uint16_t lo = (uint16_t)(0xDC00 | (cp & 0x3FF));
+            out[n++] = (uint8_t)hi;
+            out[n++] = (uint8_t)(hi >> 8);
+            out[n++] = (uint8_t)lo;
+            out[n++] = (uint8_t)(lo >> 8);
+        } else {
+            out[n++] = (uint8_t)cp;
+            out[n++] = (uint8_t)(cp >> 8);
+        }
+    }
+    return n;
 }
\ No newline at end of file
@@ -0,0 +1,630 @@
+#include "../include/zip_cracker.h"
+#include <zip.h>
+#include <immintrin.h>
+
+#define ZIP_CENTRAL_HEADER_SIZE 46
+
+// WinZip AES扩展字段
+#define ZIP_AES_EXTRA_ID   0x9901
+#define ZIP_AES_EXTRA_SIZE 7
+
+// PBKDF2参数
+#define ZIP_AES_ITERATIONS 1000
+#define SHA1_BLOCK_SIZE    64
+#define SHA1_DIGEST_SIZE   20
+
+// 单个HMAC块的SHA-1填充长度（64字节密钥块 + 20字节消息）
+#define HMAC_SHA1_DIGEST_BITS ((SHA1_BLOCK_SIZE + SHA1_DIGEST_SIZE) * 8)
+
+static const uint32_t sha1_iv[5] = {
+    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+
+// 小端读取
+static uint16_t read_le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline uint32_t rotl32(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+// SHA-1压缩函数（单路）
+static void sha1_compress(uint32_t state[5], const uint32_t block[16]) {
+    uint32_t w[16];
+    memcpy(w, block, sizeof(w));
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (int t = 0; t < 80; t++) {
+        if (t >= 16) {
+            w[t & 15] = rotl32(w[(t - 3) & 15] ^ w[(t - 8) & 15] ^
+                               w[(t - 14) & 15] ^ w[t & 15], 1);
+        }
+
+        uint32_t f, k;
+        if (t < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (t < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (t < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+
+        uint32_t temp = rotl32(a, 5) + f + e + k + w[t & 15];
+        e = d;
+        d = c;
+        c = rotl32(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+// 对任意长度数据计算SHA-1（仅用于超长密码的HMAC密钥）
+static void sha1_digest(const uint8_t *data, size_t len, uint8_t out[SHA1_DIGEST_SIZE]) {
+    uint32_t state[5];
+    uint32_t block[16];
+    uint8_t tail[SHA1_BLOCK_SIZE * 2];
+    memcpy(state, sha1_iv, sizeof(state));
+
+    size_t full = len / SHA1_BLOCK_SIZE;
+    for (size_t i = 0; i < full; i++) {
+        for (int j = 0; j < 16; j++) {
+            block[j] = read_be32(data + i * SHA1_BLOCK_SIZE + j * 4);
+        }
+        sha1_compress(state, block);
+    }
+
+    size_t rest = len - full * SHA1_BLOCK_SIZE;
+    size_t tail_len = rest + 9 <= SHA1_BLOCK_SIZE ? SHA1_BLOCK_SIZE : SHA1_BLOCK_SIZE * 2;
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, data + full * SHA1_BLOCK_SIZE, rest);
+    tail[rest] = 0x80;
+    uint64_t bits = (uint64_t)len * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[tail_len - 1 - i] = (uint8_t)(bits >> (i * 8));
+    }
+
+    for (size_t off = 0; off < tail_len; off += SHA1_BLOCK_SIZE) {
+        for (int j = 0; j < 16; j++) {
+            block[j] = read_be32(tail + off + j * 4);
+        }
+        sha1_compress(state, block);
+    }
+
+    for (int i = 0; i < 5; i++) {
+        out[i * 4] = (uint8_t)(state[i] >> 24);
+        out[i * 4 + 1] = (uint8_t)(state[i] >> 16);
+        out[i * 4 + 2] = (uint8_t)(state[i] >> 8);
+        out[i * 4 + 3] = (uint8_t)state[i];
+    }
+}
+
+// 计算一个HMAC-SHA1的ipad/opad中间状态和第一轮U1
+static void hmac_sha1_prepare(const zip_aes_entry_t *entry, const char *password, size_t len,
+                              uint32_t istate[5], uint32_t ostate[5], uint32_t u[5]) {
+    uint8_t key[SHA1_BLOCK_SIZE];
+    memset(key, 0, sizeof(key));
+    if (len > SHA1_BLOCK_SIZE) {
+        sha1_digest((const uint8_t*)password, len, key);
+    } else {
+        memcpy(key, password, len);
+    }
+
+    uint32_t ipad[16], opad[16];
+    for (int j = 0; j < 16; j++) {
+        uint32_t word = read_be32(key + j * 4);
+        ipad[j] = word ^ 0x36363636;
+        opad[j] = word ^ 0x5C5C5C5C;
+    }
+
+    memcpy(istate, sha1_iv, sizeof(sha1_iv));
+    memcpy(ostate, sha1_iv, sizeof(sha1_iv));
+    sha1_compress(istate, ipad);
+    sha1_compress(ostate, opad);
+
+    // U1 = HMAC(salt || INT(block))，盐最长16字节，与块号一起放得进一个块
+    uint8_t msg[SHA1_BLOCK_SIZE];
+    memset(msg, 0, sizeof(msg));
+    memcpy(msg, entry->salt, entry->salt_len);
+    msg[entry->salt_len + 3] = (uint8_t)entry->pbkdf2_block;
+    msg[entry->salt_len + 4] = 0x80;
+    uint32_t msg_bits = (SHA1_BLOCK_SIZE + entry->salt_len + 4) * 8;
+    msg[62] = (uint8_t)(msg_bits >> 8);
+    msg[63] = (uint8_t)msg_bits;
+
+    uint32_t block[16];
+    uint32_t inner[5];
+    for (int j = 0; j < 16; j++) {
+        block[j] = read_be32(msg + j * 4);
+    }
+    memcpy(inner, istate, sizeof(inner));
+    sha1_compress(inner, block);
+
+    memset(block, 0, sizeof(block));
+    memcpy(block, inner, sizeof(inner));
+    block[5] = 0x80000000;
+    block[15] = HMAC_SHA1_DIGEST_BITS;
+    memcpy(u, ostate, sizeof(inner));
+    sha1_compress(u, block);
+}
+
+// 从PBKDF2输出块中取出2字节密码校验值
+static uint16_t extract_verifier(const zip_aes_entry_t *entry, const uint32_t t[5]) {
+    int off = entry->verifier_offset;
+    uint8_t b0 = (uint8_t)(t[off / 4] >> (24 - (off % 4) * 8));
+    uint8_t b1 = (uint8_t)(t[(off + 1) / 4] >> (24 - ((off + 1) % 4) * 8));
+    return (uint16_t)(b0 | (b1 << 8));
+}
+
+// 标量路径：单个密码的PBKDF2迭代
+static bool check_password_scalar(const zip_aes_entry_t *entry, const char *password, size_t len) {
+    uint32_t istate[5], ostate[5], u[5], t[5];
+    hmac_sha1_prepare(entry, password, len, istate, ostate, u);
+    memcpy(t, u, sizeof(t));
+
+    uint32_t block[16];
+    memset(block, 0, sizeof(block));
+    block[5] = 0x80000000;
+    block[15] = HMAC_SHA1_DIGEST_BITS;
+
+    for (int iter = 1; iter < ZIP_AES_ITERATIONS; iter++) {
+        uint32_t inner[5];
+        memcpy(block, u, sizeof(u));
+        memcpy(inner, istate, sizeof(inner));
+        sha1_compress(inner, block);
+
+        memcpy(block, inner, sizeof(inner));
+        memcpy(u, ostate, sizeof(u));
+        sha1_compress(u, block);
+
+        for (int j = 0; j < 5; j++) {
+            t[j] ^= u[j];
+        }
+    }
+
+    return extract_verifier(entry, t) == entry->verifier;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#define ROTL256(x, n) _mm256_or_si256(_mm256_slli_epi32((x), (n)), _mm256_srli_epi32((x), 32 - (n)))
+
+// AVX2多路SHA-1压缩：8个独立状态同时推进，消息只有前5个字是变量
+__attribute__((target("avx2")))
+static inline void sha1_compress_x8(__m256i state[5], const __m256i msg[5]) {
+    __m256i w[16];
+    for (int j = 0; j < 5; j++) w[j] = msg[j];
+    w[5] = _mm256_set1_epi32((int)0x80000000);
+    for (int j = 6; j < 15; j++) w[j] = _mm256_setzero_si256();
+    w[15] = _mm256_set1_epi32(HMAC_SHA1_DIGEST_BITS);
+
+    __m256i a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (int t = 0; t < 80; t++) {
+        if (t >= 16) {
+            __m256i x = _mm256_xor_si256(_mm256_xor_si256(w[(t - 3) & 15], w[(t - 8) & 15]),
+                                         _mm256_xor_si256(w[(t - 14) & 15], w[t & 15]));
+            w[t & 15] = ROTL256(x, 1);
+        }
+
+        __m256i f, k;
+        if (t < 20) {
+            f = _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d)));
+            k = _mm256_set1_epi32(0x5A827999);
+        } else if (t < 40) {
+            f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+            k = _mm256_set1_epi32(0x6ED9EBA1);
+        } else if (t < 60) {
+            f = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(d, _mm256_or_si256(b, c)));
+            k = _mm256_set1_epi32((int)0x8F1BBCDC);
+        } else {
+            f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+            k = _mm256_set1_epi32((int)0xCA62C1D6);
+        }
+
+        __m256i temp = _mm256_add_epi32(_mm256_add_epi32(ROTL256(a, 5), f),
+                                        _mm256_add_epi32(_mm256_add_epi32(e, k), w[t & 15]));
+        e = d;
+        d = c;
+        c = ROTL256(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    state[0] = _mm256_add_epi32(state[0], a);
+    state[1] = _mm256_add_epi32(state[1], b);
+    state[2] = _mm256_add_epi32(state[2], c);
+    state[3] = _mm256_add_epi32(state[3], d);
+    state[4] = _mm256_add_epi32(state[4], e);
+}
+
+// AVX2：8个密码同时做PBKDF2迭代
+__attribute__((target("avx2")))
+static void check_lanes_avx2(const zip_aes_entry_t *entry, const char *const *passwords,
+                             const size_t *lens, int count, bool *results) {
+    uint32_t istate[5][8], ostate[5][8], u0[5][8];
+
+    for (int lane = 0; lane < 8; lane++) {
+        uint32_t is[5], os[5], u[5];
+        int src = lane < count ? lane : 0;
+        hmac_sha1_prepare(entry, passwords[src], lens[src], is, os, u);
+        for (int j = 0; j < 5; j++) {
+            istate[j][lane] = is[j];
+            ostate[j][lane] = os[j];
+            u0[j][lane] = u[j];
+        }
+    }
+
+    __m256i is[5], os[5], u[5], t[5];
+    for (int j = 0; j < 5; j++) {
+        is[j] = _mm256_loadu_si256((const __m256i*)istate[j]);
+        os[j] = _mm256_loadu_si256((const __m256i*)ostate[j]);
+        u[j] = _mm256_loadu_si256((const __m256i*)u0[j]);
+        t[j] = u[j];
+    }
+
+    for (int iter = 1; iter < ZIP_AES_ITERATIONS; iter++) {
+        __m256i inner[5];
+        for (int j = 0; j < 5; j++) inner[j] = is[j];
+        sha1_compress_x8(inner, u);
+
+        for (int j = 0; j < 5; j++) u[j] = os[j];
+        sha1_compress_x8(u, inner);
+
+        for (int j = 0; j < 5; j++) t[j] = _mm256_xor_si256(t[j], u[j]);
+    }
+
+    uint32_t out[5][8];
+    for (int j = 0; j < 5; j++) {
+        _mm256_storeu_si256((__m256i*)out[j], t[j]);
+    }
+
+    for (int lane = 0; lane < count; lane++) {
+        uint32_t lane_t[5];
+        for (int j = 0; j < 5; j++) lane_t[j] = out[j][lane];
+        results[lane] = extract_verifier(entry, lane_t) == entry->verifier;
+    }
+}
+
+// AVX-512多路SHA-1压缩：16个独立状态，使用三元逻辑和循环移位指令
+__attribute__((target("avx512f")))
+static inline void sha1_compress_x16(__m512i state[5], const __m512i msg[5]) {
+    __m512i w[16];
+    for (int j = 0; j < 5; j++) w[j] = msg[j];
+    w[5] = _mm512_set1_epi32((int)0x80000000);
+    for (int j = 6; j < 15; j++) w[j] = _mm512_setzero_si512();
+    w[15] = _mm512_set1_epi32(HMAC_SHA1_DIGEST_BITS);
+
+    __m512i a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (int t = 0; t < 80; t++) {
+        if (t >= 16) {
+            __m512i x = _mm512_ternarylogic_epi32(w[(t - 3) & 15], w[(t - 8) & 15],
+                                                  w[(t - 14) & 15], 0x96);
+            w[t & 15] = _mm512_rol_epi32(_mm512_xor_si512(x, w[t & 15]), 1);
+        }
+
+        __m512i f, k;
+        if (t < 20) {
+            f = _mm512_ternarylogic_epi32(b, c, d, 0xCA);
+            k = _mm512_set1_epi32(0x5A827999);
+        } else if (t < 40) {
+            f = _mm512_ternarylogic_epi32(b, c, d, 0x96);
+            k = _mm512_set1_epi32(0x6ED9EBA1);
+        } else if (t < 60) {
+            f = _mm512_ternarylogic_epi32(b, c, d, 0xE8);
+            k = _mm512_set1_epi32((int)0x8F1BBCDC);
+        } else {
+            f = _mm512_ternarylogic_epi32(b, c, d, 0x96);
+            k = _mm512_set1_epi32((int)0xCA62C1D6);
+        }
+
+        __m512i temp = _mm512_add_epi32(_mm512_add_epi32(_mm512_rol_epi32(a, 5), f),
+                                        _mm512_add_epi32(_mm512_add_epi32(e, k), w[t & 15]));
+        e = d;
+        d = c;
+        c = _mm512_rol_epi32(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    state[0] = _mm512_add_epi32(state[0], a);
+    state[1] = _mm512_add_epi32(state[1], b);
+    state[2] = _mm512_add_epi32(state[2], c);
+    state[3] = _mm512_add_epi32(state[3], d);
+    state[4] = _mm512_add_epi32(state[4], e);
+}
+
+// AVX-512：16个密码同时做PBKDF2迭代
+__attribute__((target("avx512f")))
+static void check_lanes_avx512(const zip_aes_entry_t *entry, const char *const *passwords,
+                               const size_t *lens, int count, bool *results) {
+    uint32_t istate[5][16], ostate[5][16], u0[5][16];
+
+    for (int lane = 0; lane < 16; lane++) {
+        uint32_t is[5], os[5], u[5];
+        int src = lane < count ? lane : 0;
+        hmac_sha1_prepare(entry, passwords[src], lens[src], is, os, u);
+        for (int j = 0; j < 5; j++) {
+            istate[j][lane] = is[j];
+            ostate[j][lane] = os[j];
+            u0[j][lane] = u[j];
+        }
+    }
+
+    __m512i is[5], os[5], u[5], t[5];
+    for (int j = 0; j < 5; j++) {
+        is[j] = _mm512_loadu_si512((const void*)istate[j]);
+        os[j] = _mm512_loadu_si512((const void*)ostate[j]);
+        u[j] = _mm512_loadu_si512((const void*)u0[j]);
+        t[j] = u[j];
+    }
+
+    for (int iter = 1; iter < ZIP_AES_ITERATIONS; iter++) {
+        __m512i inner[5];
+        for (int j = 0; j < 5; j++) inner[j] = is[j];
+        sha1_compress_x16(inner, u);
+
+        for (int j = 0; j < 5; j++) u[j] = os[j];
+        sha1_compress_x16(u, inner);
+
+        for (int j = 0; j < 5; j++) t[j] = _mm512_xor_si512(t[j], u[j]);
+    }
+
+    uint32_t out[5][16];
+    for (int j = 0; j < 5; j++) {
+        _mm512_storeu_si512((void*)out[j], t[j]);
+    }
+
+    for (int lane = 0; lane < count; lane++) {
+        uint32_t lane_t[5];
+        for (int j = 0; j < 5; j++) lane_t[j] = out[j][lane];
+        results[lane] = extract_verifier(entry, lane_t) == entry->verifier;
+    }
+}
+
+#endif
+
+// 从内存映像取出数据开头的盐和密码校验值
+static bool load_salt_and_verifier(const archive_image_t *image, zip_aes_entry_t *entry) {
+    if (entry->data_offset == 0 || entry->data_offset + entry->salt_len + 2 > image->size) {
+        return false;
+    }
+
+    const uint8_t *buffer = image->data + entry->data_offset;
+    memcpy(entry->salt, buffer, entry->salt_len);
+    entry->verifier = read_le16(buffer + entry->salt_len);
+    return true;
+}
+
+// 在中央目录扩展字段中查找AES参数
+static bool parse_aes_extra(const uint8_t *extra, uint16_t extra_len, zip_aes_entry_t *entry) {
+    size_t pos = 0;
+    while (pos + 4 <= extra_len) {
+        uint16_t id = read_le16(extra + pos);
+        uint16_t size = read_le16(extra + pos + 2);
+        if (pos + 4 + size > extra_len) break;
+
+        if (id == ZIP_AES_EXTRA_ID && size >= ZIP_AES_EXTRA_SIZE) {
+            const uint8_t *data = extra + pos + 4;
+            entry->vendor_version = read_le16(data);
+            entry->strength = data[4];
+            entry->actual_method = read_le16(data + 5);
+            return entry->strength >= 1 && entry->strength <= 3;
+        }
+
+        pos += 4 + size;
+    }
+    return false;
+}
+
+// 排序规则：存储条目优先，其次按压缩后大小升序（二阶段验证更便宜）
+static int compare_entries(const void *a, const void *b) {
+    const zip_aes_entry_t *ea = (const zip_aes_entry_t*)a;
+    const zip_aes_entry_t *eb = (const zip_aes_entry_t*)b;
+
+    int deflated_a = ea->actual_method != 0;
+    int deflated_b = eb->actual_method != 0;
+    if (deflated_a != deflated_b) {
+        return deflated_a - deflated_b;
+    }
+    if (ea->compressed_size != eb->compressed_size) {
+        return ea->compressed_size < eb->compressed_size ? -1 : 1;
+    }
+    return 0;
+}
+
+// 从压缩包模型中缓存所有WinZip AES加密条目，AES参数取自条目在映像中的中央目录记录
+zip_aes_ctx_t* zip_aes_load(const archive_info_t *info) {
+    if (!info || !info->image || info->type != ARCHIVE_ZIP) return NULL;
+
+    const archive_image_t *image = info->image;
+    zip_aes_ctx_t *ctx = calloc(1, sizeof(zip_aes_ctx_t));
+    if (!ctx) return NULL;
+
+    ctx->kernel = zip_crypto_select_kernel();
+    ctx->image = image;
+    ctx->entries = calloc(info->file_count ? info->file_count : 1, sizeof(zip_aes_entry_t));
+    if (!ctx->entries) {
+        free(ctx);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < info->file_count; i++) {
+        const file_entry_t *item = &info->entries[i];
+        if (item->encryption_method < ZIP_EM_AES_128 || item->encryption_method > ZIP_EM_AES_256 ||
+            item->central_offset + ZIP_CENTRAL_HEADER_SIZE > image->size) {
+            continue;
+        }
+
+        const uint8_t *rec = image->data + item->central_offset;
+        uint16_t name_len = read_le16(rec + 28);
+        uint16_t extra_len = read_le16(rec + 30);
+        if (item->central_offset + ZIP_CENTRAL_HEADER_SIZE + name_len + extra_len > image->size) {
+            continue;
+        }
+
+        zip_aes_entry_t *entry = &ctx->entries[ctx->entry_count];
+        entry->crc32 = item->crc32;
+        entry->compressed_size = item->compressed_size;
+        entry->uncompressed_size = item->uncompressed_size;
+        entry->local_header_offset = item->local_header_offset;
+        entry->data_offset = item->data_offset;
+
+        if (parse_aes_extra(rec + ZIP_CENTRAL_HEADER_SIZE + name_len, extra_len, entry)) {
+            // 密钥长度16/24/32字节，盐长度为其一半
+            entry->key_len = 8 + entry->strength * 8;
+            entry->salt_len = entry->key_len / 2;
+
+            // 校验值位于派生密钥的第2*key_len字节，只需计算它所在的那个PBKDF2块
+            int offset = entry->key_len * 2;
+            entry->pbkdf2_block = offset / SHA1_DIGEST_SIZE + 1;
+            entry->verifier_offset = offset % SHA1_DIGEST_SIZE;
+
+            if (load_salt_and_verifier(image, entry)) {
+                entry->filename = strdup(item->filename ? item->filename : "");
+                ctx->entry_count++;
+                continue;
+            }
+        }
+        memset(entry, 0, sizeof(*entry));
+    }
+
+
+    if (ctx->entry_count == 0) {
+        zip_aes_free(ctx);
+        return NULL;
+    }
+
+    // AES每个条目都要完整的PBKDF2，不做级联，只挑二阶段最便宜的条目
+    qsort(ctx->entries, ctx->entry_count, sizeof(zip_aes_entry_t), compare_entries);
+    return ctx;
+}
+
+// 检查单个密码的2字节校验值
+bool zip_aes_check_password(const zip_aes_ctx_t *ctx, const char *password, size_t len) {
+    if (!ctx || ctx->entry_count == 0 || !password) {
+        return false;
+    }
+
+    return check_password_scalar(&ctx->entries[0], password, len);
+}
+
+// 使用指定内核批量派生密钥并比较校验值
+static int check_batch_with_kernel(const zip_aes_ctx_t *ctx, zip_crypto_kernel_t kernel,
+                                   const char *const *passwords, const size_t *lens,
+                                   int count, bool *results) {
+    const zip_aes_entry_t *entry = &ctx->entries[0];
+    int lanes = kernel == ZC_KERNEL_AVX512 ? 16 : kernel == ZC_KERNEL_AVX2 ? 8 : 1;
+    int passed = 0;
+
+    for (int i = 0; i < count; i += lanes) {
+        int n = count - i < lanes ? count - i : lanes;
+
+        if (lanes == 1) {
+            results[i] = check_password_scalar(entry, passwords[i], lens[i]);
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        else if (kernel == ZC_KERNEL_AVX512) {
+            check_lanes_avx512(entry, passwords + i, lens + i, n, results + i);
+        } else {
+            check_lanes_avx2(entry, passwords + i, lens + i, n, results + i);
+        }
+#endif
+
+        for (int j = 0; j < n; j++) {
+            if (results[i + j]) passed++;
+        }
+    }
+
+    return passed;
+}
+
+// 批量校验密码，返回通过校验值比较的数量
+int zip_aes_check_batch(const zip_aes_ctx_t *ctx, const char *const *passwords,
+                        const size_t *lens, int count, bool *results) {
+    if (!ctx || ctx->entry_count == 0 || !passwords || !lens || !results || count <= 0) {
+        return 0;
+    }
+
+    return check_batch_with_kernel(ctx, ctx->kernel, passwords, lens, count, results);
+}
+
+// 测量每种内核的PBKDF2吞吐量
+void zip_aes_benchmark(void) {
+    zip_aes_entry_t entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.strength = 3;
+    entry.key_len = 32;
+    entry.salt_len = 16;
+    entry.pbkdf2_block = 4;
+    entry.verifier_offset = 4;
+    for (int i = 0; i < 16; i++) {
+        entry.salt[i] = (uint8_t)(i * 29 + 3);
+    }
+
+    zip_aes_ctx_t ctx = {0};
+    ctx.entries = &entry;
+    ctx.entry_count = 1;
+
+    const int batch = ZIP_CRYPTO_BATCH_SIZE;
+    const int rounds = 64;
+    char storage[ZIP_CRYPTO_BATCH_SIZE][16];
+    const char *passwords[ZIP_CRYPTO_BATCH_SIZE];
+    size_t lens[ZIP_CRYPTO_BATCH_SIZE];
+    bool results[ZIP_CRYPTO_BATCH_SIZE];
+
+    for (int i = 0; i < batch; i++) {
+        snprintf(storage[i], sizeof(storage[i]), "%08d", i * 7919);
+        passwords[i] = storage[i];
+        lens[i] = 8;
+    }
+
+    print_info("WinZip AES-256 校验吞吐量 (单线程, PBKDF2-HMAC-SHA1 x%d):", ZIP_AES_ITERATIONS);
+
+    zip_crypto_kernel_t kernels[] = {ZC_KERNEL_SCALAR, ZC_KERNEL_AVX2, ZC_KERNEL_AVX512};
+    zip_crypto_kernel_t best = zip_crypto_select_kernel();
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        if (kernels[k] > best) {
+            printf("  %-16s 不支持\n", zip_crypto_kernel_name(kernels[k]));
+            continue;
+        }
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int round = 0; round < rounds; round++) {
+            check_batch_with_kernel(&ctx, kernels[k], passwords, lens, batch, results);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("  %-16s %8.0f p/s\n", zip_crypto_kernel_name(kernels[k]),
+               rounds * batch / elapsed);
+    }
+}
+
+// 释放AES上下文
+void zip_aes_free(zip_aes_ctx_t *ctx) {
+    if (!ctx) return;
+
+    for (uint32_t i = 0; i < ctx->entry_count; i++) {
+        free(ctx->entries[i].filename);
+    }
+    free(ctx->entries);
+    free(ctx);
+}
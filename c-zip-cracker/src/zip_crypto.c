@@ -0,0 +1,428 @@
+#include "../include/zip_cracker.h"
+#include <zip.h>
+
+// ZIP结构签名
+#define ZIP_DESCRIPTOR_SIG     0x08074b50
+#define ZIP_EOCD_SIG           0x06054b50
+
+#define ZIP_LOCAL_HEADER_SIZE   30
+#define ZIP_CENTRAL_HEADER_SIZE 46
+#define ZIP_EOCD_SIZE           22
+
+// 通用标志位
+#define ZIP_FLAG_ENCRYPTED       0x0001
+#define ZIP_FLAG_DATA_DESCRIPTOR 0x0008
+
+// 存储（不压缩）的压缩方法号
+#define ZIP_METHOD_STORE 0
+
+// 需要解压的条目在二阶段验证中的相对代价
+#define ZIP_INFLATE_COST_FACTOR 4
+
+// 级联校验最多使用的条目数
+#define ZIP_CRYPTO_CASCADE_DEPTH 3
+
+// ZipCrypto使用的CRC32查找表
+static uint32_t zc_crc_table[256];
+static bool zc_crc_table_initialized = false;
+
+// 初始化CRC32查找表
+static void init_zc_crc_table(void) {
+    if (zc_crc_table_initialized) return;
+
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; j++) {
+            if (crc & 1) {
+                crc = (crc >> 1) ^ 0xEDB88320;
+            } else {
+                crc >>= 1;
+            }
+        }
+        zc_crc_table[i] = crc;
+    }
+    zc_crc_table_initialized = true;
+}
+
+// 获取CRC32查找表（供SIMD内核做gather查表）
+const uint32_t* zip_crypto_get_crc_table(void) {
+    init_zc_crc_table();
+    return zc_crc_table;
+}
+
+// 小端读取
+static uint16_t read_le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void write_le16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void write_le32(uint8_t *p, uint32_t v) {
+    write_le16(p, (uint16_t)v);
+    write_le16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// 使用一个明文字节更新三个密钥
+static inline void zc_update_keys(zip_crypto_keys_t *keys, uint8_t c) {
+    keys->key0 = zc_crc_table[(keys->key0 ^ c) & 0xFF] ^ (keys->key0 >> 8);
+    keys->key1 = (keys->key1 + (keys->key0 & 0xFF)) * 134775813 + 1;
+    keys->key2 = zc_crc_table[(keys->key2 ^ (keys->key1 >> 24)) & 0xFF] ^ (keys->key2 >> 8);
+}
+
+// 由key2计算当前的密钥流字节
+static inline uint8_t zc_stream_byte(const zip_crypto_keys_t *keys) {
+    uint16_t temp = (uint16_t)(keys->key2 | 2);
+    return (uint8_t)(((uint32_t)temp * (temp ^ 1)) >> 8);
+}
+
+// 用密码初始化密钥
+void zip_crypto_init_keys(zip_crypto_keys_t *keys, const char *password, size_t len) {
+    init_zc_crc_table();
+
+    keys->key0 = 0x12345678;
+    keys->key1 = 0x23456789;
+    keys->key2 = 0x34567890;
+    for (size_t i = 0; i < len; i++) {
+        zc_update_keys(keys, (uint8_t)password[i]);
+    }
+}
+
+// 解密一段数据（原地）
+void zip_crypto_decrypt(zip_crypto_keys_t *keys, uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = data[i] ^ zc_stream_byte(keys);
+        zc_update_keys(keys, c);
+        data[i] = c;
+    }
+}
+
+// 从内存映像取出条目的12字节加密头，确定校验字节
+static bool load_encryption_header(const archive_image_t *image, const file_entry_t *item,
+                                   zip_crypto_entry_t *entry) {
+    if (item->data_offset == 0 || item->compressed_size < sizeof(entry->header) ||
+        item->data_offset + sizeof(entry->header) > image->size) {
+        return false;
+    }
+
+    entry->flags = item->flags;
+    entry->compression_method = item->compression_method;
+    entry->mod_time = item->mod_time;
+    entry->crc32 = item->crc32;
+    entry->compressed_size = item->compressed_size;
+    entry->uncompressed_size = item->uncompressed_size;
+    entry->local_header_offset = item->local_header_offset;
+    entry->data_offset = item->data_offset;
+    memcpy(entry->header, image->data + item->data_offset, sizeof(entry->header));
+
+    // 设置了数据描述符时，校验字节来自修改时间的高字节
+    if (entry->flags & ZIP_FLAG_DATA_DESCRIPTOR) {
+        entry->check_byte = (uint8_t)(entry->mod_time >> 8);
+    } else {
+        entry->check_byte = (uint8_t)(entry->crc32 >> 24);
+    }
+
+    return true;
+}
+
+// 从压缩包模型中缓存所有ZipCrypto加密条目（偏移已按ZIP64和自解压前缀修正）
+zip_crypto_ctx_t* zip_crypto_load(const archive_info_t *info) {
+    if (!info || !info->image || info->type != ARCHIVE_ZIP) return NULL;
+
+    init_zc_crc_table();
+
+    zip_crypto_ctx_t *ctx = calloc(1, sizeof(zip_crypto_ctx_t));
+    if (!ctx) return NULL;
+
+    ctx->kernel = zip_crypto_select_kernel();
+    ctx->image = info->image;
+    ctx->entries = calloc(info->file_count ? info->file_count : 1, sizeof(zip_crypto_entry_t));
+    if (!ctx->entries) {
+        free(ctx);
+        return NULL;
+    }
+
+    // 只缓存传统PKWARE加密的条目
+    for (uint32_t i = 0; i < info->file_count; i++) {
+        const file_entry_t *item = &info->entries[i];
+        if (item->encryption_method != ZIP_EM_TRAD_PKWARE) {
+            continue;
+        }
+
+        zip_crypto_entry_t *entry = &ctx->entries[ctx->entry_count];
+        if (load_encryption_header(info->image, item, entry)) {
+            entry->filename = strdup(item->filename ? item->filename : "");
+            ctx->entry_count++;
+        } else {
+            memset(entry, 0, sizeof(*entry));
+        }
+    }
+
+    if (ctx->entry_count == 0) {
+        zip_crypto_free(ctx);
+        return NULL;
+    }
+
+    zip_crypto_rank_entries(ctx);
+    return ctx;
+}
+
+// 估算条目通过校验字节后的二阶段验证代价
+static uint64_t entry_verify_cost(const zip_crypto_entry_t *entry) {
+    uint64_t cost = entry->compressed_size;
+    if (entry->compression_method != ZIP_METHOD_STORE) {
+        cost *= ZIP_INFLATE_COST_FACTOR;
+    }
+    return cost;
+}
+
+// 排序规则：CRC校验字节优先于时间校验字节，其次按验证代价升序
+static int compare_entries(const void *a, const void *b) {
+    const zip_crypto_entry_t *ea = (const zip_crypto_entry_t*)a;
+    const zip_crypto_entry_t *eb = (const zip_crypto_entry_t*)b;
+
+    // 时间字节常被压缩工具写错或在多个条目间重复，可靠性较低
+    int time_a = (ea->flags & ZIP_FLAG_DATA_DESCRIPTOR) != 0;
+    int time_b = (eb->flags & ZIP_FLAG_DATA_DESCRIPTOR) != 0;
+    if (time_a != time_b) {
+        return time_a - time_b;
+    }
+
+    uint64_t cost_a = entry_verify_cost(ea);
+    uint64_t cost_b = entry_verify_cost(eb);
+    if (cost_a != cost_b) {
+        return cost_a < cost_b ? -1 : 1;
+    }
+    return 0;
+}
+
+// 按代价模型排序条目并确定级联深度
+void zip_crypto_rank_entries(zip_crypto_ctx_t *ctx) {
+    if (!ctx || ctx->entry_count == 0) return;
+
+    qsort(ctx->entries, ctx->entry_count, sizeof(zip_crypto_entry_t), compare_entries);
+
+    // 加密头完全相同的条目不提供独立信息，只保留第一个
+    ctx->cascade_count = 0;
+    for (uint32_t i = 0; i < ctx->entry_count; i++) {
+        if (ctx->cascade_count == ZIP_CRYPTO_CASCADE_DEPTH) break;
+
+        bool duplicate = false;
+        for (uint32_t j = 0; j < ctx->cascade_count; j++) {
+            if (memcmp(ctx->entries[j].header, ctx->entries[i].header, 12) == 0) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (duplicate) continue;
+
+        // 把选中的条目移到级联区域
+        if (i != ctx->cascade_count) {
+            zip_crypto_entry_t temp = ctx->entries[ctx->cascade_count];
+            ctx->entries[ctx->cascade_count] = ctx->entries[i];
+            ctx->entries[i] = temp;
+        }
+        ctx->cascade_count++;
+    }
+}
+
+// 打印级联校验顺序
+void zip_crypto_print_plan(const zip_crypto_ctx_t *ctx) {
+    if (!ctx) return;
+
+    for (uint32_t i = 0; i < ctx->cascade_count; i++) {
+        const zip_crypto_entry_t *entry = &ctx->entries[i];
+        print_info("  校验级联 #%u: %s (%s, %lu 字节, %s校验字节)", i + 1, entry->filename,
+                   entry->compression_method == ZIP_METHOD_STORE ? "存储" : "压缩",
+                   (unsigned long)entry->compressed_size,
+                   (entry->flags & ZIP_FLAG_DATA_DESCRIPTOR) ? "时间" : "CRC");
+    }
+}
+
+// 用已推进密码的密钥解密单个条目的加密头并比较校验字节
+static bool check_entry(const zip_crypto_entry_t *entry, const zip_crypto_keys_t *password_keys) {
+    zip_crypto_keys_t keys = *password_keys;
+
+    // 前11字节只需推进密钥状态
+    for (int i = 0; i < 11; i++) {
+        zc_update_keys(&keys, entry->header[i] ^ zc_stream_byte(&keys));
+    }
+
+    return (uint8_t)(entry->header[11] ^ zc_stream_byte(&keys)) == entry->check_byte;
+}
+
+// 从第first个条目开始做级联校验
+bool zip_crypto_check_cascade(const zip_crypto_ctx_t *ctx, const char *password, size_t len,
+                              uint32_t first) {
+    if (!ctx || ctx->entry_count == 0) {
+        return false;
+    }
+
+    zip_crypto_keys_t keys = {0x12345678, 0x23456789, 0x34567890};
+    for (size_t i = 0; i < len; i++) {
+        zc_update_keys(&keys, (uint8_t)password[i]);
+    }
+
+    for (uint32_t i = first; i < ctx->cascade_count; i++) {
+        if (!check_entry(&ctx->entries[i], &keys)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 检查密码：运行密钥调度，依次比较级联中每个条目的校验字节
+bool zip_crypto_check_password(const zip_crypto_ctx_t *ctx, const char *password, size_t len) {
+    return zip_crypto_check_cascade(ctx, password, len, 0);
+}
+
+// 释放ZipCrypto上下文
+void zip_crypto_free(zip_crypto_ctx_t *ctx) {
+    if (!ctx) return;
+
+    for (uint32_t i = 0; i < ctx->entry_count; i++) {
+        free(ctx->entries[i].filename);
+    }
+    free(ctx->entries);
+    free(ctx);
+}
+
+// 从内存映像复制一段数据，keys非空时顺带解密
+static bool copy_range(const archive_image_t *image, FILE *out, uint64_t offset, uint64_t len,
+                       zip_crypto_keys_t *keys) {
+    uint8_t buffer[8192];
+
+    if (offset > image->size || len > image->size - offset) {
+        return false;
+    }
+    while (len > 0) {
+        size_t want = len < sizeof(buffer) ? (size_t)len : sizeof(buffer);
+        memcpy(buffer, image->data + offset, want);
+        if (keys) {
+            zip_crypto_decrypt(keys, buffer, want);
+        }
+        if (fwrite(buffer, 1, want, out) != want) {
+            return false;
+        }
+        offset += want;
+        len -= want;
+    }
+    return true;
+}
+
+// 用内部密钥解密所有ZipCrypto条目，写出一个不加密的ZIP（其他条目原样复制，自解压前缀去掉）
+bool zip_crypto_decrypt_archive(const archive_info_t *info, const zip_crypto_keys_t *keys,
+                                const char *output_filename) {
+    if (!info || !info->image || info->type != ARCHIVE_ZIP || !keys || !output_filename) return false;
+
+    init_zc_crc_table();
+
+    const archive_image_t *image = info->image;
+    uint8_t *cd = NULL;
+    size_t cd_size = 0;
+    FILE *out = fopen(output_filename, "wb");
+    if (!out) return false;
+
+    bool ok = true;
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < info->file_count && ok; i++) {
+        const file_entry_t *entry = &info->entries[i];
+        const uint8_t *rec = image->data + entry->central_offset;
+        if (entry->central_offset + ZIP_CENTRAL_HEADER_SIZE > image->size ||
+            entry->local_header_offset + ZIP_LOCAL_HEADER_SIZE > image->size ||
+            entry->data_offset == 0) {
+            ok = false;
+            break;
+        }
+        size_t record_size = ZIP_CENTRAL_HEADER_SIZE + read_le16(rec + 28) +
+                             read_le16(rec + 30) + read_le16(rec + 32);
+
+        // 输出的是普通ZIP，超过4GB的条目需要改写ZIP64扩展字段，这里不处理
+        off_t new_offset = ftello(out);
+        if (entry->compressed_size >= 0xFFFFFFFF || entry->uncompressed_size >= 0xFFFFFFFF ||
+            new_offset < 0 || (uint64_t)new_offset >= 0xFFFFFFFF ||
+            entry->central_offset + record_size > image->size) {
+            print_error("[!] 条目 %s 超出普通ZIP的大小限制，无法用密钥解密", entry->filename);
+            ok = false;
+            break;
+        }
+
+        uint8_t *grown = realloc(cd, cd_size + record_size);
+        if (!grown) {
+            ok = false;
+            break;
+        }
+        cd = grown;
+        uint8_t *copy = cd + cd_size;
+        memcpy(copy, rec, record_size);
+
+        uint8_t local[ZIP_LOCAL_HEADER_SIZE];
+        memcpy(local, image->data + entry->local_header_offset, sizeof(local));
+        uint64_t local_tail = entry->data_offset - entry->local_header_offset - ZIP_LOCAL_HEADER_SIZE;
+        uint32_t compressed_size = (uint32_t)entry->compressed_size;
+
+        if (entry->encryption_method == ZIP_EM_TRAD_PKWARE && compressed_size >= 12) {
+            // 去掉加密标志和数据描述符，大小和CRC直接写入本地头
+            uint16_t new_flags = entry->flags & (uint16_t)~(ZIP_FLAG_ENCRYPTED | ZIP_FLAG_DATA_DESCRIPTOR);
+            write_le16(local + 6, new_flags);
+            write_le32(local + 14, entry->crc32);
+            write_le32(local + 18, compressed_size - 12);
+            write_le32(local + 22, (uint32_t)entry->uncompressed_size);
+            write_le16(copy + 8, new_flags);
+            write_le32(copy + 20, compressed_size - 12);
+
+            zip_crypto_keys_t k = *keys;
+            uint8_t header[12];
+            ok = fwrite(local, 1, sizeof(local), out) == sizeof(local) &&
+                 copy_range(image, out, entry->local_header_offset + ZIP_LOCAL_HEADER_SIZE, local_tail, NULL) &&
+                 entry->data_offset + sizeof(header) <= image->size;
+            if (ok) {
+                memcpy(header, image->data + entry->data_offset, sizeof(header));
+                zip_crypto_decrypt(&k, header, sizeof(header));
+                ok = copy_range(image, out, entry->data_offset + 12, compressed_size - 12, &k);
+            }
+        } else {
+            // 原样复制，包括可能存在的数据描述符
+            uint64_t length = ZIP_LOCAL_HEADER_SIZE + local_tail + (uint64_t)compressed_size;
+            if (entry->flags & ZIP_FLAG_DATA_DESCRIPTOR) {
+                uint64_t descriptor = entry->data_offset + compressed_size;
+                length += 12;
+                if (descriptor + 4 <= image->size && read_le32(image->data + descriptor) == ZIP_DESCRIPTOR_SIG) {
+                    length += 4;
+                }
+            }
+            ok = copy_range(image, out, entry->local_header_offset, length, NULL);
+        }
+
+        write_le32(copy + 42, (uint32_t)new_offset);
+        cd_size += record_size;
+        written++;
+    }
+
+    // 写出修改后的中央目录和结束记录
+    off_t cd_offset = ftello(out);
+    if (ok && written <= 0xFFFF && cd_offset >= 0 && (uint64_t)cd_offset < 0xFFFFFFFF &&
+        fwrite(cd, 1, cd_size, out) == cd_size) {
+        uint8_t eocd[ZIP_EOCD_SIZE];
+        memset(eocd, 0, sizeof(eocd));
+        write_le32(eocd, ZIP_EOCD_SIG);
+        write_le16(eocd + 8, (uint16_t)written);
+        write_le16(eocd + 10, (uint16_t)written);
+        write_le32(eocd + 12, (uint32_t)cd_size);
+        write_le32(eocd + 16, (uint32_t)cd_offset);
+        ok = fwrite(eocd, 1, sizeof(eocd), out) == sizeof(eocd);
+    } else {
+        ok = false;
+    }
+
+    ok = fclose(out) == 0 && ok;
+    free(cd);
+    return ok;
+}
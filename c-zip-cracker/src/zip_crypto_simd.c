@@ -0,0 +1,322 @@
+#include "../include/zip_cracker.h"
+#include <immintrin.h>
+
+// SIMD内核支持的最大密码长度，更长的密码走标量路径
+#define ZC_SIMD_MAX_LEN 64
+
+// ZipCrypto密钥调度常量
+#define ZC_KEY0_INIT 0x12345678
+#define ZC_KEY1_INIT 0x23456789
+#define ZC_KEY2_INIT 0x34567890
+#define ZC_KEY1_MUL  134775813
+
+// 基准测试使用的密码数量
+#define ZC_BENCH_PASSWORDS (4 * 1024 * 1024)
+
+// 获取内核名称
+const char* zip_crypto_kernel_name(zip_crypto_kernel_t kernel) {
+    switch (kernel) {
+        case ZC_KERNEL_AVX512:
+            return "AVX-512 (16路)";
+        case ZC_KERNEL_AVX2:
+            return "AVX2 (8路)";
+        default:
+            return "标量";
+    }
+}
+
+// 检查CPU是否支持指定内核
+static bool kernel_supported(zip_crypto_kernel_t kernel) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    switch (kernel) {
+        case ZC_KERNEL_AVX512:
+            return __builtin_cpu_supports("avx512f");
+        case ZC_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+        default:
+            return true;
+    }
+#else
+    return kernel == ZC_KERNEL_SCALAR;
+#endif
+}
+
+// 选择当前CPU支持的最快内核
+zip_crypto_kernel_t zip_crypto_select_kernel(void) {
+    if (kernel_supported(ZC_KERNEL_AVX512)) {
+        return ZC_KERNEL_AVX512;
+    }
+    if (kernel_supported(ZC_KERNEL_AVX2)) {
+        return ZC_KERNEL_AVX2;
+    }
+    return ZC_KERNEL_SCALAR;
+}
+
+// 把一组密码转置为按字节位置排列的32位通道数据
+static int transpose_lanes(uint32_t *chars, int lanes, const char *const *passwords,
+                           const size_t *lens, int count, int32_t *lane_lens) {
+    int max_len = 0;
+    for (int lane = 0; lane < lanes; lane++) {
+        int len = lane < count ? (int)lens[lane] : 0;
+        lane_lens[lane] = len;
+        if (len > max_len) max_len = len;
+    }
+
+    for (int pos = 0; pos < max_len; pos++) {
+        for (int lane = 0; lane < lanes; lane++) {
+            chars[pos * lanes + lane] = pos < lane_lens[lane] ?
+                                        (uint8_t)passwords[lane][pos] : 0;
+        }
+    }
+
+    return max_len;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// AVX2：同时推进8个密码的密钥调度
+__attribute__((target("avx2")))
+static void check_lanes_avx2(const uint32_t *table, const zip_crypto_entry_t *entry,
+                             const char *const *passwords, const size_t *lens,
+                             int count, bool *results) {
+    uint32_t chars[ZC_SIMD_MAX_LEN * 8];
+    int32_t lane_lens[8];
+    int max_len = transpose_lanes(chars, 8, passwords, lens, count, lane_lens);
+
+    const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+    const __m256i mul = _mm256_set1_epi32(ZC_KEY1_MUL);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i two = _mm256_set1_epi32(2);
+    const __m256i word_mask = _mm256_set1_epi32(0xFFFF);
+    const int *tbl = (const int*)table;
+
+    __m256i key0 = _mm256_set1_epi32(ZC_KEY0_INIT);
+    __m256i key1 = _mm256_set1_epi32(ZC_KEY1_INIT);
+    __m256i key2 = _mm256_set1_epi32(ZC_KEY2_INIT);
+    __m256i len_vec = _mm256_loadu_si256((const __m256i*)lane_lens);
+
+    // 密码阶段：长度不同的通道用掩码保持原密钥
+    for (int pos = 0; pos < max_len; pos++) {
+        __m256i active = _mm256_cmpgt_epi32(len_vec, _mm256_set1_epi32(pos));
+        __m256i c = _mm256_loadu_si256((const __m256i*)&chars[pos * 8]);
+
+        __m256i idx = _mm256_and_si256(_mm256_xor_si256(key0, c), byte_mask);
+        __m256i k0 = _mm256_xor_si256(_mm256_i32gather_epi32(tbl, idx, 4),
+                                      _mm256_srli_epi32(key0, 8));
+        __m256i k1 = _mm256_add_epi32(_mm256_mullo_epi32(
+                         _mm256_add_epi32(key1, _mm256_and_si256(k0, byte_mask)), mul), one);
+        idx = _mm256_and_si256(_mm256_xor_si256(key2, _mm256_srli_epi32(k1, 24)), byte_mask);
+        __m256i k2 = _mm256_xor_si256(_mm256_i32gather_epi32(tbl, idx, 4),
+                                      _mm256_srli_epi32(key2, 8));
+
+        key0 = _mm256_blendv_epi8(key0, k0, active);
+        key1 = _mm256_blendv_epi8(key1, k1, active);
+        key2 = _mm256_blendv_epi8(key2, k2, active);
+    }
+
+    // 加密头阶段：所有通道解密同一个12字节头
+    __m256i stream = _mm256_setzero_si256();
+    for (int i = 0; i < 12; i++) {
+        __m256i temp = _mm256_and_si256(_mm256_or_si256(key2, two), word_mask);
+        stream = _mm256_and_si256(_mm256_srli_epi32(
+                     _mm256_mullo_epi32(temp, _mm256_xor_si256(temp, one)), 8), byte_mask);
+        if (i == 11) break;
+
+        __m256i c = _mm256_xor_si256(_mm256_set1_epi32(entry->header[i]), stream);
+        __m256i idx = _mm256_and_si256(_mm256_xor_si256(key0, c), byte_mask);
+        key0 = _mm256_xor_si256(_mm256_i32gather_epi32(tbl, idx, 4), _mm256_srli_epi32(key0, 8));
+        key1 = _mm256_add_epi32(_mm256_mullo_epi32(
+                   _mm256_add_epi32(key1, _mm256_and_si256(key0, byte_mask)), mul), one);
+        idx = _mm256_and_si256(_mm256_xor_si256(key2, _mm256_srli_epi32(key1, 24)), byte_mask);
+        key2 = _mm256_xor_si256(_mm256_i32gather_epi32(tbl, idx, 4), _mm256_srli_epi32(key2, 8));
+    }
+
+    __m256i plain = _mm256_xor_si256(_mm256_set1_epi32(entry->header[11]), stream);
+    __m256i match = _mm256_cmpeq_epi32(plain, _mm256_set1_epi32(entry->check_byte));
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(match));
+
+    for (int lane = 0; lane < count; lane++) {
+        results[lane] = (mask >> lane) & 1;
+    }
+}
+
+// AVX-512：同时推进16个密码的密钥调度
+__attribute__((target("avx512f")))
+static void check_lanes_avx512(const uint32_t *table, const zip_crypto_entry_t *entry,
+                               const char *const *passwords, const size_t *lens,
+                               int count, bool *results) {
+    uint32_t chars[ZC_SIMD_MAX_LEN * 16];
+    int32_t lane_lens[16];
+    int max_len = transpose_lanes(chars, 16, passwords, lens, count, lane_lens);
+
+    const __m512i byte_mask = _mm512_set1_epi32(0xFF);
+    const __m512i mul = _mm512_set1_epi32(ZC_KEY1_MUL);
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512i two = _mm512_set1_epi32(2);
+    const __m512i word_mask = _mm512_set1_epi32(0xFFFF);
+
+    __m512i key0 = _mm512_set1_epi32(ZC_KEY0_INIT);
+    __m512i key1 = _mm512_set1_epi32(ZC_KEY1_INIT);
+    __m512i key2 = _mm512_set1_epi32(ZC_KEY2_INIT);
+    __m512i len_vec = _mm512_loadu_si512((const void*)lane_lens);
+
+    // 密码阶段：长度不同的通道用掩码保持原密钥
+    for (int pos = 0; pos < max_len; pos++) {
+        __mmask16 active = _mm512_cmpgt_epi32_mask(len_vec, _mm512_set1_epi32(pos));
+        __m512i c = _mm512_loadu_si512((const void*)&chars[pos * 16]);
+
+        __m512i idx = _mm512_and_si512(_mm512_xor_si512(key0, c), byte_mask);
+        key0 = _mm512_mask_xor_epi32(key0, active, _mm512_i32gather_epi32(idx, table, 4),
+                                     _mm512_srli_epi32(key0, 8));
+        key1 = _mm512_mask_add_epi32(key1, active, _mm512_mullo_epi32(
+                   _mm512_add_epi32(key1, _mm512_and_si512(key0, byte_mask)), mul), one);
+        idx = _mm512_and_si512(_mm512_xor_si512(key2, _mm512_srli_epi32(key1, 24)), byte_mask);
+        key2 = _mm512_mask_xor_epi32(key2, active, _mm512_i32gather_epi32(idx, table, 4),
+                                     _mm512_srli_epi32(key2, 8));
+    }
+
+    // 加密头阶段：所有通道解密同一个12字节头
+    __m512i stream = _mm512_setzero_si512();
+    for (int i = 0; i < 12; i++) {
+        __m512i temp = _mm512_and_si512(_mm512_or_si512(key2, two), word_mask);
+        stream = _mm512_and_si512(_mm512_srli_epi32(
+                     _mm512_mullo_epi32(temp, _mm512_xor_si512(temp, one)), 8), byte_mask);
+        if (i == 11) break;
+
+        __m512i c = _mm512_xor_si512(_mm512_set1_epi32(entry->header[i]), stream);
+        __m512i idx = _mm512_and_si512(_mm512_xor_si512(key0, c), byte_mask);
+        key0 = _mm512_xor_si512(_mm512_i32gather_epi32(idx, table, 4), _mm512_srli_epi32(key0, 8));
+        key1 = _mm512_add_epi32(_mm512_mullo_epi32(
+                   _mm512_add_epi32(key1, _mm512_and_si512(key0, byte_mask)), mul), one);
+        idx = _mm512_and_si512(_mm512_xor_si512(key2, _mm512_srli_epi32(key1, 24)), byte_mask);
+        key2 = _mm512_xor_si512(_mm512_i32gather_epi32(idx, table, 4), _mm512_srli_epi32(key2, 8));
+    }
+
+    __m512i plain = _mm512_xor_si512(_mm512_set1_epi32(entry->header[11]), stream);
+    __mmask16 mask = _mm512_cmpeq_epi32_mask(plain, _mm512_set1_epi32(entry->check_byte));
+
+    for (int lane = 0; lane < count; lane++) {
+        results[lane] = (mask >> lane) & 1;
+    }
+}
+
+#endif
+
+// 统计通过校验的数量
+static int count_passed(const bool *results, int count) {
+    int passed = 0;
+    for (int i = 0; i < count; i++) {
+        if (results[i]) passed++;
+    }
+    return passed;
+}
+
+// 使用指定内核批量校验密码
+static int check_batch_with_kernel(const zip_crypto_ctx_t *ctx, zip_crypto_kernel_t kernel,
+                                   const char *const *passwords, const size_t *lens,
+                                   int count, bool *results) {
+    const zip_crypto_entry_t *entry = &ctx->entries[0];
+    int lanes = kernel == ZC_KERNEL_AVX512 ? 16 : kernel == ZC_KERNEL_AVX2 ? 8 : 1;
+    int passed = 0;
+    int i = 0;
+
+    while (i < count) {
+        int n = count - i < lanes ? count - i : lanes;
+
+        // 超长密码或标量内核逐个校验
+        bool vectorizable = lanes > 1;
+        for (int j = 0; j < n && vectorizable; j++) {
+            if (lens[i + j] > ZC_SIMD_MAX_LEN) vectorizable = false;
+        }
+
+        if (!vectorizable) {
+            for (int j = 0; j < n; j++) {
+                results[i + j] = zip_crypto_check_cascade(ctx, passwords[i + j], lens[i + j], 0);
+            }
+        } else {
+#if defined(__x86_64__) || defined(__i386__)
+            if (kernel == ZC_KERNEL_AVX512) {
+                check_lanes_avx512(zip_crypto_get_crc_table(), entry, passwords + i, lens + i,
+                                   n, results + i);
+            } else {
+                check_lanes_avx2(zip_crypto_get_crc_table(), entry, passwords + i, lens + i,
+                                 n, results + i);
+            }
+#endif
+
+            // 通过第一个条目的候选再用后续条目的独立校验字节筛选
+            for (int j = 0; j < n; j++) {
+                if (results[i + j] && ctx->cascade_count > 1) {
+                    results[i + j] = zip_crypto_check_cascade(ctx, passwords[i + j], lens[i + j], 1);
+                }
+            }
+        }
+
+        passed += count_passed(results + i, n);
+        i += n;
+    }
+
+    return passed;
+}
+
+// 批量校验密码，返回通过校验字节的数量
+int zip_crypto_check_batch(const zip_crypto_ctx_t *ctx, const char *const *passwords,
+                           const size_t *lens, int count, bool *results) {
+    if (!ctx || ctx->entry_count == 0 || !passwords || !lens || !results || count <= 0) {
+        return 0;
+    }
+
+    return check_batch_with_kernel(ctx, ctx->kernel, passwords, lens, count, results);
+}
+
+// 测量每种内核的校验吞吐量
+void zip_crypto_benchmark(void) {
+    zip_crypto_entry_t entry;
+    memset(&entry, 0, sizeof(entry));
+    for (int i = 0; i < 12; i++) {
+        entry.header[i] = (uint8_t)(i * 37 + 11);
+    }
+    entry.check_byte = 0x5A;
+
+    zip_crypto_ctx_t ctx = {0};
+    ctx.entries = &entry;
+    ctx.entry_count = 1;
+    ctx.cascade_count = 1;
+
+    // 生成8位数字密码作为测试输入
+    const int batch = ZIP_CRYPTO_BATCH_SIZE;
+    char storage[ZIP_CRYPTO_BATCH_SIZE][16];
+    const char *passwords[ZIP_CRYPTO_BATCH_SIZE];
+    size_t lens[ZIP_CRYPTO_BATCH_SIZE];
+    bool results[ZIP_CRYPTO_BATCH_SIZE];
+
+    for (int i = 0; i < batch; i++) {
+        snprintf(storage[i], sizeof(storage[i]), "%08d", i * 7919);
+        passwords[i] = storage[i];
+        lens[i] = 8;
+    }
+
+    print_info("ZipCrypto校验吞吐量 (单线程, 8字符密码):");
+
+    zip_crypto_kernel_t kernels[] = {ZC_KERNEL_SCALAR, ZC_KERNEL_AVX2, ZC_KERNEL_AVX512};
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        if (!kernel_supported(kernels[k])) {
+            printf("  %-16s 不支持\n", zip_crypto_kernel_name(kernels[k]));
+            continue;
+        }
+
+        struct timespec start, end;
+        uint64_t passed = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        for (int round = 0; round < ZC_BENCH_PASSWORDS / batch; round++) {
+            passed += check_batch_with_kernel(&ctx, kernels[k], passwords, lens, batch, results);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("  %-16s %8.2f M p/s (通过校验: %lu)\n", zip_crypto_kernel_name(kernels[k]),
+               ZC_BENCH_PASSWORDS / elapsed / 1e6, (unsigned long)passed);
+    }
+}
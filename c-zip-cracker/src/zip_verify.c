@@ -0,0 +1,416 @@
+#include "../include/zip_cracker.h"
+#include <zlib.h>
+#include <bzlib.h>
+#include <lzma.h>
+#include <openssl/evp.h>
+
+// ZIP压缩方法
+#define ZIP_METHOD_STORE     0
+#define ZIP_METHOD_DEFLATE   8
+#define ZIP_METHOD_DEFLATE64 9
+#define ZIP_METHOD_BZIP2     12
+#define ZIP_METHOD_LZMA      14
+
+// 流式验证的缓冲区大小（全部在栈上）
+#define VERIFY_IN_CHUNK  4096
+#define VERIFY_OUT_CHUNK 16384
+
+// ZIP中LZMA数据前的头：2字节版本 + 2字节属性长度 + 5字节属性
+#define ZIP_LZMA_HEADER_SIZE 9
+#define LZMA_MIN_DICT_SIZE   4096
+
+// WinZip AES认证码长度
+#define ZIP_AES_AUTH_SIZE 10
+#define SHA1_BLOCK_SIZE   64
+#define SHA1_DIGEST_SIZE  20
+
+// 解压器状态
+typedef struct {
+    uint16_t method;
+    uint64_t expected_size;
+    uint64_t out_size;
+    uint32_t crc;
+    bool started;
+    bool finished;
+    z_stream zs;
+    bz_stream bz;
+    lzma_stream lz;
+    uint8_t lzma_header[ZIP_LZMA_HEADER_SIZE];
+    size_t lzma_header_len;
+} entry_decoder_t;
+
+// 累计输出的CRC和大小，超出声明大小立即失败
+static bool decoder_emit(entry_decoder_t *dec, const uint8_t *data, size_t len) {
+    dec->out_size += len;
+    if (dec->out_size > dec->expected_size) {
+        return false;
+    }
+    dec->crc = (uint32_t)crc32(dec->crc, data, (uInt)len);
+    return true;
+}
+
+// 根据第一块明文做廉价的格式检查并初始化解压器
+static bool decoder_start(entry_decoder_t *dec, const uint8_t *data, size_t len) {
+    switch (dec->method) {
+        case ZIP_METHOD_DEFLATE:
+            // 第一个deflate块的类型为3是非法的
+            if (len > 0 && ((data[0] >> 1) & 3) == 3) {
+                return false;
+            }
+            memset(&dec->zs, 0, sizeof(dec->zs));
+            return inflateInit2(&dec->zs, -MAX_WBITS) == Z_OK;
+
+        case ZIP_METHOD_BZIP2:
+            // bzip2流必须以 "BZh1".."BZh9" 开头
+            if (len >= 4 && (data[0] != 'B' || data[1] != 'Z' || data[2] != 'h' ||
+                             data[3] < '1' || data[3] > '9')) {
+                return false;
+            }
+            memset(&dec->bz, 0, sizeof(dec->bz));
+            return BZ2_bzDecompressInit(&dec->bz, 0, 1) == BZ_OK;
+
+        case ZIP_METHOD_LZMA:
+            // 属性在第一块数据中解析，这里只清空状态
+            dec->lzma_header_len = 0;
+            return true;
+
+        default:
+            return dec->method == ZIP_METHOD_STORE;
+    }
+}
+
+// 解析ZIP LZMA头并初始化原始LZMA1解码器
+static bool start_lzma(entry_decoder_t *dec) {
+    const uint8_t *h = dec->lzma_header;
+    uint16_t props_size = (uint16_t)(h[2] | (h[3] << 8));
+    if (props_size != 5) {
+        return false;
+    }
+
+    lzma_filter filters[2];
+    filters[0].id = LZMA_FILTER_LZMA1;
+    filters[0].options = NULL;
+    filters[1].id = LZMA_VLI_UNKNOWN;
+    if (lzma_properties_decode(&filters[0], NULL, h + 4, 5) != LZMA_OK) {
+        return false;
+    }
+
+    // 错误密码会解出任意字典大小，按条目大小限制以免分配巨量内存
+    lzma_options_lzma *opts = (lzma_options_lzma*)filters[0].options;
+    uint64_t dict_limit = dec->expected_size < LZMA_MIN_DICT_SIZE ? LZMA_MIN_DICT_SIZE : dec->expected_size;
+    if (opts->dict_size > dict_limit) {
+        opts->dict_size = (uint32_t)dict_limit;
+    }
+
+#ifdef LZMA_FILTER_LZMA1EXT
+    // 告诉解码器解压后大小，使无结束标记的流也能正确结束
+    filters[0].id = LZMA_FILTER_LZMA1EXT;
+    opts->ext_flags = LZMA_LZMA1EXT_ALLOW_EOPM;
+    opts->ext_size_low = (uint32_t)dec->expected_size;
+    opts->ext_size_high = (uint32_t)(dec->expected_size >> 32);
+#endif
+
+    lzma_stream init = LZMA_STREAM_INIT;
+    dec->lz = init;
+    lzma_ret ret = lzma_raw_decoder(&dec->lz, filters);
+    free(filters[0].options);
+    return ret == LZMA_OK;
+}
+
+// 向解压器输入一块明文，返回false表示数据无效
+static bool decoder_feed(entry_decoder_t *dec, const uint8_t *data, size_t len) {
+    uint8_t out[VERIFY_OUT_CHUNK];
+
+    if (!dec->started) {
+        if (!decoder_start(dec, data, len)) {
+            return false;
+        }
+        dec->started = true;
+    }
+
+    switch (dec->method) {
+        case ZIP_METHOD_STORE:
+            return decoder_emit(dec, data, len);
+
+        case ZIP_METHOD_DEFLATE: {
+            dec->zs.next_in = (Bytef*)data;
+            dec->zs.avail_in = (uInt)len;
+            // 输入耗尽但输出缓冲区写满时可能还有待输出数据
+            do {
+                dec->zs.next_out = out;
+                dec->zs.avail_out = sizeof(out);
+                int ret = inflate(&dec->zs, Z_NO_FLUSH);
+                if (ret != Z_OK && ret != Z_STREAM_END) {
+                    return false;
+                }
+                if (!decoder_emit(dec, out, sizeof(out) - dec->zs.avail_out)) {
+                    return false;
+                }
+                if (ret == Z_STREAM_END) {
+                    dec->finished = true;
+                }
+            } while (!dec->finished && (dec->zs.avail_in > 0 || dec->zs.avail_out == 0));
+            return true;
+        }
+
+        case ZIP_METHOD_BZIP2: {
+            dec->bz.next_in = (char*)data;
+            dec->bz.avail_in = (unsigned int)len;
+            // 输入耗尽但输出缓冲区写满时可能还有待输出数据
+            do {
+                dec->bz.next_out = (char*)out;
+                dec->bz.avail_out = sizeof(out);
+                int ret = BZ2_bzDecompress(&dec->bz);
+                if (ret != BZ_OK && ret != BZ_STREAM_END) {
+                    return false;
+                }
+                if (!decoder_emit(dec, out, sizeof(out) - dec->bz.avail_out)) {
+                    return false;
+                }
+                if (ret == BZ_STREAM_END) {
+                    dec->finished = true;
+                }
+            } while (!dec->finished && (dec->bz.avail_in > 0 || dec->bz.avail_out == 0));
+            return true;
+        }
+
+        case ZIP_METHOD_LZMA: {
+            // 先凑齐9字节LZMA头
+            if (dec->lzma_header_len < ZIP_LZMA_HEADER_SIZE) {
+                size_t need = ZIP_LZMA_HEADER_SIZE - dec->lzma_header_len;
+                size_t take = len < need ? len : need;
+                memcpy(dec->lzma_header + dec->lzma_header_len, data, take);
+                dec->lzma_header_len += take;
+                data += take;
+                len -= take;
+                if (dec->lzma_header_len < ZIP_LZMA_HEADER_SIZE) {
+                    return true;
+                }
+                if (!start_lzma(dec)) {
+                    dec->lzma_header_len = 0;
+                    return false;
+                }
+            }
+
+            dec->lz.next_in = data;
+            dec->lz.avail_in = len;
+            // 输入耗尽但输出缓冲区写满时可能还有待输出数据
+            do {
+                dec->lz.next_out = out;
+                dec->lz.avail_out = sizeof(out);
+                lzma_ret ret = lzma_code(&dec->lz, LZMA_RUN);
+                if (ret != LZMA_OK && ret != LZMA_STREAM_END) {
+                    return false;
+                }
+                if (!decoder_emit(dec, out, sizeof(out) - dec->lz.avail_out)) {
+                    return false;
+                }
+                if (ret == LZMA_STREAM_END) {
+                    dec->finished = true;
+                }
+            } while (!dec->finished && (dec->lz.avail_in > 0 || dec->lz.avail_out == 0));
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+// 冲刷解压器剩余输出（LZMA无结束标记时需要）
+static bool decoder_finish(entry_decoder_t *dec) {
+    if (dec->method == ZIP_METHOD_LZMA && dec->started &&
+        dec->lzma_header_len == ZIP_LZMA_HEADER_SIZE && !dec->finished) {
+        uint8_t out[VERIFY_OUT_CHUNK];
+        while (dec->out_size < dec->expected_size) {
+            dec->lz.next_in = NULL;
+            dec->lz.avail_in = 0;
+            dec->lz.next_out = out;
+            dec->lz.avail_out = sizeof(out);
+            lzma_ret ret = lzma_code(&dec->lz, LZMA_FINISH);
+            size_t produced = sizeof(out) - dec->lz.avail_out;
+            if (!decoder_emit(dec, out, produced)) {
+                return false;
+            }
+            if (ret == LZMA_STREAM_END || produced == 0) {
+                break;
+            }
+            if (ret != LZMA_OK) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// 释放解压器
+static void decoder_end(entry_decoder_t *dec) {
+    if (!dec->started) return;
+
+    switch (dec->method) {
+        case ZIP_METHOD_DEFLATE:
+            inflateEnd(&dec->zs);
+            break;
+        case ZIP_METHOD_BZIP2:
+            BZ2_bzDecompressEnd(&dec->bz);
+            break;
+        case ZIP_METHOD_LZMA:
+            if (dec->lzma_header_len == ZIP_LZMA_HEADER_SIZE) {
+                lzma_end(&dec->lz);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// 检查压缩方法是否能原生验证
+static bool method_supported(uint16_t method) {
+    return method == ZIP_METHOD_STORE || method == ZIP_METHOD_DEFLATE ||
+           method == ZIP_METHOD_BZIP2 || method == ZIP_METHOD_LZMA;
+}
+
+// 流式解密+解压一个ZipCrypto条目，遇到无效数据立即中止，最后比较CRC32
+static zip_verify_result_t verify_crypto_entry(const archive_image_t *image, const zip_crypto_entry_t *entry,
+                                               const char *password, size_t len) {
+    if (!method_supported(entry->compression_method)) {
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+
+    uint64_t remaining = entry->compressed_size - sizeof(entry->header);
+    if (entry->compression_method == ZIP_METHOD_STORE && remaining != entry->uncompressed_size) {
+        return ZIP_VERIFY_FAIL;
+    }
+
+    zip_crypto_keys_t keys;
+    uint8_t header[sizeof(entry->header)];
+    zip_crypto_init_keys(&keys, password, len);
+    memcpy(header, entry->header, sizeof(header));
+    zip_crypto_decrypt(&keys, header, sizeof(header));
+
+    entry_decoder_t dec;
+    memset(&dec, 0, sizeof(dec));
+    dec.method = entry->compression_method;
+    dec.expected_size = entry->uncompressed_size;
+
+    uint8_t chunk[VERIFY_IN_CHUNK];
+    uint64_t offset = entry->data_offset + sizeof(entry->header);
+    if (offset > image->size || remaining > image->size - offset) {
+        decoder_end(&dec);
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+    bool ok = true;
+
+    while (remaining > 0 && ok && !dec.finished) {
+        size_t want = remaining < sizeof(chunk) ? (size_t)remaining : sizeof(chunk);
+        memcpy(chunk, image->data + offset, want);
+        zip_crypto_decrypt(&keys, chunk, want);
+        ok = decoder_feed(&dec, chunk, want);
+        offset += want;
+        remaining -= want;
+    }
+
+    if (ok) {
+        ok = decoder_finish(&dec);
+    }
+    decoder_end(&dec);
+
+    if (!ok || dec.out_size != entry->uncompressed_size || dec.crc != entry->crc32) {
+        return ZIP_VERIFY_FAIL;
+    }
+    return ZIP_VERIFY_OK;
+}
+
+// 第二阶段验证：对通过校验字节的密码做完整解密、解压和CRC32比较
+zip_verify_result_t zip_crypto_verify_password(const zip_crypto_ctx_t *ctx,
+                                               const char *password, size_t len) {
+    if (!ctx || ctx->entry_count == 0 || !ctx->image || !password) {
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+
+    // 使用级联中第一个可原生验证的条目（代价模型已把最便宜的排在前面）
+    for (uint32_t i = 0; i < ctx->cascade_count; i++) {
+        if (method_supported(ctx->entries[i].compression_method)) {
+            return verify_crypto_entry(ctx->image, &ctx->entries[i], password, len);
+        }
+    }
+    return ZIP_VERIFY_UNSUPPORTED;
+}
+
+// 计算 SHA1(pad || data) 的外层HMAC
+static bool hmac_sha1_final(EVP_MD_CTX *outer, const uint8_t *key, size_t key_len,
+                            const uint8_t inner_digest[SHA1_DIGEST_SIZE], uint8_t out[SHA1_DIGEST_SIZE]) {
+    uint8_t pad[SHA1_BLOCK_SIZE];
+    memset(pad, 0x5C, sizeof(pad));
+    for (size_t i = 0; i < key_len; i++) {
+        pad[i] ^= key[i];
+    }
+
+    unsigned int out_len = 0;
+    return EVP_DigestInit_ex(outer, EVP_sha1(), NULL) == 1 &&
+           EVP_DigestUpdate(outer, pad, sizeof(pad)) == 1 &&
+           EVP_DigestUpdate(outer, inner_digest, SHA1_DIGEST_SIZE) == 1 &&
+           EVP_DigestFinal_ex(outer, out, &out_len) == 1;
+}
+
+// 第二阶段验证：派生完整密钥并比较AES条目末尾的HMAC-SHA1认证码
+zip_verify_result_t zip_aes_verify_password(const zip_aes_ctx_t *ctx,
+                                            const char *password, size_t len) {
+    if (!ctx || ctx->entry_count == 0 || !ctx->image || !password) {
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+
+    const zip_aes_entry_t *entry = &ctx->entries[0];
+    uint64_t overhead = (uint64_t)entry->salt_len + 2 + ZIP_AES_AUTH_SIZE;
+    if (entry->compressed_size < overhead) {
+        return ZIP_VERIFY_FAIL;
+    }
+    if (entry->data_offset > ctx->image->size || entry->compressed_size > ctx->image->size - entry->data_offset) {
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+
+    // 派生密钥：加密密钥 | 认证密钥 | 2字节校验值
+    uint8_t derived[32 * 2 + 2];
+    size_t derived_len = (size_t)entry->key_len * 2 + 2;
+    if (PKCS5_PBKDF2_HMAC_SHA1(password, (int)len, entry->salt, entry->salt_len, 1000,
+                               (int)derived_len, derived) != 1) {
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+    const uint8_t *auth_key = derived + entry->key_len;
+
+    EVP_MD_CTX *inner = EVP_MD_CTX_new();
+    EVP_MD_CTX *outer = EVP_MD_CTX_new();
+    if (!inner || !outer) {
+        EVP_MD_CTX_free(inner);
+        EVP_MD_CTX_free(outer);
+        return ZIP_VERIFY_UNSUPPORTED;
+    }
+
+    uint8_t pad[SHA1_BLOCK_SIZE];
+    memset(pad, 0x36, sizeof(pad));
+    for (int i = 0; i < entry->key_len; i++) {
+        pad[i] ^= auth_key[i];
+    }
+
+    zip_verify_result_t result = ZIP_VERIFY_UNSUPPORTED;
+    bool ok = EVP_DigestInit_ex(inner, EVP_sha1(), NULL) == 1 &&
+              EVP_DigestUpdate(inner, pad, sizeof(pad)) == 1;
+
+    // 认证码覆盖全部密文，直接在映像上计算
+    const uint8_t *cipher = ctx->image->data + entry->data_offset + entry->salt_len + 2;
+    size_t cipher_len = (size_t)(entry->compressed_size - overhead);
+    const uint8_t *stored_auth = cipher + cipher_len;
+    ok = ok && EVP_DigestUpdate(inner, cipher, cipher_len) == 1;
+
+    uint8_t inner_digest[SHA1_DIGEST_SIZE];
+    uint8_t mac[SHA1_DIGEST_SIZE];
+    unsigned int digest_len = 0;
+    if (ok && EVP_DigestFinal_ex(inner, inner_digest, &digest_len) == 1 &&
+        hmac_sha1_final(outer, auth_key, entry->key_len, inner_digest, mac)) {
+        result = memcmp(mac, stored_auth, ZIP_AES_AUTH_SIZE) == 0 ? ZIP_VERIFY_OK : ZIP_VERIFY_FAIL;
+    }
+
+    EVP_MD_CTX_free(inner);
+    EVP_MD_CTX_free(outer);
+    return result;
+}